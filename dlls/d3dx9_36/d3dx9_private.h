@@ -91,6 +91,9 @@ static inline BOOL is_conversion_to_supported(const struct pixel_format_desc *fo
     return !!format->from_rgba;
 }
 
+void d3dx_init_cpu_optimizations(void) DECLSPEC_HIDDEN;
+void d3dx_enable_cpu_optimizations(BOOL enable) DECLSPEC_HIDDEN;
+
 HRESULT map_view_of_file(const WCHAR *filename, void **buffer, DWORD *length) DECLSPEC_HIDDEN;
 HRESULT load_resource_into_memory(HMODULE module, HRSRC resinfo, void **buffer, DWORD *length) DECLSPEC_HIDDEN;
 
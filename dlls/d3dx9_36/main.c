@@ -36,6 +36,7 @@ BOOL WINAPI DllMain(HINSTANCE inst, DWORD reason, void *reserved)
         return FALSE; /* prefer native version */
     case DLL_PROCESS_ATTACH:
         DisableThreadLibraryCalls(inst);
+        d3dx_init_cpu_optimizations();
         break;
     }
     return TRUE;
@@ -48,6 +49,8 @@ BOOL WINAPI D3DXCheckVersion(UINT d3d_sdk_ver, UINT d3dx_sdk_ver)
 
 DWORD WINAPI D3DXCpuOptimizations(BOOL enable)
 {
-    FIXME("%#x - stub\n", enable);
+    TRACE("enable %#x.\n", enable);
+
+    d3dx_enable_cpu_optimizations(enable);
     return 0;
 }
@@ -27,6 +27,12 @@
 
 #include "d3dx9_private.h"
 
+#if defined(__x86_64__) || (defined(__i386__) && defined(__GNUC__) \
+        && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#include <xmmintrin.h>
+#define D3DX_HAVE_SSE_KERNELS
+#endif
+
 WINE_DEFAULT_DEBUG_CHANNEL(d3dx);
 
 struct ID3DXMatrixStackImpl
@@ -41,6 +47,141 @@ struct ID3DXMatrixStackImpl
 
 static const unsigned int INITIAL_STACK_SIZE = 32;
 
+/*_________________CPU optimizations_____________*/
+
+/* The SSE kernels below evaluate every output component with the same
+ * operations, in the same order, as the scalar code, so they produce the same
+ * results as long as the scalar code doesn't use extended precision (e.g. x87
+ * on i386). */
+#ifdef D3DX_HAVE_SSE_KERNELS
+
+#ifdef __i386__
+#define D3DX_SSE_FUNC __attribute__((target("sse")))
+#else
+#define D3DX_SSE_FUNC
+#endif
+
+static BOOL d3dx_have_sse, d3dx_use_sse;
+
+void d3dx_init_cpu_optimizations(void)
+{
+    d3dx_have_sse = IsProcessorFeaturePresent(PF_XMMI_INSTRUCTIONS_AVAILABLE);
+    d3dx_use_sse = d3dx_have_sse;
+    TRACE("Using SSE kernels: %#x.\n", d3dx_use_sse);
+}
+
+void d3dx_enable_cpu_optimizations(BOOL enable)
+{
+    d3dx_use_sse = enable && d3dx_have_sse;
+}
+
+static D3DX_SSE_FUNC void d3dx_matrix_multiply_sse(D3DXMATRIX *out,
+        const D3DXMATRIX *m1, const D3DXMATRIX *m2, BOOL transpose)
+{
+    __m128 r0, r1, r2, r3, o0, o1, o2, o3;
+
+    r0 = _mm_loadu_ps(m2->u.m[0]);
+    r1 = _mm_loadu_ps(m2->u.m[1]);
+    r2 = _mm_loadu_ps(m2->u.m[2]);
+    r3 = _mm_loadu_ps(m2->u.m[3]);
+
+#define D3DX_MULTIPLY_ROW(i) \
+        _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m1->u.m[i][0]), r0), \
+                _mm_mul_ps(_mm_set1_ps(m1->u.m[i][1]), r1)), \
+                _mm_mul_ps(_mm_set1_ps(m1->u.m[i][2]), r2)), \
+                _mm_mul_ps(_mm_set1_ps(m1->u.m[i][3]), r3))
+    o0 = D3DX_MULTIPLY_ROW(0);
+    o1 = D3DX_MULTIPLY_ROW(1);
+    o2 = D3DX_MULTIPLY_ROW(2);
+    o3 = D3DX_MULTIPLY_ROW(3);
+#undef D3DX_MULTIPLY_ROW
+
+    if (transpose)
+        _MM_TRANSPOSE4_PS(o0, o1, o2, o3);
+
+    _mm_storeu_ps(out->u.m[0], o0);
+    _mm_storeu_ps(out->u.m[1], o1);
+    _mm_storeu_ps(out->u.m[2], o2);
+    _mm_storeu_ps(out->u.m[3], o3);
+}
+
+/* Transforms "elements" vectors of "components" floats by "matrix". Missing
+ * components are treated as 0.0f, except for w which is treated as 1.0f. */
+static D3DX_SSE_FUNC void d3dx_transform_array_sse(void *out, UINT outstride, const void *in,
+        UINT instride, const D3DXMATRIX *matrix, UINT elements, unsigned int components)
+{
+    const char *src = in;
+    char *dst = out;
+    __m128 r0, r1, r2, r3, v;
+    const float *f;
+    UINT i;
+
+    r0 = _mm_loadu_ps(matrix->u.m[0]);
+    r1 = _mm_loadu_ps(matrix->u.m[1]);
+    r2 = _mm_loadu_ps(matrix->u.m[2]);
+    r3 = _mm_loadu_ps(matrix->u.m[3]);
+
+    for (i = 0; i < elements; ++i, src += instride, dst += outstride)
+    {
+        f = (const float *)src;
+        v = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(f[0]), r0), _mm_mul_ps(_mm_set1_ps(f[1]), r1));
+        switch (components)
+        {
+            case 2:
+                v = _mm_add_ps(v, r3);
+                break;
+            case 3:
+                v = _mm_add_ps(_mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(f[2]), r2)), r3);
+                break;
+            default:
+                v = _mm_add_ps(_mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(f[2]), r2)),
+                        _mm_mul_ps(_mm_set1_ps(f[3]), r3));
+                break;
+        }
+        _mm_storeu_ps((float *)dst, v);
+    }
+}
+
+static BOOL d3dx_matrix_multiply_simd(D3DXMATRIX *out, const D3DXMATRIX *m1, const D3DXMATRIX *m2, BOOL transpose)
+{
+    if (!d3dx_use_sse)
+        return FALSE;
+    d3dx_matrix_multiply_sse(out, m1, m2, transpose);
+    return TRUE;
+}
+
+static BOOL d3dx_transform_array_simd(void *out, UINT outstride, const void *in,
+        UINT instride, const D3DXMATRIX *matrix, UINT elements, unsigned int components)
+{
+    if (!d3dx_use_sse)
+        return FALSE;
+    d3dx_transform_array_sse(out, outstride, in, instride, matrix, elements, components);
+    return TRUE;
+}
+
+#else
+
+void d3dx_init_cpu_optimizations(void)
+{
+}
+
+void d3dx_enable_cpu_optimizations(BOOL enable)
+{
+}
+
+static BOOL d3dx_matrix_multiply_simd(D3DXMATRIX *out, const D3DXMATRIX *m1, const D3DXMATRIX *m2, BOOL transpose)
+{
+    return FALSE;
+}
+
+static BOOL d3dx_transform_array_simd(void *out, UINT outstride, const void *in,
+        UINT instride, const D3DXMATRIX *matrix, UINT elements, unsigned int components)
+{
+    return FALSE;
+}
+
+#endif
+
 /*_________________D3DXColor____________________*/
 
 D3DXCOLOR* WINAPI D3DXColorAdjustContrast(D3DXCOLOR *pout, const D3DXCOLOR *pc, FLOAT s)
@@ -397,6 +538,9 @@ D3DXMATRIX* WINAPI D3DXMatrixMultiply(D3DXMATRIX *pout, const D3DXMATRIX *pm1, c
 
     TRACE("pout %p, pm1 %p, pm2 %p\n", pout, pm1, pm2);
 
+    if (d3dx_matrix_multiply_simd(pout, pm1, pm2, FALSE))
+        return pout;
+
     for (i=0; i<4; i++)
     {
         for (j=0; j<4; j++)
@@ -416,6 +560,9 @@ D3DXMATRIX* WINAPI D3DXMatrixMultiplyTranspose(D3DXMATRIX *pout, const D3DXMATRI
 
     TRACE("pout %p, pm1 %p, pm2 %p\n", pout, pm1, pm2);
 
+    if (d3dx_matrix_multiply_simd(pout, pm1, pm2, TRUE))
+        return pout;
+
     for (i = 0; i < 4; i++)
         for (j = 0; j < 4; j++)
             temp.u.m[j][i] = pm1->u.m[i][0] * pm2->u.m[0][j] + pm1->u.m[i][1] * pm2->u.m[1][j] + pm1->u.m[i][2] * pm2->u.m[2][j] + pm1->u.m[i][3] * pm2->u.m[3][j];
@@ -1290,6 +1437,9 @@ D3DXPLANE* WINAPI D3DXPlaneTransformArray(D3DXPLANE* out, UINT outstride, const
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+    if (d3dx_transform_array_simd(out, outstride, in, instride, matrix, elements, 4))
+        return out;
+
     for (i = 0; i < elements; ++i) {
         D3DXPlaneTransform(
             (D3DXPLANE*)((char*)out + outstride * i),
@@ -1693,6 +1843,9 @@ D3DXVECTOR4* WINAPI D3DXVec2TransformArray(D3DXVECTOR4* out, UINT outstride, con
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+    if (d3dx_transform_array_simd(out, outstride, in, instride, matrix, elements, 2))
+        return out;
+
     for (i = 0; i < elements; ++i) {
         D3DXVec2Transform(
             (D3DXVECTOR4*)((char*)out + outstride * i),
@@ -1879,6 +2032,9 @@ D3DXVECTOR4* WINAPI D3DXVec3TransformArray(D3DXVECTOR4* out, UINT outstride, con
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+    if (d3dx_transform_array_simd(out, outstride, in, instride, matrix, elements, 3))
+        return out;
+
     for (i = 0; i < elements; ++i) {
         D3DXVec3Transform(
             (D3DXVECTOR4*)((char*)out + outstride * i),
@@ -2086,6 +2242,9 @@ D3DXVECTOR4* WINAPI D3DXVec4TransformArray(D3DXVECTOR4* out, UINT outstride, con
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+    if (d3dx_transform_array_simd(out, outstride, in, instride, matrix, elements, 4))
+        return out;
+
     for (i = 0; i < elements; ++i) {
         D3DXVec4Transform(
             (D3DXVECTOR4*)((char*)out + outstride * i),
@@ -1590,53 +1590,401 @@ static void fill_attribute_table(DWORD *attrib_buffer, DWORD numfaces, void *ind
     attrib_table_size++;
 }
 
-static int attrib_entry_compare(const DWORD **a, const DWORD **b)
+/* Create face_remap, a new attribute buffer for attribute sort optimization.
+ * The faces are sorted with a stable LSD radix sort on the attribute ids, so
+ * faces with the same attribute keep their relative order. */
+static HRESULT remap_faces_for_attrsort(struct d3dx9_mesh *This, const DWORD *indices,
+        DWORD *attrib_buffer, DWORD **sorted_attrib_buffer, DWORD **face_remap)
+{
+    DWORD *order, *tmp_order, *counts;
+    DWORD i, pass, shift, high_bits = 0;
+
+    order = HeapAlloc(GetProcessHeap(), 0, This->numfaces * 2 * sizeof(*order));
+    if (!order)
+        return E_OUTOFMEMORY;
+    tmp_order = order + This->numfaces;
+
+    counts = HeapAlloc(GetProcessHeap(), 0, 0x10000 * sizeof(*counts));
+    if (!counts)
+    {
+        HeapFree(GetProcessHeap(), 0, order);
+        return E_OUTOFMEMORY;
+    }
+
+    *face_remap = HeapAlloc(GetProcessHeap(), 0, This->numfaces * sizeof(**face_remap));
+    *sorted_attrib_buffer = HeapAlloc(GetProcessHeap(), 0, This->numfaces * sizeof(**sorted_attrib_buffer));
+    if (!*face_remap || !*sorted_attrib_buffer)
+    {
+        HeapFree(GetProcessHeap(), 0, *sorted_attrib_buffer);
+        HeapFree(GetProcessHeap(), 0, *face_remap);
+        *sorted_attrib_buffer = NULL;
+        *face_remap = NULL;
+        HeapFree(GetProcessHeap(), 0, counts);
+        HeapFree(GetProcessHeap(), 0, order);
+        return E_OUTOFMEMORY;
+    }
+
+    for (i = 0; i < This->numfaces; i++)
+    {
+        order[i] = i;
+        high_bits |= attrib_buffer[i] >> 16;
+    }
+
+    /* Attribute ids usually fit in 16 bits, in which case a single pass is
+     * enough. */
+    for (pass = 0; pass < (high_bits ? 2 : 1); pass++)
+    {
+        DWORD *swap, sum = 0;
+
+        shift = pass * 16;
+        memset(counts, 0, 0x10000 * sizeof(*counts));
+        for (i = 0; i < This->numfaces; i++)
+            counts[(attrib_buffer[i] >> shift) & 0xffff]++;
+        for (i = 0; i < 0x10000; i++)
+        {
+            DWORD count = counts[i];
+            counts[i] = sum;
+            sum += count;
+        }
+        for (i = 0; i < This->numfaces; i++)
+            tmp_order[counts[(attrib_buffer[order[i]] >> shift) & 0xffff]++] = order[i];
+
+        swap = order;
+        order = tmp_order;
+        tmp_order = swap;
+    }
+
+    for (i = 0; i < This->numfaces; i++)
+    {
+        (*face_remap)[order[i]] = i;
+        (*sorted_attrib_buffer)[i] = attrib_buffer[order[i]];
+    }
+
+    HeapFree(GetProcessHeap(), 0, counts);
+    HeapFree(GetProcessHeap(), 0, order < tmp_order ? order : tmp_order);
+
+    return D3D_OK;
+}
+
+#define VERTEX_CACHE_SIZE 32
+
+struct vertex_cache_vertex
+{
+    float score;
+    int cache_pos;
+    DWORD face_count; /* number of faces using the vertex that were not emitted yet */
+    DWORD face_start; /* first entry of the vertex in the vertex to face table */
+};
+
+/* Vertex scoring from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation".
+ * Vertices that are in the cache, or are used by few remaining faces, score
+ * higher. */
+static float vertex_cache_score(const struct vertex_cache_vertex *vertex)
 {
-    const DWORD *ptr_a = *a;
-    const DWORD *ptr_b = *b;
-    int delta = *ptr_a - *ptr_b;
+    float score = 0.0f;
+
+    if (!vertex->face_count)
+        return -1.0f;
+
+    if (vertex->cache_pos >= 0)
+    {
+        /* The vertices of the last face score the same, independently of
+         * their order. */
+        if (vertex->cache_pos < 3)
+            score = 0.75f;
+        else
+            score = powf(1.0f - (vertex->cache_pos - 3) * (1.0f / (VERTEX_CACHE_SIZE - 3)), 1.5f);
+    }
 
-    if (delta)
-        return delta;
+    return score + 2.0f / sqrtf(vertex->face_count);
+}
 
-    delta = ptr_a - ptr_b; /* for stable sort */
-    return delta;
+static float face_cache_score(const struct vertex_cache_vertex *vertices, const DWORD *face_indices)
+{
+    /* Sum in double precision, so that the result doesn't depend on the order
+     * of the vertices in the face. */
+    return (double)vertices[face_indices[0]].score + vertices[face_indices[1]].score
+            + vertices[face_indices[2]].score;
 }
 
-/* Create face_remap, a new attribute buffer for attribute sort optimization. */
-static HRESULT remap_faces_for_attrsort(struct d3dx9_mesh *This, const DWORD *indices,
-        DWORD *attrib_buffer, DWORD **sorted_attrib_buffer, DWORD **face_remap)
+/* Orders the faces so that a post-transform vertex cache is used well.
+ * face_remap receives the old face index for each new face position. */
+static HRESULT optimize_faces_for_vertex_cache(const DWORD *indices, DWORD num_faces,
+        DWORD num_vertices, DWORD *face_remap)
 {
-    DWORD **sorted_attrib_ptr_buffer = NULL;
-    DWORD i;
+    DWORD cache[VERTEX_CACHE_SIZE + 3], new_cache[VERTEX_CACHE_SIZE + 3];
+    unsigned int cache_size = 0, new_cache_size, i, j, k;
+    struct vertex_cache_vertex *vertices;
+    DWORD *vertex_faces, best, next_face;
+    float *face_scores, best_score;
+
+    for (i = 0; i < num_faces * 3; i++)
+    {
+        if (indices[i] >= num_vertices)
+        {
+            WARN("Index %u out of range, vertex count %u.\n", indices[i], num_vertices);
+            return D3DERR_INVALIDCALL;
+        }
+    }
 
-    sorted_attrib_ptr_buffer = HeapAlloc(GetProcessHeap(), 0, This->numfaces * sizeof(*sorted_attrib_ptr_buffer));
-    if (!sorted_attrib_ptr_buffer)
+    vertices = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, num_vertices * sizeof(*vertices));
+    vertex_faces = HeapAlloc(GetProcessHeap(), 0, num_faces * 3 * sizeof(*vertex_faces));
+    face_scores = HeapAlloc(GetProcessHeap(), 0, num_faces * sizeof(*face_scores));
+    if (!vertices || !vertex_faces || !face_scores)
+    {
+        HeapFree(GetProcessHeap(), 0, face_scores);
+        HeapFree(GetProcessHeap(), 0, vertex_faces);
+        HeapFree(GetProcessHeap(), 0, vertices);
         return E_OUTOFMEMORY;
+    }
 
-    *face_remap = HeapAlloc(GetProcessHeap(), 0, This->numfaces * sizeof(**face_remap));
-    if (!*face_remap)
+    /* Build the vertex to face table. */
+    for (i = 0; i < num_faces * 3; i++)
+        vertices[indices[i]].face_count++;
+    for (i = 0, j = 0; i < num_vertices; i++)
+    {
+        vertices[i].face_start = j;
+        j += vertices[i].face_count;
+        vertices[i].face_count = 0;
+        vertices[i].cache_pos = -1;
+    }
+    for (i = 0; i < num_faces * 3; i++)
+    {
+        struct vertex_cache_vertex *vertex = &vertices[indices[i]];
+        vertex_faces[vertex->face_start + vertex->face_count++] = i / 3;
+    }
+    for (i = 0; i < num_vertices; i++)
+        vertices[i].score = vertex_cache_score(&vertices[i]);
+
+    best = ~0u;
+    best_score = -1.0f;
+    for (i = 0; i < num_faces; i++)
+    {
+        face_scores[i] = face_cache_score(vertices, &indices[i * 3]);
+        if (face_scores[i] >= best_score)
+        {
+            best_score = face_scores[i];
+            best = i;
+        }
+    }
+
+    next_face = num_faces;
+    for (i = 0; i < num_faces; i++)
+    {
+        /* Nothing in the cache is used by the remaining faces, continue with
+         * the last face that wasn't emitted yet. */
+        if (best == ~0u)
+        {
+            while (face_scores[--next_face] < 0.0f);
+            best = next_face;
+        }
+
+        face_remap[i] = best;
+        face_scores[best] = -1.0f;
+
+        new_cache_size = 0;
+        for (j = 0; j < 3; j++)
+        {
+            DWORD index = indices[best * 3 + j];
+            struct vertex_cache_vertex *vertex = &vertices[index];
+            DWORD *faces = &vertex_faces[vertex->face_start];
+
+            for (k = 0; k < vertex->face_count; k++)
+            {
+                if (faces[k] == best)
+                {
+                    faces[k] = faces[--vertex->face_count];
+                    break;
+                }
+            }
+
+            for (k = 0; k < new_cache_size; k++)
+            {
+                if (new_cache[k] == index)
+                    break;
+            }
+            if (k == new_cache_size)
+                new_cache[new_cache_size++] = index;
+        }
+        for (j = 0; j < cache_size; j++)
+        {
+            for (k = 0; k < 3 && k < new_cache_size; k++)
+            {
+                if (new_cache[k] == cache[j])
+                    break;
+            }
+            if (k == 3 || k == new_cache_size)
+                new_cache[new_cache_size++] = cache[j];
+        }
+
+        for (j = 0; j < new_cache_size; j++)
+        {
+            struct vertex_cache_vertex *vertex = &vertices[new_cache[j]];
+
+            vertex->cache_pos = j < VERTEX_CACHE_SIZE ? j : -1;
+            vertex->score = vertex_cache_score(vertex);
+        }
+
+        /* Only the faces using the cached vertices changed their score. */
+        best = ~0u;
+        best_score = -1.0f;
+        for (j = 0; j < new_cache_size; j++)
+        {
+            const struct vertex_cache_vertex *vertex = &vertices[new_cache[j]];
+            const DWORD *faces = &vertex_faces[vertex->face_start];
+
+            for (k = 0; k < vertex->face_count; k++)
+            {
+                DWORD face = faces[k];
+                float score = face_cache_score(vertices, &indices[face * 3]);
+
+                face_scores[face] = score;
+                if (score > best_score || (score == best_score && face > best))
+                {
+                    best_score = score;
+                    best = face;
+                }
+            }
+        }
+
+        cache_size = min(new_cache_size, VERTEX_CACHE_SIZE);
+        memcpy(cache, new_cache, cache_size * sizeof(*cache));
+    }
+
+    HeapFree(GetProcessHeap(), 0, face_scores);
+    HeapFree(GetProcessHeap(), 0, vertex_faces);
+    HeapFree(GetProcessHeap(), 0, vertices);
+
+    return D3D_OK;
+}
+
+/* Reorders the faces of each attribute range for the vertex cache. face_remap
+ * is the old to new face mapping, and is updated in place. */
+static HRESULT remap_faces_for_vertex_cache(struct d3dx9_mesh *This, const DWORD *indices,
+        const DWORD *sorted_attrib_buffer, DWORD *face_remap)
+{
+    DWORD *order, *range_order, *range_indices, *vertex_map, *range_vertices;
+    DWORD start, count, num_range_vertices, i, j;
+    HRESULT hr = D3D_OK;
+
+    order = HeapAlloc(GetProcessHeap(), 0, This->numfaces * 6 * sizeof(*order));
+    vertex_map = HeapAlloc(GetProcessHeap(), 0, This->numvertices * sizeof(*vertex_map));
+    range_vertices = HeapAlloc(GetProcessHeap(), 0, This->numfaces * 3 * sizeof(*range_vertices));
+    if (!order || !vertex_map || !range_vertices)
+    {
+        hr = E_OUTOFMEMORY;
+        goto done;
+    }
+    range_order = order + This->numfaces;
+    range_indices = range_order + This->numfaces;
+
+    /* new -> old face mapping */
+    for (i = 0; i < This->numfaces; i++)
+        order[face_remap[i]] = i;
+    memset(vertex_map, 0xff, This->numvertices * sizeof(*vertex_map));
+
+    for (start = 0; start < This->numfaces; start += count)
     {
-        HeapFree(GetProcessHeap(), 0, sorted_attrib_ptr_buffer);
+        for (count = 1; start + count < This->numfaces; count++)
+        {
+            if (sorted_attrib_buffer[start + count] != sorted_attrib_buffer[start])
+                break;
+        }
+
+        /* Renumber the vertices used by the range, so that the optimizer only
+         * needs to track those. */
+        num_range_vertices = 0;
+        for (i = 0; i < count; i++)
+        {
+            for (j = 0; j < 3; j++)
+            {
+                DWORD index = indices[order[start + i] * 3 + j];
+
+                if (vertex_map[index] == ~0u)
+                {
+                    vertex_map[index] = num_range_vertices;
+                    range_vertices[num_range_vertices++] = index;
+                }
+                range_indices[i * 3 + j] = vertex_map[index];
+            }
+        }
+        for (i = 0; i < num_range_vertices; i++)
+            vertex_map[range_vertices[i]] = ~0u;
+
+        if (FAILED(hr = optimize_faces_for_vertex_cache(range_indices, count, num_range_vertices, range_order)))
+            goto done;
+
+        for (i = 0; i < count; i++)
+            face_remap[order[start + range_order[i]]] = start + i;
+    }
+
+done:
+    HeapFree(GetProcessHeap(), 0, range_vertices);
+    HeapFree(GetProcessHeap(), 0, vertex_map);
+    HeapFree(GetProcessHeap(), 0, order);
+    return hr;
+}
+
+/* Creates a vertex_remap that orders the vertices by their first use in the
+ * new face order. Unused vertices are removed if compact is set, and moved to
+ * the end otherwise. Indices are updated according to the vertex_remap. */
+static HRESULT remap_vertices_for_face_order(struct d3dx9_mesh *This, DWORD *indices,
+        const DWORD *face_remap, BOOL compact, DWORD *new_num_vertices, ID3DXBuffer **vertex_remap)
+{
+    DWORD *vertex_remap_ptr, *old_to_new, *order;
+    DWORD num_vertices = 0, i, j;
+    HRESULT hr;
+
+    old_to_new = HeapAlloc(GetProcessHeap(), 0, (This->numvertices + This->numfaces) * sizeof(*old_to_new));
+    if (!old_to_new)
         return E_OUTOFMEMORY;
+    order = old_to_new + This->numvertices;
+
+    hr = D3DXCreateBuffer(This->numvertices * sizeof(DWORD), vertex_remap);
+    if (FAILED(hr))
+    {
+        HeapFree(GetProcessHeap(), 0, old_to_new);
+        return hr;
     }
+    vertex_remap_ptr = ID3DXBuffer_GetBufferPointer(*vertex_remap);
 
     for (i = 0; i < This->numfaces; i++)
-        sorted_attrib_ptr_buffer[i] = &attrib_buffer[i];
-    qsort(sorted_attrib_ptr_buffer, This->numfaces, sizeof(*sorted_attrib_ptr_buffer),
-         (int(*)(const void *, const void *))attrib_entry_compare);
+        order[face_remap[i]] = i;
+    memset(old_to_new, 0xff, This->numvertices * sizeof(*old_to_new));
 
     for (i = 0; i < This->numfaces; i++)
     {
-        DWORD old_face = sorted_attrib_ptr_buffer[i] - attrib_buffer;
-        (*face_remap)[old_face] = i;
+        for (j = 0; j < 3; j++)
+        {
+            DWORD index = indices[order[i] * 3 + j];
+
+            if (old_to_new[index] == ~0u)
+            {
+                old_to_new[index] = num_vertices;
+                vertex_remap_ptr[num_vertices++] = index;
+            }
+        }
+    }
+    if (!compact)
+    {
+        for (i = 0; i < This->numvertices; i++)
+        {
+            if (old_to_new[i] == ~0u)
+            {
+                old_to_new[i] = num_vertices;
+                vertex_remap_ptr[num_vertices++] = i;
+            }
+        }
     }
+    for (i = num_vertices; i < This->numvertices; i++)
+        vertex_remap_ptr[i] = -1;
 
-    /* overwrite sorted_attrib_ptr_buffer with the values themselves */
-    *sorted_attrib_buffer = (DWORD*)sorted_attrib_ptr_buffer;
-    for (i = 0; i < This->numfaces; i++)
-        (*sorted_attrib_buffer)[(*face_remap)[i]] = attrib_buffer[i];
+    for (i = 0; i < This->numfaces * 3; i++)
+        indices[i] = old_to_new[indices[i]];
+
+    *new_num_vertices = num_vertices;
 
+    HeapFree(GetProcessHeap(), 0, old_to_new);
     return D3D_OK;
 }
 
@@ -1666,14 +2014,15 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
     if ((flags & (D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER)) == (D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER))
         return D3DERR_INVALIDCALL;
 
-    if (flags & (D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER))
+    if (flags & D3DXMESHOPT_STRIPREORDER)
     {
-        if (flags & D3DXMESHOPT_VERTEXCACHE)
-            FIXME("D3DXMESHOPT_VERTEXCACHE not implemented.\n");
-        if (flags & D3DXMESHOPT_STRIPREORDER)
-            FIXME("D3DXMESHOPT_STRIPREORDER not implemented.\n");
+        FIXME("D3DXMESHOPT_STRIPREORDER not implemented.\n");
         return E_NOTIMPL;
     }
+    /* Reordering the faces for the vertex cache keeps the attribute groups
+     * together. */
+    if (flags & D3DXMESHOPT_VERTEXCACHE)
+        flags |= D3DXMESHOPT_ATTRSORT;
 
     hr = iface->lpVtbl->LockIndexBuffer(iface, 0, &indices);
     if (FAILED(hr)) goto cleanup;
@@ -1694,18 +2043,25 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
         hr = compact_mesh(This, dword_indices, &new_num_vertices, &vertex_remap);
         if (FAILED(hr)) goto cleanup;
     } else if (flags & D3DXMESHOPT_ATTRSORT) {
-        if (!(flags & D3DXMESHOPT_IGNOREVERTS))
-        {
-            FIXME("D3DXMESHOPT_ATTRSORT vertex reordering not implemented.\n");
-            hr = E_NOTIMPL;
-            goto cleanup;
-        }
-
         hr = iface->lpVtbl->LockAttributeBuffer(iface, 0, &attrib_buffer);
         if (FAILED(hr)) goto cleanup;
 
         hr = remap_faces_for_attrsort(This, dword_indices, attrib_buffer, &sorted_attrib_buffer, &face_remap);
         if (FAILED(hr)) goto cleanup;
+
+        if (flags & D3DXMESHOPT_VERTEXCACHE)
+        {
+            hr = remap_faces_for_vertex_cache(This, dword_indices, sorted_attrib_buffer, face_remap);
+            if (FAILED(hr)) goto cleanup;
+        }
+
+        if (!(flags & D3DXMESHOPT_IGNOREVERTS))
+        {
+            new_num_alloc_vertices = This->numvertices;
+            hr = remap_vertices_for_face_order(This, dword_indices, face_remap,
+                    flags & D3DXMESHOPT_COMPACT, &new_num_vertices, &vertex_remap);
+            if (FAILED(hr)) goto cleanup;
+        }
     }
 
     if (vertex_remap)
@@ -7207,54 +7563,44 @@ cleanup:
  *
  * RETURNS
  *   Success: D3D_OK.
- *   Failure: D3DERR_INVALIDCALL.
- *
- * BUGS
- *   The face re-ordering does not use the vertex cache optimally.
+ *   Failure: D3DERR_INVALIDCALL, E_OUTOFMEMORY.
  *
  */
 HRESULT WINAPI D3DXOptimizeFaces(const void *indices, UINT num_faces,
         UINT num_vertices, BOOL indices_are_32bit, DWORD *face_remap)
 {
-    UINT i;
-    UINT j = num_faces - 1;
     UINT limit_16_bit = 2 << 15; /* According to MSDN */
-    HRESULT hr = D3D_OK;
+    DWORD *dword_indices;
+    HRESULT hr;
+    UINT i;
 
-    FIXME("indices %p, num_faces %u, num_vertices %u, indices_are_32bit %#x, face_remap %p semi-stub. "
-            "Face order will not be optimal.\n",
+    TRACE("indices %p, num_faces %u, num_vertices %u, indices_are_32bit %#x, face_remap %p.\n",
             indices, num_faces, num_vertices, indices_are_32bit, face_remap);
 
     if (!indices_are_32bit && num_faces >= limit_16_bit)
     {
         WARN("Number of faces must be less than %d when using 16-bit indices.\n",
              limit_16_bit);
-        hr = D3DERR_INVALIDCALL;
-        goto error;
+        return D3DERR_INVALIDCALL;
     }
 
     if (!face_remap)
     {
         WARN("Face remap pointer is NULL.\n");
-        hr = D3DERR_INVALIDCALL;
-        goto error;
+        return D3DERR_INVALIDCALL;
     }
 
-    /* The faces are drawn in reverse order for simple meshes. This ordering
-     * is not optimal for complicated meshes, but will not break anything
-     * either. The ordering should be changed to take advantage of the vertex
-     * cache on the graphics card.
-     *
-     * TODO Re-order to take advantage of vertex cache.
-     */
-    for (i = 0; i < num_faces; i++)
-    {
-        face_remap[i] = j--;
-    }
+    if (indices_are_32bit)
+        return optimize_faces_for_vertex_cache(indices, num_faces, num_vertices, face_remap);
 
-    return D3D_OK;
+    if (!(dword_indices = HeapAlloc(GetProcessHeap(), 0, num_faces * 3 * sizeof(*dword_indices))))
+        return E_OUTOFMEMORY;
+    for (i = 0; i < num_faces * 3; i++)
+        dword_indices[i] = ((const WORD *)indices)[i];
 
-error:
+    hr = optimize_faces_for_vertex_cache(dword_indices, num_faces, num_vertices, face_remap);
+
+    HeapFree(GetProcessHeap(), 0, dword_indices);
     return hr;
 }
 
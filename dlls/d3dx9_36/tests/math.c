@@ -23,6 +23,8 @@
 #include "d3dx9.h"
 #include <math.h>
 
+DWORD WINAPI D3DXCpuOptimizations(BOOL enable);
+
 static BOOL compare_float(float f, float g, unsigned int ulps)
 {
     int x = *(int *)&f;
@@ -3200,6 +3202,137 @@ static void test_D3DXVec_Array(void)
     }
 }
 
+static void benchmark_cpu_optimizations(BOOL enable, const D3DXMATRIX *mat, D3DXVECTOR4 *out,
+        const D3DXVECTOR4 *in, unsigned int count)
+{
+    DWORD start, multiply_time, transform_time;
+    D3DXMATRIX m = *mat;
+    unsigned int i;
+
+    D3DXCpuOptimizations(enable);
+
+    start = GetTickCount();
+    for (i = 0; i < 1000000; ++i)
+        D3DXMatrixMultiply(&m, &m, mat);
+    multiply_time = GetTickCount() - start;
+
+    start = GetTickCount();
+    for (i = 0; i < 1000; ++i)
+    {
+        D3DXVec3TransformArray(out, sizeof(*out), (const D3DXVECTOR3 *)in, sizeof(*in), mat, count);
+        D3DXVec4TransformArray(out, sizeof(*out), in, sizeof(*in), mat, count);
+    }
+    transform_time = GetTickCount() - start;
+
+    trace("Optimizations %s: 1000000 D3DXMatrixMultiply() calls took %u ms, "
+            "1000 D3DXVec3/4TransformArray() calls of %u vectors took %u ms.\n",
+            enable ? "enabled" : "disabled", multiply_time, count, transform_time);
+}
+
+static void test_D3DXCpuOptimizations(void)
+{
+    D3DXMATRIX mat1, mat2, expected_mat, mat;
+    float in[5 * 64], out[5 * 64], expected[5 * 64];
+    D3DXVECTOR4 *bench_in, *bench_out;
+    unsigned int i, j, stride;
+
+    /* All the values are small multiples of 1/4, so the results don't depend
+     * on the precision or the order of the operations. */
+    for (i = 0; i < 4; ++i)
+    {
+        for (j = 0; j < 4; ++j)
+        {
+            U(mat1).m[i][j] = (float)((int)(i * 5 + j * 3) % 9 - 4) * 0.25f;
+            U(mat2).m[i][j] = (float)((int)(i * 7 + j) % 11 - 5) * 0.5f;
+        }
+    }
+    for (i = 0; i < ARRAY_SIZE(in); ++i)
+        in[i] = (float)((int)(i * 13) % 17 - 8) * 0.25f;
+
+    D3DXCpuOptimizations(FALSE);
+    D3DXMatrixMultiply(&expected_mat, &mat1, &mat2);
+    D3DXCpuOptimizations(TRUE);
+    D3DXMatrixMultiply(&mat, &mat1, &mat2);
+    expect_matrix(&expected_mat, &mat, 0);
+    mat = mat1;
+    D3DXMatrixMultiply(&mat, &mat, &mat2);
+    expect_matrix(&expected_mat, &mat, 0);
+
+    D3DXCpuOptimizations(FALSE);
+    D3DXMatrixMultiplyTranspose(&expected_mat, &mat1, &mat2);
+    D3DXCpuOptimizations(TRUE);
+    D3DXMatrixMultiplyTranspose(&mat, &mat1, &mat2);
+    expect_matrix(&expected_mat, &mat, 0);
+    mat = mat2;
+    D3DXMatrixMultiplyTranspose(&mat, &mat1, &mat);
+    expect_matrix(&expected_mat, &mat, 0);
+
+    /* Odd input strides and an output stride larger than the output vectors. */
+    for (stride = 2; stride <= 4; ++stride)
+    {
+        memset(expected, 0xcc, sizeof(expected));
+        memset(out, 0xcc, sizeof(out));
+
+        D3DXCpuOptimizations(FALSE);
+        if (stride == 2)
+            D3DXVec2TransformArray((D3DXVECTOR4 *)expected, 5 * sizeof(float),
+                    (const D3DXVECTOR2 *)in, stride * sizeof(float), &mat1, 63);
+        else if (stride == 3)
+            D3DXVec3TransformArray((D3DXVECTOR4 *)expected, 5 * sizeof(float),
+                    (const D3DXVECTOR3 *)in, stride * sizeof(float), &mat1, 63);
+        else
+            D3DXVec4TransformArray((D3DXVECTOR4 *)expected, 5 * sizeof(float),
+                    (const D3DXVECTOR4 *)in, stride * sizeof(float), &mat1, 63);
+
+        D3DXCpuOptimizations(TRUE);
+        if (stride == 2)
+            D3DXVec2TransformArray((D3DXVECTOR4 *)out, 5 * sizeof(float),
+                    (const D3DXVECTOR2 *)in, stride * sizeof(float), &mat1, 63);
+        else if (stride == 3)
+            D3DXVec3TransformArray((D3DXVECTOR4 *)out, 5 * sizeof(float),
+                    (const D3DXVECTOR3 *)in, stride * sizeof(float), &mat1, 63);
+        else
+            D3DXVec4TransformArray((D3DXVECTOR4 *)out, 5 * sizeof(float),
+                    (const D3DXVECTOR4 *)in, stride * sizeof(float), &mat1, 63);
+
+        for (i = 0; i < ARRAY_SIZE(out); ++i)
+        {
+            ok(!memcmp(&out[i], &expected[i], sizeof(*out)),
+                    "Stride %u: got unexpected value %.8e at index %u, expected %.8e.\n",
+                    stride, out[i], i, expected[i]);
+            if (memcmp(&out[i], &expected[i], sizeof(*out)))
+                break;
+        }
+    }
+
+    memcpy(expected, in, sizeof(expected));
+    memcpy(out, in, sizeof(out));
+    D3DXCpuOptimizations(FALSE);
+    D3DXPlaneTransformArray((D3DXPLANE *)expected, sizeof(D3DXPLANE),
+            (const D3DXPLANE *)expected, sizeof(D3DXPLANE), &mat2, ARRAY_SIZE(in) / 4);
+    D3DXCpuOptimizations(TRUE);
+    D3DXPlaneTransformArray((D3DXPLANE *)out, sizeof(D3DXPLANE),
+            (const D3DXPLANE *)out, sizeof(D3DXPLANE), &mat2, ARRAY_SIZE(in) / 4);
+    ok(!memcmp(out, expected, sizeof(out)), "Got unexpected in-place plane transform results.\n");
+
+    if (winetest_interactive)
+    {
+        bench_in = HeapAlloc(GetProcessHeap(), 0, 4096 * sizeof(*bench_in));
+        bench_out = HeapAlloc(GetProcessHeap(), 0, 4096 * sizeof(*bench_out));
+        for (i = 0; i < 4096 * 4; ++i)
+            ((float *)bench_in)[i] = (float)(i % 17) * 0.125f;
+        D3DXMatrixRotationYawPitchRoll(&mat, 0.1f, 0.2f, 0.3f);
+
+        benchmark_cpu_optimizations(FALSE, &mat, bench_out, bench_in, 4096);
+        benchmark_cpu_optimizations(TRUE, &mat, bench_out, bench_in, 4096);
+
+        HeapFree(GetProcessHeap(), 0, bench_out);
+        HeapFree(GetProcessHeap(), 0, bench_in);
+    }
+
+    D3DXCpuOptimizations(TRUE);
+}
+
 static void test_D3DXFloat_Array(void)
 {
     unsigned int i;
@@ -4379,6 +4512,7 @@ START_TEST(math)
     test_Matrix_Decompose();
     test_Matrix_Transformation2D();
     test_D3DXVec_Array();
+    test_D3DXCpuOptimizations();
     test_D3DXFloat_Array();
     test_D3DXSHAdd();
     test_D3DXSHDot();
@@ -10488,6 +10488,118 @@ static void test_optimize_faces(void)
     "faces when using 16-bit indices. Got %x\n, expected D3DERR_INVALIDCALL\n", hr);
 }
 
+static void test_optimize_inplace(void)
+{
+    static const DWORD flags[] =
+    {
+        D3DXMESHOPT_ATTRSORT,
+        D3DXMESHOPT_ATTRSORT | D3DXMESHOPT_COMPACT,
+        D3DXMESHOPT_VERTEXCACHE,
+        D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_IGNOREVERTS,
+    };
+    const unsigned int grid_size = 6, num_faces = grid_size * grid_size * 2;
+    const unsigned int num_vertices = (grid_size + 1) * (grid_size + 1);
+    struct test_context *test_context;
+    WORD *indices, orig_indices[6 * 6 * 6];
+    DWORD *attributes, orig_attributes[6 * 6 * 2];
+    DWORD adjacency[6 * 6 * 6], face_remap[6 * 6 * 2];
+    ID3DXBuffer *vertex_remap;
+    D3DXVECTOR3 *vertices;
+    unsigned int i, j, x, y;
+    ID3DXMesh *mesh;
+    DWORD *remap;
+    HRESULT hr;
+
+    if (!(test_context = new_test_context()))
+    {
+        skip("Couldn't create test context.\n");
+        return;
+    }
+
+    for (y = 0, i = 0; y < grid_size; ++y)
+    {
+        for (x = 0; x < grid_size; ++x)
+        {
+            WORD v = y * (grid_size + 1) + x;
+
+            orig_indices[i++] = v;
+            orig_indices[i++] = v + 1;
+            orig_indices[i++] = v + grid_size + 1;
+            orig_indices[i++] = v + 1;
+            orig_indices[i++] = v + grid_size + 2;
+            orig_indices[i++] = v + grid_size + 1;
+        }
+    }
+    /* Interleave three attribute groups. */
+    for (i = 0; i < num_faces; ++i)
+        orig_attributes[i] = (i * 7) % 3;
+
+    for (i = 0; i < ARRAY_SIZE(flags); ++i)
+    {
+        hr = D3DXCreateMeshFVF(num_faces, num_vertices, D3DXMESH_MANAGED, D3DFVF_XYZ,
+                test_context->device, &mesh);
+        ok(hr == D3D_OK, "Test %u: Got unexpected hr %#x.\n", i, hr);
+
+        mesh->lpVtbl->LockVertexBuffer(mesh, 0, (void **)&vertices);
+        for (j = 0; j < num_vertices; ++j)
+        {
+            vertices[j].x = j % (grid_size + 1);
+            vertices[j].y = j / (grid_size + 1);
+            vertices[j].z = 0.0f;
+        }
+        mesh->lpVtbl->UnlockVertexBuffer(mesh);
+        mesh->lpVtbl->LockIndexBuffer(mesh, 0, (void **)&indices);
+        memcpy(indices, orig_indices, sizeof(orig_indices));
+        mesh->lpVtbl->UnlockIndexBuffer(mesh);
+        mesh->lpVtbl->LockAttributeBuffer(mesh, 0, &attributes);
+        memcpy(attributes, orig_attributes, sizeof(orig_attributes));
+        mesh->lpVtbl->UnlockAttributeBuffer(mesh);
+
+        hr = mesh->lpVtbl->GenerateAdjacency(mesh, 0.0f, adjacency);
+        ok(hr == D3D_OK, "Test %u: Got unexpected hr %#x.\n", i, hr);
+
+        vertex_remap = NULL;
+        hr = mesh->lpVtbl->OptimizeInplace(mesh, flags[i], adjacency, NULL, face_remap, &vertex_remap);
+        ok(hr == D3D_OK, "Test %u: Got unexpected hr %#x.\n", i, hr);
+        if (FAILED(hr))
+        {
+            mesh->lpVtbl->Release(mesh);
+            continue;
+        }
+        ok(mesh->lpVtbl->GetNumVertices(mesh) == num_vertices, "Test %u: Got unexpected vertex count %u.\n",
+                i, mesh->lpVtbl->GetNumVertices(mesh));
+        remap = ID3DXBuffer_GetBufferPointer(vertex_remap);
+
+        /* The faces are grouped by attribute, and every new face is an old
+         * face with its vertices remapped. */
+        mesh->lpVtbl->LockIndexBuffer(mesh, D3DLOCK_READONLY, (void **)&indices);
+        mesh->lpVtbl->LockAttributeBuffer(mesh, D3DLOCK_READONLY, &attributes);
+        for (j = 0; j < num_faces; ++j)
+        {
+            DWORD old_face = face_remap[j];
+
+            ok(old_face < num_faces, "Test %u: Got unexpected face remap %u for face %u.\n", i, old_face, j);
+            if (old_face >= num_faces)
+                break;
+            ok(!j || attributes[j] >= attributes[j - 1], "Test %u: Faces are not sorted by attribute at face %u.\n",
+                    i, j);
+            ok(attributes[j] == orig_attributes[old_face], "Test %u: Got unexpected attribute %u for face %u.\n",
+                    i, attributes[j], j);
+            ok(remap[indices[j * 3]] == orig_indices[old_face * 3]
+                    && remap[indices[j * 3 + 1]] == orig_indices[old_face * 3 + 1]
+                    && remap[indices[j * 3 + 2]] == orig_indices[old_face * 3 + 2],
+                    "Test %u: Got unexpected indices for face %u.\n", i, j);
+        }
+        mesh->lpVtbl->UnlockAttributeBuffer(mesh);
+        mesh->lpVtbl->UnlockIndexBuffer(mesh);
+
+        ID3DXBuffer_Release(vertex_remap);
+        mesh->lpVtbl->Release(mesh);
+    }
+
+    free_test_context(test_context);
+}
+
 static HRESULT clear_normals(ID3DXMesh *mesh)
 {
     HRESULT hr;
@@ -11399,6 +11511,7 @@ START_TEST(mesh)
     test_clone_mesh();
     test_valid_mesh();
     test_optimize_faces();
+    test_optimize_inplace();
     test_compute_normals();
     test_D3DXFrameFind();
     test_load_skin_mesh_from_xof();
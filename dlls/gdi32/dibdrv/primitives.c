@@ -25,8 +25,202 @@
 
 #include "wine/debug.h"
 
+#if defined(__x86_64__) || (defined(__i386__) && defined(__GNUC__) \
+        && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#include <emmintrin.h>
+#define HAVE_SSE2_PRIMITIVES
+#endif
+
 WINE_DEFAULT_DEBUG_CHANNEL(dib);
 
+/* The SSE2 versions of the primitives produce the same results as the
+ * scalar code; they only process several pixels at a time. */
+#ifdef HAVE_SSE2_PRIMITIVES
+
+#ifdef __i386__
+#define SSE2_FUNC __attribute__((target("sse2")))
+#else
+#define SSE2_FUNC
+#endif
+
+static BOOL use_sse2;
+
+void init_dib_primitives(void)
+{
+    use_sse2 = IsProcessorFeaturePresent( PF_XMMI64_INSTRUCTIONS_AVAILABLE );
+    TRACE( "using SSE2 primitives: %u\n", use_sse2 );
+}
+
+/* (v + 127) / 255 for v <= 255 * 255 */
+static inline SSE2_FUNC __m128i div255_epi16( __m128i v )
+{
+    v = _mm_add_epi16( v, _mm_set1_epi16( 128 ) );
+    return _mm_srli_epi16( _mm_add_epi16( v, _mm_srli_epi16( v, 8 ) ), 8 );
+}
+
+static inline SSE2_FUNC __m128i broadcast_alpha_epi16( __m128i v )
+{
+    return _mm_shufflehi_epi16( _mm_shufflelo_epi16( v, 0xff ), 0xff );
+}
+
+/* Packs 16-bit channels the way the scalar code combines them: a channel
+ * that exceeds 255 carries into the next one. */
+static inline SSE2_FUNC __m128i pack_argb_epi16( __m128i lo, __m128i hi )
+{
+    const __m128i mask = _mm_set1_epi16( 0xff );
+    __m128i bytes = _mm_packus_epi16( _mm_and_si128( lo, mask ), _mm_and_si128( hi, mask ) );
+    __m128i carry = _mm_packus_epi16( _mm_srli_epi16( lo, 8 ), _mm_srli_epi16( hi, 8 ) );
+    return _mm_or_si128( bytes, _mm_slli_epi32( carry, 8 ) );
+}
+
+static inline SSE2_FUNC __m128i blend_argb_epi16( __m128i dst, __m128i src )
+{
+    __m128i inv_alpha = _mm_sub_epi16( _mm_set1_epi16( 255 ), broadcast_alpha_epi16( src ) );
+    return _mm_add_epi16( src, div255_epi16( _mm_mullo_epi16( dst, inv_alpha ) ) );
+}
+
+static SSE2_FUNC int blend_argb_row_sse2( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    const __m128i zero = _mm_setzero_si128(), const_alpha = _mm_set1_epi16( alpha );
+    __m128i d, s, lo, hi;
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        lo = _mm_unpacklo_epi8( s, zero );
+        hi = _mm_unpackhi_epi8( s, zero );
+        if (alpha != 255)
+        {
+            lo = div255_epi16( _mm_mullo_epi16( lo, const_alpha ) );
+            hi = div255_epi16( _mm_mullo_epi16( hi, const_alpha ) );
+        }
+        lo = blend_argb_epi16( _mm_unpacklo_epi8( d, zero ), lo );
+        hi = blend_argb_epi16( _mm_unpackhi_epi8( d, zero ), hi );
+        _mm_storeu_si128( (__m128i *)(dst + x), pack_argb_epi16( lo, hi ) );
+    }
+    return x;
+}
+
+static SSE2_FUNC int blend_constant_alpha_row_sse2( DWORD *dst, const DWORD *src, int len,
+                                                    DWORD alpha, DWORD src_alpha_mask )
+{
+    const __m128i zero = _mm_setzero_si128(), or_mask = _mm_set1_epi32( src_alpha_mask );
+    const __m128i src_alpha = _mm_set1_epi16( alpha ), dst_alpha = _mm_set1_epi16( 255 - alpha );
+    __m128i d, s, lo, hi;
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        s = _mm_or_si128( _mm_loadu_si128( (const __m128i *)(src + x) ), or_mask );
+        lo = _mm_add_epi16( _mm_mullo_epi16( _mm_unpacklo_epi8( s, zero ), src_alpha ),
+                            _mm_mullo_epi16( _mm_unpacklo_epi8( d, zero ), dst_alpha ) );
+        hi = _mm_add_epi16( _mm_mullo_epi16( _mm_unpackhi_epi8( s, zero ), src_alpha ),
+                            _mm_mullo_epi16( _mm_unpackhi_epi8( d, zero ), dst_alpha ) );
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_packus_epi16( div255_epi16( lo ), div255_epi16( hi ) ) );
+    }
+    return x;
+}
+
+static SSE2_FUNC void rop_row_32_sse2( DWORD *ptr, int len, DWORD and, DWORD xor )
+{
+    const __m128i and_mask = _mm_set1_epi32( and ), xor_mask = _mm_set1_epi32( xor );
+    __m128i v;
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        v = _mm_loadu_si128( (const __m128i *)(ptr + x) );
+        v = _mm_xor_si128( _mm_and_si128( v, and_mask ), xor_mask );
+        _mm_storeu_si128( (__m128i *)(ptr + x), v );
+    }
+    for (; x < len; x++) ptr[x] = (ptr[x] & and) ^ xor;
+}
+
+static SSE2_FUNC int glyph_run_sse2( const BYTE *glyph, int len, BYTE min_val, BYTE max_val )
+{
+    const __m128i min_vec = _mm_set1_epi8( min_val ), max_vec = _mm_set1_epi8( max_val );
+    unsigned int mask;
+    __m128i g;
+    int x;
+
+    for (x = 0; x + 16 <= len; x += 16)
+    {
+        g = _mm_loadu_si128( (const __m128i *)(glyph + x) );
+        mask = _mm_movemask_epi8( _mm_and_si128( _mm_cmpeq_epi8( _mm_max_epu8( g, min_vec ), g ),
+                                                 _mm_cmpeq_epi8( _mm_min_epu8( g, max_vec ), g ) ) );
+        if (mask != 0xffff) return x + __builtin_ctz( ~mask );
+    }
+    while (x < len && glyph[x] >= min_val && glyph[x] <= max_val) x++;
+    return x;
+}
+
+/* The row helpers return the number of pixels they processed, the caller
+ * handles the rest with the scalar code. */
+static inline int blend_argb_row( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    if (!use_sse2) return 0;
+    return blend_argb_row_sse2( dst, src, len, alpha );
+}
+
+static inline int blend_constant_alpha_row( DWORD *dst, const DWORD *src, int len,
+                                            DWORD alpha, DWORD src_alpha_mask )
+{
+    if (!use_sse2) return 0;
+    return blend_constant_alpha_row_sse2( dst, src, len, alpha, src_alpha_mask );
+}
+
+static inline BOOL rop_row_32( DWORD *ptr, int len, DWORD and, DWORD xor )
+{
+    if (!use_sse2) return FALSE;
+    rop_row_32_sse2( ptr, len, and, xor );
+    return TRUE;
+}
+
+/* Returns the number of leading glyph values in [min_val, max_val]. */
+static inline int glyph_run( const BYTE *glyph, int len, BYTE min_val, BYTE max_val )
+{
+    int x = 0;
+
+    if (use_sse2) return glyph_run_sse2( glyph, len, min_val, max_val );
+    while (x < len && glyph[x] >= min_val && glyph[x] <= max_val) x++;
+    return x;
+}
+
+#else  /* HAVE_SSE2_PRIMITIVES */
+
+void init_dib_primitives(void)
+{
+}
+
+static inline int blend_argb_row( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    return 0;
+}
+
+static inline int blend_constant_alpha_row( DWORD *dst, const DWORD *src, int len,
+                                            DWORD alpha, DWORD src_alpha_mask )
+{
+    return 0;
+}
+
+static inline BOOL rop_row_32( DWORD *ptr, int len, DWORD and, DWORD xor )
+{
+    return FALSE;
+}
+
+static inline int glyph_run( const BYTE *glyph, int len, BYTE min_val, BYTE max_val )
+{
+    int x = 0;
+
+    while (x < len && glyph[x] >= min_val && glyph[x] <= max_val) x++;
+    return x;
+}
+
+#endif  /* HAVE_SSE2_PRIMITIVES */
+
 /* Bayer matrices for dithering */
 
 static const BYTE bayer_4x4[4][4] =
@@ -276,8 +470,11 @@ static void solid_rects_32(const dib_info *dib, int num, const RECT *rc, DWORD a
         start = get_pixel_ptr_32(dib, rc->left, rc->top);
         if (and)
             for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 4)
+            {
+                if (rop_row_32( start, rc->right - rc->left, and, xor )) continue;
                 for(x = rc->left, ptr = start; x < rc->right; x++)
                     do_rop_32(ptr++, and, xor);
+            }
         else
             for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 4)
                 memset_32( start, xor, rc->right - rc->left );
@@ -4656,26 +4853,27 @@ static void blend_rect_8888(const dib_info *dst, const RECT *rc,
 {
     DWORD *src_ptr = get_pixel_ptr_32( src, origin->x, origin->y );
     DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
-    int x, y;
+    int x, y, width = rc->right - rc->left;
 
     if (blend.AlphaFormat & AC_SRC_ALPHA)
     {
 	if (blend.SourceConstantAlpha == 255)
 	    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-		for (x = 0; x < rc->right - rc->left; x++)
+		for (x = blend_argb_row( dst_ptr, src_ptr, width, 255 ); x < width; x++)
 		    dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
         else
 	    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-		for (x = 0; x < rc->right - rc->left; x++)
+		for (x = blend_argb_row( dst_ptr, src_ptr, width, blend.SourceConstantAlpha ); x < width; x++)
 		    dst_ptr[x] = blend_argb_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
     }
     else if (src->compression == BI_RGB)
 	for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-	    for (x = 0; x < rc->right - rc->left; x++)
+	    for (x = blend_constant_alpha_row( dst_ptr, src_ptr, width, blend.SourceConstantAlpha, 0 ); x < width; x++)
 		dst_ptr[x] = blend_argb_constant_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
     else
 	for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-	    for (x = 0; x < rc->right - rc->left; x++)
+	    for (x = blend_constant_alpha_row( dst_ptr, src_ptr, width, blend.SourceConstantAlpha, 0xff000000 );
+                 x < width; x++)
 		dst_ptr[x] = blend_argb_no_src_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
 }
 
@@ -6071,14 +6269,24 @@ static void draw_glyph_8888( const dib_info *dib, const RECT *rect, const dib_in
 {
     DWORD *dst_ptr = get_pixel_ptr_32( dib, rect->left, rect->top );
     const BYTE *glyph_ptr = get_pixel_ptr_8( glyph, origin->x, origin->y );
-    int x, y;
+    int x, y, len;
 
     for (y = rect->top; y < rect->bottom; y++)
     {
         for (x = 0; x < rect->right - rect->left; x++)
         {
-            if (glyph_ptr[x] <= 1) continue;
-            if (glyph_ptr[x] >= 16) { dst_ptr[x] = text_pixel; continue; }
+            if (glyph_ptr[x] <= 1)
+            {
+                x += glyph_run( glyph_ptr + x + 1, rect->right - rect->left - x - 1, 0, 1 );
+                continue;
+            }
+            if (glyph_ptr[x] >= 16)
+            {
+                len = glyph_run( glyph_ptr + x, rect->right - rect->left - x, 16, 0xff );
+                memset_32( dst_ptr + x, text_pixel, len );
+                x += len - 1;
+                continue;
+            }
             dst_ptr[x] = aa_rgb( dst_ptr[x] >> 16, dst_ptr[x] >> 8, dst_ptr[x], text_pixel, ranges + glyph_ptr[x] );
         }
         dst_ptr += dib->stride / 4;
@@ -6091,7 +6299,7 @@ static void draw_glyph_32( const dib_info *dib, const RECT *rect, const dib_info
 {
     DWORD *dst_ptr = get_pixel_ptr_32( dib, rect->left, rect->top );
     const BYTE *glyph_ptr = get_pixel_ptr_8( glyph, origin->x, origin->y );
-    int x, y;
+    int x, y, len;
     DWORD text, val;
 
     text = get_field( text_pixel, dib->red_shift,   dib->red_len ) << 16 |
@@ -6102,8 +6310,18 @@ static void draw_glyph_32( const dib_info *dib, const RECT *rect, const dib_info
     {
         for (x = 0; x < rect->right - rect->left; x++)
         {
-            if (glyph_ptr[x] <= 1) continue;
-            if (glyph_ptr[x] >= 16) { dst_ptr[x] = text_pixel; continue; }
+            if (glyph_ptr[x] <= 1)
+            {
+                x += glyph_run( glyph_ptr + x + 1, rect->right - rect->left - x - 1, 0, 1 );
+                continue;
+            }
+            if (glyph_ptr[x] >= 16)
+            {
+                len = glyph_run( glyph_ptr + x, rect->right - rect->left - x, 16, 0xff );
+                memset_32( dst_ptr + x, text_pixel, len );
+                x += len - 1;
+                continue;
+            }
             val = aa_rgb( get_field(dst_ptr[x], dib->red_shift,   dib->red_len),
                           get_field(dst_ptr[x], dib->green_shift, dib->green_len),
                           get_field(dst_ptr[x], dib->blue_shift,  dib->blue_len),
@@ -6127,7 +6345,11 @@ static void draw_glyph_24( const dib_info *dib, const RECT *rect, const dib_info
     {
         for (x = 0; x < rect->right - rect->left; x++)
         {
-            if (glyph_ptr[x] <= 1) continue;
+            if (glyph_ptr[x] <= 1)
+            {
+                x += glyph_run( glyph_ptr + x + 1, rect->right - rect->left - x - 1, 0, 1 );
+                continue;
+            }
             if (glyph_ptr[x] >= 16)
                 val = text_pixel;
             else
@@ -6158,7 +6380,11 @@ static void draw_glyph_555( const dib_info *dib, const RECT *rect, const dib_inf
     {
         for (x = 0; x < rect->right - rect->left; x++)
         {
-            if (glyph_ptr[x] <= 1) continue;
+            if (glyph_ptr[x] <= 1)
+            {
+                x += glyph_run( glyph_ptr + x + 1, rect->right - rect->left - x - 1, 0, 1 );
+                continue;
+            }
             if (glyph_ptr[x] >= 16) { dst_ptr[x] = text_pixel; continue; }
             val = aa_rgb( ((dst_ptr[x] >> 7) & 0xf8) | ((dst_ptr[x] >> 12) & 0x07),
                           ((dst_ptr[x] >> 2) & 0xf8) | ((dst_ptr[x] >>  7) & 0x07),
@@ -6187,7 +6413,11 @@ static void draw_glyph_16( const dib_info *dib, const RECT *rect, const dib_info
     {
         for (x = 0; x < rect->right - rect->left; x++)
         {
-            if (glyph_ptr[x] <= 1) continue;
+            if (glyph_ptr[x] <= 1)
+            {
+                x += glyph_run( glyph_ptr + x + 1, rect->right - rect->left - x - 1, 0, 1 );
+                continue;
+            }
             if (glyph_ptr[x] >= 16) { dst_ptr[x] = text_pixel; continue; }
             val = aa_rgb( get_field(dst_ptr[x], dib->red_shift,   dib->red_len),
                           get_field(dst_ptr[x], dib->green_shift, dib->green_len),
@@ -48,10 +48,19 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(enhmetafile);
 
+/* record index, built on first playback */
+struct emf_index
+{
+    UINT           count;      /* number of valid records */
+    BOOL           band_safe;  /* records only depend on the pixels they draw */
+    DWORD          offsets[1]; /* offset of each record */
+};
+
 typedef struct
 {
     ENHMETAHEADER  *emh;
     BOOL           on_disk;   /* true if metafile is on disk */
+    struct emf_index *index;
 } ENHMETAFILEOBJ;
 
 static const struct emr_name {
@@ -278,6 +287,7 @@ HENHMETAFILE EMF_Create_HENHMETAFILE(ENHMETAHEADER *emh, DWORD filesize, BOOL on
 
     metaObj->emh = emh;
     metaObj->on_disk = on_disk;
+    metaObj->index = NULL;
 
     if (!(hmf = alloc_gdi_handle( metaObj, OBJ_ENHMETAFILE, NULL )))
         HeapFree( GetProcessHeap(), 0, metaObj );
@@ -297,6 +307,7 @@ static BOOL EMF_Delete_HENHMETAFILE( HENHMETAFILE hmf )
         UnmapViewOfFile( metaObj->emh );
     else
         HeapFree( GetProcessHeap(), 0, metaObj->emh );
+    HeapFree( GetProcessHeap(), 0, metaObj->index );
     HeapFree( GetProcessHeap(), 0, metaObj );
     return TRUE;
 }
@@ -319,6 +330,67 @@ static ENHMETAHEADER *EMF_GetEnhMetaHeader( HENHMETAFILE hmf )
     return ret;
 }
 
+/* records that depend on pixels outside of the area they draw to, or that
+ * are replayed in device coordinates */
+static BOOL emr_is_band_safe( DWORD type )
+{
+    switch (type)
+    {
+    case EMR_EXTFLOODFILL:
+    case EMR_SETBRUSHORGEX:
+        return FALSE;
+    default:
+        return TRUE;
+    }
+}
+
+/******************************************************************
+ *         get_emf_index
+ *
+ * Returns the record index of the metafile, building it on first use. The
+ * records are validated once here instead of on every playback.
+ */
+static const struct emf_index *get_emf_index( HENHMETAFILE hmf )
+{
+    const struct emf_index *ret = NULL;
+    ENHMETAFILEOBJ *metaObj = GDI_GetObjPtr( hmf, OBJ_ENHMETAFILE );
+    const ENHMETAHEADER *emh;
+    const ENHMETARECORD *emr;
+    struct emf_index *index;
+    DWORD offset, count = 0;
+
+    if (!metaObj) return NULL;
+    if ((ret = metaObj->index)) goto done;
+
+    emh = metaObj->emh;
+    for (offset = 0; offset < emh->nBytes; offset += emr->nSize, count++)
+    {
+        emr = (const ENHMETARECORD *)((const char *)emh + offset);
+        if (emh->nBytes - offset < 8 || emr->nSize < 8 || emr->nSize > emh->nBytes - offset)
+        {
+            WARN( "record truncated\n" );
+            break;
+        }
+    }
+
+    if (!(index = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET( struct emf_index, offsets[count] ))))
+        goto done;
+    index->count = count;
+    index->band_safe = TRUE;
+    for (offset = 0, count = 0; count < index->count; offset += emr->nSize, count++)
+    {
+        emr = (const ENHMETARECORD *)((const char *)emh + offset);
+        index->offsets[count] = offset;
+        if (!emr_is_band_safe( emr->iType )) index->band_safe = FALSE;
+    }
+    TRACE( "hmf %p: %u records, band safe %u\n", hmf, index->count, index->band_safe );
+    ret = metaObj->index = index;
+
+done:
+    GDI_ReleaseObj( hmf );
+    return ret;
+}
+
 /*****************************************************************************
  *         EMF_GetEnhMetaFile
  *
@@ -2315,7 +2387,7 @@ BOOL WINAPI EnumEnhMetaFile(
     BOOL ret;
     ENHMETAHEADER *emh;
     ENHMETARECORD *emr;
-    DWORD offset;
+    const struct emf_index *index;
     UINT i;
     HANDLETABLE *ht;
     INT savedMode = 0;
@@ -2342,6 +2414,12 @@ BOOL WINAPI EnumEnhMetaFile(
         return FALSE;
     }
 
+    if (!(index = get_emf_index(hmf)))
+    {
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return FALSE;
+    }
+
     info = HeapAlloc( GetProcessHeap(), 0,
 		    sizeof (enum_emh_data) + sizeof(HANDLETABLE) * emh->nHandles );
     if(!info)
@@ -2465,18 +2543,9 @@ BOOL WINAPI EnumEnhMetaFile(
     }
 
     ret = TRUE;
-    offset = 0;
-    while(ret && offset < emh->nBytes)
+    for (i = 0; ret && i < index->count; i++)
     {
-	emr = (ENHMETARECORD *)((char *)emh + offset);
-
-        if (offset + 8 > emh->nBytes ||
-            offset > offset + emr->nSize ||
-            offset + emr->nSize > emh->nBytes)
-        {
-            WARN("record truncated\n");
-            break;
-        }
+	emr = (ENHMETARECORD *)((char *)emh + index->offsets[i]);
 
         /* In Win9x mode we update the xform if the record will produce output */
         if (hdc && IS_WIN9X() && emr_produces_output(emr->iType))
@@ -2484,7 +2553,6 @@ BOOL WINAPI EnumEnhMetaFile(
 
 	TRACE("Calling EnumFunc with record %s, size %d\n", get_emr_name(emr->iType), emr->nSize);
 	ret = (*callback)(hdc, ht, emr, emh->nHandles, (LPARAM)data);
-	offset += emr->nSize;
     }
 
     if (hdc)
@@ -2535,6 +2603,186 @@ static INT CALLBACK EMF_PlayEnhMetaFileCallback(HDC hdc, HANDLETABLE *ht,
     return PlayEnhMetaFileRecord(hdc, ht, emr, handles);
 }
 
+/* Large DIB targets are rendered in horizontal bands on separate threads.
+ * Each band replays the whole metafile into its own DIB, offset so that the
+ * band lands at the top of it, and then copies the rows back. */
+
+#define EMF_BAND_MIN_PIXELS  (1024 * 1024)
+#define EMF_MAX_BANDS        8
+
+struct emf_band
+{
+    HENHMETAFILE      hmf;
+    const DIBSECTION *dib;
+    RECT              rect;       /* placement rectangle, relative to the band */
+    INT               top;        /* first row of the band in the target */
+    INT               height;
+    HPEN              pen;
+    HBRUSH            brush;
+    HFONT             font;
+    INT               bk_mode;
+    INT               char_extra;
+    FLOAT             miter_limit;
+    POINT             brush_org;
+    POINT             cur_pos;
+    BOOL              ret;
+};
+
+/* transfer the DC state that playback doesn't restore, in device coordinates */
+static void get_emf_band_state( HDC hdc, struct emf_band *band, INT top )
+{
+    band->bk_mode = GetBkMode( hdc );
+    band->char_extra = GetTextCharacterExtra( hdc );
+    GetMiterLimit( hdc, &band->miter_limit );
+    GetBrushOrgEx( hdc, &band->brush_org );
+    GetCurrentPositionEx( hdc, &band->cur_pos );
+    band->brush_org.y += top;
+    band->cur_pos.y += top;
+}
+
+static void set_emf_band_state( HDC hdc, const struct emf_band *band, INT top )
+{
+    SetBkMode( hdc, band->bk_mode );
+    SetTextCharacterExtra( hdc, band->char_extra );
+    SetMiterLimit( hdc, band->miter_limit, NULL );
+    SetBrushOrgEx( hdc, band->brush_org.x, band->brush_org.y - top, NULL );
+    MoveToEx( hdc, band->cur_pos.x, band->cur_pos.y - top, NULL );
+}
+
+static BYTE *get_dib_row( const DIBSECTION *dib, INT y )
+{
+    if (dib->dsBmih.biHeight > 0) y = dib->dsBm.bmHeight - 1 - y;
+    return (BYTE *)dib->dsBm.bmBits + y * dib->dsBm.bmWidthBytes;
+}
+
+static DWORD WINAPI play_emf_band( void *arg )
+{
+    struct emf_band *band = arg;
+    const DIBSECTION *dib = band->dib;
+    char buffer[FIELD_OFFSET( BITMAPINFO, bmiColors[3] )];
+    BITMAPINFO *info = (BITMAPINFO *)buffer;
+    HBITMAP bitmap, old_bitmap;
+    BYTE *bits;
+    HDC hdc;
+    INT y;
+
+    band->ret = FALSE;
+    if (!(hdc = CreateCompatibleDC( 0 ))) return 0;
+
+    info->bmiHeader = dib->dsBmih;
+    info->bmiHeader.biHeight = -band->height;
+    info->bmiHeader.biSizeImage = 0;
+    memcpy( info->bmiColors, dib->dsBitfields, sizeof(dib->dsBitfields) );
+    if (!(bitmap = CreateDIBSection( hdc, info, DIB_RGB_COLORS, (void **)&bits, NULL, 0 )))
+    {
+        DeleteDC( hdc );
+        return 0;
+    }
+
+    for (y = 0; y < band->height; y++)
+        memcpy( bits + y * dib->dsBm.bmWidthBytes, get_dib_row( dib, band->top + y ), dib->dsBm.bmWidthBytes );
+
+    old_bitmap = SelectObject( hdc, bitmap );
+    SelectObject( hdc, band->pen );
+    SelectObject( hdc, band->brush );
+    SelectObject( hdc, band->font );
+    set_emf_band_state( hdc, band, band->top );
+
+    band->ret = EnumEnhMetaFile( hdc, band->hmf, EMF_PlayEnhMetaFileCallback, NULL, &band->rect );
+    GdiFlush();
+    get_emf_band_state( hdc, band, band->top );
+
+    for (y = 0; y < band->height; y++)
+        memcpy( get_dib_row( dib, band->top + y ), bits + y * dib->dsBm.bmWidthBytes, dib->dsBm.bmWidthBytes );
+
+    SelectObject( hdc, old_bitmap );
+    DeleteObject( bitmap );
+    DeleteDC( hdc );
+    return 0;
+}
+
+/* returns FALSE if the metafile has to be played the normal way */
+static BOOL play_enh_metafile_banded( HDC hdc, HENHMETAFILE hmf, const RECT *rect, BOOL *ret )
+{
+    struct emf_band bands[EMF_MAX_BANDS];
+    HANDLE threads[EMF_MAX_BANDS];
+    const struct emf_index *index;
+    SYSTEM_INFO system_info;
+    DIBSECTION dib;
+    XFORM xform;
+    POINT pt;
+    HRGN rgn;
+    UINT i, count, started;
+    INT height, band_height;
+    BOOL has_clip;
+
+    if (!hdc || !rect || IS_WIN9X()) return FALSE;
+    if (GetObjectType( hdc ) != OBJ_MEMDC) return FALSE;
+    if (GetObjectW( GetCurrentObject( hdc, OBJ_BITMAP ), sizeof(dib), &dib ) != sizeof(dib)) return FALSE;
+    if (dib.dsBm.bmBitsPixel < 16 || !dib.dsBm.bmBits) return FALSE;
+    height = dib.dsBm.bmHeight;
+    if ((ULONGLONG)dib.dsBm.bmWidth * height < EMF_BAND_MIN_PIXELS) return FALSE;
+
+    GetSystemInfo( &system_info );
+    count = min( system_info.dwNumberOfProcessors, EMF_MAX_BANDS );
+    if (count < 2) return FALSE;
+
+    /* only plain device coordinates, the bands replace the DC state */
+    if (GetMapMode( hdc ) != MM_TEXT || GetLayout( hdc )) return FALSE;
+    GetWorldTransform( hdc, &xform );
+    if (xform.eM11 != 1.0f || xform.eM12 != 0.0f || xform.eM21 != 0.0f || xform.eM22 != 1.0f ||
+        xform.eDx != 0.0f || xform.eDy != 0.0f)
+        return FALSE;
+    GetViewportOrgEx( hdc, &pt );
+    if (pt.x || pt.y) return FALSE;
+    GetWindowOrgEx( hdc, &pt );
+    if (pt.x || pt.y) return FALSE;
+    rgn = CreateRectRgn( 0, 0, 0, 0 );
+    has_clip = GetClipRgn( hdc, rgn ) || GetMetaRgn( hdc, rgn );
+    DeleteObject( rgn );
+    if (has_clip) return FALSE;
+
+    if (!(index = get_emf_index( hmf )) || !index->band_safe) return FALSE;
+
+    GdiFlush();
+    band_height = (height + count - 1) / count;
+    for (i = 0; i < count; i++)
+    {
+        bands[i].hmf = hmf;
+        bands[i].dib = &dib;
+        bands[i].top = i * band_height;
+        bands[i].height = min( band_height, height - bands[i].top );
+        bands[i].rect = *rect;
+        offset_rect( &bands[i].rect, 0, -bands[i].top );
+        bands[i].pen = GetCurrentObject( hdc, OBJ_PEN );
+        bands[i].brush = GetCurrentObject( hdc, OBJ_BRUSH );
+        bands[i].font = GetCurrentObject( hdc, OBJ_FONT );
+        get_emf_band_state( hdc, &bands[i], 0 );
+        bands[i].ret = FALSE;
+        if (bands[i].height <= 0) count = i;
+    }
+
+    TRACE( "playing %p in %u bands of %d rows\n", hmf, count, band_height );
+
+    /* the calling thread renders the first band itself */
+    for (i = 1, started = 1; i < count; i++, started++)
+        if (!(threads[i] = CreateThread( NULL, 0, play_emf_band, &bands[i], 0, NULL ))) break;
+    play_emf_band( &bands[0] );
+    for (i = started; i < count; i++) play_emf_band( &bands[i] );
+
+    *ret = bands[0].ret;
+    for (i = 1; i < started; i++)
+    {
+        WaitForSingleObject( threads[i], INFINITE );
+        CloseHandle( threads[i] );
+    }
+    for (i = 1; i < count; i++) *ret = *ret && bands[i].ret;
+
+    /* leave the DC as the normal playback would */
+    set_emf_band_state( hdc, &bands[0], 0 );
+    return TRUE;
+}
+
 /**************************************************************************
  *    PlayEnhMetaFile  (GDI32.@)
  *
@@ -2551,6 +2799,10 @@ BOOL WINAPI PlayEnhMetaFile(
        const RECT *lpRect /* [in] rectangle to place metafile inside */
       )
 {
+    BOOL ret;
+
+    if (play_enh_metafile_banded( hdc, hmf, lpRect, &ret )) return ret;
+
     return EnumEnhMetaFile(hdc, hmf, EMF_PlayEnhMetaFileCallback, NULL,
 			   lpRect);
 }
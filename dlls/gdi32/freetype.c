@@ -287,6 +287,7 @@ typedef struct tagFace {
     struct tagFamily *family;
     /* Cached data for Enum */
     struct enum_data *cached_enum_data;
+    DWORD id;             /* unique id, used as glyph cache key */
 } Face;
 
 #define ADDFONT_EXTERNAL_FONT 0x01
@@ -436,6 +437,7 @@ struct tagGdiFont {
     ULONG ttc_item_offset; /* 0 if font is not a part of TrueType collection */
     DWORD cache_num;
     DWORD instance_id;
+    DWORD face_id;
     struct font_fileinfo *fileinfo;
 };
 
@@ -468,6 +470,11 @@ static struct list system_links = LIST_INIT(system_links);
 
 static struct list font_subst_list = LIST_INIT(font_subst_list);
 
+static LONG next_face_id;
+
+/* set while the system font list is built for the font index instead of the registry cache */
+static BOOL defer_font_cache;
+
 static struct list font_list = LIST_INIT(font_list);
 
 struct freetype_physdev
@@ -587,6 +594,7 @@ static const WCHAR face_internal_leading_value[] = {'I','n','t','e','r','n','a',
 static const WCHAR face_font_sig_value[] = {'F','o','n','t',' ','S','i','g','n','a','t','u','r','e',0};
 static const WCHAR face_file_name_value[] = {'F','i','l','e',' ','N','a','m','e','\0'};
 static const WCHAR face_full_name_value[] = {'F','u','l','l',' ','N','a','m','e','\0'};
+static const WCHAR font_index_value[] = {'F','o','n','t',' ','I','n','d','e','x',0};
 
 
 struct font_mapping
@@ -1650,6 +1658,7 @@ static void load_face(HKEY hkey_face, WCHAR *face_name, Family *family, void *bu
         face = HeapAlloc(GetProcessHeap(), 0, sizeof(*face));
         face->cached_enum_data = NULL;
         face->family = NULL;
+        face->id = InterlockedIncrement( &next_face_id );
 
         face->refcount = 1;
         face->file = strdupW( buffer );
@@ -1765,16 +1774,26 @@ static void load_font_list_from_cache(HKEY hkey_font_cache)
         if (!RegQueryValueExW(hkey_family, english_name_value, NULL, NULL, (BYTE *)buffer, &size))
             english_family = strdupW( buffer );
 
-        family = create_family(family_name, english_family);
-
-        if(english_family)
+        /* the family may already have been loaded from the font index */
+        if ((family = find_family_from_name(family_name)))
         {
-            FontSubst *subst = HeapAlloc(GetProcessHeap(), 0, sizeof(*subst));
-            subst->from.name = strdupW(english_family);
-            subst->from.charset = -1;
-            subst->to.name = strdupW(family_name);
-            subst->to.charset = -1;
-            add_font_subst(&font_subst_list, subst, 0);
+            family->refcount++;
+            HeapFree(GetProcessHeap(), 0, family_name);
+            HeapFree(GetProcessHeap(), 0, english_family);
+        }
+        else
+        {
+            family = create_family(family_name, english_family);
+
+            if(english_family)
+            {
+                FontSubst *subst = HeapAlloc(GetProcessHeap(), 0, sizeof(*subst));
+                subst->from.name = strdupW(english_family);
+                subst->from.charset = -1;
+                subst->to.name = strdupW(family_name);
+                subst->to.charset = -1;
+                add_font_subst(&font_subst_list, subst, 0);
+            }
         }
 
         size = sizeof(buffer);
@@ -1873,7 +1892,9 @@ static void remove_face_from_cache( Face *face )
 {
     HKEY hkey_family;
 
-    RegOpenKeyExW( hkey_font_cache, face->family->FamilyName, 0, KEY_ALL_ACCESS, &hkey_family );
+    /* faces loaded from the font index are not in the registry cache */
+    if (RegOpenKeyExW( hkey_font_cache, face->family->FamilyName, 0, KEY_ALL_ACCESS, &hkey_family ))
+        return;
 
     if (face->scalable)
     {
@@ -1890,6 +1911,472 @@ static void remove_face_from_cache( Face *face )
     RegCloseKey(hkey_family);
 }
 
+/* Font index
+ *
+ * The system font list is saved to a binary file in the prefix and mapped by
+ * later processes, so that they neither scan the font directories nor load
+ * the registry cache. Like the registry cache, the index is rebuilt by the
+ * first process of each session; later processes also check the modification
+ * times of the directories the fonts were found in. Faces are only opened with
+ * FreeType once they are selected. Fonts added at run time through
+ * AddFontResource are still shared through the registry cache. */
+
+#define FONT_INDEX_MAGIC    0x78646966  /* "fidx" */
+#define FONT_INDEX_VERSION  1
+
+struct font_index_header
+{
+    DWORD     magic;         /* FONT_INDEX_MAGIC */
+    DWORD     version;       /* FONT_INDEX_VERSION */
+    DWORD     size;          /* total size of the file */
+    DWORD     lang;          /* language the face names were read in */
+    DWORD     aa_flags;      /* default anti-aliasing flags */
+    DWORD     dir_count;
+    DWORD     face_count;
+    DWORD     family_count;
+    /* followed by the directories, faces, families and string data */
+};
+
+struct font_index_dir
+{
+    LONGLONG  mtime;         /* modification time, -1 if the directory doesn't exist */
+    DWORD     name;          /* offset of the unix directory name */
+    DWORD     reserved;
+};
+
+struct font_index_face
+{
+    ULONGLONG dev;
+    ULONGLONG ino;
+    DWORD     style_name;    /* string offsets, 0 if not present */
+    DWORD     full_name;
+    DWORD     file;
+    DWORD     face_index;
+    DWORD     ntm_flags;
+    DWORD     font_version;
+    DWORD     flags;
+    FONTSIGNATURE fs;
+    LONG      scalable;
+    LONG      height;
+    LONG      width;
+    LONG      size;
+    LONG      x_ppem;
+    LONG      y_ppem;
+    LONG      internal_leading;
+    DWORD     reserved;
+};
+
+struct font_index_family
+{
+    DWORD     name;
+    DWORD     english_name;
+    DWORD     face_count;    /* number of faces, stored in family order */
+};
+
+/* directories scanned while building the font list */
+static char **font_index_dirs;
+static unsigned int font_index_dir_count, font_index_dir_size;
+
+static char *get_font_index_path(void)
+{
+    static const char name[] = "/fontindex";
+    const char *config_dir = wine_get_config_dir();
+    char *path;
+
+    if (!config_dir) return NULL;
+    if (!(path = HeapAlloc( GetProcessHeap(), 0, strlen(config_dir) + sizeof(name) ))) return NULL;
+    strcpy( path, config_dir );
+    strcat( path, name );
+    return path;
+}
+
+static void add_font_index_dir( const char *dir )
+{
+    unsigned int i;
+
+    for (i = 0; i < font_index_dir_count; i++)
+        if (!strcmp( font_index_dirs[i], dir )) return;
+
+    if (font_index_dir_count == font_index_dir_size)
+    {
+        unsigned int new_size = max( 16, font_index_dir_size * 2 );
+        char **new_dirs;
+
+        if (font_index_dirs)
+            new_dirs = HeapReAlloc( GetProcessHeap(), 0, font_index_dirs, new_size * sizeof(*new_dirs) );
+        else
+            new_dirs = HeapAlloc( GetProcessHeap(), 0, new_size * sizeof(*new_dirs) );
+        if (!new_dirs) return;
+        font_index_dirs = new_dirs;
+        font_index_dir_size = new_size;
+    }
+    if ((font_index_dirs[font_index_dir_count] = HeapAlloc( GetProcessHeap(), 0, strlen(dir) + 1 )))
+        strcpy( font_index_dirs[font_index_dir_count++], dir );
+}
+
+static void free_font_index_dirs(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < font_index_dir_count; i++) HeapFree( GetProcessHeap(), 0, font_index_dirs[i] );
+    HeapFree( GetProcessHeap(), 0, font_index_dirs );
+    font_index_dirs = NULL;
+    font_index_dir_count = font_index_dir_size = 0;
+}
+
+static LONGLONG get_dir_mtime( const char *dir )
+{
+    struct stat st;
+
+    if (stat( dir, &st ) == -1) return -1;
+    return st.st_mtime;
+}
+
+static inline BOOL is_indexed_face( const Face *face )
+{
+    return face->file && (face->flags & ADDFONT_ADD_TO_CACHE) && !(face->flags & ADDFONT_ADD_RESOURCE);
+}
+
+/* returns a string stored in the index, or NULL if the offset is invalid */
+static const void *get_font_index_string( const BYTE *data, DWORD size, DWORD offset, BOOL unicode )
+{
+    if (!offset || offset >= size) return NULL;
+    if (unicode)
+    {
+        const WCHAR *str = (const WCHAR *)(data + offset);
+        DWORD i, len = (size - offset) / sizeof(WCHAR);
+
+        if (offset % sizeof(WCHAR)) return NULL;
+        for (i = 0; i < len; i++) if (!str[i]) return str;
+    }
+    else if (memchr( data + offset, 0, size - offset )) return data + offset;
+    return NULL;
+}
+
+static BOOL load_font_index_data( const BYTE *data, DWORD size )
+{
+    const struct font_index_header *header = (const struct font_index_header *)data;
+    const struct font_index_dir *dirs;
+    const struct font_index_face *faces;
+    const struct font_index_family *families;
+    DWORD i, j, face_pos = 0;
+
+    if (size < sizeof(*header) || header->magic != FONT_INDEX_MAGIC ||
+        header->version != FONT_INDEX_VERSION || header->size != size)
+        return FALSE;
+    if (header->lang != GetSystemDefaultLangID() || header->aa_flags != default_aa_flags)
+        return FALSE;
+    if (header->dir_count > size / sizeof(*dirs) || header->face_count > size / sizeof(*faces) ||
+        header->family_count > size / sizeof(*families) ||
+        (ULONGLONG)sizeof(*header) + header->dir_count * sizeof(*dirs) + header->face_count * sizeof(*faces) +
+        header->family_count * sizeof(*families) > size)
+        return FALSE;
+
+    dirs = (const struct font_index_dir *)(header + 1);
+    faces = (const struct font_index_face *)(dirs + header->dir_count);
+    families = (const struct font_index_family *)(faces + header->face_count);
+
+    for (i = 0; i < header->dir_count; i++)
+    {
+        const char *dir = get_font_index_string( data, size, dirs[i].name, FALSE );
+
+        if (!dir || get_dir_mtime( dir ) != dirs[i].mtime)
+        {
+            TRACE( "%s changed, ignoring font index\n", debugstr_a(dir) );
+            return FALSE;
+        }
+    }
+
+    /* validate everything before touching the font list */
+    for (i = 0; i < header->family_count; i++)
+    {
+        if (!get_font_index_string( data, size, families[i].name, TRUE )) return FALSE;
+        if (families[i].english_name && !get_font_index_string( data, size, families[i].english_name, TRUE ))
+            return FALSE;
+        if (families[i].face_count > header->face_count - face_pos) return FALSE;
+        for (j = face_pos; j < face_pos + families[i].face_count; j++)
+        {
+            if (!get_font_index_string( data, size, faces[j].style_name, TRUE ) ||
+                !get_font_index_string( data, size, faces[j].file, TRUE ))
+                return FALSE;
+            if (faces[j].full_name && !get_font_index_string( data, size, faces[j].full_name, TRUE ))
+                return FALSE;
+        }
+        face_pos += families[i].face_count;
+    }
+
+    for (i = 0, face_pos = 0; i < header->family_count; i++)
+    {
+        const WCHAR *english = get_font_index_string( data, size, families[i].english_name, TRUE );
+        Family *family = create_family( strdupW( get_font_index_string( data, size, families[i].name, TRUE )),
+                                        english ? strdupW( english ) : NULL );
+
+        if (english)
+        {
+            FontSubst *subst = HeapAlloc( GetProcessHeap(), 0, sizeof(*subst) );
+            subst->from.name = strdupW( english );
+            subst->from.charset = -1;
+            subst->to.name = strdupW( family->FamilyName );
+            subst->to.charset = -1;
+            add_font_subst( &font_subst_list, subst, 0 );
+        }
+
+        for (j = 0; j < families[i].face_count; j++)
+        {
+            const struct font_index_face *src = &faces[face_pos++];
+            const WCHAR *full_name = get_font_index_string( data, size, src->full_name, TRUE );
+            Face *face = HeapAlloc( GetProcessHeap(), 0, sizeof(*face) );
+
+            face->refcount = 1;
+            face->id = InterlockedIncrement( &next_face_id );
+            face->StyleName = strdupW( get_font_index_string( data, size, src->style_name, TRUE ));
+            face->FullName = full_name ? strdupW( full_name ) : NULL;
+            face->file = strdupW( get_font_index_string( data, size, src->file, TRUE ));
+            face->dev = src->dev;
+            face->ino = src->ino;
+            face->font_data_ptr = NULL;
+            face->font_data_size = 0;
+            face->face_index = src->face_index;
+            face->fs = src->fs;
+            face->ntmFlags = src->ntm_flags;
+            face->font_version = (LONG)src->font_version;
+            face->scalable = src->scalable;
+            face->size.height = src->height;
+            face->size.width = src->width;
+            face->size.size = src->size;
+            face->size.x_ppem = src->x_ppem;
+            face->size.y_ppem = src->y_ppem;
+            face->size.internal_leading = src->internal_leading;
+            face->flags = src->flags;
+            face->family = NULL;
+            face->cached_enum_data = NULL;
+
+            if (insert_face_in_family_list( face, family ))
+                TRACE( "Added font %s %s\n", debugstr_w(family->FamilyName), debugstr_w(face->StyleName) );
+            release_face( face );
+        }
+        release_family( family );
+    }
+
+    TRACE( "loaded %u families, %u faces\n", header->family_count, header->face_count );
+    return TRUE;
+}
+
+static BOOL load_font_index(void)
+{
+    char *path = get_font_index_path();
+    struct stat st;
+    void *data;
+    BOOL ret = FALSE;
+    int fd;
+
+    if (!path) return FALSE;
+    fd = open( path, O_RDONLY );
+    HeapFree( GetProcessHeap(), 0, path );
+    if (fd == -1) return FALSE;
+
+    if (!fstat( fd, &st ) && st.st_size >= sizeof(struct font_index_header) && st.st_size <= 0x7fffffff)
+    {
+        data = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if (data != MAP_FAILED)
+        {
+            ret = load_font_index_data( data, st.st_size );
+            munmap( data, st.st_size );
+        }
+    }
+    close( fd );
+    return ret;
+}
+
+struct font_index_strings
+{
+    BYTE  *data;
+    DWORD  base;   /* offset of the string data in the file */
+    DWORD  size;
+    DWORD  alloc;
+};
+
+static DWORD add_font_index_string( struct font_index_strings *strings, const void *str, DWORD len )
+{
+    DWORD offset = (strings->size + sizeof(WCHAR) - 1) & ~(sizeof(WCHAR) - 1);
+
+    if (offset + len > strings->alloc)
+    {
+        DWORD new_alloc = max( offset + len, strings->alloc * 2 );
+        BYTE *new_data;
+
+        if (strings->data) new_data = HeapReAlloc( GetProcessHeap(), 0, strings->data, new_alloc );
+        else new_data = HeapAlloc( GetProcessHeap(), 0, new_alloc );
+        if (!new_data) return 0;
+        strings->data = new_data;
+        strings->alloc = new_alloc;
+    }
+    memset( strings->data + strings->size, 0, offset - strings->size );
+    memcpy( strings->data + offset, str, len );
+    strings->size = offset + len;
+    return strings->base + offset;
+}
+
+static inline DWORD add_font_index_stringW( struct font_index_strings *strings, const WCHAR *str )
+{
+    if (!str) return 0;
+    return add_font_index_string( strings, str, (strlenW( str ) + 1) * sizeof(WCHAR) );
+}
+
+static BOOL write_font_index( const char *path, const struct font_index_header *header,
+                              const struct font_index_dir *dirs, const struct font_index_face *faces,
+                              const struct font_index_family *families, const struct font_index_strings *strings )
+{
+    char *tmp_path = HeapAlloc( GetProcessHeap(), 0, strlen(path) + sizeof(".tmp") );
+    BOOL ret;
+    int fd;
+
+    if (!tmp_path) return FALSE;
+    strcpy( tmp_path, path );
+    strcat( tmp_path, ".tmp" );
+
+    if ((fd = open( tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0666 )) == -1)
+    {
+        HeapFree( GetProcessHeap(), 0, tmp_path );
+        return FALSE;
+    }
+    ret = write( fd, header, sizeof(*header) ) == sizeof(*header) &&
+          write( fd, dirs, header->dir_count * sizeof(*dirs) ) == header->dir_count * sizeof(*dirs) &&
+          write( fd, faces, header->face_count * sizeof(*faces) ) == header->face_count * sizeof(*faces) &&
+          write( fd, families, header->family_count * sizeof(*families) ) == header->family_count * sizeof(*families) &&
+          write( fd, strings->data, strings->size ) == strings->size;
+    close( fd );
+
+    /* replace the index atomically, processes may be mapping it */
+    if (!ret || rename( tmp_path, path ) == -1)
+    {
+        unlink( tmp_path );
+        ret = FALSE;
+    }
+    HeapFree( GetProcessHeap(), 0, tmp_path );
+    return ret;
+}
+
+static void add_font_list_to_cache(void)
+{
+    Family *family;
+    Face *face;
+
+    LIST_FOR_EACH_ENTRY( family, &font_list, Family, entry )
+        LIST_FOR_EACH_ENTRY( face, &family->faces, Face, entry )
+            if (face->flags & ADDFONT_ADD_TO_CACHE) add_face_to_cache( face );
+}
+
+static BOOL save_font_index(void)
+{
+    struct font_index_header header;
+    struct font_index_dir *dirs = NULL;
+    struct font_index_face *faces = NULL;
+    struct font_index_family *families = NULL;
+    struct font_index_strings strings = { NULL };
+    Family *family;
+    Face *face;
+    char *path, *dir, *p;
+    DWORD i, face_pos = 0, family_pos = 0;
+    BOOL ret = FALSE;
+
+    if (!(path = get_font_index_path())) return FALSE;
+
+    memset( &header, 0, sizeof(header) );
+    header.magic = FONT_INDEX_MAGIC;
+    header.version = FONT_INDEX_VERSION;
+    header.lang = GetSystemDefaultLangID();
+    header.aa_flags = default_aa_flags;
+
+    LIST_FOR_EACH_ENTRY( family, &font_list, Family, entry )
+    {
+        BOOL indexed = FALSE;
+
+        LIST_FOR_EACH_ENTRY( face, &family->faces, Face, entry )
+        {
+            if (!is_indexed_face( face )) continue;
+            header.face_count++;
+            indexed = TRUE;
+
+            /* fonts from the registry or fontconfig can live outside of the scanned directories */
+            if (!(dir = strWtoA( CP_UNIXCP, face->file ))) goto done;
+            if ((p = strrchr( dir, '/' )) && p != dir)
+            {
+                *p = 0;
+                add_font_index_dir( dir );
+            }
+            HeapFree( GetProcessHeap(), 0, dir );
+        }
+        if (indexed) header.family_count++;
+    }
+    header.dir_count = font_index_dir_count;
+
+    if (!(dirs = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, max( 1, header.dir_count ) * sizeof(*dirs) )) ||
+        !(faces = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, max( 1, header.face_count ) * sizeof(*faces) )) ||
+        !(families = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, max( 1, header.family_count ) * sizeof(*families) )))
+        goto done;
+
+    strings.base = sizeof(header) + header.dir_count * sizeof(*dirs) + header.face_count * sizeof(*faces) +
+                   header.family_count * sizeof(*families);
+
+    for (i = 0; i < header.dir_count; i++)
+    {
+        dirs[i].mtime = get_dir_mtime( font_index_dirs[i] );
+        if (!(dirs[i].name = add_font_index_string( &strings, font_index_dirs[i], strlen(font_index_dirs[i]) + 1 )))
+            goto done;
+    }
+
+    LIST_FOR_EACH_ENTRY( family, &font_list, Family, entry )
+    {
+        struct font_index_family *dst_family = NULL;
+
+        LIST_FOR_EACH_ENTRY( face, &family->faces, Face, entry )
+        {
+            struct font_index_face *dst = &faces[face_pos];
+
+            if (!is_indexed_face( face )) continue;
+            if (!dst_family) dst_family = &families[family_pos++];
+            dst->dev = face->dev;
+            dst->ino = face->ino;
+            if (!(dst->style_name = add_font_index_stringW( &strings, face->StyleName ))) goto done;
+            if (!(dst->file = add_font_index_stringW( &strings, face->file ))) goto done;
+            if (face->FullName && !(dst->full_name = add_font_index_stringW( &strings, face->FullName )))
+                goto done;
+            dst->face_index = face->face_index;
+            dst->ntm_flags = face->ntmFlags;
+            dst->font_version = face->font_version;
+            dst->flags = face->flags;
+            dst->fs = face->fs;
+            dst->scalable = face->scalable;
+            dst->height = face->size.height;
+            dst->width = face->size.width;
+            dst->size = face->size.size;
+            dst->x_ppem = face->size.x_ppem;
+            dst->y_ppem = face->size.y_ppem;
+            dst->internal_leading = face->size.internal_leading;
+            dst_family->face_count++;
+            face_pos++;
+        }
+        if (!dst_family) continue;
+        if (!(dst_family->name = add_font_index_stringW( &strings, family->FamilyName ))) goto done;
+        if (family->EnglishName && !(dst_family->english_name = add_font_index_stringW( &strings, family->EnglishName )))
+            goto done;
+    }
+
+    header.size = strings.base + strings.size;
+    ret = write_font_index( path, &header, dirs, faces, families, &strings );
+    TRACE( "saved %u families, %u faces, %u directories: %u\n",
+           header.family_count, header.face_count, header.dir_count, ret );
+
+done:
+    HeapFree( GetProcessHeap(), 0, strings.data );
+    HeapFree( GetProcessHeap(), 0, families );
+    HeapFree( GetProcessHeap(), 0, faces );
+    HeapFree( GetProcessHeap(), 0, dirs );
+    HeapFree( GetProcessHeap(), 0, path );
+    return ret;
+}
+
 static WCHAR *prepend_at(WCHAR *family)
 {
     WCHAR *str;
@@ -2087,6 +2574,7 @@ static Face *create_face( FT_Face ft_face, FT_Long face_index, const char *file,
     Face *face = HeapAlloc( GetProcessHeap(), 0, sizeof(*face) );
 
     face->refcount = 1;
+    face->id = InterlockedIncrement( &next_face_id );
     face->StyleName = get_face_name( ft_face, TT_NAME_ID_FONT_SUBFAMILY, GetSystemDefaultLangID() );
     if (!face->StyleName) face->StyleName = towstr( CP_ACP, ft_face->style_name );
 
@@ -2154,7 +2642,7 @@ static void AddFaceToList(FT_Face ft_face, const char *file, void *font_data_ptr
 
     if (insert_face_in_family_list( face, family ))
     {
-        if (flags & ADDFONT_ADD_TO_CACHE)
+        if ((flags & ADDFONT_ADD_TO_CACHE) && !defer_font_cache)
             add_face_to_cache( face );
 
         TRACE("Added font %s %s\n", debugstr_w(family->FamilyName),
@@ -2725,6 +3213,7 @@ static BOOL ReadFontDir(const char *dirname, BOOL external_fonts)
 
     TRACE("Loading fonts from %s\n", debugstr_a(dirname));
 
+    add_font_index_dir(dirname);
     dir = opendir(dirname);
     if(!dir) {
         WARN("Can't open directory %s\n", debugstr_a(dirname));
@@ -4376,7 +4865,7 @@ static void reorder_font_list(void)
 BOOL WineEngInit(void)
 {
     HKEY hkey;
-    DWORD disposition;
+    DWORD disposition, index;
     HANDLE font_mutex;
 
     /* update locale dependent font info in registry */
@@ -4414,8 +4903,33 @@ BOOL WineEngInit(void)
 
     create_font_cache_key(&hkey_font_cache, &disposition);
 
-    if(disposition == REG_CREATED_NEW_KEY)
-        init_font_list();
+    if(disposition == REG_CREATED_NEW_KEY || reg_load_dword(hkey_font_cache, font_index_value, &index) == ERROR_SUCCESS)
+    {
+        /* the registry cache doesn't contain the system fonts, get them from the font index,
+         * which the first process of the session rebuilds since fonts may have been replaced */
+        BOOL indexed = disposition != REG_CREATED_NEW_KEY && load_font_index();
+
+        if (!indexed)
+        {
+            defer_font_cache = TRUE;
+            init_font_list();
+            defer_font_cache = FALSE;
+            indexed = save_font_index();
+            free_font_index_dirs();
+        }
+
+        /* fonts added through AddFontResource by other processes */
+        if (disposition != REG_CREATED_NEW_KEY)
+            load_font_list_from_cache(hkey_font_cache);
+
+        if (indexed)
+            reg_save_dword(hkey_font_cache, font_index_value, 1);
+        else
+        {
+            add_font_list_to_cache();
+            RegDeleteValueW(hkey_font_cache, font_index_value);
+        }
+    }
     else
         load_font_list_from_cache(hkey_font_cache);
 
@@ -4582,6 +5096,7 @@ static FT_Face OpenFontFace(GdiFont *font, Face *face, LONG width, LONG height)
 
     /* set it here, as load_VDMX needs it */
     font->ft_face = ft_face;
+    font->face_id = face->id;
 
     if(FT_IS_SCALABLE(ft_face)) {
         FT_ULong len;
@@ -4751,6 +5266,163 @@ static void set_cached_metrics( GdiFont *font, UINT index, const GLYPHMETRICS *g
     font->gm[block][entry].init = TRUE;
 }
 
+/* Process-wide cache of rendered glyph bitmaps. Unlike the FONT_GM metrics
+ * cache it is not tied to a GdiFont, so it survives fonts dropping out of
+ * the unused font list. Entries are keyed by everything that affects the
+ * rendering and evicted in LRU order once the cache exceeds its size. */
+
+#define GLYPH_CACHE_BUCKETS   1024
+#define GLYPH_CACHE_MAX_SIZE  (4 * 1024 * 1024)
+
+struct glyph_cache_key
+{
+    DWORD     face_id;       /* face the glyph is rendered from */
+    DWORD     font_face_id;  /* face of the selected font, differs for linked fonts */
+    FONT_DESC font_desc;
+    MAT2      matrix;
+    UINT      index;
+    UINT      format;
+    FT_Int    load_flags;
+    BOOL      tategaki;
+};
+
+struct glyph_cache_entry
+{
+    struct list            entry;      /* entry in the hash bucket */
+    struct list            lru_entry;  /* entry in the LRU list, most recent first */
+    struct glyph_cache_key key;
+    DWORD                  hash;
+    GLYPHMETRICS           gm;
+    ABC                    abc;
+    DWORD                  size;
+    BYTE                   data[1];
+};
+
+static struct list glyph_cache_buckets[GLYPH_CACHE_BUCKETS];
+static struct list glyph_cache_lru = LIST_INIT(glyph_cache_lru);
+static SIZE_T glyph_cache_size;
+static DWORD glyph_cache_count, glyph_cache_hits, glyph_cache_misses;
+
+static BOOL is_glyph_bitmap_format( UINT format )
+{
+    switch (format)
+    {
+    case GGO_BITMAP:
+    case GGO_GRAY2_BITMAP:
+    case GGO_GRAY4_BITMAP:
+    case GGO_GRAY8_BITMAP:
+    case WINE_GGO_GRAY16_BITMAP:
+    case WINE_GGO_HRGB_BITMAP:
+    case WINE_GGO_HBGR_BITMAP:
+    case WINE_GGO_VRGB_BITMAP:
+    case WINE_GGO_VBGR_BITMAP:
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static DWORD hash_glyph_cache_key( const struct glyph_cache_key *key )
+{
+    const BYTE *ptr = (const BYTE *)key;
+    DWORD i, hash = 2166136261u;
+
+    for (i = 0; i < sizeof(*key); i++) hash = (hash ^ ptr[i]) * 16777619;
+    return hash;
+}
+
+static void init_glyph_cache_key( struct glyph_cache_key *key, const GdiFont *incoming_font,
+                                  const GdiFont *font, UINT index, UINT format, FT_Int load_flags,
+                                  BOOL tategaki, const MAT2 *matrix )
+{
+    /* the key is hashed and compared as raw memory, clear the padding */
+    memset( key, 0, sizeof(*key) );
+    key->face_id      = font->face_id;
+    key->font_face_id = incoming_font->face_id;
+    key->font_desc    = incoming_font->font_desc;
+    key->matrix       = *matrix;
+    key->index        = index;
+    key->format       = format;
+    key->load_flags   = load_flags;
+    key->tategaki     = tategaki;
+}
+
+static void trace_glyph_cache_stats(void)
+{
+    if ((glyph_cache_hits + glyph_cache_misses) % 1024) return;
+    TRACE( "%u hits, %u misses, %u glyphs, %u bytes\n", glyph_cache_hits, glyph_cache_misses,
+           glyph_cache_count, (DWORD)glyph_cache_size );
+}
+
+static BOOL get_cached_glyph( const struct glyph_cache_key *key, GLYPHMETRICS *gm, ABC *abc,
+                              DWORD buflen, BYTE *buf, DWORD *needed )
+{
+    struct glyph_cache_entry *cached;
+    DWORD hash = hash_glyph_cache_key( key );
+    struct list *bucket = &glyph_cache_buckets[hash % GLYPH_CACHE_BUCKETS];
+
+    if (!bucket->next) list_init( bucket );
+
+    LIST_FOR_EACH_ENTRY( cached, bucket, struct glyph_cache_entry, entry )
+    {
+        if (cached->hash != hash || memcmp( &cached->key, key, sizeof(*key) )) continue;
+
+        glyph_cache_hits++;
+        trace_glyph_cache_stats();
+        list_remove( &cached->lru_entry );
+        list_add_head( &glyph_cache_lru, &cached->lru_entry );
+
+        /* same results as get_mono_glyph_bitmap() and friends */
+        if (!buf || !buflen) *needed = cached->size;
+        else if (!cached->size || cached->size > buflen) *needed = GDI_ERROR;
+        else
+        {
+            memcpy( buf, cached->data, cached->size );
+            memset( buf + cached->size, 0, buflen - cached->size );
+            *needed = cached->size;
+        }
+        if (*needed != GDI_ERROR) *gm = cached->gm;
+        *abc = cached->abc;
+        return TRUE;
+    }
+
+    glyph_cache_misses++;
+    trace_glyph_cache_stats();
+    return FALSE;
+}
+
+static void add_cached_glyph( const struct glyph_cache_key *key, const GLYPHMETRICS *gm,
+                              const ABC *abc, const BYTE *data, DWORD size )
+{
+    struct glyph_cache_entry *cached;
+    DWORD hash = hash_glyph_cache_key( key );
+
+    if (size > GLYPH_CACHE_MAX_SIZE / 16) return;
+
+    while (glyph_cache_size + size > GLYPH_CACHE_MAX_SIZE && !list_empty( &glyph_cache_lru ))
+    {
+        cached = LIST_ENTRY( list_tail( &glyph_cache_lru ), struct glyph_cache_entry, lru_entry );
+        list_remove( &cached->entry );
+        list_remove( &cached->lru_entry );
+        glyph_cache_size -= cached->size;
+        glyph_cache_count--;
+        HeapFree( GetProcessHeap(), 0, cached );
+    }
+
+    if (!(cached = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET( struct glyph_cache_entry, data[size] ))))
+        return;
+    cached->key  = *key;
+    cached->hash = hash;
+    cached->gm   = *gm;
+    cached->abc  = *abc;
+    cached->size = size;
+    memcpy( cached->data, data, size );
+
+    list_add_head( &glyph_cache_buckets[hash % GLYPH_CACHE_BUCKETS], &cached->entry );
+    list_add_head( &glyph_cache_lru, &cached->lru_entry );
+    glyph_cache_size += size;
+    glyph_cache_count++;
+}
+
 static DWORD get_font_data( GdiFont *font, DWORD table, DWORD offset, LPVOID buf, DWORD cbData)
 {
     FT_Face ft_face = font->ft_face;
@@ -7536,6 +8208,8 @@ static DWORD get_glyph_outline(GdiFont *incoming_font, UINT glyph, UINT format,
     BOOL needsTransform = FALSE;
     BOOL tategaki = (font->name[0] == '@');
     BOOL vertical_metrics;
+    BOOL cacheable;
+    struct glyph_cache_key cache_key;
 
     TRACE("%p, %04x, %08x, %p, %08x, %p, %p\n", font, glyph, format, lpgm,
 	  buflen, buf, lpmat);
@@ -7570,6 +8244,14 @@ static DWORD get_glyph_outline(GdiFont *incoming_font, UINT glyph, UINT format,
         get_cached_metrics( font, glyph_index, lpgm, abc ))
         return 1; /* FIXME */
 
+    if ((cacheable = is_glyph_bitmap_format( format )))
+    {
+        init_glyph_cache_key( &cache_key, incoming_font, font, glyph_index, format,
+                              load_flags, tategaki, lpmat );
+        if (get_cached_glyph( &cache_key, lpgm, abc, buflen, buf, &needed ))
+            return needed;
+    }
+
     needsTransform = get_transform_matrices( font, tategaki, lpmat, matrices );
 
     vertical_metrics = (tategaki && FT_HAS_VERTICAL(ft_face));
@@ -7699,6 +8381,9 @@ static DWORD get_glyph_outline(GdiFont *incoming_font, UINT glyph, UINT format,
     if (needed != GDI_ERROR)
         *lpgm = gm;
 
+    if (cacheable && needed != GDI_ERROR && buf && buflen)
+        add_cached_glyph( &cache_key, &gm, abc, buf, needed );
+
     return needed;
 }
 
@@ -370,6 +370,8 @@ static BOOL REGION_UnionRegion(WINEREGION *d, WINEREGION *s1, WINEREGION *s2);
 static BOOL REGION_SubtractRegion(WINEREGION *d, WINEREGION *s1, WINEREGION *s2);
 static BOOL REGION_XorRegion(WINEREGION *d, WINEREGION *s1, WINEREGION *s2);
 static BOOL REGION_UnionRectWithRegion(const RECT *rect, WINEREGION *rgn);
+static INT REGION_Coalesce(WINEREGION *pReg, INT prevStart, INT curStart);
+static void REGION_SetExtents(WINEREGION *pReg);
 
 /***********************************************************************
  *            get_region_type
@@ -929,6 +931,126 @@ static void translate( POINT *pt, UINT count, const XFORM *xform )
     }
 }
 
+/* check whether a rectangle list is already sorted in y-x banded order */
+static BOOL is_banded_rect_list( const RECT *rects, UINT count )
+{
+    UINT i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (rects[i].left >= rects[i].right || rects[i].top >= rects[i].bottom) return FALSE;
+        if (!i) continue;
+        if (rects[i].top == rects[i - 1].top)
+        {
+            if (rects[i].bottom != rects[i - 1].bottom) return FALSE;
+            if (rects[i].left <= rects[i - 1].right) return FALSE;
+        }
+        else if (rects[i].top < rects[i - 1].bottom) return FALSE;
+    }
+    return TRUE;
+}
+
+/* copy a banded rectangle list into an empty region, merging identical adjacent bands */
+static BOOL copy_banded_rects( WINEREGION *rgn, const RECT *rects, UINT count )
+{
+    UINT start, end;
+    INT cur_band, prev_band = 0;
+
+    if (!grow_region( rgn, count )) return FALSE;
+
+    for (start = 0; start < count; start = end)
+    {
+        for (end = start + 1; end < count; end++)
+            if (rects[end].top != rects[start].top) break;
+
+        cur_band = rgn->numRects;
+        memcpy( rgn->rects + cur_band, rects + start, (end - start) * sizeof(RECT) );
+        rgn->numRects += end - start;
+        if (cur_band) prev_band = REGION_Coalesce( rgn, prev_band, cur_band );
+    }
+    REGION_SetExtents( rgn );
+    return TRUE;
+}
+
+/***********************************************************************
+ *           REGION_UnionRects
+ *
+ * Union an arbitrary list of rectangles into an empty region. Sorted input
+ * is copied directly, anything else is merged in halves so that the cost
+ * stays close to n log n instead of growing quadratically.
+ */
+static BOOL REGION_UnionRects( WINEREGION *rgn, const RECT *rects, UINT count )
+{
+    WINEREGION first, second;
+    UINT i, half;
+    BOOL ret;
+
+    if (is_banded_rect_list( rects, count )) return copy_banded_rects( rgn, rects, count );
+
+    if (count <= 64)
+    {
+        for (i = 0; i < count; i++)
+        {
+            if (rects[i].left >= rects[i].right || rects[i].top >= rects[i].bottom) continue;
+            if (!REGION_UnionRectWithRegion( &rects[i], rgn )) return FALSE;
+        }
+        return TRUE;
+    }
+
+    half = count / 2;
+    init_region( &first, 0 );
+    init_region( &second, 0 );
+    ret = REGION_UnionRects( &first, rects, half ) &&
+          REGION_UnionRects( &second, rects + half, count - half ) &&
+          REGION_UnionRegion( rgn, &first, &second );
+    destroy_region( &first );
+    destroy_region( &second );
+    return ret;
+}
+
+/* build a region from transformed rectangles with a single scan conversion */
+static HRGN create_transformed_region( const XFORM *xform, const RECT *rects, UINT count )
+{
+    POINT *pts;
+    INT *counts;
+    UINT i, nb_polygons = 0;
+    HRGN hrgn = 0;
+
+    if (count > INT_MAX / (4 * sizeof(POINT))) return 0;
+    pts = HeapAlloc( GetProcessHeap(), 0, count * 4 * sizeof(*pts) );
+    counts = HeapAlloc( GetProcessHeap(), 0, count * sizeof(*counts) );
+    if (!pts || !counts) goto done;
+
+    for (i = 0; i < count; i++)
+    {
+        POINT *pt = pts + 4 * nb_polygons;
+        RECT rc = rects[i];
+
+        /* all polygons must have the same orientation for the winding rule to yield their union */
+        order_rect( &rc );
+        if (rc.left == rc.right || rc.top == rc.bottom) continue;
+
+        pt[0].x = rc.left;
+        pt[0].y = rc.top;
+        pt[1].x = rc.right;
+        pt[1].y = rc.top;
+        pt[2].x = rc.right;
+        pt[2].y = rc.bottom;
+        pt[3].x = rc.left;
+        pt[3].y = rc.bottom;
+        translate( pt, 4, xform );
+        counts[nb_polygons++] = 4;
+    }
+
+    if (nb_polygons) hrgn = create_polypolygon_region( pts, counts, nb_polygons, WINDING, NULL );
+    if (!hrgn) hrgn = CreateRectRgn( 0, 0, 0, 0 );
+
+done:
+    HeapFree( GetProcessHeap(), 0, pts );
+    HeapFree( GetProcessHeap(), 0, counts );
+    return hrgn;
+}
+
 
 /***********************************************************************
  *           ExtCreateRegion   (GDI32.@)
@@ -951,7 +1073,6 @@ HRGN WINAPI ExtCreateRegion( const XFORM* lpXform, DWORD dwCount, const RGNDATA*
 {
     HRGN hrgn = 0;
     WINEREGION *obj;
-    const RECT *pCurRect, *pEndRect;
 
     if (!rgndata)
     {
@@ -967,45 +1088,11 @@ HRGN WINAPI ExtCreateRegion( const XFORM* lpXform, DWORD dwCount, const RGNDATA*
         WARN("(Unsupported region data type: %u)\n", rgndata->rdh.iType);
 
     if (lpXform)
-    {
-        const RECT *pCurRect, *pEndRect;
+        return create_transformed_region( lpXform, (const RECT *)rgndata->Buffer, rgndata->rdh.nCount );
 
-        hrgn = CreateRectRgn( 0, 0, 0, 0 );
+    if (!(obj = alloc_region( 0 ))) return 0;
 
-        pEndRect = (const RECT *)rgndata->Buffer + rgndata->rdh.nCount;
-        for (pCurRect = (const RECT *)rgndata->Buffer; pCurRect < pEndRect; pCurRect++)
-        {
-            static const INT count = 4;
-            HRGN poly_hrgn;
-            POINT pt[4];
-
-            pt[0].x = pCurRect->left;
-            pt[0].y = pCurRect->top;
-            pt[1].x = pCurRect->right;
-            pt[1].y = pCurRect->top;
-            pt[2].x = pCurRect->right;
-            pt[2].y = pCurRect->bottom;
-            pt[3].x = pCurRect->left;
-            pt[3].y = pCurRect->bottom;
-
-            translate( pt, 4, lpXform );
-            poly_hrgn = CreatePolyPolygonRgn( pt, &count, 1, WINDING );
-            CombineRgn( hrgn, hrgn, poly_hrgn, RGN_OR );
-            DeleteObject( poly_hrgn );
-        }
-        return hrgn;
-    }
-
-    if (!(obj = alloc_region( rgndata->rdh.nCount ))) return 0;
-
-    pEndRect = (const RECT *)rgndata->Buffer + rgndata->rdh.nCount;
-    for(pCurRect = (const RECT *)rgndata->Buffer; pCurRect < pEndRect; pCurRect++)
-    {
-        if (pCurRect->left < pCurRect->right && pCurRect->top < pCurRect->bottom)
-        {
-            if (!REGION_UnionRectWithRegion( pCurRect, obj )) goto done;
-        }
-    }
+    if (!REGION_UnionRects( obj, (const RECT *)rgndata->Buffer, rgndata->rdh.nCount )) goto done;
     hrgn = alloc_gdi_handle( obj, OBJ_REGION, &region_funcs );
 
 done:
@@ -1152,11 +1239,57 @@ BOOL WINAPI EqualRgn( HRGN hrgn1, HRGN hrgn2 )
 static BOOL REGION_UnionRectWithRegion(const RECT *rect, WINEREGION *rgn)
 {
     WINEREGION region;
+    RECT *last;
+    INT band;
+
+    if (rect->left < rect->right && rect->top < rect->bottom)
+    {
+        /* fast paths for rectangles added in banded order, which keep the region
+         * canonical by only touching its last band */
+        if (!rgn->numRects)
+        {
+            rgn->rects[0] = rgn->extents = *rect;
+            rgn->numRects = 1;
+            return TRUE;
+        }
+
+        last = &rgn->rects[rgn->numRects - 1];
+        for (band = rgn->numRects - 1; band > 0; band--)
+            if (rgn->rects[band - 1].top != last->top) break;
+
+        if (rect->top >= rgn->extents.bottom)
+        {
+            /* new band below the region */
+            if (!add_rect( rgn, rect->left, rect->top, rect->right, rect->bottom )) return FALSE;
+            REGION_Coalesce( rgn, band, rgn->numRects - 1 );
+            goto done;
+        }
+        if (rect->top == last->top && rect->bottom == last->bottom && rect->left >= last->right)
+        {
+            /* extend the last band to the right */
+            if (rect->left == last->right) last->right = rect->right;
+            else if (!add_rect( rgn, rect->left, rect->top, rect->right, rect->bottom )) return FALSE;
+
+            if (band > 0)
+            {
+                INT prev = band - 1;
+                while (prev > 0 && rgn->rects[prev - 1].top == rgn->rects[band - 1].top) prev--;
+                REGION_Coalesce( rgn, prev, band );
+            }
+            goto done;
+        }
+    }
 
     init_region( &region, 1 );
     region.numRects = 1;
     region.extents = *region.rects = *rect;
     return REGION_UnionRegion(rgn, rgn, &region);
+
+done:
+    rgn->extents.left = min( rgn->extents.left, rect->left );
+    rgn->extents.right = max( rgn->extents.right, rect->right );
+    rgn->extents.bottom = max( rgn->extents.bottom, rect->bottom );
+    return TRUE;
 }
 
 
@@ -2032,6 +2165,48 @@ static BOOL REGION_UnionO (WINEREGION *pReg, RECT *r1, RECT *r1End,
 #undef MERGERECT
 }
 
+/***********************************************************************
+ *	     REGION_AppendRegion
+ *
+ * Union of two regions where the second one lies entirely below the first,
+ * which reduces to concatenating the bands and merging them at the seam.
+ */
+static BOOL REGION_AppendRegion(WINEREGION *newReg, WINEREGION *upper, WINEREGION *lower)
+{
+    WINEREGION tmp;
+    WINEREGION *dst = newReg;
+    INT prevStart, curStart;
+    RECT extents;
+
+    extents.left = min( upper->extents.left, lower->extents.left );
+    extents.top = upper->extents.top;
+    extents.right = max( upper->extents.right, lower->extents.right );
+    extents.bottom = lower->extents.bottom;
+
+    if (newReg == lower)
+    {
+        if (!init_region( &tmp, upper->numRects + lower->numRects )) return FALSE;
+        dst = &tmp;
+    }
+    if (!REGION_CopyRegion( dst, upper ) || !grow_region( dst, upper->numRects + lower->numRects ))
+    {
+        if (dst == &tmp) destroy_region( &tmp );
+        return FALSE;
+    }
+
+    curStart = dst->numRects;
+    for (prevStart = curStart - 1; prevStart > 0; prevStart--)
+        if (dst->rects[prevStart - 1].top != dst->rects[curStart - 1].top) break;
+
+    memcpy( dst->rects + curStart, lower->rects, lower->numRects * sizeof(RECT) );
+    dst->numRects += lower->numRects;
+    REGION_Coalesce( dst, prevStart, curStart );
+
+    if (dst == &tmp) move_rects( newReg, &tmp );
+    newReg->extents = extents;
+    return TRUE;
+}
+
 /***********************************************************************
  *	     REGION_UnionRegion
  */
@@ -2089,6 +2264,14 @@ static BOOL REGION_UnionRegion(WINEREGION *newReg, WINEREGION *reg1, WINEREGION
 	return ret;
     }
 
+    /*
+     * One region lies entirely below the other
+     */
+    if (reg2->extents.top >= reg1->extents.bottom)
+        return REGION_AppendRegion(newReg, reg1, reg2);
+    if (reg1->extents.top >= reg2->extents.bottom)
+        return REGION_AppendRegion(newReg, reg2, reg1);
+
     if ((ret = REGION_RegionOp (newReg, reg1, reg2, REGION_UnionO, REGION_UnionNonO, REGION_UnionNonO)))
     {
         newReg->extents.left = min(reg1->extents.left, reg2->extents.left);
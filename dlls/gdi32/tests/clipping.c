@@ -291,6 +291,91 @@ static void test_ExtCreateRegion(void)
 
 }
 
+static HRGN create_region_from_rects(const XFORM *xform, const RECT *rects, DWORD count)
+{
+    DWORD size = FIELD_OFFSET(RGNDATA, Buffer[count * sizeof(RECT)]);
+    RGNDATA *data = HeapAlloc(GetProcessHeap(), 0, size);
+    HRGN hrgn;
+
+    data->rdh.dwSize = sizeof(data->rdh);
+    data->rdh.iType = RDH_RECTANGLES;
+    data->rdh.nCount = count;
+    data->rdh.nRgnSize = count * sizeof(RECT);
+    SetRectEmpty(&data->rdh.rcBound);
+    memcpy(data->Buffer, rects, count * sizeof(RECT));
+    hrgn = ExtCreateRegion(xform, size, data);
+    HeapFree(GetProcessHeap(), 0, data);
+    return hrgn;
+}
+
+static void test_ExtCreateRegion_many_rects(void)
+{
+    static const XFORM xform = { 0.5, 0.0, 0.0, 1.5, 10.0, 20.0 };
+    static const int orders[] = { 1, -1, 7 };
+    RECT rects[2000];
+    HRGN hrgn, expect, tmp;
+    DWORD count, size;
+    RGNDATA *data;
+    int i, j, k, ret;
+
+    for (k = 0; k < sizeof(orders) / sizeof(orders[0]); k++)
+    {
+        /* overlapping rows of rectangles, including some that exactly continue their neighbours */
+        count = sizeof(rects) / sizeof(rects[0]);
+        for (i = 0; i < count; i++)
+        {
+            j = (i * orders[k] + count) % count;
+            SetRect(&rects[i], (j % 10) * 20, (j / 10) * 3, (j % 10) * 20 + 10 + (j % 3) * 5, (j / 10) * 3 + 4);
+        }
+
+        expect = CreateRectRgn(0, 0, 0, 0);
+        for (i = 0; i < count; i++)
+        {
+            tmp = CreateRectRgnIndirect(&rects[i]);
+            CombineRgn(expect, expect, tmp, RGN_OR);
+            DeleteObject(tmp);
+        }
+
+        hrgn = create_region_from_rects(NULL, rects, count);
+        ok(hrgn != 0, "%d: ExtCreateRegion error %u\n", k, GetLastError());
+        ok(EqualRgn(hrgn, expect), "%d: regions differ\n", k);
+
+        /* the result must be the canonical y-x banded form */
+        size = GetRegionData(hrgn, 0, NULL);
+        data = HeapAlloc(GetProcessHeap(), 0, size);
+        ret = GetRegionData(hrgn, size, data);
+        ok(ret == size, "%d: GetRegionData returned %d\n", k, ret);
+        for (i = 1; i < data->rdh.nCount; i++)
+        {
+            const RECT *prev = (const RECT *)data->Buffer + i - 1, *cur = prev + 1;
+            if (cur->top == prev->top)
+                ok(cur->bottom == prev->bottom && cur->left > prev->right,
+                   "%d: bad rect %s after %s\n", k, wine_dbgstr_rect(cur), wine_dbgstr_rect(prev));
+            else
+                ok(cur->top >= prev->bottom,
+                   "%d: bad rect %s after %s\n", k, wine_dbgstr_rect(cur), wine_dbgstr_rect(prev));
+        }
+        HeapFree(GetProcessHeap(), 0, data);
+        DeleteObject(hrgn);
+        DeleteObject(expect);
+
+        /* transformed rectangles */
+        count = 100;
+        expect = CreateRectRgn(0, 0, 0, 0);
+        for (i = 0; i < count; i++)
+        {
+            tmp = create_region_from_rects(&xform, &rects[i], 1);
+            CombineRgn(expect, expect, tmp, RGN_OR);
+            DeleteObject(tmp);
+        }
+        hrgn = create_region_from_rects(&xform, rects, count);
+        ok(hrgn != 0, "%d: ExtCreateRegion error %u\n", k, GetLastError());
+        ok(EqualRgn(hrgn, expect), "%d: transformed regions differ\n", k);
+        DeleteObject(hrgn);
+        DeleteObject(expect);
+    }
+}
+
 static void test_GetClipRgn(void)
 {
     HDC hdc;
@@ -538,6 +623,7 @@ START_TEST(clipping)
 {
     test_GetRandomRgn();
     test_ExtCreateRegion();
+    test_ExtCreateRegion_many_rects();
     test_GetClipRgn();
     test_memory_dc_clipping();
     test_window_dc_clipping();
@@ -3516,11 +3516,71 @@ static void test_simple_graphics(void)
     DeleteDC(mem_dc);
 }
 
+static void benchmark_primitives(void)
+{
+    static const char text[] = "The quick brown fox jumps over the lazy dog";
+    char bmibuf[sizeof(BITMAPINFO) + 256 * sizeof(RGBQUAD)];
+    BITMAPINFO *bmi = (BITMAPINFO *)bmibuf;
+    BLENDFUNCTION blend = { AC_SRC_OVER, 0, 0x80, AC_SRC_ALPHA };
+    HDC hdc, src_dc;
+    HBITMAP dib, src_dib, orig_bm, orig_src;
+    HFONT font, orig_font;
+    DWORD *bits, *src_bits, start, i;
+
+    memset( bmibuf, 0, sizeof(bmibuf) );
+    bmi->bmiHeader.biSize        = sizeof(bmi->bmiHeader);
+    bmi->bmiHeader.biWidth       = 1024;
+    bmi->bmiHeader.biHeight      = -1024;
+    bmi->bmiHeader.biPlanes      = 1;
+    bmi->bmiHeader.biBitCount    = 32;
+    bmi->bmiHeader.biCompression = BI_RGB;
+
+    hdc = CreateCompatibleDC( 0 );
+    src_dc = CreateCompatibleDC( 0 );
+    dib = CreateDIBSection( 0, bmi, DIB_RGB_COLORS, (void **)&bits, NULL, 0 );
+    src_dib = CreateDIBSection( 0, bmi, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+    orig_bm = SelectObject( hdc, dib );
+    orig_src = SelectObject( src_dc, src_dib );
+    for (i = 0; i < 1024 * 1024; i++) src_bits[i] = (i * 0x01020304) | 0x40000000;
+
+    start = GetTickCount();
+    for (i = 0; i < 100; i++) GdiAlphaBlend( hdc, 0, 0, 1024, 1024, src_dc, 0, 0, 1024, 1024, blend );
+    trace( "AlphaBlend per-pixel alpha: %u ms\n", GetTickCount() - start );
+
+    blend.SourceConstantAlpha = 0x40;
+    blend.AlphaFormat = 0;
+    start = GetTickCount();
+    for (i = 0; i < 100; i++) GdiAlphaBlend( hdc, 0, 0, 1024, 1024, src_dc, 0, 0, 1024, 1024, blend );
+    trace( "AlphaBlend constant alpha: %u ms\n", GetTickCount() - start );
+
+    SelectObject( hdc, GetStockObject( GRAY_BRUSH ));
+    start = GetTickCount();
+    for (i = 0; i < 100; i++) PatBlt( hdc, 0, 0, 1024, 1024, PATINVERT );
+    trace( "PatBlt PATINVERT: %u ms\n", GetTickCount() - start );
+
+    font = CreateFontA( 24, 0, 0, 0, FW_NORMAL, 0, 0, 0, ANSI_CHARSET, 0, 0,
+                        ANTIALIASED_QUALITY, 0, "Tahoma" );
+    orig_font = SelectObject( hdc, font );
+    SetBkMode( hdc, TRANSPARENT );
+    start = GetTickCount();
+    for (i = 0; i < 10000; i++) ExtTextOutA( hdc, 0, (i % 40) * 25, 0, NULL, text, strlen(text), NULL );
+    trace( "ExtTextOut anti-aliased: %u ms\n", GetTickCount() - start );
+
+    DeleteObject( SelectObject( hdc, orig_font ));
+    SelectObject( src_dc, orig_src );
+    SelectObject( hdc, orig_bm );
+    DeleteObject( src_dib );
+    DeleteObject( dib );
+    DeleteDC( src_dc );
+    DeleteDC( hdc );
+}
+
 START_TEST(dib)
 {
     CryptAcquireContextW(&crypt_prov, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT);
 
     test_simple_graphics();
+    if (winetest_interactive) benchmark_primitives();
 
     CryptReleaseContext(crypt_prov, 0);
 }
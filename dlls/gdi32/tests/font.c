@@ -5774,6 +5774,57 @@ static void test_fullname2(void)
 
 }
 
+static void test_GetGlyphOutline_repeated(void)
+{
+    static const MAT2 identity = { {0,1}, {0,0}, {0,0}, {0,1} };
+    static const UINT formats[] = { GGO_BITMAP, GGO_GRAY2_BITMAP, GGO_GRAY4_BITMAP, GGO_GRAY8_BITMAP };
+    BYTE buf[2][4096];
+    GLYPHMETRICS gm[2];
+    LOGFONTA lf;
+    HFONT hfont, old_hfont;
+    DWORD size, ret;
+    HDC hdc;
+    UINT i, j;
+
+    if (!is_truetype_font_installed("Tahoma"))
+    {
+        skip("Tahoma is not installed\n");
+        return;
+    }
+
+    hdc = CreateCompatibleDC(0);
+    memset(&lf, 0, sizeof(lf));
+    lf.lfHeight = 36;
+    lstrcpyA(lf.lfFaceName, "Tahoma");
+
+    for (i = 0; i < ARRAY_SIZE(formats); i++)
+    {
+        /* rendering a glyph again, also with a new font object, gives the same results */
+        for (j = 0; j < 2; j++)
+        {
+            hfont = CreateFontIndirectA(&lf);
+            old_hfont = SelectObject(hdc, hfont);
+
+            memset(&gm[j], 0xcc, sizeof(gm[j]));
+            size = GetGlyphOutlineA(hdc, 'A', formats[i], &gm[j], 0, NULL, &identity);
+            ok(size != GDI_ERROR && size <= sizeof(buf[j]), "%u: got size %u\n", formats[i], size);
+            memset(buf[j], 0xcc, sizeof(buf[j]));
+            ret = GetGlyphOutlineA(hdc, 'A', formats[i], &gm[j], sizeof(buf[j]), buf[j], &identity);
+            ok(ret == size, "%u: expected %u, got %u\n", formats[i], size, ret);
+
+            ret = GetGlyphOutlineA(hdc, 'A', formats[i], &gm[j], size - 1, buf[j], &identity);
+            ok(ret == GDI_ERROR, "%u: expected GDI_ERROR, got %u\n", formats[i], ret);
+
+            SelectObject(hdc, old_hfont);
+            DeleteObject(hfont);
+        }
+        ok(!memcmp(&gm[0], &gm[1], sizeof(gm[0])), "%u: glyph metrics differ\n", formats[i]);
+        ok(!memcmp(buf[0], buf[1], size), "%u: glyph bitmaps differ\n", formats[i]);
+    }
+
+    DeleteDC(hdc);
+}
+
 static void test_GetGlyphOutline_empty_contour(void)
 {
     HDC hdc;
@@ -7250,6 +7301,7 @@ START_TEST(font)
     test_RealizationInfo();
     test_GetTextFace();
     test_GetGlyphOutline();
+    test_GetGlyphOutline_repeated();
     test_GetTextMetrics2("Tahoma", -11);
     test_GetTextMetrics2("Tahoma", -55);
     test_GetTextMetrics2("Tahoma", -110);
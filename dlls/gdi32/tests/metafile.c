@@ -4281,6 +4281,99 @@ static void test_emf_WorldTransform(void)
     }
 }
 
+static void test_emf_large_dib(void)
+{
+    static const POINT poly[] = { {100, 900}, {700, 50}, {1200, 950}, {50, 300}, {1250, 300} };
+    static const char text[] = "Enhanced metafile";
+    BITMAPINFO info;
+    HDC hdc_emf, hdc[2];
+    HBITMAP bitmap[2], old_bitmap[2];
+    HBRUSH brush;
+    HPEN pen;
+    HRGN rgn;
+    HENHMETAFILE hemf;
+    RECT rect;
+    POINT pos[2];
+    DWORD *bits[2];
+    SYSTEM_INFO si;
+    BOOL ret;
+    int i, bk_mode[2];
+
+    /* Wine only renders in bands when there is more than one CPU */
+    GetSystemInfo(&si);
+    if (si.dwNumberOfProcessors < 2)
+        skip("Single CPU, the banded playback can't be tested.\n");
+
+    hdc_emf = CreateEnhMetaFileA(0, NULL, NULL, NULL);
+    ok(hdc_emf != 0, "CreateEnhMetaFileA error %d\n", GetLastError());
+
+    brush = CreateHatchBrush(HS_DIAGCROSS, RGB(0, 0, 255));
+    SelectObject(hdc_emf, brush);
+    pen = CreatePen(PS_DASH, 1, RGB(255, 0, 0));
+    SelectObject(hdc_emf, pen);
+    Ellipse(hdc_emf, 10, 10, 1200, 1000);
+    SetPolyFillMode(hdc_emf, WINDING);
+    Polygon(hdc_emf, poly, ARRAY_SIZE(poly));
+    rgn = CreateEllipticRgn(200, 200, 1000, 900);
+    ExtSelectClipRgn(hdc_emf, rgn, RGN_COPY);
+    DeleteObject(rgn);
+    SelectObject(hdc_emf, GetStockObject(GRAY_BRUSH));
+    Rectangle(hdc_emf, 100, 100, 1100, 600);
+    SetBkMode(hdc_emf, TRANSPARENT);
+    for (i = 0; i < 20; i++) TextOutA(hdc_emf, 150 + i * 10, 150 + i * 40, text, strlen(text));
+    MoveToEx(hdc_emf, 0, 0, NULL);
+    LineTo(hdc_emf, 1279, 1023);
+    SelectObject(hdc_emf, GetStockObject(BLACK_PEN));
+    SelectObject(hdc_emf, GetStockObject(WHITE_BRUSH));
+    DeleteObject(pen);
+    DeleteObject(brush);
+
+    hemf = CloseEnhMetaFile(hdc_emf);
+    ok(hemf != 0, "CloseEnhMetaFile error %d\n", GetLastError());
+
+    memset(&info, 0, sizeof(info));
+    info.bmiHeader.biSize = sizeof(info.bmiHeader);
+    info.bmiHeader.biWidth = 1280;
+    info.bmiHeader.biHeight = 1024;
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+    SetRect(&rect, 0, 0, 1280, 1024);
+
+    /* large DIBs may be rendered in bands, a clip region forces the normal playback */
+    for (i = 0; i < 2; i++)
+    {
+        hdc[i] = CreateCompatibleDC(0);
+        bitmap[i] = CreateDIBSection(hdc[i], &info, DIB_RGB_COLORS, (void **)&bits[i], NULL, 0);
+        ok(bitmap[i] != 0, "CreateDIBSection error %d\n", GetLastError());
+        old_bitmap[i] = SelectObject(hdc[i], bitmap[i]);
+        FillRect(hdc[i], &rect, GetStockObject(WHITE_BRUSH));
+        if (i)
+        {
+            rgn = CreateRectRgnIndirect(&rect);
+            SelectClipRgn(hdc[i], rgn);
+            DeleteObject(rgn);
+        }
+        ret = PlayEnhMetaFile(hdc[i], hemf, &rect);
+        ok(ret, "PlayEnhMetaFile failed\n");
+        GetCurrentPositionEx(hdc[i], &pos[i]);
+        bk_mode[i] = GetBkMode(hdc[i]);
+    }
+
+    ok(!memcmp(bits[0], bits[1], 1280 * 1024 * 4), "playback results differ\n");
+    ok(pos[0].x == pos[1].x && pos[0].y == pos[1].y, "got position %d,%d and %d,%d\n",
+       pos[0].x, pos[0].y, pos[1].x, pos[1].y);
+    ok(bk_mode[0] == bk_mode[1], "got bk mode %d and %d\n", bk_mode[0], bk_mode[1]);
+
+    for (i = 0; i < 2; i++)
+    {
+        SelectObject(hdc[i], old_bitmap[i]);
+        DeleteObject(bitmap[i]);
+        DeleteDC(hdc[i]);
+    }
+    DeleteEnhMetaFile(hemf);
+}
+
 START_TEST(metafile)
 {
     init_function_pointers();
@@ -4298,6 +4391,7 @@ START_TEST(metafile)
     test_emf_PolyPolyline();
     test_emf_GradientFill();
     test_emf_WorldTransform();
+    test_emf_large_dib();
 
     /* For win-format metafiles (mfdrv) */
     test_mf_SaveDC();
@@ -1115,6 +1115,12 @@ static GpStatus brush_fill_path(GpGraphics *graphics, GpBrush *brush)
     return status;
 }
 
+static BOOL is_antialiased(GpGraphics *graphics)
+{
+    return graphics->smoothing == SmoothingModeAntiAlias ||
+           graphics->smoothing == SmoothingModeHighQuality;
+}
+
 static BOOL brush_can_fill_pixels(GpBrush *brush)
 {
     switch (brush->bt)
@@ -3944,7 +3950,8 @@ GpStatus WINGDIPAPI GdipDrawPath(GpGraphics *graphics, GpPen *pen, GpPath *path)
 
     if (graphics->image && graphics->image->type == ImageTypeMetafile)
         retval = METAFILE_DrawPath((GpMetafile*)graphics->image, pen, path);
-    else if (!graphics->hdc || graphics->alpha_hdc || !brush_can_fill_path(pen->brush, FALSE))
+    else if (!graphics->hdc || graphics->alpha_hdc || !brush_can_fill_path(pen->brush, FALSE) ||
+             (is_antialiased(graphics) && brush_can_fill_pixels(pen->brush)))
         retval = SOFTWARE_GdipDrawPath(graphics, pen, path);
     else
         retval = GDI32_GdipDrawPath(graphics, pen, path);
@@ -4230,6 +4237,311 @@ end:
     return retval;
 }
 
+/* Number of sub-scanlines sampled per pixel row by the coverage rasterizer.
+ * Horizontal coverage is computed exactly with 8 bits of precision. */
+#define COVERAGE_SUBSAMPLES 4
+
+struct coverage_edge
+{
+    REAL x, y;      /* top end point */
+    REAL dxdy;
+    INT first, end; /* sub-scanlines crossed by the edge */
+    INT dir;
+};
+
+struct coverage_crossing
+{
+    REAL x;
+    INT dir;
+};
+
+static int compare_coverage_edges(const void *a, const void *b)
+{
+    const struct coverage_edge *edge1 = a, *edge2 = b;
+    return edge1->first - edge2->first;
+}
+
+static void add_coverage_edge(struct coverage_edge *edges, INT *count, const GpPointF *p1,
+    const GpPointF *p2, const GpRect *bounds)
+{
+    struct coverage_edge *edge = &edges[*count];
+    const GpPointF *top = p1, *bottom = p2;
+    REAL first, end;
+
+    if (p1->Y == p2->Y) return;
+    if (p1->Y > p2->Y)
+    {
+        top = p2;
+        bottom = p1;
+    }
+
+    /* sub-scanline s samples the row at bounds->Y + (s + 0.5) / COVERAGE_SUBSAMPLES */
+    first = ceilf((top->Y - bounds->Y) * COVERAGE_SUBSAMPLES - 0.5f);
+    end = ceilf((bottom->Y - bounds->Y) * COVERAGE_SUBSAMPLES - 0.5f);
+    if (first < 0.0f) first = 0.0f;
+    if (end > bounds->Height * COVERAGE_SUBSAMPLES) end = bounds->Height * COVERAGE_SUBSAMPLES;
+    if (first >= end) return;
+
+    edge->x = top->X;
+    edge->y = top->Y;
+    edge->dxdy = (bottom->X - top->X) / (bottom->Y - top->Y);
+    edge->first = first;
+    edge->end = end;
+    edge->dir = (top == p1) ? 1 : -1;
+    (*count)++;
+}
+
+/* Accumulate a span covering [x1, x2) on one sub-scanline, in 1/256 pixel units. */
+static void add_coverage_span(INT *partial, INT *full, INT width, REAL x1, REAL x2)
+{
+    INT start, end, i1, i2;
+
+    if (x1 < 0.0f) x1 = 0.0f;
+    if (x2 > width) x2 = width;
+    if (x1 >= x2) return;
+
+    start = gdip_round(x1 * 256.0f);
+    end = gdip_round(x2 * 256.0f);
+    if (start >= end) return;
+
+    i1 = start >> 8;
+    i2 = end >> 8;
+    if (i1 == i2)
+    {
+        partial[i1] += end - start;
+        return;
+    }
+    partial[i1] += 256 - (start & 0xff);
+    full[i1 + 1] += 256;
+    full[i2] -= 256;
+    partial[i2] += end & 0xff;
+}
+
+/* Scan converts a flattened device space path into a coverage mask of the
+ * given bounds, one byte per pixel. */
+static GpStatus rasterize_path_coverage(const GpPath *path, const GpRect *bounds, BYTE *mask)
+{
+    const GpPointF *points = path->pathdata.Points;
+    const BYTE *types = path->pathdata.Types;
+    struct coverage_edge *edges, **active;
+    struct coverage_crossing *crossings;
+    INT *partial, *full;
+    INT i, j, count = 0, next_edge = 0, active_count = 0, start = 0, sub;
+    GpStatus stat = Ok;
+
+    edges = heap_alloc(path->pathdata.Count * sizeof(*edges));
+    active = heap_alloc(path->pathdata.Count * sizeof(*active));
+    crossings = heap_alloc(path->pathdata.Count * sizeof(*crossings));
+    partial = heap_alloc_zero((bounds->Width + 2) * sizeof(*partial));
+    full = heap_alloc_zero((bounds->Width + 2) * sizeof(*full));
+    if (!edges || !active || !crossings || !partial || !full)
+    {
+        stat = OutOfMemory;
+        goto done;
+    }
+
+    /* every figure is implicitly closed when filling */
+    for (i = 0; i < path->pathdata.Count; i++)
+    {
+        INT next = i + 1;
+
+        if ((types[i] & PathPointTypePathTypeMask) == PathPointTypeStart)
+            start = i;
+        if (next == path->pathdata.Count || (types[next] & PathPointTypePathTypeMask) == PathPointTypeStart)
+            next = start;
+        add_coverage_edge(edges, &count, &points[i], &points[next], bounds);
+    }
+
+    qsort(edges, count, sizeof(*edges), compare_coverage_edges);
+
+    for (sub = 0; sub < bounds->Height * COVERAGE_SUBSAMPLES; sub++)
+    {
+        REAL y = bounds->Y + (sub + 0.5f) / COVERAGE_SUBSAMPLES;
+        INT winding = 0;
+        REAL span_start = 0.0f;
+
+        for (i = j = 0; i < active_count; i++)
+            if (active[i]->end > sub) active[j++] = active[i];
+        active_count = j;
+        while (next_edge < count && edges[next_edge].first <= sub)
+            active[active_count++] = &edges[next_edge++];
+
+        /* the crossings are nearly sorted from one sub-scanline to the next */
+        for (i = 0; i < active_count; i++)
+        {
+            struct coverage_crossing crossing;
+
+            crossing.x = active[i]->x + (y - active[i]->y) * active[i]->dxdy - bounds->X;
+            crossing.dir = active[i]->dir;
+            for (j = i; j > 0 && crossings[j - 1].x > crossing.x; j--)
+                crossings[j] = crossings[j - 1];
+            crossings[j] = crossing;
+        }
+
+        for (i = 0; i < active_count; i++)
+        {
+            BOOL inside, was_inside;
+
+            if (path->fill == FillModeAlternate)
+            {
+                was_inside = winding & 1;
+                winding += crossings[i].dir;
+                inside = winding & 1;
+            }
+            else
+            {
+                was_inside = winding != 0;
+                winding += crossings[i].dir;
+                inside = winding != 0;
+            }
+
+            if (inside && !was_inside)
+                span_start = crossings[i].x;
+            else if (!inside && was_inside)
+                add_coverage_span(partial, full, bounds->Width, span_start, crossings[i].x);
+        }
+
+        if (sub % COVERAGE_SUBSAMPLES == COVERAGE_SUBSAMPLES - 1)
+        {
+            BYTE *row = mask + (sub / COVERAGE_SUBSAMPLES) * bounds->Width;
+            INT sum = 0, value;
+
+            for (i = 0; i < bounds->Width; i++)
+            {
+                sum += full[i];
+                value = sum + partial[i];
+                row[i] = min(255, (value * 255 + COVERAGE_SUBSAMPLES * 128) / (COVERAGE_SUBSAMPLES * 256));
+            }
+            memset(partial, 0, (bounds->Width + 2) * sizeof(*partial));
+            memset(full, 0, (bounds->Width + 2) * sizeof(*full));
+        }
+    }
+
+done:
+    heap_free(edges);
+    heap_free(active);
+    heap_free(crossings);
+    heap_free(partial);
+    heap_free(full);
+    return stat;
+}
+
+/* Scale the alpha of the brush pixels by the coverage; fully covered and
+ * empty runs are the common case and are handled without multiplying. */
+static void apply_coverage_mask(DWORD *pixels, const BYTE *mask, INT count)
+{
+    INT i;
+
+    for (i = 0; i < count; i++)
+    {
+        DWORD alpha;
+
+        if (mask[i] == 0xff) continue;
+        if (!mask[i])
+        {
+            pixels[i] = 0;
+            continue;
+        }
+        alpha = ((pixels[i] >> 24) * mask[i] + 127) / 255;
+        pixels[i] = (pixels[i] & 0x00ffffff) | (alpha << 24);
+    }
+}
+
+static GpStatus SOFTWARE_GdipFillPathAntialiased(GpGraphics *graphics, GpBrush *brush, GpPath *path)
+{
+    GpStatus stat;
+    GpPath *flat_path;
+    GpMatrix world_to_device;
+    GpRectF graphics_bounds;
+    GpRect bound_rect;
+    REAL min_x, min_y, max_x, max_y, offset;
+    INT i, left, top, right, bottom;
+    DWORD *pixel_data;
+    BYTE *mask;
+
+    stat = gdi_transform_acquire(graphics);
+    if (stat != Ok)
+        return stat;
+
+    stat = get_graphics_device_bounds(graphics, &graphics_bounds);
+
+    if (stat == Ok)
+        stat = get_graphics_transform(graphics, WineCoordinateSpaceGdiDevice,
+            CoordinateSpaceWorld, &world_to_device);
+
+    /* unless pixels are offset by half, integer coordinates are pixel centers */
+    offset = (graphics->pixeloffset == PixelOffsetModeHalf ||
+              graphics->pixeloffset == PixelOffsetModeHighQuality) ? 0.0f : 0.5f;
+
+    if (stat == Ok)
+        stat = GdipTranslateMatrix(&world_to_device, offset, offset, MatrixOrderAppend);
+
+    if (stat == Ok)
+        stat = GdipClonePath(path, &flat_path);
+
+    if (stat != Ok)
+    {
+        gdi_transform_release(graphics);
+        return stat;
+    }
+
+    stat = GdipFlattenPath(flat_path, &world_to_device, 0.25);
+
+    if (stat == Ok && flat_path->pathdata.Count)
+    {
+        min_x = max_x = flat_path->pathdata.Points[0].X;
+        min_y = max_y = flat_path->pathdata.Points[0].Y;
+        for (i = 1; i < flat_path->pathdata.Count; i++)
+        {
+            min_x = min(min_x, flat_path->pathdata.Points[i].X);
+            min_y = min(min_y, flat_path->pathdata.Points[i].Y);
+            max_x = max(max_x, flat_path->pathdata.Points[i].X);
+            max_y = max(max_y, flat_path->pathdata.Points[i].Y);
+        }
+
+        left = max(floorf(min_x), graphics_bounds.X);
+        top = max(floorf(min_y), graphics_bounds.Y);
+        right = min(ceilf(max_x), graphics_bounds.X + graphics_bounds.Width);
+        bottom = min(ceilf(max_y), graphics_bounds.Y + graphics_bounds.Height);
+
+        if (left < right && top < bottom)
+        {
+            bound_rect.X = left;
+            bound_rect.Y = top;
+            bound_rect.Width = right - left;
+            bound_rect.Height = bottom - top;
+
+            mask = heap_alloc(bound_rect.Width * bound_rect.Height);
+            pixel_data = heap_alloc_zero(sizeof(*pixel_data) * bound_rect.Width * bound_rect.Height);
+
+            if (!mask || !pixel_data)
+                stat = OutOfMemory;
+
+            if (stat == Ok)
+                stat = rasterize_path_coverage(flat_path, &bound_rect, mask);
+
+            if (stat == Ok)
+                stat = brush_fill_pixels(graphics, brush, pixel_data, &bound_rect, bound_rect.Width);
+
+            if (stat == Ok)
+            {
+                apply_coverage_mask(pixel_data, mask, bound_rect.Width * bound_rect.Height);
+
+                stat = alpha_blend_pixels(graphics, bound_rect.X, bound_rect.Y, (BYTE *)pixel_data,
+                    bound_rect.Width, bound_rect.Height, bound_rect.Width * 4, PixelFormat32bppARGB);
+            }
+
+            heap_free(mask);
+            heap_free(pixel_data);
+        }
+    }
+
+    GdipDeletePath(flat_path);
+    gdi_transform_release(graphics);
+
+    return stat;
+}
+
 static GpStatus SOFTWARE_GdipFillPath(GpGraphics *graphics, GpBrush *brush, GpPath *path)
 {
     GpStatus stat;
@@ -4238,6 +4550,9 @@ static GpStatus SOFTWARE_GdipFillPath(GpGraphics *graphics, GpBrush *brush, GpPa
     if (!brush_can_fill_pixels(brush))
         return NotImplemented;
 
+    if (is_antialiased(graphics))
+        return SOFTWARE_GdipFillPathAntialiased(graphics, brush, path);
+
     /* FIXME: This could probably be done more efficiently without regions. */
 
     stat = GdipCreateRegionPath(path, &rgn);
@@ -4270,7 +4585,8 @@ GpStatus WINGDIPAPI GdipFillPath(GpGraphics *graphics, GpBrush *brush, GpPath *p
     if (graphics->image && graphics->image->type == ImageTypeMetafile)
         return METAFILE_FillPath((GpMetafile*)graphics->image, brush, path);
 
-    if (!graphics->image && !graphics->alpha_hdc)
+    if (!graphics->image && !graphics->alpha_hdc &&
+        !(is_antialiased(graphics) && brush_can_fill_pixels(brush)))
         stat = GDI32_GdipFillPath(graphics, brush, path);
 
     if (stat == NotImplemented)
@@ -6091,6 +6091,57 @@ static void test_GdipFillRectangles(void)
     ReleaseDC(hwnd, hdc);
 }
 
+static void test_antialiased_fill(void)
+{
+    static const SmoothingMode modes[] = { SmoothingModeNone, SmoothingModeAntiAlias };
+    GpStatus status;
+    GpGraphics *graphics;
+    GpBitmap *bitmap;
+    GpBrush *brush;
+    ARGB color;
+    int i;
+
+    status = GdipCreateSolidFill(0xffff0000, (GpSolidFill **)&brush);
+    expect(Ok, status);
+
+    for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
+    {
+        status = GdipCreateBitmapFromScan0(16, 16, 0, PixelFormat32bppARGB, NULL, &bitmap);
+        expect(Ok, status);
+        status = GdipGetImageGraphicsContext((GpImage *)bitmap, &graphics);
+        expect(Ok, status);
+
+        status = GdipSetSmoothingMode(graphics, modes[i]);
+        expect(Ok, status);
+        status = GdipSetPixelOffsetMode(graphics, PixelOffsetModeHalf);
+        expect(Ok, status);
+
+        /* left and right edges split pixels 2 and 6 in half */
+        status = GdipFillRectangle(graphics, brush, 2.5, 2.0, 4.0, 4.0);
+        expect(Ok, status);
+        GdipDeleteGraphics(graphics);
+
+        status = GdipBitmapGetPixel(bitmap, 4, 3, &color);
+        expect(Ok, status);
+        expect(0xffff0000, color);
+
+        status = GdipBitmapGetPixel(bitmap, 10, 10, &color);
+        expect(Ok, status);
+        expect(0, color);
+
+        status = GdipBitmapGetPixel(bitmap, 2, 3, &color);
+        expect(Ok, status);
+        if (modes[i] == SmoothingModeAntiAlias)
+            ok((color >> 24) > 0x60 && (color >> 24) < 0xa0, "got %08x\n", color);
+        else
+            ok((color >> 24) == 0 || (color >> 24) == 0xff, "got %08x\n", color);
+
+        GdipDisposeImage((GpImage *)bitmap);
+    }
+
+    GdipDeleteBrush(brush);
+}
+
 static void test_GdipGetVisibleClipBounds_memoryDC(void)
 {
     HDC hdc,dc;
@@ -6876,6 +6927,7 @@ START_TEST(graphics)
     test_alpha_hdc();
     test_bitmapfromgraphics();
     test_GdipFillRectangles();
+    test_antialiased_fill();
     test_GdipGetVisibleClipBounds_memoryDC();
     test_GdipFillRectanglesOnMemoryDCSolidBrush();
     test_GdipFillRectanglesOnMemoryDCTextureBrush();
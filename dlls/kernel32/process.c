@@ -2299,8 +2299,12 @@ static BOOL create_process( HANDLE hFile, LPSECURITY_ATTRIBUTES psa, LPSECURITY_
     NTSTATUS status;
     BOOL success = FALSE;
     HANDLE process_info, process_handle = 0;
-    struct object_attributes *objattr;
-    data_size_t attr_len;
+    struct object_attributes *objattr, *thread_objattr;
+    data_size_t attr_len, thread_attr_len;
+    struct __server_batch batch;
+    struct __server_request_info process_call, thread_call;
+    struct new_process_request *process_req;
+    struct new_thread_request *thread_req;
     WCHAR *env_end;
     char *winedebug = NULL;
     startup_info_t *startup_info;
@@ -2347,51 +2351,48 @@ static BOOL create_process( HANDLE hFile, LPSECURITY_ATTRIBUTES psa, LPSECURITY_
     wine_server_send_fd( socketfd[1] );
     close( socketfd[1] );
 
-    /* create the process on the server side */
+    /* create the process and its first thread on the server side */
 
     alloc_object_attributes( psa, &objattr, &attr_len );
-    SERVER_START_REQ( new_process )
-    {
-        req->inherit_all    = inherit;
-        req->create_flags   = flags;
-        req->socket_fd      = socketfd[1];
-        req->exe_file       = wine_server_obj_handle( hFile );
-        req->access         = PROCESS_ALL_ACCESS;
-        req->cpu            = pe_info->cpu;
-        req->info_size      = startup_info_size;
-        wine_server_add_data( req, objattr, attr_len );
-        wine_server_add_data( req, startup_info, startup_info_size );
-        wine_server_add_data( req, params->Environment, (env_end - params->Environment) * sizeof(WCHAR) );
-        if (!(status = wine_server_call( req )))
-        {
-            info->dwProcessId = (DWORD)reply->pid;
-            process_handle    = wine_server_ptr_handle( reply->handle );
-        }
-        process_info = wine_server_ptr_handle( reply->info );
-    }
-    SERVER_END_REQ;
-    HeapFree( GetProcessHeap(), 0, objattr );
-
+    alloc_object_attributes( tsa, &thread_objattr, &thread_attr_len );
+    wine_server_batch_init( &batch );
+
+    process_req = wine_server_batch_add( &batch, &process_call, REQ_new_process );
+    process_req->inherit_all    = inherit;
+    process_req->create_flags   = flags;
+    process_req->socket_fd      = socketfd[1];
+    process_req->exe_file       = wine_server_obj_handle( hFile );
+    process_req->access         = PROCESS_ALL_ACCESS;
+    process_req->cpu            = pe_info->cpu;
+    process_req->info_size      = startup_info_size;
+    wine_server_add_data( process_req, objattr, attr_len );
+    wine_server_add_data( process_req, startup_info, startup_info_size );
+    wine_server_add_data( process_req, params->Environment, (env_end - params->Environment) * sizeof(WCHAR) );
+
+    /* the thread process handle is filled by the server from the new_process reply */
+    thread_req = wine_server_batch_add( &batch, &thread_call, REQ_new_thread );
+    thread_req->access     = THREAD_ALL_ACCESS;
+    thread_req->suspend    = !!(flags & CREATE_SUSPENDED);
+    thread_req->request_fd = -1;
+    wine_server_add_data( thread_req, thread_objattr, thread_attr_len );
+    wine_server_batch_link( &batch, FIELD_OFFSET( struct new_thread_request, process ),
+                            FIELD_OFFSET( struct new_process_reply, handle ));
+
+    status = wine_server_call_batch( &batch );
+    if (!process_call.u.reply.reply_header.error)
+    {
+        info->dwProcessId = (DWORD)process_call.u.reply.new_process_reply.pid;
+        process_handle    = wine_server_ptr_handle( process_call.u.reply.new_process_reply.handle );
+    }
+    process_info = wine_server_ptr_handle( process_call.u.reply.new_process_reply.info );
     if (!status)
     {
-        alloc_object_attributes( tsa, &objattr, &attr_len );
-        SERVER_START_REQ( new_thread )
-        {
-            req->process    = wine_server_obj_handle( process_handle );
-            req->access     = THREAD_ALL_ACCESS;
-            req->suspend    = !!(flags & CREATE_SUSPENDED);
-            req->request_fd = -1;
-            wine_server_add_data( req, objattr, attr_len );
-            if (!(status = wine_server_call( req )))
-            {
-                info->hProcess = process_handle;
-                info->hThread = wine_server_ptr_handle( reply->handle );
-                info->dwThreadId = reply->tid;
-            }
-        }
-        SERVER_END_REQ;
-        HeapFree( GetProcessHeap(), 0, objattr );
+        info->hProcess   = process_handle;
+        info->hThread    = wine_server_ptr_handle( thread_call.u.reply.new_thread_reply.handle );
+        info->dwThreadId = thread_call.u.reply.new_thread_reply.tid;
     }
+    HeapFree( GetProcessHeap(), 0, objattr );
+    HeapFree( GetProcessHeap(), 0, thread_objattr );
 
     if (status)
     {
@@ -28,6 +28,7 @@
 #include "winbase.h"
 #include "winreg.h"
 #include "winternl.h"
+#include "wine/heapstats.h"
 #include "wine/test.h"
 
 #define MAGIC_DEAD 0xdeadbeef
@@ -892,6 +893,72 @@ static void test_HeapQueryInformation(void)
     ok(info == 0 || info == 1 || info == 2, "expected 0, 1 or 2, got %u\n", info);
 }
 
+static void test_heap_statistics(void)
+{
+    struct wine_heap_statistics stats;
+    void *ptrs[10], *large;
+    HANDLE heap;
+    SIZE_T size;
+    BOOL ret;
+    int i;
+
+    if (!pHeapQueryInformation) return;
+
+    heap = HeapCreate( 0, 0, 0 );
+    ok( heap != NULL, "HeapCreate failed\n" );
+
+    size = 0;
+    ret = pHeapQueryInformation( heap, HeapWineStatistics, &stats, sizeof(stats), &size );
+    if (!ret)
+    {
+        skip( "HeapWineStatistics not supported\n" );
+        HeapDestroy( heap );
+        return;
+    }
+    ok( size == sizeof(stats), "wrong size %lu\n", size );
+    ok( stats.heap == heap, "wrong heap %p/%p\n", stats.heap, heap );
+    ok( !stats.in_use_blocks, "wrong block count %lu\n", stats.in_use_blocks );
+    ok( stats.committed && stats.committed <= stats.reserved, "wrong committed size %lu/%lu\n",
+        stats.committed, stats.reserved );
+    ok( stats.largest_free && stats.largest_free <= stats.free, "wrong free size %lu/%lu\n",
+        stats.largest_free, stats.free );
+
+    for (i = 0; i < ARRAY_SIZE(ptrs); i++) ptrs[i] = HeapAlloc( heap, 0, 100 );
+    large = HeapAlloc( heap, 0, 1 << 20 );
+    ptrs[0] = HeapReAlloc( heap, 0, ptrs[0], 5000 );
+    HeapFree( heap, 0, ptrs[1] );
+    HeapFree( heap, 0, ptrs[2] );
+
+    ret = pHeapQueryInformation( heap, HeapWineStatistics, &stats, sizeof(stats), NULL );
+    ok( ret, "HeapQueryInformation failed %u\n", GetLastError() );
+    ok( stats.in_use_blocks == 9, "wrong block count %lu\n", stats.in_use_blocks );
+    ok( stats.in_use == 7 * 100 + 5000 + (1 << 20), "wrong size in use %lu\n", stats.in_use );
+    ok( stats.allocs == 11, "wrong alloc count %s\n", wine_dbgstr_longlong(stats.allocs) );
+    ok( stats.frees == 2, "wrong free count %s\n", wine_dbgstr_longlong(stats.frees) );
+    ok( stats.reallocs == 1, "wrong realloc count %s\n", wine_dbgstr_longlong(stats.reallocs) );
+    ok( stats.large_blocks == 1, "wrong large block count %lu\n", stats.large_blocks );
+    ok( stats.large_size >= (1 << 20), "wrong large block size %lu\n", stats.large_size );
+    /* 100 bytes is in the 64-127 class, 5000 in the 4096-8191 class */
+    ok( stats.classes[7].blocks == 7, "wrong block count %lu\n", stats.classes[7].blocks );
+    ok( stats.classes[7].bytes == 700, "wrong byte count %lu\n", stats.classes[7].bytes );
+    ok( stats.classes[7].allocs == 10, "wrong alloc count %s\n", wine_dbgstr_longlong(stats.classes[7].allocs) );
+    ok( stats.classes[13].blocks == 1, "wrong block count %lu\n", stats.classes[13].blocks );
+    ok( stats.classes[21].blocks == 1, "wrong block count %lu\n", stats.classes[21].blocks );
+
+    HeapFree( heap, 0, large );
+    ret = pHeapQueryInformation( heap, HeapWineStatistics, &stats, sizeof(stats), NULL );
+    ok( ret, "HeapQueryInformation failed %u\n", GetLastError() );
+    ok( !stats.large_blocks, "wrong large block count %lu\n", stats.large_blocks );
+    ok( stats.in_use_blocks == 8, "wrong block count %lu\n", stats.in_use_blocks );
+
+    SetLastError( 0xdeadbeef );
+    ret = pHeapQueryInformation( heap, HeapWineStatistics, &stats, sizeof(stats) - 1, &size );
+    ok( !ret, "HeapQueryInformation should fail\n" );
+    ok( GetLastError() == ERROR_INSUFFICIENT_BUFFER, "wrong error %u\n", GetLastError() );
+
+    HeapDestroy( heap );
+}
+
 static void test_heap_checks( DWORD flags )
 {
     BYTE old, *p, *p2;
@@ -1245,6 +1312,7 @@ START_TEST(heap)
     test_sized_HeapReAlloc((1 << 20), 1);
 
     test_HeapQueryInformation();
+    test_heap_statistics();
     test_GetPhysicallyInstalledSystemMemory();
 
     if (pRtlGetNtGlobalFlags)
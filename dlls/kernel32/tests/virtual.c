@@ -490,6 +490,59 @@ static void test_VirtualAlloc(void)
     ok(VirtualFree(addr1, 0, MEM_RELEASE), "VirtualFree failed\n");
 }
 
+static void test_VirtualAlloc_fragmented(void)
+{
+    static const DWORD alloc_types[] = { MEM_RESERVE, MEM_RESERVE | MEM_TOP_DOWN };
+    MEMORY_BASIC_INFORMATION info;
+    void *addr[512], *ptr;
+    unsigned int i, j;
+    BOOL ret;
+
+    for (j = 0; j < ARRAY_SIZE(alloc_types); j++)
+    {
+        for (i = 0; i < ARRAY_SIZE(addr); i++)
+        {
+            addr[i] = VirtualAlloc( NULL, 0x1000, alloc_types[j], PAGE_NOACCESS );
+            ok( addr[i] != NULL, "%u: VirtualAlloc failed %u\n", i, GetLastError() );
+        }
+
+        /* punch holes, then fill them again with larger allocations */
+        for (i = 0; i < ARRAY_SIZE(addr); i += 2)
+        {
+            ret = VirtualFree( addr[i], 0, MEM_RELEASE );
+            ok( ret, "%u: VirtualFree failed %u\n", i, GetLastError() );
+        }
+        for (i = 0; i < ARRAY_SIZE(addr); i += 2)
+        {
+            addr[i] = VirtualAlloc( NULL, 0x8000, alloc_types[j], PAGE_READWRITE );
+            ok( addr[i] != NULL, "%u: VirtualAlloc failed %u\n", i, GetLastError() );
+            ok( VirtualQuery( addr[i], &info, sizeof(info) ) == sizeof(info), "VirtualQuery failed\n" );
+            ok( info.AllocationBase == addr[i], "%u: got %p, expected %p\n", i, info.AllocationBase, addr[i] );
+            ok( info.RegionSize == 0x8000, "%u: got size %lx\n", i, info.RegionSize );
+            ok( info.State == MEM_RESERVE, "%u: got state %x\n", i, info.State );
+        }
+
+        /* the allocations that were left alone must not have been touched */
+        for (i = 1; i < ARRAY_SIZE(addr); i += 2)
+        {
+            ok( VirtualQuery( addr[i], &info, sizeof(info) ) == sizeof(info), "VirtualQuery failed\n" );
+            ok( info.AllocationBase == addr[i], "%u: got %p, expected %p\n", i, info.AllocationBase, addr[i] );
+            ok( info.AllocationProtect == PAGE_NOACCESS, "%u: got protect %x\n", i, info.AllocationProtect );
+            ok( info.RegionSize == 0x1000, "%u: got size %lx\n", i, info.RegionSize );
+        }
+
+        ptr = VirtualAlloc( NULL, 0x100000, alloc_types[j], PAGE_READWRITE );
+        ok( ptr != NULL, "VirtualAlloc failed %u\n", GetLastError() );
+        VirtualFree( ptr, 0, MEM_RELEASE );
+
+        for (i = 0; i < ARRAY_SIZE(addr); i++)
+        {
+            ret = VirtualFree( addr[i], 0, MEM_RELEASE );
+            ok( ret, "%u: VirtualFree failed %u\n", i, GetLastError() );
+        }
+    }
+}
+
 static void test_MapViewOfFile(void)
 {
     static const char testfile[] = "testfile.xxx";
@@ -4452,6 +4505,7 @@ START_TEST(virtual)
     test_VirtualProtect();
     test_VirtualAllocEx();
     test_VirtualAlloc();
+    test_VirtualAlloc_fragmented();
     test_MapViewOfFile();
     test_NtMapViewOfSection();
     test_NtAreMappedFilesTheSame();
@@ -42,6 +42,8 @@
 #include "ntdll_misc.h"
 #include "wine/list.h"
 #include "wine/debug.h"
+#include "wine/exception.h"
+#include "wine/heapstats.h"
 #include "wine/server.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(heap);
@@ -164,6 +166,10 @@ typedef struct tagHEAP
     ARENA_INUSE    **pending_free;  /* Ring buffer for pending free requests */
     RTL_CRITICAL_SECTION critSection; /* Critical section for serialization */
     FREE_LIST_ENTRY *freeList;      /* Free lists */
+    ULONGLONG        allocs;        /* Total number of allocations */
+    ULONGLONG        frees;         /* Total number of frees */
+    ULONGLONG        reallocs;      /* Total number of reallocations */
+    struct wine_heap_size_class classes[WINE_HEAP_SIZE_CLASSES]; /* Allocated blocks by size */
 } HEAP;
 
 #define HEAP_MAGIC       ((DWORD)('H' | ('E'<<8) | ('A'<<16) | ('P'<<24)))
@@ -330,6 +336,306 @@ static RTL_CRITICAL_SECTION_DEBUG process_heap_critsect_debug =
       0, 0, { (DWORD_PTR)(__FILE__ ": main process heap section") }
 };
 
+/* sampled allocation sites, enabled by setting WINEHEAPPROFILE to the sampling rate */
+#define MAX_HEAP_SITES    4096   /* must be a power of 2 */
+#define MAX_HEAP_SAMPLES  65536  /* must be a power of 2 */
+#define DELETED_SITE      ((HANDLE)~(ULONG_PTR)0)  /* site of a destroyed heap */
+
+struct heap_sample
+{
+    void                 *ptr;   /* sampled block */
+    SIZE_T                size;  /* requested size */
+    ULONG                 site;  /* index in sites array */
+};
+
+struct heap_profile
+{
+    ULONG                 nb_sites;
+    ULONG                 nb_samples;
+    ULONG                 dropped;
+    struct wine_heap_site sites[MAX_HEAP_SITES];
+    struct heap_sample    samples[MAX_HEAP_SAMPLES];
+};
+
+static ULONG heap_sample_rate;
+static LONG heap_sample_count;
+static struct heap_profile *heap_profile;
+
+static RTL_CRITICAL_SECTION heap_profile_section;
+static RTL_CRITICAL_SECTION_DEBUG heap_profile_section_debug =
+{
+    0, 0, &heap_profile_section,
+    { &heap_profile_section_debug.ProcessLocksList, &heap_profile_section_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": heap_profile_section") }
+};
+static RTL_CRITICAL_SECTION heap_profile_section = { &heap_profile_section_debug, -1, 0, 0, 0, 0 };
+
+/* get the size class of a block for the heap statistics */
+static inline unsigned int get_size_class( SIZE_T size )
+{
+    unsigned int ret = RtlFindMostSignificantBit( size ) + 1;
+    return min( ret, WINE_HEAP_SIZE_CLASSES - 1 );
+}
+
+/* update the statistics for a new block; the heap lock must be held */
+static inline void stats_alloc( HEAP *heap, SIZE_T size )
+{
+    struct wine_heap_size_class *class = &heap->classes[get_size_class( size )];
+
+    class->blocks++;
+    class->bytes += size;
+    class->allocs++;
+    heap->allocs++;
+}
+
+/* update the statistics for a freed block; the heap lock must be held */
+static inline void stats_free( HEAP *heap, SIZE_T size )
+{
+    struct wine_heap_size_class *class = &heap->classes[get_size_class( size )];
+
+    class->blocks--;
+    class->bytes -= size;
+    heap->frees++;
+}
+
+/* update the statistics for a resized block; the heap lock must be held */
+static inline void stats_realloc( HEAP *heap, SIZE_T old_size, SIZE_T size )
+{
+    struct wine_heap_size_class *old_class = &heap->classes[get_size_class( old_size )];
+    struct wine_heap_size_class *class = &heap->classes[get_size_class( size )];
+
+    old_class->blocks--;
+    old_class->bytes -= old_size;
+    class->blocks++;
+    class->bytes += size;
+    heap->reallocs++;
+}
+
+static inline ULONG hash_heap_sample( const void *ptr )
+{
+    ULONG_PTR hash = (ULONG_PTR)ptr / ALIGNMENT;
+    return (hash ^ (hash >> 16)) & (MAX_HEAP_SAMPLES - 1);
+}
+
+/***********************************************************************
+ *           init_heap_profile
+ */
+static void init_heap_profile(void)
+{
+    const char *env = getenv( "WINEHEAPPROFILE" );
+    SIZE_T size = sizeof(*heap_profile);
+    void *addr = NULL;
+    int rate;
+
+    if (!env || (rate = atoi( env )) <= 0) return;
+    if (NtAllocateVirtualMemory( NtCurrentProcess(), &addr, 0, &size, MEM_COMMIT, PAGE_READWRITE ))
+    {
+        ERR( "failed to allocate heap profile data\n" );
+        return;
+    }
+    heap_profile = addr;
+    heap_sample_rate = rate;
+    TRACE( "sampling one allocation out of %u\n", heap_sample_rate );
+}
+
+/***********************************************************************
+ *           find_heap_sample
+ *
+ * Find the index of a sampled block. Must be called with the profile lock held.
+ */
+static int find_heap_sample( const void *ptr )
+{
+    ULONG i;
+
+    for (i = hash_heap_sample( ptr ); heap_profile->samples[i].ptr; i = (i + 1) & (MAX_HEAP_SAMPLES - 1))
+        if (heap_profile->samples[i].ptr == ptr) return i;
+    return -1;
+}
+
+/***********************************************************************
+ *           add_heap_sample
+ *
+ * Must be called with the profile lock held.
+ */
+static void add_heap_sample( void *ptr, SIZE_T size, ULONG site )
+{
+    ULONG i;
+
+    for (i = hash_heap_sample( ptr ); heap_profile->samples[i].ptr; i = (i + 1) & (MAX_HEAP_SAMPLES - 1))
+        if (heap_profile->samples[i].ptr == ptr) break;
+    if (!heap_profile->samples[i].ptr) heap_profile->nb_samples++;
+    heap_profile->samples[i].ptr  = ptr;
+    heap_profile->samples[i].size = size;
+    heap_profile->samples[i].site = site;
+}
+
+/***********************************************************************
+ *           remove_heap_sample
+ *
+ * Remove a sampled block, keeping the linear probing sequences intact.
+ * Must be called with the profile lock held.
+ */
+static void remove_heap_sample( ULONG i )
+{
+    struct heap_sample *samples = heap_profile->samples;
+    ULONG j = i, k;
+
+    for (;;)
+    {
+        j = (j + 1) & (MAX_HEAP_SAMPLES - 1);
+        if (!samples[j].ptr) break;
+        k = hash_heap_sample( samples[j].ptr );
+        /* move the entry up unless its home slot lies cyclically in (i, j] */
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j)) continue;
+        samples[i] = samples[j];
+        i = j;
+    }
+    samples[i].ptr = NULL;
+    heap_profile->nb_samples--;
+}
+
+struct heap_profile_stack
+{
+    ULONG frames;
+    void *stack[WINE_HEAP_SITE_FRAMES];
+};
+
+/***********************************************************************
+ *           heap_profile_capture
+ *
+ * Capture the stack of every heap_sample_rate allocation. This must be done
+ * before taking the heap lock, since unwinding can take other locks.
+ */
+static BOOL DECLSPEC_NOINLINE heap_profile_capture( struct heap_profile_stack *stack )
+{
+    if (interlocked_xchg_add( &heap_sample_count, 1 ) % heap_sample_rate) return FALSE;
+
+    /* skip this function and RtlAllocateHeap */
+    stack->frames = RtlCaptureStackBackTrace( 2, WINE_HEAP_SITE_FRAMES, stack->stack, NULL );
+    return TRUE;
+}
+
+/***********************************************************************
+ *           heap_profile_alloc
+ *
+ * Record the allocation site of a sampled allocation.
+ */
+static void heap_profile_alloc( HEAP *heap, void *ptr, SIZE_T size, const struct heap_profile_stack *stack )
+{
+    const ULONG frames = stack->frames;
+    struct wine_heap_site *site;
+    ULONG_PTR hash;
+    ULONG i;
+
+    hash = (ULONG_PTR)heap;
+    for (i = 0; i < frames; i++) hash = hash * 31 + (ULONG_PTR)stack->stack[i];
+    hash ^= hash >> 16;
+
+    RtlEnterCriticalSection( &heap_profile_section );
+
+    for (i = hash & (MAX_HEAP_SITES - 1); ; i = (i + 1) & (MAX_HEAP_SITES - 1))
+    {
+        site = &heap_profile->sites[i];
+        if (!site->heap) break;
+        if (site->heap == heap && site->frames == frames &&
+            !memcmp( site->stack, stack->stack, frames * sizeof(stack->stack[0]) )) break;
+    }
+    if (!site->heap)
+    {
+        if (heap_profile->nb_sites >= MAX_HEAP_SITES * 3 / 4) goto dropped;
+        site->heap = heap;
+        site->frames = frames;
+        memcpy( site->stack, stack->stack, frames * sizeof(stack->stack[0]) );
+        heap_profile->nb_sites++;
+    }
+    site->allocs++;
+    site->bytes += size;
+    if (heap_profile->nb_samples >= MAX_HEAP_SAMPLES * 3 / 4) goto dropped;
+    site->live_blocks++;
+    site->live_bytes += size;
+    add_heap_sample( ptr, size, i );
+    RtlLeaveCriticalSection( &heap_profile_section );
+    return;
+
+dropped:
+    heap_profile->dropped++;
+    RtlLeaveCriticalSection( &heap_profile_section );
+}
+
+/***********************************************************************
+ *           heap_profile_free
+ */
+static void heap_profile_free( const void *ptr )
+{
+    struct wine_heap_site *site;
+    int i;
+
+    if (!heap_profile->nb_samples) return;
+
+    RtlEnterCriticalSection( &heap_profile_section );
+    if ((i = find_heap_sample( ptr )) != -1)
+    {
+        site = &heap_profile->sites[heap_profile->samples[i].site];
+        site->live_blocks--;
+        site->live_bytes -= heap_profile->samples[i].size;
+        remove_heap_sample( i );
+    }
+    RtlLeaveCriticalSection( &heap_profile_section );
+}
+
+/***********************************************************************
+ *           heap_profile_realloc
+ *
+ * Must be called with the heap lock held, so that the old block cannot be reused yet.
+ */
+static void heap_profile_realloc( const void *old_ptr, void *ptr, SIZE_T size )
+{
+    struct wine_heap_site *site;
+    ULONG index;
+    int i;
+
+    if (!heap_profile->nb_samples) return;
+
+    RtlEnterCriticalSection( &heap_profile_section );
+    if ((i = find_heap_sample( old_ptr )) != -1)
+    {
+        index = heap_profile->samples[i].site;
+        site = &heap_profile->sites[index];
+        site->live_bytes += size - heap_profile->samples[i].size;
+        if (ptr == old_ptr) heap_profile->samples[i].size = size;
+        else
+        {
+            remove_heap_sample( i );
+            add_heap_sample( ptr, size, index );
+        }
+    }
+    RtlLeaveCriticalSection( &heap_profile_section );
+}
+
+/***********************************************************************
+ *           heap_profile_destroy
+ *
+ * Forget the samples of a heap that is being destroyed.
+ */
+static void heap_profile_destroy( HEAP *heap )
+{
+    ULONG i;
+
+    RtlEnterCriticalSection( &heap_profile_section );
+    for (i = 0; i < MAX_HEAP_SAMPLES; )
+    {
+        if (heap_profile->samples[i].ptr &&
+            heap_profile->sites[heap_profile->samples[i].site].heap == heap)
+            remove_heap_sample( i );  /* another entry may have moved into this slot */
+        else
+            i++;
+    }
+    /* keep the slots to preserve the probing sequences, but make sure they never match again */
+    for (i = 0; i < MAX_HEAP_SITES; i++)
+        if (heap_profile->sites[i].heap == heap) heap_profile->sites[i].heap = DELETED_SITE;
+    RtlLeaveCriticalSection( &heap_profile_section );
+}
+
 
 /***********************************************************************
  *           HEAP_Dump
@@ -1576,6 +1882,7 @@ HANDLE WINAPI RtlCreateHeap( ULONG flags, PVOID addr, SIZE_T totalSize, SIZE_T c
     {
         processHeap = subheap->heap;  /* assume the first heap we create is the process main heap */
         list_init( &processHeap->entry );
+        init_heap_profile();
     }
 
     return subheap->heap;
@@ -1615,6 +1922,8 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE heap )
     heapPtr->critSection.DebugInfo->Spare[0] = 0;
     RtlDeleteCriticalSection( &heapPtr->critSection );
 
+    if (heap_sample_rate) heap_profile_destroy( heapPtr );
+
     LIST_FOR_EACH_ENTRY_SAFE( arena, arena_next, &heapPtr->large_list, ARENA_LARGE, entry )
     {
         list_remove( &arena->entry );
@@ -1668,6 +1977,8 @@ void * WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_
     ARENA_INUSE *pInUse;
     SUBHEAP *subheap;
     HEAP *heapPtr = HEAP_GetPtr( heap );
+    struct heap_profile_stack stack;
+    BOOL sampled;
     SIZE_T rounded_size;
 
     /* Validate the parameters */
@@ -1683,11 +1994,15 @@ void * WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_
     }
     if (rounded_size < HEAP_MIN_DATA_SIZE) rounded_size = HEAP_MIN_DATA_SIZE;
 
+    sampled = heap_sample_rate && heap_profile_capture( &stack );
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     if (rounded_size >= HEAP_MIN_LARGE_BLOCK_SIZE && (flags & HEAP_GROWABLE))
     {
         void *ret = allocate_large_block( heap, flags, size );
+        if (ret) stats_alloc( heapPtr, size );
+        if (ret && sampled) heap_profile_alloc( heapPtr, ret, size, &stack );
         if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
         if (!ret && (flags & HEAP_GENERATE_EXCEPTIONS)) RtlRaiseStatus( STATUS_NO_MEMORY );
         TRACE("(%p,%08x,%08lx): returning %p\n", heap, flags, size, ret );
@@ -1725,6 +2040,9 @@ void * WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_
 
     notify_alloc( pInUse + 1, size, flags & HEAP_ZERO_MEMORY );
     initialize_block( pInUse + 1, size, pInUse->unused_bytes, flags );
+    stats_alloc( heapPtr, size );
+    /* record the sample before another thread can free the block */
+    if (sampled) heap_profile_alloc( heapPtr, pInUse + 1, size, &stack );
 
     if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
 
@@ -1768,6 +2086,8 @@ BOOLEAN WINAPI DECLSPEC_HOTPATCH RtlFreeHeap( HANDLE heap, ULONG flags, void *pt
     flags |= heapPtr->flags;
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
+    if (heap_sample_rate) heap_profile_free( ptr );
+
     /* Inform valgrind we are trying to free memory, so it can throw up an error message */
     notify_free( ptr );
 
@@ -1776,9 +2096,15 @@ BOOLEAN WINAPI DECLSPEC_HOTPATCH RtlFreeHeap( HANDLE heap, ULONG flags, void *pt
     if (!validate_block_pointer( heapPtr, &subheap, pInUse )) goto error;
 
     if (!subheap)
+    {
+        stats_free( heapPtr, ((ARENA_LARGE *)ptr - 1)->data_size );
         free_large_block( heapPtr, flags, ptr );
+    }
     else
+    {
+        stats_free( heapPtr, (pInUse->size & ARENA_SIZE_MASK) - pInUse->unused_bytes );
         HEAP_MakeInUseBlockFree( subheap, pInUse );
+    }
 
     if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
     TRACE("(%p,%08x,%p): returning TRUE\n", heap, flags, ptr );
@@ -1837,6 +2163,7 @@ PVOID WINAPI RtlReAllocateHeap( HANDLE heap, ULONG flags, PVOID ptr, SIZE_T size
     if (!validate_block_pointer( heapPtr, &subheap, pArena )) goto error;
     if (!subheap)
     {
+        oldActualSize = ((ARENA_LARGE *)ptr - 1)->data_size;
         if (!(ret = realloc_large_block( heapPtr, flags, ptr, size ))) goto oom;
         goto done;
     }
@@ -1921,6 +2248,8 @@ PVOID WINAPI RtlReAllocateHeap( HANDLE heap, ULONG flags, PVOID ptr, SIZE_T size
 
     ret = pArena + 1;
 done:
+    stats_realloc( heapPtr, oldActualSize, size );
+    if (heap_sample_rate) heap_profile_realloc( ptr, ret, size );
     if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
     TRACE("(%p,%08x,%p,%08lx): returning %p\n", heap, flags, ptr, size, ret );
     return ret;
@@ -2240,13 +2569,104 @@ ULONG WINAPI RtlGetProcessHeaps( ULONG count, HANDLE *heaps )
     return total;
 }
 
+/***********************************************************************
+ *           collect_heap_statistics
+ *
+ * Must be called with the heap lock held.
+ */
+static void collect_heap_statistics( HEAP *heap, struct wine_heap_statistics *stats )
+{
+    SUBHEAP *subheap;
+    ARENA_LARGE *large;
+    struct list *ptr;
+    unsigned int i;
+
+    memset( stats, 0, sizeof(*stats) );
+    stats->heap = heap;
+    stats->flags = heap->flags;
+
+    LIST_FOR_EACH_ENTRY( subheap, &heap->subheap_list, SUBHEAP, entry )
+    {
+        stats->subheaps++;
+        stats->reserved += subheap->size;
+        stats->committed += subheap->commitSize;
+    }
+
+    /* all the free lists are linked together, their heads have a zero size */
+    LIST_FOR_EACH( ptr, &heap->freeList[0].arena.entry )
+    {
+        ARENA_FREE *arena = LIST_ENTRY( ptr, ARENA_FREE, entry );
+        SIZE_T size = arena->size & ARENA_SIZE_MASK;
+
+        if (!size) continue;
+        stats->free += size;
+        stats->free_blocks++;
+        stats->largest_free = max( stats->largest_free, size );
+    }
+
+    LIST_FOR_EACH_ENTRY( large, &heap->large_list, ARENA_LARGE, entry )
+    {
+        stats->large_blocks++;
+        stats->large_size += large->block_size;
+    }
+
+    stats->allocs = heap->allocs;
+    stats->frees = heap->frees;
+    stats->reallocs = heap->reallocs;
+    memcpy( stats->classes, heap->classes, sizeof(stats->classes) );
+
+    for (i = 0; i < WINE_HEAP_SIZE_CLASSES; i++)
+    {
+        stats->in_use += stats->classes[i].bytes;
+        stats->in_use_blocks += stats->classes[i].blocks;
+    }
+}
+
+/***********************************************************************
+ *           get_heap_statistics
+ */
+static void get_heap_statistics( HEAP *heap, struct wine_heap_statistics *stats )
+{
+    if (!(heap->flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heap->critSection );
+    collect_heap_statistics( heap, stats );
+    if (!(heap->flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heap->critSection );
+}
+
+/***********************************************************************
+ *           get_heap_sites
+ *
+ * Copy the allocation sites of a heap, or of all heaps if heap is NULL.
+ * Returns the total number of sites.
+ */
+static ULONG get_heap_sites( HEAP *heap, struct wine_heap_site *sites, ULONG count )
+{
+    ULONG i, total = 0;
+
+    if (!heap_sample_rate) return 0;
+
+    RtlEnterCriticalSection( &heap_profile_section );
+    for (i = 0; i < MAX_HEAP_SITES; i++)
+    {
+        const struct wine_heap_site *site = &heap_profile->sites[i];
+
+        if (!site->heap || site->heap == DELETED_SITE) continue;
+        if (heap && site->heap != heap) continue;
+        if (total < count) sites[total] = *site;
+        total++;
+    }
+    RtlLeaveCriticalSection( &heap_profile_section );
+    return total;
+}
+
 /***********************************************************************
  *           RtlQueryHeapInformation    (NTDLL.@)
  */
 NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class,
                                          PVOID info, SIZE_T size_in, PSIZE_T size_out)
 {
-    switch (info_class)
+    HEAP *heapPtr;
+
+    switch ((ULONG)info_class)
     {
     case HeapCompatibilityInformation:
         if (size_out) *size_out = sizeof(ULONG);
@@ -2257,6 +2677,35 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
         *(ULONG *)info = 0; /* standard heap */
         return STATUS_SUCCESS;
 
+    case HeapWineStatistics:
+        if (size_out) *size_out = sizeof(struct wine_heap_statistics);
+
+        if (size_in < sizeof(struct wine_heap_statistics))
+            return STATUS_BUFFER_TOO_SMALL;
+
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+        get_heap_statistics( heapPtr, info );
+        return STATUS_SUCCESS;
+
+    case HeapWineAllocationSites:
+    {
+        struct wine_heap_sites *sites = info;
+        SIZE_T header = FIELD_OFFSET( struct wine_heap_sites, sites );
+        ULONG count = size_in > header ? (size_in - header) / sizeof(sites->sites[0]) : 0;
+        ULONG total;
+
+        if (size_in < header) return STATUS_BUFFER_TOO_SMALL;
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+
+        total = get_heap_sites( heapPtr, sites->sites, count );
+        if (size_out) *size_out = header + total * sizeof(sites->sites[0]);
+        sites->rate = heap_sample_rate;
+        sites->count = min( total, count );
+        sites->dropped = heap_profile ? heap_profile->dropped : 0;
+        sites->reserved = 0;
+        return total > count ? STATUS_BUFFER_TOO_SMALL : STATUS_SUCCESS;
+    }
+
     default:
         FIXME("Unknown heap information class %u\n", info_class);
         return STATUS_INVALID_INFO_CLASS;
@@ -2271,3 +2720,85 @@ NTSTATUS WINAPI RtlSetHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_
     FIXME("%p %d %p %ld stub\n", heap, info_class, info, size);
     return STATUS_SUCCESS;
 }
+
+
+static void CALLBACK heap_snapshot_unlock( BOOL normal, void *arg )
+{
+    HEAP *heap = arg;
+
+    if (!(heap->flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heap->critSection );
+}
+
+/***********************************************************************
+ *           __wine_heap_snapshot    (NTDLL.@)
+ *
+ * Fill a struct wine_heap_snapshot with the statistics of all the process
+ * heaps. Its prototype allows calling it with CreateRemoteThread, so that
+ * the heaps of a running process can be inspected from outside.
+ */
+DWORD WINAPI __wine_heap_snapshot( void *arg )
+{
+    struct wine_heap_snapshot *snapshot = arg;
+    struct wine_heap_statistics *stats = (struct wine_heap_statistics *)(snapshot + 1);
+    HANDLE *heaps;
+    ULONG i, count, nb_heaps, nb_sites, size = snapshot->size;
+
+    count = RtlGetProcessHeaps( 0, NULL );
+    for (;;)
+    {
+        if (!(heaps = RtlAllocateHeap( processHeap, 0, count * sizeof(*heaps) ))) return STATUS_NO_MEMORY;
+        if ((nb_heaps = RtlGetProcessHeaps( count, heaps )) <= count) break;
+        RtlFreeHeap( processHeap, 0, heaps );
+        count = nb_heaps;
+    }
+
+    if (size < sizeof(*snapshot) + nb_heaps * sizeof(*stats)) count = 0;
+    else count = nb_heaps;
+
+    for (i = 0; i < count; i++)
+    {
+        HEAP *heapPtr;
+
+        memset( &stats[i], 0, sizeof(stats[i]) );
+
+        /* the heap may be destroyed while we look at it */
+        __TRY
+        {
+            heapPtr = HEAP_GetPtr( heaps[i] );
+        }
+        __EXCEPT_PAGE_FAULT
+        {
+            heapPtr = NULL;
+        }
+        __ENDTRY
+        if (!heapPtr) continue;
+
+        if (!(heapPtr->flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
+        __TRY
+        {
+            __TRY
+            {
+                collect_heap_statistics( heapPtr, &stats[i] );
+            }
+            __FINALLY_CTX( heap_snapshot_unlock, heapPtr )
+        }
+        __EXCEPT_PAGE_FAULT
+        {
+            memset( &stats[i], 0, sizeof(stats[i]) );
+        }
+        __ENDTRY
+    }
+    RtlFreeHeap( processHeap, 0, heaps );
+
+    size -= min( size, sizeof(*snapshot) + count * sizeof(*stats) );
+    nb_sites = get_heap_sites( NULL, (struct wine_heap_site *)(stats + count),
+                               size / sizeof(struct wine_heap_site) );
+
+    snapshot->needed = sizeof(*snapshot) + nb_heaps * sizeof(*stats) +
+                       nb_sites * sizeof(struct wine_heap_site);
+    snapshot->heaps = count;
+    snapshot->sites = min( nb_sites, size / sizeof(struct wine_heap_site) );
+    snapshot->rate = heap_sample_rate;
+    snapshot->dropped = heap_profile ? heap_profile->dropped : 0;
+    return snapshot->needed > snapshot->size ? STATUS_BUFFER_TOO_SMALL : STATUS_SUCCESS;
+}
@@ -24,6 +24,8 @@
 
 #include <assert.h>
 #include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
 #ifdef HAVE_SYS_MMAN_H
 # include <sys/mman.h>
 #endif
@@ -1831,6 +1833,136 @@ static void load_builtin_callback( void *module, const char *filename )
 }
 
 
+/***********************************************************************
+ *           perf map support
+ *
+ * Linux perf can't symbolize code in anonymous mappings, which is how PE images
+ * are seen from the Unix side. When WINEPERFMAP is set, we describe the code
+ * sections of every PE module in /tmp/perf-<pid>.map, using the export table.
+ */
+struct perf_symbol
+{
+    DWORD       rva;
+    const char *name;
+};
+
+static int perf_map_fd = -1;
+
+static int compare_perf_symbols( const void *a, const void *b )
+{
+    const struct perf_symbol *sym1 = a, *sym2 = b;
+
+    if (sym1->rva != sym2->rva) return sym1->rva < sym2->rva ? -1 : 1;
+    return 0;
+}
+
+static void init_perf_map(void)
+{
+    const char *env = getenv( "WINEPERFMAP" );
+    char path[64];
+
+    if (!env || !atoi( env )) return;
+    sprintf( path, "/tmp/perf-%d.map", getpid() );
+    /* this runs once per process, drop the entries of a previous process with the same pid */
+    if ((perf_map_fd = open( path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644 )) == -1)
+        WARN( "failed to open %s\n", debugstr_a(path) );
+}
+
+static void add_perf_map_entry( char *buffer, unsigned int *pos, const char *base, DWORD start,
+                                DWORD end, const char *dll, const char *name )
+{
+    if (start >= end) return;
+    if (*pos > 0x10000 - 1024)
+    {
+        write( perf_map_fd, buffer, *pos );
+        *pos = 0;
+    }
+    *pos += snprintf( buffer + *pos, 1024, "%lx %x %s!%.400s\n",
+                      (ULONG_PTR)base + start, end - start, dll, name );
+}
+
+/***********************************************************************
+ *           write_perf_map
+ *
+ * Add the symbols of a PE module to the perf map.
+ * The loader_section must be locked while calling this function.
+ */
+static void write_perf_map( const WINE_MODREF *wm, const IMAGE_NT_HEADERS *nt )
+{
+    const char *base = wm->ldr.BaseAddress;
+    const IMAGE_SECTION_HEADER *sec = (const IMAGE_SECTION_HEADER *)((const char *)&nt->OptionalHeader +
+                                                                     nt->FileHeader.SizeOfOptionalHeader);
+    const IMAGE_EXPORT_DIRECTORY *exports;
+    struct perf_symbol *symbols = NULL;
+    unsigned int i, j, count = 0, pos = 0;
+    char dll[MAX_PATH], *buffer;
+    DWORD size;
+    int len;
+
+    if (perf_map_fd == -1) return;
+
+    len = ntdll_wcstoumbs( 0, wm->ldr.BaseDllName.Buffer, wm->ldr.BaseDllName.Length / sizeof(WCHAR),
+                           dll, sizeof(dll) - 1, NULL, NULL );
+    dll[max( len, 0 )] = 0;
+
+    if ((exports = RtlImageDirectoryEntryToData( wm->ldr.BaseAddress, TRUE,
+                                                 IMAGE_DIRECTORY_ENTRY_EXPORT, &size )) &&
+        (symbols = RtlAllocateHeap( GetProcessHeap(), 0, exports->NumberOfNames * sizeof(*symbols) )))
+    {
+        const DWORD *functions = (const DWORD *)(base + exports->AddressOfFunctions);
+        const DWORD *names = (const DWORD *)(base + exports->AddressOfNames);
+        const WORD *ordinals = (const WORD *)(base + exports->AddressOfNameOrdinals);
+
+        for (i = 0; i < exports->NumberOfNames; i++)
+        {
+            DWORD rva;
+
+            if (ordinals[i] >= exports->NumberOfFunctions) continue;
+            rva = functions[ordinals[i]];
+            /* skip forwarded entry points */
+            if (rva >= (const char *)exports - base && rva < (const char *)exports - base + size) continue;
+            symbols[count].rva = rva;
+            symbols[count].name = base + names[i];
+            count++;
+        }
+        qsort( symbols, count, sizeof(*symbols), compare_perf_symbols );
+    }
+
+    if (!(buffer = RtlAllocateHeap( GetProcessHeap(), 0, 0x10000 )))
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, symbols );
+        return;
+    }
+
+    for (i = j = 0; i < nt->FileHeader.NumberOfSections; i++, sec++)
+    {
+        DWORD start = sec->VirtualAddress, end;
+
+        if (!(sec->Characteristics & (IMAGE_SCN_MEM_EXECUTE | IMAGE_SCN_CNT_CODE))) continue;
+        end = start + (sec->Misc.VirtualSize ? sec->Misc.VirtualSize : sec->SizeOfRawData);
+
+        while (j < count && symbols[j].rva < start) j++;
+        /* code before the first export is attributed to the section */
+        add_perf_map_entry( buffer, &pos, base, start, j < count ? min( symbols[j].rva, end ) : end,
+                            dll, (const char *)sec->Name );
+        while (j < count && symbols[j].rva < end)
+        {
+            DWORD next = end;
+            unsigned int k = j + 1;
+
+            while (k < count && symbols[k].rva == symbols[j].rva) k++;  /* skip aliases */
+            if (k < count) next = min( symbols[k].rva, end );
+            add_perf_map_entry( buffer, &pos, base, symbols[j].rva, next, dll, symbols[j].name );
+            j = k;
+        }
+    }
+    if (pos) write( perf_map_fd, buffer, pos );
+
+    RtlFreeHeap( GetProcessHeap(), 0, buffer );
+    RtlFreeHeap( GetProcessHeap(), 0, symbols );
+}
+
+
 /***********************************************************************
  *           set_security_cookie
  *
@@ -2149,6 +2281,7 @@ static NTSTATUS load_native_dll( LPCWSTR load_path, const UNICODE_STRING *nt_nam
     if (image_info->image_flags & IMAGE_FLAGS_ComPlusILOnly) wm->ldr.Flags |= LDR_COR_ILONLY;
 
     set_security_cookie( module, image_info->map_size );
+    write_perf_map( wm, nt );
 
     /* fixup imports */
 
@@ -3251,6 +3384,7 @@ void WINAPI LdrShutdownProcess(void)
     TRACE("()\n");
     process_detaching = TRUE;
     process_detach();
+    if (TRACE_ON(relay)) RELAY_ShutdownProcess();
 }
 
 
@@ -3311,6 +3445,8 @@ void WINAPI LdrShutdownThread(void)
     RtlFreeHeap( GetProcessHeap(), 0, NtCurrentTeb()->FlsSlots );
     RtlFreeHeap( GetProcessHeap(), 0, NtCurrentTeb()->TlsExpansionSlots );
     RtlLeaveCriticalSection( &loader_section );
+
+    if (TRACE_ON(relay)) RELAY_ShutdownThread();
 }
 
 
@@ -3758,6 +3894,7 @@ void __wine_process_init(void)
     umask( FILE_umask );
 
     load_global_options();
+    init_perf_map();
 
     /* setup the load callback and create ntdll modref */
     wine_dll_set_callback( load_builtin_callback );
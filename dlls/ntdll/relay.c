@@ -26,6 +26,11 @@
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -34,6 +39,8 @@
 #include "wine/exception.h"
 #include "ntdll_misc.h"
 #include "wine/unicode.h"
+#include "wine/list.h"
+#include "wine/relay.h"
 #include "wine/debug.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(relay);
@@ -59,16 +66,83 @@ struct relay_entry_point
 {
     void       *orig_func;    /* original entry point function */
     const char *name;         /* function name (if any) */
+    LONGLONG    calls;        /* number of calls (statistics mode) */
+    LONGLONG    time;         /* inclusive time spent in the function (statistics mode) */
 };
 
 struct relay_private_data
 {
+    struct list              entry;             /* entry in relay_modules list */
     HMODULE                  module;            /* module handle of this dll */
     unsigned int             base;              /* ordinal base */
+    unsigned int             index;             /* module index in binary traces */
+    unsigned int             count;             /* number of entry points */
     char                     dllname[40];       /* dll name (without .dll extension) */
     struct relay_entry_point entry_points[1];   /* list of dll entry points */
 };
 
+enum relay_mode
+{
+    RELAY_MODE_TEXT,    /* trace calls and arguments as text on the debug output */
+    RELAY_MODE_BINARY,  /* store compact binary records in the relay output file */
+    RELAY_MODE_STATS    /* only count calls and time per entry point */
+};
+
+#define RELAY_MAX_DEPTH      256
+#define RELAY_BUFFER_RECORDS 4096
+
+/* state of the pending binary records of a thread */
+#define RELAY_THREAD_IDLE    0  /* can be flushed by another thread */
+#define RELAY_THREAD_BUSY    1  /* being updated by the owner thread */
+#define RELAY_THREAD_CLOSED  2  /* flushed at process exit, no longer updated */
+
+/* relay data of a thread after RELAY_ShutdownThread, calls are no longer recorded */
+#define RELAY_THREAD_DETACHED ((struct relay_thread_data *)~(ULONG_PTR)0)
+
+struct relay_frame
+{
+    const struct relay_private_data *data;
+    unsigned int                     ordinal;
+    ULONG_PTR                        retaddr;
+    ULONGLONG                        time;
+};
+
+/* per-thread relay data for the binary and statistics modes */
+struct relay_thread_data
+{
+    struct list               entry;                    /* entry in relay_threads list */
+    LONG                      state;                    /* records state (binary mode) */
+    unsigned int              depth;                    /* current call depth */
+    struct relay_frame        frames[RELAY_MAX_DEPTH];  /* pending calls (statistics mode) */
+    struct relay_trace_block  block;                    /* pending records header (binary mode) */
+    struct relay_trace_record records[1];               /* pending records (binary mode) */
+};
+
+static enum relay_mode relay_mode = RELAY_MODE_TEXT;
+static int relay_fd = -1;
+static unsigned int relay_module_count;
+static struct list relay_modules = LIST_INIT( relay_modules );
+static struct list relay_threads = LIST_INIT( relay_threads );
+
+static RTL_CRITICAL_SECTION relay_section;
+static RTL_CRITICAL_SECTION_DEBUG relay_critsect_debug =
+{
+    0, 0, &relay_section,
+    { &relay_critsect_debug.ProcessLocksList, &relay_critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": relay_section") }
+};
+static RTL_CRITICAL_SECTION relay_section = { &relay_critsect_debug, -1, 0, 0, 0, 0 };
+
+/* serializes the writes to the binary relay output */
+static RTL_CRITICAL_SECTION relay_output_section;
+static RTL_CRITICAL_SECTION_DEBUG relay_output_critsect_debug =
+{
+    0, 0, &relay_output_section,
+    { &relay_output_critsect_debug.ProcessLocksList, &relay_output_critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": relay_output_section") }
+};
+static RTL_CRITICAL_SECTION relay_output_section = { &relay_output_critsect_debug, -1, 0, 0, 0, 0 };
+
 static const WCHAR **debug_relay_excludelist;
 static const WCHAR **debug_relay_includelist;
 static const WCHAR **debug_snoop_excludelist;
@@ -164,6 +238,83 @@ static const WCHAR **load_list( HKEY hkey, const WCHAR *value )
     return list;
 }
 
+/***********************************************************************
+ *           load_string
+ *
+ * Load a string from a registry value.
+ */
+static BOOL load_string( HKEY hkey, const WCHAR *value, WCHAR *str, DWORD size )
+{
+    char buffer[offsetof( KEY_VALUE_PARTIAL_INFORMATION, Data[MAX_PATH * sizeof(WCHAR)] )];
+    KEY_VALUE_PARTIAL_INFORMATION *info = (KEY_VALUE_PARTIAL_INFORMATION *)buffer;
+    UNICODE_STRING name;
+    DWORD count;
+
+    RtlInitUnicodeString( &name, value );
+    if (NtQueryValueKey( hkey, &name, KeyValuePartialInformation, buffer, sizeof(buffer), &count ))
+        return FALSE;
+    if (info->Type != REG_SZ || info->DataLength < sizeof(WCHAR)) return FALSE;
+    count = min( info->DataLength / sizeof(WCHAR), size );
+    memcpy( str, info->Data, count * sizeof(WCHAR) );
+    str[count - 1] = 0;
+    TRACE( "%s = %s\n", debugstr_w(value), debugstr_w(str) );
+    return TRUE;
+}
+
+/***********************************************************************
+ *           init_relay_output
+ *
+ * Select the relay mode and open the output file for the binary and statistics modes.
+ */
+static void init_relay_output( HKEY hkey )
+{
+    static const WCHAR RelayModeW[] = {'R','e','l','a','y','M','o','d','e',0};
+    static const WCHAR RelayOutputW[] = {'R','e','l','a','y','O','u','t','p','u','t',0};
+    static const WCHAR binaryW[] = {'b','i','n','a','r','y',0};
+    static const WCHAR statsW[] = {'s','t','a','t','s',0};
+    struct relay_trace_header header;
+    LARGE_INTEGER counter, frequency;
+    char path[MAX_PATH];
+    WCHAR str[MAX_PATH];
+
+    if (!load_string( hkey, RelayModeW, str, ARRAY_SIZE(str) )) return;
+    if (!strcmpiW( str, binaryW )) relay_mode = RELAY_MODE_BINARY;
+    else if (!strcmpiW( str, statsW )) relay_mode = RELAY_MODE_STATS;
+    else return;
+
+#ifdef __arm__
+    FIXME( "relay mode %s not supported on this CPU, using text mode\n", debugstr_w(str) );
+    relay_mode = RELAY_MODE_TEXT;
+    return;
+#endif
+
+    if (load_string( hkey, RelayOutputW, str, ARRAY_SIZE(str) ) &&
+        ntdll_wcstoumbs( 0, str, strlenW(str) + 1, path, sizeof(path), NULL, NULL ) > 0)
+        relay_fd = open( path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0666 );
+    else if (relay_mode == RELAY_MODE_BINARY)
+    {
+        sprintf( path, "/tmp/wine-relay-%04x.bin", GetCurrentProcessId() );
+        relay_fd = open( path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0666 );
+    }
+    else relay_fd = dup( 2 );
+
+    if (relay_fd == -1)
+    {
+        ERR( "cannot open relay output %s, using text mode\n", debugstr_a(path) );
+        relay_mode = RELAY_MODE_TEXT;
+        return;
+    }
+    if (relay_mode != RELAY_MODE_BINARY) return;
+
+    NtQueryPerformanceCounter( &counter, &frequency );
+    header.magic     = RELAY_TRACE_MAGIC;
+    header.version   = RELAY_TRACE_VERSION;
+    header.pid       = GetCurrentProcessId();
+    header.reserved  = 0;
+    header.frequency = frequency.QuadPart;
+    write( relay_fd, &header, sizeof(header) );
+}
+
 /***********************************************************************
  *           init_debug_lists
  *
@@ -208,6 +359,7 @@ static DWORD WINAPI init_debug_lists( RTL_RUN_ONCE *once, void *param, void **co
     debug_from_relay_excludelist = load_list( hkey, RelayFromExcludeW );
     debug_from_snoop_includelist = load_list( hkey, SnoopFromIncludeW );
     debug_from_snoop_excludelist = load_list( hkey, SnoopFromExcludeW );
+    init_relay_output( hkey );
 
     NtClose( hkey );
     return TRUE;
@@ -322,6 +474,294 @@ static void trace_string_w( INT_PTR ptr )
     else TRACE( "%08lx", ptr );
 }
 
+/***********************************************************************
+ *           get_relay_thread_data
+ *
+ * Get the per-thread data used by the binary and statistics modes.
+ */
+static struct relay_thread_data *get_relay_thread_data(void)
+{
+    struct ntdll_thread_data *thread_data = ntdll_get_thread_data();
+    struct relay_thread_data *data = thread_data->relay_data;
+    SIZE_T size;
+
+    if (data) return data != RELAY_THREAD_DETACHED ? data : NULL;
+
+    size = offsetof( struct relay_thread_data,
+                     records[relay_mode == RELAY_MODE_BINARY ? RELAY_BUFFER_RECORDS : 0] );
+    if (!(data = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, size ))) return NULL;
+    data->block.type = RELAY_BLOCK_RECORDS;
+    data->block.id   = HandleToULong( NtCurrentTeb()->ClientId.UniqueThread );
+
+    RtlEnterCriticalSection( &relay_section );
+    list_add_tail( &relay_threads, &data->entry );
+    RtlLeaveCriticalSection( &relay_section );
+    thread_data->relay_data = data;
+    return data;
+}
+
+/***********************************************************************
+ *           flush_relay_records
+ *
+ * Write the pending records of a thread to the relay output.
+ */
+static void flush_relay_records( struct relay_thread_data *data )
+{
+    if (!data->block.count) return;
+
+    data->block.size = data->block.count * sizeof(data->records[0]);
+    RtlEnterCriticalSection( &relay_output_section );
+    write( relay_fd, &data->block, sizeof(data->block) );
+    write( relay_fd, data->records, data->block.size );
+    RtlLeaveCriticalSection( &relay_output_section );
+    data->block.count = 0;
+}
+
+/* the owner thread marks its records busy while adding to them, fails once they are closed */
+static inline BOOL lock_relay_records( struct relay_thread_data *data )
+{
+    return interlocked_cmpxchg( &data->state, RELAY_THREAD_BUSY, RELAY_THREAD_IDLE ) == RELAY_THREAD_IDLE;
+}
+
+static inline void unlock_relay_records( struct relay_thread_data *data )
+{
+    interlocked_cmpxchg( &data->state, RELAY_THREAD_IDLE, RELAY_THREAD_BUSY );
+}
+
+/***********************************************************************
+ *           close_relay_records
+ *
+ * Take over the records of another thread at process exit. Threads that stay
+ * busy have been killed in the middle of a call by NtTerminateProcess, the
+ * records they have already counted are complete.
+ */
+static void close_relay_records( struct relay_thread_data *data )
+{
+    unsigned int i;
+
+    for (i = 0; i < 100; i++)
+    {
+        if (interlocked_cmpxchg( &data->state, RELAY_THREAD_CLOSED, RELAY_THREAD_IDLE ) != RELAY_THREAD_BUSY)
+            break;
+        NtYieldExecution();
+    }
+    data->state = RELAY_THREAD_CLOSED;
+}
+
+static inline void add_relay_counter( LONGLONG *counter, LONGLONG value )
+{
+    LONGLONG old;
+
+    do old = *counter;
+    while (interlocked_cmpxchg64( counter, old + value, old ) != old);
+}
+
+static inline ULONGLONG get_relay_time(void)
+{
+    LARGE_INTEGER counter;
+
+    NtQueryPerformanceCounter( &counter, NULL );
+    return counter.QuadPart;
+}
+
+/***********************************************************************
+ *           relay_record_entry
+ *
+ * Record a call in binary or statistics mode, without any formatting.
+ */
+static void *relay_record_entry( struct relay_private_data *data, unsigned int ordinal, ULONG_PTR retaddr )
+{
+    struct relay_entry_point *entry_point = data->entry_points + ordinal;
+    struct relay_thread_data *thread = get_relay_thread_data();
+
+    if (!thread) return entry_point->orig_func;
+
+    if (relay_mode == RELAY_MODE_BINARY)
+    {
+        struct relay_trace_record *record;
+
+        if (!lock_relay_records( thread )) return entry_point->orig_func;
+        record = &thread->records[thread->block.count];
+        record->type    = RELAY_RECORD_CALL;
+        record->module  = data->index;
+        record->ordinal = ordinal;
+        record->time    = get_relay_time();
+        record->value   = retaddr;
+        if (++thread->block.count == RELAY_BUFFER_RECORDS) flush_relay_records( thread );
+        unlock_relay_records( thread );
+    }
+    else
+    {
+        add_relay_counter( &entry_point->calls, 1 );
+        if (thread->depth < RELAY_MAX_DEPTH)
+        {
+            struct relay_frame *frame = &thread->frames[thread->depth];
+
+            frame->data    = data;
+            frame->ordinal = ordinal;
+            frame->retaddr = retaddr;
+            frame->time    = get_relay_time();
+        }
+        thread->depth++;
+    }
+    return entry_point->orig_func;
+}
+
+/***********************************************************************
+ *           relay_record_exit
+ */
+static void relay_record_exit( struct relay_private_data *data, unsigned int ordinal,
+                               ULONG_PTR retaddr, ULONGLONG retval )
+{
+    struct relay_thread_data *thread = ntdll_get_thread_data()->relay_data;
+    ULONGLONG time = get_relay_time();
+    unsigned int i;
+
+    if (!thread || thread == RELAY_THREAD_DETACHED) return;
+
+    if (relay_mode == RELAY_MODE_BINARY)
+    {
+        struct relay_trace_record *record;
+
+        if (!lock_relay_records( thread )) return;
+        record = &thread->records[thread->block.count];
+        record->type    = RELAY_RECORD_RET;
+        record->module  = data->index;
+        record->ordinal = ordinal;
+        record->time    = time;
+        record->value   = retval;
+        if (++thread->block.count == RELAY_BUFFER_RECORDS) flush_relay_records( thread );
+        unlock_relay_records( thread );
+        return;
+    }
+
+    if (!thread->depth) return;
+    if (thread->depth > RELAY_MAX_DEPTH)
+    {
+        thread->depth--;
+        return;
+    }
+    /* skip frames left behind by exceptions unwinding through relayed calls */
+    for (i = thread->depth; i > 0; i--)
+    {
+        struct relay_frame *frame = &thread->frames[i - 1];
+
+        if (frame->data != data || frame->ordinal != ordinal || frame->retaddr != retaddr) continue;
+        add_relay_counter( &data->entry_points[ordinal].time, time - frame->time );
+        thread->depth = i - 1;
+        break;
+    }
+}
+
+/***********************************************************************
+ *           write_relay_module
+ *
+ * Write the names of a module entry points to the binary relay output.
+ */
+static void write_relay_module( struct relay_private_data *data )
+{
+    struct relay_trace_block block;
+    unsigned int i;
+    char *buffer, *p;
+
+    block.type  = RELAY_BLOCK_MODULE;
+    block.id    = data->index;
+    block.count = data->count;
+    block.size  = sizeof(DWORD) + strlen( data->dllname ) + 1;
+    for (i = 0; i < data->count; i++)
+        if (data->entry_points[i].name) block.size += strlen( data->entry_points[i].name );
+    block.size += data->count;
+    block.size = (block.size + 7) & ~7;
+
+    if (!(buffer = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, block.size ))) return;
+    *(DWORD *)buffer = data->base;
+    p = buffer + sizeof(DWORD);
+    strcpy( p, data->dllname );
+    p += strlen( p ) + 1;
+    for (i = 0; i < data->count; i++)
+    {
+        if (data->entry_points[i].name) strcpy( p, data->entry_points[i].name );
+        p += strlen( p ) + 1;
+    }
+
+    RtlEnterCriticalSection( &relay_output_section );
+    write( relay_fd, &block, sizeof(block) );
+    write( relay_fd, buffer, block.size );
+    RtlLeaveCriticalSection( &relay_output_section );
+    RtlFreeHeap( GetProcessHeap(), 0, buffer );
+}
+
+struct relay_stat
+{
+    const struct relay_private_data *data;
+    unsigned int                     ordinal;
+};
+
+static int compare_relay_stats( const void *a, const void *b )
+{
+    const struct relay_stat *stat1 = a, *stat2 = b;
+    LONGLONG time1 = stat1->data->entry_points[stat1->ordinal].time;
+    LONGLONG time2 = stat2->data->entry_points[stat2->ordinal].time;
+
+    if (time1 != time2) return time1 > time2 ? -1 : 1;
+    return 0;
+}
+
+/***********************************************************************
+ *           dump_relay_stats
+ *
+ * Write the per entry point statistics, sorted by inclusive time.
+ */
+static void dump_relay_stats(void)
+{
+    struct relay_private_data *data;
+    struct relay_stat *stats;
+    unsigned int i, count = 0;
+    LARGE_INTEGER counter, frequency;
+    LDR_MODULE *ldr;
+    char buffer[256];
+
+    LIST_FOR_EACH_ENTRY( data, &relay_modules, struct relay_private_data, entry )
+        for (i = 0; i < data->count; i++) if (data->entry_points[i].calls) count++;
+
+    if (!(stats = RtlAllocateHeap( GetProcessHeap(), 0, count * sizeof(*stats) ))) return;
+    count = 0;
+    LIST_FOR_EACH_ENTRY( data, &relay_modules, struct relay_private_data, entry )
+    {
+        for (i = 0; i < data->count; i++)
+        {
+            if (!data->entry_points[i].calls) continue;
+            stats[count].data = data;
+            stats[count].ordinal = i;
+            count++;
+        }
+    }
+    qsort( stats, count, sizeof(*stats), compare_relay_stats );
+    NtQueryPerformanceCounter( &counter, &frequency );
+
+    sprintf( buffer, "%04x:relay statistics:\n%12s %14s %10s  %s\n",
+             GetCurrentProcessId(), "calls", "total(us)", "avg(us)", "function" );
+    write( relay_fd, buffer, strlen(buffer) );
+    for (i = 0; i < count; i++)
+    {
+        const struct relay_entry_point *entry_point = &stats[i].data->entry_points[stats[i].ordinal];
+        ULONGLONG ticks = entry_point->time;
+        ULONGLONG time = ticks / frequency.QuadPart * 1000000
+                         + ticks % frequency.QuadPart * 1000000 / frequency.QuadPart;
+        int len = snprintf( buffer, sizeof(buffer), "%12llu %14llu %10llu  %s.",
+                            (unsigned long long)entry_point->calls, (unsigned long long)time,
+                            (unsigned long long)(time / entry_point->calls), stats[i].data->dllname );
+
+        /* names of unloaded modules are no longer accessible */
+        if (entry_point->name && !LdrFindEntryForAddress( stats[i].data->module, &ldr ))
+            snprintf( buffer + len, sizeof(buffer) - len, "%s\n", entry_point->name );
+        else
+            snprintf( buffer + len, sizeof(buffer) - len, "%u\n", stats[i].data->base + stats[i].ordinal );
+        write( relay_fd, buffer, strlen(buffer) );
+    }
+    RtlFreeHeap( GetProcessHeap(), 0, stats );
+}
+
 #ifdef __i386__
 
 /***********************************************************************
@@ -336,6 +776,23 @@ DECLSPEC_HIDDEN void * WINAPI relay_trace_entry( struct relay_descr *descr, unsi
     struct relay_entry_point *entry_point = data->entry_points + ordinal;
     unsigned int i, pos;
 
+    if (relay_mode != RELAY_MODE_TEXT)
+    {
+        for (i = pos = 0; !is_ret_val( arg_types[i] ); i++)
+        {
+            if (arg_types[i] == 'j' || arg_types[i] == 'd') pos += 2;
+            else if (arg_types[i] == 'k') pos += 4;
+            else pos++;
+        }
+        *nb_args = pos;
+        if (arg_types[0] == 't')
+        {
+            *nb_args |= 0x80000000;  /* thiscall/fastcall */
+            if (arg_types[1] == 't') *nb_args |= 0x40000000;  /* fastcall */
+        }
+        return relay_record_entry( data, ordinal, stack[-1] );
+    }
+
     TRACE( "\1Call %s(", func_name( data, ordinal ));
 
     for (i = pos = 0; !is_ret_val( arg_types[i] ); i++)
@@ -388,6 +845,12 @@ DECLSPEC_HIDDEN void WINAPI relay_trace_exit( struct relay_descr *descr, unsigne
 {
     const char *arg_types = descr->args_string + HIWORD(idx);
 
+    if (relay_mode != RELAY_MODE_TEXT)
+    {
+        relay_record_exit( descr->private, LOWORD(idx), (ULONG_PTR)retaddr, retval );
+        return;
+    }
+
     TRACE( "\1Ret  %s()", func_name( descr->private, LOWORD(idx) ));
 
     while (!is_ret_val( *arg_types )) arg_types++;
@@ -628,6 +1091,13 @@ DECLSPEC_HIDDEN void * WINAPI relay_trace_entry( struct relay_descr *descr, unsi
     struct relay_entry_point *entry_point = data->entry_points + ordinal;
     unsigned int i;
 
+    if (relay_mode != RELAY_MODE_TEXT)
+    {
+        for (i = 0; !is_ret_val( arg_types[i] ); i++) ;
+        *nb_args = i;
+        return relay_record_entry( data, ordinal, stack[-1] );
+    }
+
     TRACE( "\1Call %s(", func_name( data, ordinal ));
 
     for (i = 0; !is_ret_val( arg_types[i] ); i++)
@@ -658,6 +1128,12 @@ DECLSPEC_HIDDEN void * WINAPI relay_trace_entry( struct relay_descr *descr, unsi
 DECLSPEC_HIDDEN void WINAPI relay_trace_exit( struct relay_descr *descr, unsigned int idx,
                                               INT_PTR retaddr, INT_PTR retval )
 {
+    if (relay_mode != RELAY_MODE_TEXT)
+    {
+        relay_record_exit( descr->private, LOWORD(idx), retaddr, retval );
+        return;
+    }
+
     TRACE( "\1Ret  %s() retval=%08lx ret=%08lx\n",
            func_name( descr->private, LOWORD(idx) ), retval, retaddr );
 }
@@ -728,6 +1204,13 @@ DECLSPEC_HIDDEN void * WINAPI relay_trace_entry( struct relay_descr *descr, unsi
     struct relay_entry_point *entry_point = data->entry_points + ordinal;
     unsigned int i;
 
+    if (relay_mode != RELAY_MODE_TEXT)
+    {
+        for (i = 0; !is_ret_val( arg_types[i] ); i++) ;
+        *nb_args = i;
+        return relay_record_entry( data, ordinal, stack[-1] );
+    }
+
     TRACE( "\1Call %s(", func_name( data, ordinal ));
 
     for (i = 0; !is_ret_val( arg_types[i] ); i++)
@@ -764,6 +1247,12 @@ DECLSPEC_HIDDEN void * WINAPI relay_trace_entry( struct relay_descr *descr, unsi
 DECLSPEC_HIDDEN void WINAPI relay_trace_exit( struct relay_descr *descr, unsigned int idx,
                                               INT_PTR retaddr, INT_PTR retval )
 {
+    if (relay_mode != RELAY_MODE_TEXT)
+    {
+        relay_record_exit( descr->private, LOWORD(idx), retaddr, retval );
+        return;
+    }
+
     TRACE( "\1Ret  %s() retval=%08lx ret=%08lx\n",
            func_name( descr->private, LOWORD(idx) ), retval, retaddr );
 }
@@ -888,6 +1377,7 @@ void RELAY_SetupDLL( HMODULE module )
 
     data->module = module;
     data->base   = exports->Base;
+    data->count  = exports->NumberOfFunctions;
     len = strlen( (char *)module + exports->Name );
     if (len > 4 && !_stricmp( (char *)module + exports->Name + len - 4, ".dll" )) len -= 4;
     len = min( len, sizeof(data->dllname) - 1 );
@@ -916,6 +1406,62 @@ void RELAY_SetupDLL( HMODULE module )
         data->entry_points[i].orig_func = (char *)module + *funcs;
         *funcs = entry_point_rva + descr->entry_point_offsets[i];
     }
+
+    if (relay_mode == RELAY_MODE_TEXT) return;
+
+    RtlEnterCriticalSection( &relay_section );
+    data->index = relay_module_count++;
+    list_add_tail( &relay_modules, &data->entry );
+    RtlLeaveCriticalSection( &relay_section );
+    if (relay_mode == RELAY_MODE_BINARY) write_relay_module( data );
+}
+
+
+/***********************************************************************
+ *           RELAY_ShutdownThread
+ *
+ * Flush the binary records of the current thread and release its relay data.
+ */
+void RELAY_ShutdownThread(void)
+{
+    struct ntdll_thread_data *thread_data = ntdll_get_thread_data();
+    struct relay_thread_data *data = thread_data->relay_data;
+
+    /* don't create new data for the calls made until the thread exits */
+    thread_data->relay_data = RELAY_THREAD_DETACHED;
+    if (!data || data == RELAY_THREAD_DETACHED) return;
+
+    /* once removed from the list, RELAY_ShutdownProcess no longer accesses it */
+    RtlEnterCriticalSection( &relay_section );
+    list_remove( &data->entry );
+    RtlLeaveCriticalSection( &relay_section );
+    if (relay_mode == RELAY_MODE_BINARY) flush_relay_records( data );
+    RtlFreeHeap( GetProcessHeap(), 0, data );
+}
+
+
+/***********************************************************************
+ *           RELAY_ShutdownProcess
+ *
+ * Flush the binary records of all threads, or dump the call statistics.
+ */
+void RELAY_ShutdownProcess(void)
+{
+    struct relay_thread_data *data;
+
+    if (relay_mode == RELAY_MODE_TEXT) return;
+
+    RtlEnterCriticalSection( &relay_section );
+    if (relay_mode == RELAY_MODE_BINARY)
+    {
+        LIST_FOR_EACH_ENTRY( data, &relay_threads, struct relay_thread_data, entry )
+        {
+            close_relay_records( data );
+            flush_relay_records( data );
+        }
+    }
+    else dump_relay_stats();
+    RtlLeaveCriticalSection( &relay_section );
 }
 
 #else  /* __i386__ || __x86_64__ || __arm__ || __aarch64__ */
@@ -930,6 +1476,14 @@ void RELAY_SetupDLL( HMODULE module )
 {
 }
 
+void RELAY_ShutdownThread(void)
+{
+}
+
+void RELAY_ShutdownProcess(void)
+{
+}
+
 #endif  /* __i386__ || __x86_64__ || __arm__ || __aarch64__ */
 
 
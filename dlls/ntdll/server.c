@@ -324,6 +324,113 @@ unsigned int wine_server_call( void *req_ptr )
 }
 
 
+/***********************************************************************
+ *           wine_server_call_batch (NTDLL.@)
+ *
+ * Perform several server calls in a single round trip.
+ *
+ * PARAMS
+ *     batch [I/O] Requests built with wine_server_batch_add
+ *
+ * RETURNS
+ *     The status of the first request that failed, or STATUS_SUCCESS.
+ *
+ * NOTES
+ *     The requests are executed in order and execution stops at the first
+ *     failure; the requests that were not executed get STATUS_REQUEST_ABORTED.
+ *     wine_server_batch_link can be used to pass a handle returned by a request
+ *     to the next one.
+ */
+unsigned int CDECL wine_server_call_batch( struct __server_batch *batch )
+{
+    static const char padding[8];
+    struct iovec vec[1 + MAX_BATCH_REQUESTS * (__SERVER_MAX_DATA + 3)];
+    union generic_request request;
+    union generic_reply reply;
+    char buffer[1024], *data = buffer, *ptr;
+    data_size_t size = 0, reply_size = 0, len;
+    unsigned int i, j, count = 1, done = 0, ret;
+    sigset_t old_set;
+    int res;
+
+    assert( batch->count <= MAX_BATCH_REQUESTS );
+
+    for (i = 0; i < batch->count; i++)
+    {
+        struct __server_request_info *req = batch->reqs[i];
+
+        vec[count].iov_base = &batch->headers[i];
+        vec[count++].iov_len = sizeof(batch->headers[i]);
+        vec[count].iov_base = &req->u.req;
+        vec[count++].iov_len = sizeof(req->u.req);
+        for (j = 0; j < req->data_count; j++)
+        {
+            vec[count].iov_base = (void *)req->data[j].ptr;
+            vec[count++].iov_len = req->data[j].size;
+        }
+        len = req->u.req.request_header.request_size;
+        if (len & 7)
+        {
+            vec[count].iov_base = (void *)padding;
+            vec[count++].iov_len = 8 - (len & 7);
+        }
+        size += sizeof(batch->headers[i]) + sizeof(req->u.req) + ((len + 7) & ~7);
+        reply_size += sizeof(req->u.reply) + ((req->u.req.request_header.reply_size + 7) & ~7);
+    }
+
+    memset( &request, 0, sizeof(request) );
+    request.request_header.req = REQ_batch;
+    request.request_header.request_size = size;
+    request.request_header.reply_size = reply_size;
+    vec[0].iov_base = &request;
+    vec[0].iov_len = sizeof(request);
+
+    if (reply_size > sizeof(buffer) && !(data = RtlAllocateHeap( GetProcessHeap(), 0, reply_size )))
+    {
+        ret = STATUS_NO_MEMORY;
+        goto done;
+    }
+
+    pthread_sigmask( SIG_BLOCK, &server_block_set, &old_set );
+    if ((res = writev( ntdll_get_thread_data()->request_fd, vec, count )) == size + sizeof(request))
+    {
+        read_reply_data( &reply, sizeof(reply) );
+        if (reply.reply_header.reply_size) read_reply_data( data, reply.reply_header.reply_size );
+        ret = reply.reply_header.error;
+        done = min( reply.batch_reply.count, batch->count );
+    }
+    else
+    {
+        if (res >= 0) server_protocol_error( "partial write %d\n", res );
+        if (errno == EPIPE) abort_thread(0);
+        if (errno != EFAULT) server_protocol_perror( "write" );
+        ret = STATUS_ACCESS_VIOLATION;
+    }
+    pthread_sigmask( SIG_SETMASK, &old_set, NULL );
+
+    for (i = 0, ptr = data; i < done; i++)
+    {
+        struct __server_request_info *req = batch->reqs[i];
+
+        memcpy( &req->u.reply, ptr, sizeof(req->u.reply) );
+        ptr += sizeof(req->u.reply);
+        len = req->u.reply.reply_header.reply_size;
+        if (len) memcpy( req->reply_data, ptr, len );
+        ptr += (len + 7) & ~7;
+    }
+    if (data != buffer) RtlFreeHeap( GetProcessHeap(), 0, data );
+
+done:
+    /* the requests that were not executed still get a valid reply */
+    for (i = done; i < batch->count; i++)
+    {
+        memset( &batch->reqs[i]->u.reply, 0, sizeof(batch->reqs[i]->u.reply) );
+        batch->reqs[i]->u.reply.reply_header.error = STATUS_REQUEST_ABORTED;
+    }
+    return ret;
+}
+
+
 /***********************************************************************
  *           server_enter_uninterrupted_section
  */
@@ -4438,8 +4438,57 @@ __ASM_GLOBAL_FUNC( RtlRaiseException,
  */
 USHORT WINAPI RtlCaptureStackBackTrace( ULONG skip, ULONG count, PVOID *buffer, ULONG *hash )
 {
-    FIXME( "(%d, %d, %p, %p) stub!\n", skip, count, buffer, hash );
-    return 0;
+    CONTEXT context, new_context;
+    LDR_MODULE *module;
+    RUNTIME_FUNCTION *func;
+    PEXCEPTION_ROUTINE handler;
+    ULONG64 base, frame;
+    void *data;
+    ULONG i = 0, num_entries = 0;
+
+    TRACE( "(%u, %u, %p, %p)\n", skip, count, buffer, hash );
+
+    RtlCaptureContext( &context );
+    if (hash) *hash = 0;
+
+    while (num_entries < count)
+    {
+        new_context = context;
+
+        if ((func = lookup_function_info( context.Rip, &base, &module )))
+        {
+            RtlVirtualUnwind( UNW_FLAG_NHANDLER, base, context.Rip, func, &new_context,
+                              &data, &frame, NULL );
+        }
+        else
+        {
+            struct dwarf_eh_bases bases;
+            const struct dwarf_fde *fde;
+            BOOL got_info = FALSE;
+
+            if (module && !(module->Flags & LDR_WINE_INTERNAL)) break;
+            if ((fde = _Unwind_Find_FDE( (void *)(context.Rip - 1), &bases )))
+            {
+                if (dwarf_virtual_unwind( context.Rip, &frame, &new_context, fde,
+                                          &bases, &handler, &data )) break;
+                got_info = TRUE;
+            }
+#ifdef HAVE_LIBUNWIND_H
+            else if (libunwind_virtual_unwind( context.Rip, &got_info, &frame, &new_context,
+                                               &handler, &data )) break;
+#endif
+            if (!got_info) break;
+        }
+
+        if (!new_context.Rip || new_context.Rsp <= context.Rsp ||
+            new_context.Rsp >= (ULONG64)NtCurrentTeb()->Tib.StackBase) break;
+        context = new_context;
+
+        if (i++ < skip) continue;
+        buffer[num_entries++] = (void *)context.Rip;
+        if (hash) *hash += (ULONG)context.Rip;
+    }
+    return num_entries;
 }
 
 
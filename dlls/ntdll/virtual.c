@@ -74,6 +74,9 @@ struct file_view
     void         *base;          /* base address */
     size_t        size;          /* size in bytes */
     unsigned int  protect;       /* protection for all pages at allocation time and SEC_* flags */
+    void         *tree_start;    /* start of the first view in the subtree rooted at this view */
+    void         *tree_end;      /* end of the last view in the subtree rooted at this view */
+    size_t        tree_gap;      /* largest free gap between two views of the subtree */
 };
 
 /* per-page protection flags */
@@ -281,6 +284,36 @@ static int compare_view( const void *addr, const struct wine_rb_entry *entry )
 }
 
 
+/***********************************************************************
+ *           augment_view
+ *
+ * Update the subtree information of a view after the tree has changed below it.
+ */
+static void augment_view( struct wine_rb_entry *entry )
+{
+    struct file_view *view = WINE_RB_ENTRY_VALUE( entry, struct file_view, entry );
+
+    view->tree_start = view->base;
+    view->tree_end = (char *)view->base + view->size;
+    view->tree_gap = 0;
+
+    if (entry->left)
+    {
+        struct file_view *left = WINE_RB_ENTRY_VALUE( entry->left, struct file_view, entry );
+        view->tree_start = left->tree_start;
+        view->tree_gap = max( left->tree_gap, (size_t)((char *)view->base - (char *)left->tree_end) );
+    }
+    if (entry->right)
+    {
+        struct file_view *right = WINE_RB_ENTRY_VALUE( entry->right, struct file_view, entry );
+        view->tree_end = right->tree_end;
+        view->tree_gap = max( view->tree_gap, right->tree_gap );
+        view->tree_gap = max( view->tree_gap, (size_t)((char *)right->tree_start -
+                                                       ((char *)view->base + view->size)) );
+    }
+}
+
+
 /***********************************************************************
  *           VIRTUAL_GetProtStr
  */
@@ -451,70 +484,108 @@ static struct file_view *find_view_range( const void *addr, size_t size )
 
 
 /***********************************************************************
- *           find_free_area
+ *           try_free_gap
  *
- * Find a free area between views inside the specified range.
- * The csVirtual section must be held by caller.
+ * Check if an aligned block of the requested size fits in the free gap between start
+ * and end, clipped to the specified range.
  */
-static void *find_free_area( void *base, void *end, size_t size, size_t mask, int top_down )
+static inline void *try_free_gap( char *start, char *end, char *base, char *limit,
+                                  size_t size, size_t mask, int top_down )
 {
-    struct wine_rb_entry *first = NULL, *ptr = views_tree.root;
-    void *start;
+    char *ptr;
 
-    /* find the first (resp. last) view inside the range */
-    while (ptr)
+    if (start < base) start = base;
+    if (end > limit) end = limit;
+    if (start >= end || (size_t)(end - start) < size) return NULL;
+
+    if (top_down)
     {
-        struct file_view *view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
-        if ((char *)view->base + view->size >= (char *)end)
-        {
-            end = min( end, view->base );
-            ptr = ptr->left;
-        }
-        else if (view->base <= base)
-        {
-            base = max( (char *)base, (char *)view->base + view->size );
-            ptr = ptr->right;
-        }
-        else
-        {
-            first = ptr;
-            ptr = top_down ? ptr->right : ptr->left;
-        }
+        ptr = ROUND_ADDR( end - size, mask );
+        if (ptr < start) return NULL;
     }
+    else
+    {
+        ptr = ROUND_ADDR( start + mask, mask );
+        if (!ptr || ptr < start || ptr >= end || (size_t)(end - ptr) < size) return NULL;
+    }
+    return ptr;
+}
+
+
+/***********************************************************************
+ *           find_free_gap
+ *
+ * Find the lowest (resp. highest) suitable free gap between the views of a subtree.
+ * Subtrees that don't contain a gap large enough, or that don't intersect the
+ * specified range, are skipped so that the search is logarithmic in the number of views.
+ */
+static void *find_free_gap( struct wine_rb_entry *entry, char *base, char *limit,
+                            size_t size, size_t mask, int top_down )
+{
+    struct file_view *view = WINE_RB_ENTRY_VALUE( entry, struct file_view, entry );
+    struct file_view *left = NULL, *right = NULL;
+    char *view_end = (char *)view->base + view->size;
+    void *ret;
+
+    if (view->tree_gap < size) return NULL;
+    if ((char *)view->tree_end <= base || (char *)view->tree_start >= limit) return NULL;
+
+    if (entry->left) left = WINE_RB_ENTRY_VALUE( entry->left, struct file_view, entry );
+    if (entry->right) right = WINE_RB_ENTRY_VALUE( entry->right, struct file_view, entry );
 
     if (top_down)
     {
-        start = ROUND_ADDR( (char *)end - size, mask );
-        if (start >= end || start < base) return NULL;
-
-        while (first)
+        if (right)
         {
-            struct file_view *view = WINE_RB_ENTRY_VALUE( first, struct file_view, entry );
-
-            if ((char *)view->base + view->size <= (char *)start) break;
-            start = ROUND_ADDR( (char *)view->base - size, mask );
-            /* stop if remaining space is not large enough */
-            if (!start || start >= end || start < base) return NULL;
-            first = wine_rb_prev( first );
+            if ((ret = find_free_gap( entry->right, base, limit, size, mask, top_down ))) return ret;
+            if ((ret = try_free_gap( view_end, right->tree_start, base, limit, size, mask, top_down ))) return ret;
+        }
+        if (left)
+        {
+            if ((ret = try_free_gap( left->tree_end, view->base, base, limit, size, mask, top_down ))) return ret;
+            if ((ret = find_free_gap( entry->left, base, limit, size, mask, top_down ))) return ret;
         }
     }
     else
     {
-        start = ROUND_ADDR( (char *)base + mask, mask );
-        if (!start || start >= end || (char *)end - (char *)start < size) return NULL;
-
-        while (first)
+        if (left)
         {
-            struct file_view *view = WINE_RB_ENTRY_VALUE( first, struct file_view, entry );
-
-            if ((char *)view->base >= (char *)start + size) break;
-            start = ROUND_ADDR( (char *)view->base + view->size + mask, mask );
-            /* stop if remaining space is not large enough */
-            if (!start || start >= end || (char *)end - (char *)start < size) return NULL;
-            first = wine_rb_next( first );
+            if ((ret = find_free_gap( entry->left, base, limit, size, mask, top_down ))) return ret;
+            if ((ret = try_free_gap( left->tree_end, view->base, base, limit, size, mask, top_down ))) return ret;
+        }
+        if (right)
+        {
+            if ((ret = try_free_gap( view_end, right->tree_start, base, limit, size, mask, top_down ))) return ret;
+            if ((ret = find_free_gap( entry->right, base, limit, size, mask, top_down ))) return ret;
         }
     }
-    return start;
+    return NULL;
+}
+
+
+/***********************************************************************
+ *           find_free_area
+ *
+ * Find a free area between views inside the specified range.
+ * The csVirtual section must be held by caller.
+ */
+static void *find_free_area( void *base, void *end, size_t size, size_t mask, int top_down )
+{
+    struct file_view *root;
+    void *ret;
+
+    if (!views_tree.root) return try_free_gap( base, end, base, end, size, mask, top_down );
+
+    root = WINE_RB_ENTRY_VALUE( views_tree.root, struct file_view, entry );
+
+    /* free space above the last view and below the first view */
+    if (top_down && (ret = try_free_gap( root->tree_end, end, base, end, size, mask, TRUE ))) return ret;
+    if (!top_down && (ret = try_free_gap( base, root->tree_start, base, end, size, mask, FALSE ))) return ret;
+
+    if ((ret = find_free_gap( views_tree.root, base, end, size, mask, top_down ))) return ret;
+
+    if (top_down) return try_free_gap( base, root->tree_start, base, end, size, mask, TRUE );
+    return try_free_gap( root->tree_end, end, base, end, size, mask, FALSE );
 }
 
 
@@ -1830,7 +1901,7 @@ void virtual_init(void)
     view_block_start = alloc_views.base;
     view_block_end = view_block_start + view_block_size / sizeof(*view_block_start);
     pages_vprot = (void *)((char *)alloc_views.base + view_block_size);
-    wine_rb_init( &views_tree, compare_view );
+    wine_rb_init_augmented( &views_tree, compare_view, augment_view );
 
     /* make the DOS area accessible (except the low 64K) to hide bugs in broken apps like Excel 2003 */
     size = (char *)address_space_start - (char *)0x10000;
@@ -1967,6 +2038,7 @@ NTSTATUS virtual_alloc_thread_stack( TEB *teb, SIZE_T reserve_size, SIZE_T commi
         /* shrink the first view and create a second one for the extra size */
         /* this allows the app to free the stack without freeing the thread start portion */
         view->size -= extra_size;
+        wine_rb_augment_path( &views_tree, &view->entry );
         status = create_view( &extra_view, (char *)view->base + view->size, extra_size,
                               VPROT_READ | VPROT_WRITE | VPROT_COMMITTED );
         if (status != STATUS_SUCCESS)
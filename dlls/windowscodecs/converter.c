@@ -133,6 +133,169 @@ static void to_sRGB(BYTE *bgr)
 }
 #endif
 
+typedef void (*convert_row_func)(const BYTE *src, BYTE *dst, UINT width);
+
+static void convert_row_gray8_to_bgra(const BYTE *src, BYTE *dst, UINT width)
+{
+    DWORD *dstpixel = (DWORD *)dst;
+    UINT x;
+
+    for (x = 0; x < width; x++)
+        dstpixel[x] = 0xff000000 | (src[x] << 16) | (src[x] << 8) | src[x];
+}
+
+static void convert_row_bgr24_to_bgra(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++)
+    {
+        dst[4 * x] = src[3 * x];
+        dst[4 * x + 1] = src[3 * x + 1];
+        dst[4 * x + 2] = src[3 * x + 2];
+        dst[4 * x + 3] = 0xff;
+    }
+}
+
+static void convert_row_rgb24_to_bgra(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++)
+    {
+        dst[4 * x] = src[3 * x + 2];
+        dst[4 * x + 1] = src[3 * x + 1];
+        dst[4 * x + 2] = src[3 * x];
+        dst[4 * x + 3] = 0xff;
+    }
+}
+
+static void convert_row_bgra_to_bgr24(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++)
+    {
+        dst[3 * x] = src[4 * x];
+        dst[3 * x + 1] = src[4 * x + 1];
+        dst[3 * x + 2] = src[4 * x + 2];
+    }
+}
+
+static void convert_row_set_alpha(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++)
+        dst[4 * x + 3] = 0xff;
+}
+
+static void convert_row_premultiply(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++)
+    {
+        BYTE alpha = src[4 * x + 3];
+        if (alpha != 255)
+        {
+            dst[4 * x] = src[4 * x] * alpha / 255;
+            dst[4 * x + 1] = src[4 * x + 1] * alpha / 255;
+            dst[4 * x + 2] = src[4 * x + 2] * alpha / 255;
+        }
+    }
+}
+
+static void convert_row_unpremultiply(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++)
+    {
+        BYTE alpha = src[4 * x + 3];
+        if (alpha != 0 && alpha != 255)
+        {
+            dst[4 * x] = src[4 * x] * 255 / alpha;
+            dst[4 * x + 1] = src[4 * x + 1] * 255 / alpha;
+            dst[4 * x + 2] = src[4 * x + 2] * 255 / alpha;
+        }
+    }
+}
+
+/* large conversions are split into bands of rows, one per CPU */
+#define CONVERT_BAND_MIN_PIXELS (1024 * 1024)
+#define CONVERT_MAX_BANDS 16
+
+struct convert_band
+{
+    convert_row_func convert;
+    const BYTE *src;
+    BYTE *dst;
+    UINT srcstride, dststride;
+    UINT width, height;
+};
+
+static DWORD WINAPI convert_band_proc(void *arg)
+{
+    const struct convert_band *band = arg;
+    UINT y;
+
+    for (y = 0; y < band->height; y++)
+        band->convert(band->src + (SIZE_T)band->srcstride * y,
+                      band->dst + (SIZE_T)band->dststride * y, band->width);
+    return 0;
+}
+
+/* src and dst may be the same buffer for conversions done in place */
+static void convert_rows(convert_row_func convert, const BYTE *src, UINT srcstride,
+    BYTE *dst, UINT dststride, UINT width, UINT height)
+{
+    struct convert_band bands[CONVERT_MAX_BANDS];
+    HANDLE threads[CONVERT_MAX_BANDS];
+    SYSTEM_INFO system_info;
+    UINT i, count = 1, started, band_height;
+
+    if (!width || !height)
+        return;
+
+    if ((ULONGLONG)width * height >= CONVERT_BAND_MIN_PIXELS)
+    {
+        GetSystemInfo(&system_info);
+        count = min(min(system_info.dwNumberOfProcessors, CONVERT_MAX_BANDS), height);
+    }
+
+    band_height = (height + count - 1) / count;
+    for (i = 0; i < count; i++)
+    {
+        if (i * band_height >= height)
+        {
+            count = i;
+            break;
+        }
+        bands[i].convert = convert;
+        bands[i].src = src + (SIZE_T)srcstride * band_height * i;
+        bands[i].dst = dst + (SIZE_T)dststride * band_height * i;
+        bands[i].srcstride = srcstride;
+        bands[i].dststride = dststride;
+        bands[i].width = width;
+        bands[i].height = min(band_height, height - i * band_height);
+    }
+
+    if (count > 1) TRACE("converting %ux%u in %u bands\n", width, height, count);
+
+    /* the calling thread converts the first band itself */
+    for (i = 1, started = 1; i < count; i++, started++)
+        if (!(threads[i] = CreateThread(NULL, 0, convert_band_proc, &bands[i], 0, NULL))) break;
+    convert_band_proc(&bands[0]);
+    for (i = started; i < count; i++) convert_band_proc(&bands[i]);
+
+    for (i = 1; i < started; i++)
+    {
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+    }
+}
+
 static inline FormatConverter *impl_from_IWICFormatConverter(IWICFormatConverter *iface)
 {
     return CONTAINING_RECORD(iface, FormatConverter, IWICFormatConverter_iface);
@@ -338,13 +501,8 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcbyte;
-            BYTE *dstrow;
-            DWORD *dstpixel;
 
             srcstride = prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -355,21 +513,8 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
 
             if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcbyte = srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++)
-                    {
-                        *dstpixel++ = 0xff000000|(*srcbyte<<16)|(*srcbyte<<8)|*srcbyte;
-                        srcbyte++;
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+                convert_rows(convert_row_gray8_to_bgra, srcdata, srcstride,
+                             pbBuffer, cbStride, prc->Width, prc->Height);
 
             HeapFree(GetProcessHeap(), 0, srcdata);
 
@@ -619,13 +764,8 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            BYTE *dstpixel;
 
             srcstride = 3 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -636,22 +776,8 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
 
             if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        *dstpixel++=*srcpixel++; /* blue */
-                        *dstpixel++=*srcpixel++; /* green */
-                        *dstpixel++=*srcpixel++; /* red */
-                        *dstpixel++=255; /* alpha */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+                convert_rows(convert_row_bgr24_to_bgra, srcdata, srcstride,
+                             pbBuffer, cbStride, prc->Width, prc->Height);
 
             HeapFree(GetProcessHeap(), 0, srcdata);
 
@@ -662,14 +788,8 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            BYTE *dstpixel;
-            BYTE tmppixel[3];
 
             srcstride = 3 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -680,26 +800,8 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
 
             if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        tmppixel[0]=*srcpixel++; /* red */
-                        tmppixel[1]=*srcpixel++; /* green */
-                        tmppixel[2]=*srcpixel++; /* blue */
-
-                        *dstpixel++=tmppixel[2]; /* blue */
-                        *dstpixel++=tmppixel[1]; /* green */
-                        *dstpixel++=tmppixel[0]; /* red */
-                        *dstpixel++=255; /* alpha */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+                convert_rows(convert_row_rgb24_to_bgra, srcdata, srcstride,
+                             pbBuffer, cbStride, prc->Width, prc->Height);
 
             HeapFree(GetProcessHeap(), 0, srcdata);
 
@@ -710,15 +812,13 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
 
             res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(res)) return res;
 
             /* set all alpha values to 255 */
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                    pbBuffer[cbStride*y+4*x+3] = 0xff;
+            convert_rows(convert_row_set_alpha, pbBuffer, cbStride,
+                         pbBuffer, cbStride, prc->Width, prc->Height);
         }
         return S_OK;
     case format_32bppBGRA:
@@ -729,22 +829,12 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
 
             res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(res)) return res;
 
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 0 && alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * 255 / alpha;
-                    }
-                }
+            convert_rows(convert_row_unpremultiply, pbBuffer, cbStride,
+                         pbBuffer, cbStride, prc->Width, prc->Height);
         }
         return S_OK;
     case format_48bppRGB:
@@ -872,15 +962,12 @@ static HRESULT copypixels_to_32bppRGBA(struct FormatConverter *This, const WICRe
     case format_32bppRGB:
         if (prc)
         {
-            INT x, y;
-
             hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(hr)) return hr;
 
             /* set all alpha values to 255 */
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                    pbBuffer[cbStride*y+4*x+3] = 0xff;
+            convert_rows(convert_row_set_alpha, pbBuffer, cbStride,
+                         pbBuffer, cbStride, prc->Width, prc->Height);
         }
         return S_OK;
 
@@ -892,22 +979,11 @@ static HRESULT copypixels_to_32bppRGBA(struct FormatConverter *This, const WICRe
     case format_32bppPRGBA:
         if (prc)
         {
-            INT x, y;
-
             hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(hr)) return hr;
 
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 0 && alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * 255 / alpha;
-                    }
-                }
+            convert_rows(convert_row_unpremultiply, pbBuffer, cbStride,
+                         pbBuffer, cbStride, prc->Width, prc->Height);
         }
         return S_OK;
 
@@ -965,21 +1041,8 @@ static HRESULT copypixels_to_32bppPBGRA(struct FormatConverter *This, const WICR
     default:
         hr = copypixels_to_32bppBGRA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
         if (SUCCEEDED(hr) && prc)
-        {
-            INT x, y;
-
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * alpha / 255;
-                    }
-                }
-        }
+            convert_rows(convert_row_premultiply, pbBuffer, cbStride,
+                         pbBuffer, cbStride, prc->Width, prc->Height);
         return hr;
     }
 }
@@ -998,21 +1061,8 @@ static HRESULT copypixels_to_32bppPRGBA(struct FormatConverter *This, const WICR
     default:
         hr = copypixels_to_32bppRGBA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
         if (SUCCEEDED(hr) && prc)
-        {
-            INT x, y;
-
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * alpha / 255;
-                    }
-                }
-        }
+            convert_rows(convert_row_premultiply, pbBuffer, cbStride,
+                         pbBuffer, cbStride, prc->Width, prc->Height);
         return hr;
     }
 }
@@ -1040,13 +1090,8 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
         if (prc)
         {
             HRESULT res;
-            INT x, y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            BYTE *dstpixel;
 
             srcstride = 4 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -1057,22 +1102,8 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
             res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
 
             if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        *dstpixel++=*srcpixel++; /* blue */
-                        *dstpixel++=*srcpixel++; /* green */
-                        *dstpixel++=*srcpixel++; /* red */
-                        srcpixel++; /* alpha */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+                convert_rows(convert_row_bgra_to_bgr24, srcdata, srcstride,
+                             pbBuffer, cbStride, prc->Width, prc->Height);
 
             HeapFree(GetProcessHeap(), 0, srcdata);
 
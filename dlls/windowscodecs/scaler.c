@@ -193,6 +193,142 @@ static void NearestNeighbor_CopyScanline(BitmapScaler *This,
     }
 }
 
+/* position of the center of a destination pixel in the source, in 1/256 pixel units */
+static void Linear_GetSourceCoords(UINT dst, UINT dst_size, UINT src_size,
+    UINT *src0, UINT *src1, UINT *frac)
+{
+    LONGLONG pos = ((LONGLONG)(2 * dst + 1) * src_size * 256) / (2 * dst_size) - 128;
+
+    if (pos < 0) pos = 0;
+    *src0 = pos >> 8;
+    *frac = pos & 0xff;
+    if (*src0 >= src_size - 1)
+    {
+        *src0 = src_size - 1;
+        *frac = 0;
+    }
+    *src1 = *frac ? *src0 + 1 : *src0;
+}
+
+static void Linear_GetRequiredSourceRect(BitmapScaler *This,
+    UINT x, UINT y, WICRect *src_rect)
+{
+    UINT x0, x1, y0, y1, frac;
+
+    Linear_GetSourceCoords(x, This->width, This->src_width, &x0, &x1, &frac);
+    Linear_GetSourceCoords(y, This->height, This->src_height, &y0, &y1, &frac);
+    src_rect->X = x0;
+    src_rect->Y = y0;
+    src_rect->Width = x1 - x0 + 1;
+    src_rect->Height = y1 - y0 + 1;
+}
+
+static void Linear_CopyScanline(BitmapScaler *This,
+    UINT dst_x, UINT dst_y, UINT dst_width,
+    BYTE **src_data, UINT src_data_x, UINT src_data_y, BYTE *pbBuffer)
+{
+    UINT i, c;
+    UINT bytesperpixel = This->bpp/8;
+    UINT x0, x1, fx, y0, y1, fy, top, bottom;
+    const BYTE *row0, *row1;
+
+    Linear_GetSourceCoords(dst_y, This->height, This->src_height, &y0, &y1, &fy);
+    row0 = src_data[y0 - src_data_y];
+    row1 = src_data[y1 - src_data_y];
+
+    for (i=0; i<dst_width; i++)
+    {
+        Linear_GetSourceCoords(dst_x + i, This->width, This->src_width, &x0, &x1, &fx);
+        x0 = (x0 - src_data_x) * bytesperpixel;
+        x1 = (x1 - src_data_x) * bytesperpixel;
+
+        for (c=0; c<bytesperpixel; c++)
+        {
+            top = row0[x0 + c] * (256 - fx) + row0[x1 + c] * fx;
+            bottom = row1[x0 + c] * (256 - fx) + row1[x1 + c] * fx;
+            *pbBuffer++ = (top * (256 - fy) + bottom * fy + 0x8000) >> 16;
+        }
+    }
+}
+
+/* A destination pixel covers [dst * src_size, (dst + 1) * src_size) in units
+ * of 1/dst_size source pixels; each source pixel is weighted by its overlap. */
+static void Fant_GetSourceRange(UINT dst, UINT dst_size, UINT src_size, UINT *first, UINT *last)
+{
+    *first = (ULONGLONG)dst * src_size / dst_size;
+    *last = ((ULONGLONG)(dst + 1) * src_size + dst_size - 1) / dst_size - 1;
+}
+
+static inline UINT Fant_GetWeight(UINT dst, UINT dst_size, UINT src, UINT src_size)
+{
+    ULONGLONG start = max((ULONGLONG)dst * src_size, (ULONGLONG)src * dst_size);
+    ULONGLONG end = min((ULONGLONG)(dst + 1) * src_size, (ULONGLONG)(src + 1) * dst_size);
+
+    return end - start;
+}
+
+static void Fant_GetRequiredSourceRect(BitmapScaler *This,
+    UINT x, UINT y, WICRect *src_rect)
+{
+    UINT x0, x1, y0, y1;
+
+    Fant_GetSourceRange(x, This->width, This->src_width, &x0, &x1);
+    Fant_GetSourceRange(y, This->height, This->src_height, &y0, &y1);
+    src_rect->X = x0;
+    src_rect->Y = y0;
+    src_rect->Width = x1 - x0 + 1;
+    src_rect->Height = y1 - y0 + 1;
+}
+
+static void Fant_CopyScanline(BitmapScaler *This,
+    UINT dst_x, UINT dst_y, UINT dst_width,
+    BYTE **src_data, UINT src_data_x, UINT src_data_y, BYTE *pbBuffer)
+{
+    UINT i, c, sx, sy;
+    UINT bytesperpixel = This->bpp/8;
+    UINT x0, x1, y0, y1;
+    ULONGLONG sum[4], weight, total = (ULONGLONG)This->src_width * This->src_height;
+    const BYTE *src;
+
+    Fant_GetSourceRange(dst_y, This->height, This->src_height, &y0, &y1);
+
+    for (i=0; i<dst_width; i++)
+    {
+        Fant_GetSourceRange(dst_x + i, This->width, This->src_width, &x0, &x1);
+        memset(sum, 0, sizeof(sum));
+
+        for (sy=y0; sy<=y1; sy++)
+        {
+            UINT weight_y = Fant_GetWeight(dst_y, This->height, sy, This->src_height);
+
+            src = src_data[sy - src_data_y] + (x0 - src_data_x) * bytesperpixel;
+            for (sx=x0; sx<=x1; sx++)
+            {
+                weight = (ULONGLONG)weight_y * Fant_GetWeight(dst_x + i, This->width, sx, This->src_width);
+                for (c=0; c<bytesperpixel; c++)
+                    sum[c] += *src++ * weight;
+            }
+        }
+
+        for (c=0; c<bytesperpixel; c++)
+            *pbBuffer++ = (sum[c] + total / 2) / total;
+    }
+}
+
+/* formats with one byte per channel that can be interpolated directly */
+static BOOL is_interpolatable_format(const WICPixelFormatGUID *format)
+{
+    return IsEqualGUID(format, &GUID_WICPixelFormat8bppGray) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat24bppBGR) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat24bppRGB) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat32bppBGR) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat32bppBGRA) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat32bppPBGRA) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat32bppRGB) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat32bppRGBA) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat32bppPRGBA);
+}
+
 static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
     const WICRect *prc, UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
 {
@@ -341,6 +477,43 @@ static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
     {
         switch (mode)
         {
+        case WICBitmapInterpolationModeCubic:
+            FIXME("bicubic interpolation not implemented, using linear\n");
+            /* fall-through */
+        case WICBitmapInterpolationModeLinear:
+        case WICBitmapInterpolationModeFant:
+            if (is_interpolatable_format(&src_pixelformat))
+            {
+                IWICBitmapSource_AddRef(pISource);
+                This->source = pISource;
+            }
+            else if ((This->bpp % 8) == 0)
+            {
+                /* keep the pixel format of the source, those are only scaled
+                 * with the nearest neighbor */
+                IWICBitmapSource_AddRef(pISource);
+                This->source = pISource;
+                This->fn_get_required_source_rect = NearestNeighbor_GetRequiredSourceRect;
+                This->fn_copy_scanline = NearestNeighbor_CopyScanline;
+                break;
+            }
+            else
+            {
+                hr = WICConvertBitmapSource(&GUID_WICPixelFormat32bppBGRA,
+                    pISource, &This->source);
+                This->bpp = 32;
+            }
+            if (mode == WICBitmapInterpolationModeFant)
+            {
+                This->fn_get_required_source_rect = Fant_GetRequiredSourceRect;
+                This->fn_copy_scanline = Fant_CopyScanline;
+            }
+            else
+            {
+                This->fn_get_required_source_rect = Linear_GetRequiredSourceRect;
+                This->fn_copy_scanline = Linear_CopyScanline;
+            }
+            break;
         default:
             FIXME("unsupported mode %i\n", mode);
             /* fall-through */
@@ -1245,6 +1245,73 @@ static void test_bitmap_scaler(void)
     IWICBitmap_Release(bitmap);
 }
 
+static void test_bitmap_scaler_interpolation(void)
+{
+    static const WICBitmapInterpolationMode modes[] =
+    {
+        WICBitmapInterpolationModeLinear,
+        WICBitmapInterpolationModeFant,
+    };
+    static BYTE data[] =
+    {
+          0, 100, 200, 52,
+         20,  40,  60, 80,
+    };
+    IWICBitmapScaler *scaler;
+    IWICBitmap *bitmap;
+    WICPixelFormatGUID format;
+    BYTE buffer[2];
+    HRESULT hr;
+    UINT i;
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 4, 2, &GUID_WICPixelFormat8bppGray,
+        4, sizeof(data), data, &bitmap);
+    ok(hr == S_OK, "Failed to create a bitmap, hr %#x.\n", hr);
+
+    for (i = 0; i < ARRAY_SIZE(modes); i++)
+    {
+        hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+        ok(hr == S_OK, "Failed to create bitmap scaler, hr %#x.\n", hr);
+
+        hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, 2, 1, modes[i]);
+        ok(hr == S_OK, "%u: Failed to initialize bitmap scaler, hr %#x.\n", modes[i], hr);
+
+        /* halving both dimensions averages each 2x2 block */
+        memset(buffer, 0xcc, sizeof(buffer));
+        hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 2, sizeof(buffer), buffer);
+        ok(hr == S_OK, "%u: Failed to copy pixels, hr %#x.\n", modes[i], hr);
+        ok(buffer[0] == 40 && buffer[1] == 98, "%u: Unexpected pixels %u,%u.\n",
+            modes[i], buffer[0], buffer[1]);
+
+        IWICBitmapScaler_Release(scaler);
+    }
+
+    IWICBitmap_Release(bitmap);
+
+    /* formats that aren't interpolated keep their pixel format */
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 2, 2, &GUID_WICPixelFormat16bppBGR555,
+        4, 8, data, &bitmap);
+    ok(hr == S_OK, "Failed to create a bitmap, hr %#x.\n", hr);
+
+    for (i = 0; i < ARRAY_SIZE(modes); i++)
+    {
+        hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+        ok(hr == S_OK, "Failed to create bitmap scaler, hr %#x.\n", hr);
+
+        hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, 1, 1, modes[i]);
+        ok(hr == S_OK, "%u: Failed to initialize bitmap scaler, hr %#x.\n", modes[i], hr);
+
+        hr = IWICBitmapScaler_GetPixelFormat(scaler, &format);
+        ok(hr == S_OK, "%u: Failed to get pixel format, hr %#x.\n", modes[i], hr);
+        ok(IsEqualGUID(&format, &GUID_WICPixelFormat16bppBGR555), "%u: Unexpected pixel format %s.\n",
+            modes[i], wine_dbgstr_guid(&format));
+
+        IWICBitmapScaler_Release(scaler);
+    }
+
+    IWICBitmap_Release(bitmap);
+}
+
 START_TEST(bitmap)
 {
     HRESULT hr;
@@ -1262,6 +1329,7 @@ START_TEST(bitmap)
     test_CreateBitmapFromHBITMAP();
     test_clipper();
     test_bitmap_scaler();
+    test_bitmap_scaler_interpolation();
 
     IWICImagingFactory_Release(factory);
 
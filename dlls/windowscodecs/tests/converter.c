@@ -615,6 +615,34 @@ static void test_default_converter(void)
     DeleteTestBitmap(src_obj);
 }
 
+static void test_converter_empty_rect(void)
+{
+    BitmapTestSrc *src_obj;
+    IWICFormatConverter *converter;
+    WICRect rc = { 0, 0, 0, 0 };
+    BYTE buf[32 * 4];
+    HRESULT hr;
+
+    CreateTestBitmap(&testdata_32bppBGR, &src_obj);
+
+    hr = IWICImagingFactory_CreateFormatConverter(factory, &converter);
+    ok(hr == S_OK, "CreateFormatConverter error %#x\n", hr);
+
+    hr = IWICFormatConverter_Initialize(converter, &src_obj->IWICBitmapSource_iface,
+        &GUID_WICPixelFormat32bppBGRA, WICBitmapDitherTypeNone, NULL, 0.0,
+        WICBitmapPaletteTypeCustom);
+    ok(hr == S_OK, "Initialize error %#x\n", hr);
+
+    rc.Width = testdata_32bppBGR.width;
+    memset(buf, 0x55, sizeof(buf));
+    hr = IWICFormatConverter_CopyPixels(converter, &rc, rc.Width * 4, sizeof(buf), buf);
+    ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+    ok(buf[0] == 0x55 && buf[3] == 0x55, "buffer should not be touched\n");
+
+    IWICFormatConverter_Release(converter);
+    DeleteTestBitmap(src_obj);
+}
+
 typedef struct property_opt_test_data
 {
     LPCOLESTR name;
@@ -1817,6 +1845,7 @@ START_TEST(converter)
 
     test_invalid_conversion();
     test_default_converter();
+    test_converter_empty_rect();
     test_converter_8bppIndexed();
 
     test_encoder(&testdata_BlackWhite, &CLSID_WICPngEncoder,
@@ -5641,10 +5641,17 @@ static BOOL shader_arb_has_ffp_proj_control(void *shader_priv)
 
 static void shader_arb_precompile(void *shader_priv, struct wined3d_shader *shader) {}
 
+static HRESULT shader_arb_translate(void *shader_priv, struct wined3d_shader *shader,
+        struct wined3d_string_buffer *source)
+{
+    return E_NOTIMPL;
+}
+
 const struct wined3d_shader_backend_ops arb_program_shader_backend =
 {
     shader_arb_handle_instruction,
     shader_arb_precompile,
+    shader_arb_translate,
     shader_arb_select,
     shader_arb_select_compute,
     shader_arb_disable,
@@ -5941,12 +5948,12 @@ static void alpha_test_arbfp(struct wined3d_context *context, const struct wined
 
     if (state->render_states[WINED3D_RS_ALPHATESTENABLE])
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_ALPHA_TEST);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_ALPHA_TEST, TRUE);
         checkGLcall("glEnable GL_ALPHA_TEST");
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_ALPHA_TEST);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_ALPHA_TEST, FALSE);
         checkGLcall("glDisable GL_ALPHA_TEST");
         return;
     }
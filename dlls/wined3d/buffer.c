@@ -897,7 +897,8 @@ void wined3d_buffer_load(struct wined3d_buffer *buffer, struct wined3d_context *
 
     TRACE("buffer %p.\n", buffer);
 
-    if (buffer->resource.map_count)
+    /* Maps through the upload heap don't touch the buffer object. */
+    if (buffer->resource.map_count && !buffer->upload.flags)
     {
         WARN("Buffer is mapped, skipping preload.\n");
         return;
@@ -1242,6 +1243,273 @@ void wined3d_buffer_upload_data(struct wined3d_buffer *buffer, struct wined3d_co
     wined3d_buffer_gl_upload_ranges(wined3d_buffer_gl(buffer), context, data, range.offset, 1, &range);
 }
 
+/* Reserve "size" bytes at the head of the heap. Application thread only. */
+static BOOL wined3d_upload_heap_reserve(struct wined3d_upload_heap *heap, unsigned int size, ULONGLONG *pos)
+{
+    ULONGLONG start = heap->head, limit;
+    size_t heap_offset;
+
+    size = (size + RESOURCE_ALIGNMENT - 1) & ~(RESOURCE_ALIGNMENT - 1);
+    if (size > WINED3D_UPLOAD_HEAP_SIZE / 4)
+        return FALSE;
+
+    heap_offset = start % WINED3D_UPLOAD_HEAP_SIZE;
+    if (heap_offset + size > WINED3D_UPLOAD_HEAP_SIZE)
+        start += WINED3D_UPLOAD_HEAP_SIZE - heap_offset;
+
+    limit = InterlockedCompareExchange64(&heap->retired, 0, 0);
+    if (heap->map_count && heap->map_start < limit)
+        limit = heap->map_start;
+    if (start + size - limit > WINED3D_UPLOAD_HEAP_SIZE)
+    {
+        TRACE("Upload heap is full.\n");
+        return FALSE;
+    }
+
+    heap->head = start + size;
+    *pos = start;
+
+    return TRUE;
+}
+
+/* Allocate memory for data that is written immediately, and consumed by a
+ * command queued right after. "end" is the position to pass to
+ * wined3d_upload_heap_retire() once the command is executed. */
+BYTE *wined3d_upload_heap_alloc(struct wined3d_upload_heap *heap, unsigned int size,
+        size_t *heap_offset, ULONGLONG *end)
+{
+    ULONGLONG pos;
+
+    if (!wined3d_upload_heap_reserve(heap, size, &pos))
+        return NULL;
+
+    *heap_offset = pos % WINED3D_UPLOAD_HEAP_SIZE;
+    *end = heap->map_count ? heap->map_start : heap->head;
+
+    return heap->map_ptr + *heap_offset;
+}
+
+BOOL wined3d_buffer_map_upload(struct wined3d_buffer *buffer, struct wined3d_map_desc *map_desc,
+        const struct wined3d_box *box, DWORD flags)
+{
+    struct wined3d_upload_heap *heap = buffer->resource.device->upload_heap;
+    unsigned int offset;
+    ULONGLONG pos;
+
+    /* Only DISCARD maps are handled here. The application may write anywhere
+     * in the buffer after those, so the whole buffer is uploaded, and nothing
+     * in the heap memory has to match the current contents. */
+    if (!heap || buffer->resource.map_count || buffer->upload.flags
+            || (flags & WINED3D_MAP_READ) || !(flags & WINED3D_MAP_DISCARD)
+            || !(buffer->flags & WINED3D_BUFFER_USE_BO) || buffer->flags & WINED3D_BUFFER_PIN_SYSMEM)
+        return FALSE;
+
+    offset = box ? box->left : 0;
+    if (offset > buffer->resource.size)
+        return FALSE;
+
+    if (!wined3d_upload_heap_reserve(heap, buffer->resource.size, &pos))
+        return FALSE;
+    if (!heap->map_count++)
+        heap->map_start = pos;
+
+    buffer->upload.flags = flags;
+    buffer->upload.heap_offset = pos % WINED3D_UPLOAD_HEAP_SIZE;
+    buffer->upload.end = heap->head;
+    InterlockedIncrement(&buffer->resource.map_count);
+    map_desc->data = heap->map_ptr + buffer->upload.heap_offset + offset;
+    map_desc->row_pitch = map_desc->slice_pitch = buffer->resource.size;
+
+    TRACE("Returning upload heap memory at %p for buffer %p.\n", map_desc->data, buffer);
+
+    return TRUE;
+}
+
+BOOL wined3d_buffer_unmap_upload(struct wined3d_buffer *buffer)
+{
+    struct wined3d_upload_heap *heap = buffer->resource.device->upload_heap;
+    ULONGLONG end;
+
+    if (!buffer->upload.flags)
+        return FALSE;
+
+    /* Data before "map_start" belongs to maps that were already unmapped, so
+     * their copies are queued before this one. */
+    end = --heap->map_count ? heap->map_start : heap->head;
+    wined3d_cs_emit_upload_buffer(buffer->resource.device->cs, buffer, 0,
+            buffer->resource.size, buffer->upload.heap_offset, end, buffer->upload.flags);
+    InterlockedDecrement(&buffer->resource.map_count);
+    buffer->upload.flags = 0;
+
+    return TRUE;
+}
+
+/* Handle a sub-resource update through the upload heap. */
+BOOL wined3d_buffer_update_upload(struct wined3d_buffer *buffer, const struct wined3d_box *box, const void *data)
+{
+    struct wined3d_upload_heap *heap = buffer->resource.device->upload_heap;
+    unsigned int size = box->right - box->left;
+    size_t heap_offset;
+    ULONGLONG end;
+    BYTE *dst;
+
+    if (buffer->upload.flags || !(buffer->flags & WINED3D_BUFFER_USE_BO)
+            || buffer->flags & WINED3D_BUFFER_PIN_SYSMEM
+            || !(dst = wined3d_upload_heap_alloc(heap, size, &heap_offset, &end)))
+        return FALSE;
+
+    memcpy(dst, data, size);
+    wined3d_cs_emit_upload_buffer(buffer->resource.device->cs, buffer, box->left, size, heap_offset, end, 0);
+
+    return TRUE;
+}
+
+/* Context activation is done by the caller. */
+void wined3d_buffer_upload_from_heap(struct wined3d_buffer *buffer, struct wined3d_context *context,
+        size_t heap_offset, unsigned int offset, unsigned int size, DWORD flags)
+{
+    struct wined3d_upload_heap *heap = buffer->resource.device->upload_heap;
+    struct wined3d_buffer_gl *buffer_gl = wined3d_buffer_gl(buffer);
+    struct wined3d_bo_address dst, src;
+
+    /* The buffer may have lost its BO, or started needing conversion, after
+     * the map was handled. Go through system memory in that case. */
+    if (buffer->conversion_map || buffer->flags & WINED3D_BUFFER_PIN_SYSMEM
+            || !wined3d_buffer_prepare_location(buffer, context, WINED3D_LOCATION_BUFFER))
+    {
+        if (!wined3d_buffer_load_location(buffer, context, WINED3D_LOCATION_SYSMEM))
+        {
+            ERR("Failed to load system memory.\n");
+            return;
+        }
+        memcpy((BYTE *)buffer->resource.heap_memory + offset, heap->map_ptr + heap_offset, size);
+        wined3d_buffer_invalidate_range(buffer, ~WINED3D_LOCATION_SYSMEM, offset, size);
+        return;
+    }
+
+    if (flags & WINED3D_MAP_DISCARD)
+        wined3d_buffer_validate_location(buffer, WINED3D_LOCATION_BUFFER);
+    else if (!wined3d_buffer_load_location(buffer, context, WINED3D_LOCATION_BUFFER))
+    {
+        ERR("Failed to load buffer location.\n");
+        return;
+    }
+
+    dst.buffer_object = buffer_gl->buffer_object;
+    dst.addr = (BYTE *)(ULONG_PTR)offset;
+    src.buffer_object = heap->buffer_object;
+    src.addr = (BYTE *)heap_offset;
+    context_copy_bo_address(context, &dst, buffer_gl->buffer_type_hint, &src, GL_COPY_READ_BUFFER, size);
+    wined3d_buffer_invalidate_location(buffer, ~WINED3D_LOCATION_BUFFER);
+
+    if ((flags & WINED3D_MAP_DISCARD) && buffer->resource.heap_memory)
+        wined3d_buffer_evict_sysmem(buffer);
+}
+
+/* Context activation is done by the caller. */
+struct wined3d_upload_heap *wined3d_upload_heap_create(struct wined3d_device *device,
+        struct wined3d_context *context)
+{
+    static const GLbitfield map_flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+    struct wined3d_upload_heap *heap;
+    unsigned int i;
+
+    if (!gl_info->supported[ARB_BUFFER_STORAGE] || !gl_info->supported[ARB_MAP_BUFFER_RANGE]
+            || !gl_info->supported[ARB_COPY_BUFFER] || !gl_info->supported[ARB_SYNC])
+    {
+        TRACE("Persistent buffer mappings not supported, not creating an upload heap.\n");
+        return NULL;
+    }
+
+    if (!(heap = heap_alloc_zero(sizeof(*heap))))
+        return NULL;
+
+    for (i = 0; i < ARRAY_SIZE(heap->fences); ++i)
+    {
+        if (FAILED(wined3d_fence_create(device, &heap->fences[i].fence)))
+        {
+            ERR("Failed to create upload heap fence.\n");
+            while (i)
+                wined3d_fence_destroy(heap->fences[--i].fence);
+            heap_free(heap);
+            return NULL;
+        }
+    }
+
+    GL_EXTCALL(glGenBuffers(1, &heap->buffer_object));
+    context_bind_bo(context, GL_COPY_READ_BUFFER, heap->buffer_object);
+    GL_EXTCALL(glBufferStorage(GL_COPY_READ_BUFFER, WINED3D_UPLOAD_HEAP_SIZE, NULL, map_flags));
+    heap->map_ptr = GL_EXTCALL(glMapBufferRange(GL_COPY_READ_BUFFER, 0, WINED3D_UPLOAD_HEAP_SIZE, map_flags));
+    checkGLcall("create upload heap");
+
+    if (!heap->map_ptr)
+    {
+        ERR("Failed to map upload heap.\n");
+        wined3d_upload_heap_destroy(heap, context);
+        return NULL;
+    }
+
+    TRACE("Created upload heap %p, buffer object %u, memory at %p.\n", heap, heap->buffer_object, heap->map_ptr);
+
+    return heap;
+}
+
+/* Context activation is done by the caller. */
+void wined3d_upload_heap_destroy(struct wined3d_upload_heap *heap, struct wined3d_context *context)
+{
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+    unsigned int i;
+
+    if (heap->map_ptr)
+    {
+        context_bind_bo(context, GL_COPY_READ_BUFFER, heap->buffer_object);
+        GL_EXTCALL(glUnmapBuffer(GL_COPY_READ_BUFFER));
+    }
+    GL_EXTCALL(glDeleteBuffers(1, &heap->buffer_object));
+    checkGLcall("destroy upload heap");
+
+    for (i = 0; i < ARRAY_SIZE(heap->fences); ++i)
+        wined3d_fence_destroy(heap->fences[i].fence);
+    heap_free(heap);
+}
+
+/* Record that the heap is used up to "end", and advance the retired position
+ * past completed fences. An "end" of 0 only polls, and fences any pending
+ * data regardless of its size. */
+void wined3d_upload_heap_retire(struct wined3d_upload_heap *heap, struct wined3d_device *device, ULONGLONG end)
+{
+    struct wined3d_upload_heap_fence *fence;
+    LONGLONG retired = heap->retired;
+
+    if (end > heap->submitted)
+        heap->submitted = end;
+
+    while (heap->fence_count)
+    {
+        fence = &heap->fences[heap->fence_start];
+        /* Make sure the fences eventually signal once they are all in use. */
+        if (wined3d_fence_test(fence->fence, device, heap->fence_count == ARRAY_SIZE(heap->fences)
+                ? WINED3DGETDATA_FLUSH : 0) != WINED3D_FENCE_OK)
+            break;
+        retired = fence->end;
+        heap->fence_start = (heap->fence_start + 1) % ARRAY_SIZE(heap->fences);
+        --heap->fence_count;
+    }
+    if (retired != heap->retired)
+        InterlockedCompareExchange64(&heap->retired, retired, heap->retired);
+
+    if (heap->submitted == heap->fenced || heap->fence_count == ARRAY_SIZE(heap->fences))
+        return;
+    if (end && heap->submitted - heap->fenced < WINED3D_UPLOAD_HEAP_SIZE / ARRAY_SIZE(heap->fences))
+        return;
+
+    fence = &heap->fences[(heap->fence_start + heap->fence_count) % ARRAY_SIZE(heap->fences)];
+    wined3d_fence_issue(fence->fence, device);
+    fence->end = heap->fenced = heap->submitted;
+    ++heap->fence_count;
+}
+
 static void wined3d_buffer_init_data(struct wined3d_buffer *buffer,
         struct wined3d_device *device, const struct wined3d_sub_resource_data *data)
 {
@@ -2369,16 +2369,15 @@ void wined3d_context_destroy(struct wined3d_context *context)
     device->adapter->adapter_ops->adapter_destroy_context(context);
 }
 
-const unsigned int *wined3d_context_gl_get_tex_unit_mapping(const struct wined3d_context_gl *context_gl,
-        const struct wined3d_shader_version *shader_version, unsigned int *base, unsigned int *count)
+const unsigned int *wined3d_get_tex_unit_mapping(const struct wined3d_gl_info *gl_info,
+        const unsigned int *tex_unit_map, const struct wined3d_shader_version *shader_version,
+        unsigned int *base, unsigned int *count)
 {
-    const struct wined3d_gl_info *gl_info = context_gl->c.gl_info;
-
     if (!shader_version)
     {
         *base = 0;
         *count = WINED3D_MAX_TEXTURES;
-        return context_gl->c.tex_unit_map;
+        return tex_unit_map;
     }
 
     if (shader_version->major >= 4)
@@ -2403,7 +2402,14 @@ const unsigned int *wined3d_context_gl_get_tex_unit_mapping(const struct wined3d
             *count = 0;
     }
 
-    return context_gl->c.tex_unit_map;
+    return tex_unit_map;
+}
+
+const unsigned int *wined3d_context_gl_get_tex_unit_mapping(const struct wined3d_context_gl *context_gl,
+        const struct wined3d_shader_version *shader_version, unsigned int *base, unsigned int *count)
+{
+    return wined3d_get_tex_unit_mapping(context_gl->c.gl_info, context_gl->c.tex_unit_map,
+            shader_version, base, count);
 }
 
 static void context_get_rt_size(const struct wined3d_context *context, SIZE *size)
@@ -2547,6 +2553,68 @@ void context_bind_bo(struct wined3d_context *context, GLenum binding, GLuint nam
     GL_EXTCALL(glBindBuffer(binding, name));
 }
 
+static unsigned int wined3d_context_gl_get_cap_idx(GLenum cap)
+{
+    switch (cap)
+    {
+        case GL_ALPHA_TEST:                     return 0;
+        case GL_BLEND:                          return 1;
+        case GL_COLOR_MATERIAL:                 return 2;
+        case GL_COLOR_SUM_EXT:                  return 3;
+        case GL_CULL_FACE:                      return 4;
+        case GL_DEPTH_BOUNDS_TEST_EXT:          return 5;
+        case GL_DEPTH_CLAMP:                    return 6;
+        case GL_DEPTH_TEST:                     return 7;
+        case GL_DITHER:                         return 8;
+        case GL_FRAMEBUFFER_SRGB:               return 9;
+        case GL_LIGHTING:                       return 10;
+        case GL_LINE_SMOOTH:                    return 11;
+        case GL_LINE_STIPPLE:                   return 12;
+        case GL_MULTISAMPLE:                    return 13;
+        case GL_NORMALIZE:                      return 14;
+        case GL_POINT_SPRITE_ARB:               return 15;
+        case GL_POLYGON_OFFSET_FILL:            return 16;
+        case GL_SAMPLE_ALPHA_TO_COVERAGE:       return 17;
+        case GL_SCISSOR_TEST:                   return 18;
+        case GL_STENCIL_TEST:                   return 19;
+        case GL_STENCIL_TEST_TWO_SIDE_EXT:      return 20;
+        default:                                return ~0u;
+    }
+}
+
+/* Many applications set the same render states over and over again, and
+ * state handlers are also invoked for states that merely depend on a state
+ * that changed. Keep track of the capabilities we set, and skip the GL call
+ * if the capability is already in the requested state. Capabilities that are
+ * changed through other means must not be changed through this function. */
+void wined3d_context_gl_enable_cap(struct wined3d_context_gl *context_gl, GLenum cap, BOOL enable)
+{
+    const struct wined3d_gl_info *gl_info = context_gl->c.gl_info;
+    unsigned int idx;
+    uint32_t mask;
+
+    if ((idx = wined3d_context_gl_get_cap_idx(cap)) != ~0u)
+    {
+        mask = 1u << idx;
+        if ((context_gl->cap_valid_mask & mask) && !(context_gl->cap_enabled_mask & mask) == !enable)
+        {
+            ++context_gl->cap_calls_skipped;
+            return;
+        }
+        context_gl->cap_valid_mask |= mask;
+        if (enable)
+            context_gl->cap_enabled_mask |= mask;
+        else
+            context_gl->cap_enabled_mask &= ~mask;
+    }
+
+    ++context_gl->cap_calls;
+    if (enable)
+        gl_info->gl_ops.gl.p_glEnable(cap);
+    else
+        gl_info->gl_ops.gl.p_glDisable(cap);
+}
+
 void wined3d_context_gl_bind_texture(struct wined3d_context_gl *context_gl, GLenum target, GLuint name)
 {
     const struct wined3d_dummy_textures *textures = &wined3d_device_gl(context_gl->c.device)->dummy_textures;
@@ -2841,27 +2909,27 @@ void wined3d_context_gl_apply_blit_state(struct wined3d_context_gl *context_gl,
 
     if (gl_info->supported[WINED3D_GL_LEGACY_CONTEXT])
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_ALPHA_TEST);
+        wined3d_context_gl_enable_cap(context_gl, GL_ALPHA_TEST, FALSE);
         context_invalidate_state(context, STATE_RENDER(WINED3D_RS_ALPHATESTENABLE));
     }
-    gl_info->gl_ops.gl.p_glDisable(GL_DEPTH_TEST);
+    wined3d_context_gl_enable_cap(context_gl, GL_DEPTH_TEST, FALSE);
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_ZENABLE));
-    gl_info->gl_ops.gl.p_glDisable(GL_BLEND);
+    wined3d_context_gl_enable_cap(context_gl, GL_BLEND, FALSE);
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_ALPHABLENDENABLE));
-    gl_info->gl_ops.gl.p_glDisable(GL_CULL_FACE);
+    wined3d_context_gl_enable_cap(context_gl, GL_CULL_FACE, FALSE);
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_CULLMODE));
-    gl_info->gl_ops.gl.p_glDisable(GL_STENCIL_TEST);
+    wined3d_context_gl_enable_cap(context_gl, GL_STENCIL_TEST, FALSE);
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_STENCILENABLE));
-    gl_info->gl_ops.gl.p_glDisable(GL_SCISSOR_TEST);
+    wined3d_context_gl_enable_cap(context_gl, GL_SCISSOR_TEST, FALSE);
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_SCISSORTESTENABLE));
     if (gl_info->supported[ARB_POINT_SPRITE])
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_POINT_SPRITE_ARB);
+        wined3d_context_gl_enable_cap(context_gl, GL_POINT_SPRITE_ARB, FALSE);
         context_invalidate_state(context, STATE_RENDER(WINED3D_RS_POINTSPRITEENABLE));
     }
     if (gl_info->supported[ARB_FRAMEBUFFER_SRGB])
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_FRAMEBUFFER_SRGB);
+        wined3d_context_gl_enable_cap(context_gl, GL_FRAMEBUFFER_SRGB, FALSE);
         context_invalidate_state(context, STATE_RENDER(WINED3D_RS_SRGBWRITEENABLE));
     }
     gl_info->gl_ops.gl.p_glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
@@ -2983,14 +3051,14 @@ void wined3d_context_gl_apply_ffp_blit_state(struct wined3d_context_gl *context_
     context_invalidate_state(context, STATE_TRANSFORM(WINED3D_TS_PROJECTION));
 
     /* Other misc states. */
-    gl_info->gl_ops.gl.p_glDisable(GL_LIGHTING);
+    wined3d_context_gl_enable_cap(context_gl, GL_LIGHTING, FALSE);
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_LIGHTING));
     gl_info->p_glDisableWINE(GL_FOG);
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_FOGENABLE));
 
     if (gl_info->supported[EXT_SECONDARY_COLOR])
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_COLOR_SUM_EXT);
+        wined3d_context_gl_enable_cap(context_gl, GL_COLOR_SUM_EXT, FALSE);
         context_invalidate_state(context, STATE_RENDER(WINED3D_RS_SPECULARENABLE));
     }
     checkGLcall("ffp blit state application");
@@ -3017,6 +3085,7 @@ static BOOL have_framebuffer_attachment(unsigned int rt_count, struct wined3d_re
 BOOL context_apply_clear_state(struct wined3d_context *context, const struct wined3d_state *state,
         UINT rt_count, const struct wined3d_fb_state *fb)
 {
+    struct wined3d_context_gl *context_gl = wined3d_context_gl(context);
     struct wined3d_rendertarget_view * const *rts = fb->render_targets;
     struct wined3d_rendertarget_view *dsv = fb->depth_stencil;
     const struct wined3d_gl_info *gl_info = context->gl_info;
@@ -3117,14 +3186,11 @@ BOOL context_apply_clear_state(struct wined3d_context *context, const struct win
     /* Blending and clearing should be orthogonal, but tests on the nvidia
      * driver show that disabling blending when clearing improves the clearing
      * performance incredibly. */
-    gl_info->gl_ops.gl.p_glDisable(GL_BLEND);
-    gl_info->gl_ops.gl.p_glEnable(GL_SCISSOR_TEST);
+    wined3d_context_gl_enable_cap(context_gl, GL_BLEND, FALSE);
+    wined3d_context_gl_enable_cap(context_gl, GL_SCISSOR_TEST, TRUE);
     if (rt_count && gl_info->supported[ARB_FRAMEBUFFER_SRGB])
     {
-        if (needs_srgb_write(context, state, fb))
-            gl_info->gl_ops.gl.p_glEnable(GL_FRAMEBUFFER_SRGB);
-        else
-            gl_info->gl_ops.gl.p_glDisable(GL_FRAMEBUFFER_SRGB);
+        wined3d_context_gl_enable_cap(context_gl, GL_FRAMEBUFFER_SRGB, needs_srgb_write(context, state, fb));
         context_invalidate_state(context, STATE_RENDER(WINED3D_RS_SRGBWRITEENABLE));
     }
     checkGLcall("setting up state for clear");
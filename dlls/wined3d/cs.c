@@ -19,10 +19,13 @@
 #include "config.h"
 #include "wine/port.h"
 #include "wined3d_private.h"
+#include "wine/wined3d_stats.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 
 #define WINED3D_INITIAL_CS_SIZE 4096
+#define WINED3D_CS_PACKET_NEXT_CHUNK (~(size_t)0)
 
 enum wined3d_cs_op
 {
@@ -69,6 +72,8 @@ enum wined3d_cs_op
     WINED3D_CS_OP_UNMAP,
     WINED3D_CS_OP_BLT_SUB_RESOURCE,
     WINED3D_CS_OP_UPDATE_SUB_RESOURCE,
+    WINED3D_CS_OP_UPLOAD_BUFFER,
+    WINED3D_CS_OP_UPLOAD_TEXTURE,
     WINED3D_CS_OP_ADD_DIRTY_TEXTURE_REGION,
     WINED3D_CS_OP_CLEAR_UNORDERED_ACCESS_VIEW,
     WINED3D_CS_OP_COPY_UAV_COUNTER,
@@ -76,6 +81,31 @@ enum wined3d_cs_op
     WINED3D_CS_OP_STOP,
 };
 
+#define WINED3D_FRAME_STATS_QUERY_COUNT 4u
+
+struct wined3d_frame_stats
+{
+    HANDLE log;
+    HANDLE mapping;
+    struct wined3d_frame_stats_block *block;
+    double tick_ms;
+
+    /* Application thread. */
+    LONGLONG app_present;
+
+    /* CS thread. */
+    ULONGLONG frame;
+    LONGLONG cs_present;
+    unsigned int depth;
+    LONGLONG op_time[WINED3D_CS_OP_STOP];
+    unsigned int op_count[WINED3D_CS_OP_STOP];
+
+    struct wined3d_timestamp_query queries[WINED3D_FRAME_STATS_QUERY_COUNT];
+    unsigned int query_start, query_count;
+    UINT64 last_timestamp;
+    float gpu_ms;
+};
+
 struct wined3d_cs_packet
 {
     size_t size;
@@ -96,6 +126,8 @@ struct wined3d_cs_present
     RECT dst_rect;
     unsigned int swap_interval;
     DWORD flags;
+    LONGLONG frame_time;
+    LONGLONG stall_time;
 };
 
 struct wined3d_cs_clear
@@ -411,6 +443,27 @@ struct wined3d_cs_update_sub_resource
     struct wined3d_sub_resource_data data;
 };
 
+struct wined3d_cs_upload_buffer
+{
+    enum wined3d_cs_op opcode;
+    struct wined3d_buffer *buffer;
+    unsigned int offset, size;
+    size_t heap_offset;
+    ULONGLONG end;
+    DWORD flags;
+};
+
+struct wined3d_cs_upload_texture
+{
+    enum wined3d_cs_op opcode;
+    struct wined3d_texture *texture;
+    unsigned int sub_resource_idx;
+    struct wined3d_box box;
+    unsigned int row_pitch, slice_pitch;
+    size_t heap_offset;
+    ULONGLONG end;
+};
+
 struct wined3d_cs_add_dirty_texture_region
 {
     enum wined3d_cs_op opcode;
@@ -503,6 +556,8 @@ static const char *debug_cs_op(enum wined3d_cs_op op)
         WINED3D_TO_STR(WINED3D_CS_OP_UNMAP);
         WINED3D_TO_STR(WINED3D_CS_OP_BLT_SUB_RESOURCE);
         WINED3D_TO_STR(WINED3D_CS_OP_UPDATE_SUB_RESOURCE);
+        WINED3D_TO_STR(WINED3D_CS_OP_UPLOAD_BUFFER);
+        WINED3D_TO_STR(WINED3D_CS_OP_UPLOAD_TEXTURE);
         WINED3D_TO_STR(WINED3D_CS_OP_ADD_DIRTY_TEXTURE_REGION);
         WINED3D_TO_STR(WINED3D_CS_OP_CLEAR_UNORDERED_ACCESS_VIEW);
         WINED3D_TO_STR(WINED3D_CS_OP_COPY_UAV_COUNTER);
@@ -535,6 +590,10 @@ static void wined3d_cs_exec_present(struct wined3d_cs *cs, const void *data)
         wined3d_resource_release(&swapchain->back_buffers[i]->resource);
     }
 
+    if (cs->device->upload_heap)
+        wined3d_upload_heap_retire(cs->device->upload_heap, cs->device, 0);
+    wined3d_texture_prefetch_readbacks(cs->device);
+
     InterlockedDecrement(&cs->pending_presents);
 }
 
@@ -554,6 +613,17 @@ void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *sw
     op->dst_rect = *dst_rect;
     op->swap_interval = swap_interval;
     op->flags = flags;
+    op->frame_time = 0;
+    op->stall_time = cs->stats.stall_time;
+    if (cs->frame_stats)
+    {
+        LARGE_INTEGER now;
+
+        QueryPerformanceCounter(&now);
+        if (cs->frame_stats->app_present)
+            op->frame_time = now.QuadPart - cs->frame_stats->app_present;
+        cs->frame_stats->app_present = now.QuadPart;
+    }
 
     pending = InterlockedIncrement(&cs->pending_presents);
 
@@ -565,13 +635,22 @@ void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *sw
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 
-    /* Limit input latency by limiting the number of presents that we can get
-     * ahead of the worker thread. */
-    while (pending >= swapchain->max_frame_latency)
+    if (TRACE_ON(d3d_perf) && cs->thread)
     {
-        wined3d_pause();
-        pending = InterlockedCompareExchange(&cs->pending_presents, 0, 0);
+        LARGE_INTEGER frequency;
+
+        QueryPerformanceFrequency(&frequency);
+        TRACE_(d3d_perf)("%u packets, %s bytes, %.1f bytes per packet, max queue depth %d bytes, "
+                "%u stalls, %.3f ms stalled.\n", cs->stats.packets, wine_dbgstr_longlong(cs->stats.bytes),
+                cs->stats.packets ? (double)cs->stats.bytes / cs->stats.packets : 0.0, cs->stats.max_pending,
+                cs->stats.stalls, cs->stats.stall_time * 1000.0 / frequency.QuadPart);
     }
+    memset(&cs->stats, 0, sizeof(cs->stats));
+
+    /* Limit input latency by limiting the number of presents that we can get
+     * ahead of the worker thread. */
+    if (pending >= swapchain->max_frame_latency)
+        wined3d_cs_wait_counter(cs, &cs->pending_presents, swapchain->max_frame_latency - 1);
 }
 
 static void wined3d_cs_exec_clear(struct wined3d_cs *cs, const void *data)
@@ -2296,16 +2375,42 @@ void wined3d_cs_emit_blt_sub_resource(struct wined3d_cs *cs, struct wined3d_reso
         wined3d_cs_finish(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
+/* Context activation is done by the caller. */
+static void wined3d_cs_update_texture(struct wined3d_context *context, struct wined3d_texture *texture,
+        unsigned int sub_resource_idx, const struct wined3d_box *box, const struct wined3d_const_bo_address *addr,
+        unsigned int row_pitch, unsigned int slice_pitch)
+{
+    unsigned int width, height, depth, level;
+    struct wined3d_box src_box;
+
+    level = sub_resource_idx % texture->level_count;
+    width = wined3d_texture_get_level_width(texture, level);
+    height = wined3d_texture_get_level_height(texture, level);
+    depth = wined3d_texture_get_level_depth(texture, level);
+
+    /* Only load the sub-resource for partial updates. */
+    if (!box->left && !box->top && !box->front
+            && box->right == width && box->bottom == height && box->back == depth)
+        wined3d_texture_prepare_texture(texture, context, FALSE);
+    else
+        wined3d_texture_load_location(texture, sub_resource_idx, context, WINED3D_LOCATION_TEXTURE_RGB);
+    wined3d_texture_gl_bind_and_dirtify(wined3d_texture_gl(texture), wined3d_context_gl(context), FALSE);
+
+    wined3d_box_set(&src_box, 0, 0, box->right - box->left, box->bottom - box->top, 0, box->back - box->front);
+    wined3d_texture_upload_data(texture, sub_resource_idx, context, texture->resource.format, &src_box,
+            addr, row_pitch, slice_pitch, box->left, box->top, box->front, FALSE);
+
+    wined3d_texture_validate_location(texture, sub_resource_idx, WINED3D_LOCATION_TEXTURE_RGB);
+    wined3d_texture_invalidate_location(texture, sub_resource_idx, ~WINED3D_LOCATION_TEXTURE_RGB);
+}
+
 static void wined3d_cs_exec_update_sub_resource(struct wined3d_cs *cs, const void *data)
 {
     const struct wined3d_cs_update_sub_resource *op = data;
     struct wined3d_resource *resource = op->resource;
     const struct wined3d_box *box = &op->box;
-    unsigned int width, height, depth, level;
     struct wined3d_const_bo_address addr;
     struct wined3d_context *context;
-    struct wined3d_texture *texture;
-    struct wined3d_box src_box;
 
     context = context_acquire(cs->device, NULL, 0);
 
@@ -2324,30 +2429,10 @@ static void wined3d_cs_exec_update_sub_resource(struct wined3d_cs *cs, const voi
         goto done;
     }
 
-    texture = wined3d_texture_from_resource(resource);
-
-    level = op->sub_resource_idx % texture->level_count;
-    width = wined3d_texture_get_level_width(texture, level);
-    height = wined3d_texture_get_level_height(texture, level);
-    depth = wined3d_texture_get_level_depth(texture, level);
-
     addr.buffer_object = 0;
     addr.addr = op->data.data;
-
-    /* Only load the sub-resource for partial updates. */
-    if (!box->left && !box->top && !box->front
-            && box->right == width && box->bottom == height && box->back == depth)
-        wined3d_texture_prepare_texture(texture, context, FALSE);
-    else
-        wined3d_texture_load_location(texture, op->sub_resource_idx, context, WINED3D_LOCATION_TEXTURE_RGB);
-    wined3d_texture_gl_bind_and_dirtify(wined3d_texture_gl(texture), wined3d_context_gl(context), FALSE);
-
-    wined3d_box_set(&src_box, 0, 0, box->right - box->left, box->bottom - box->top, 0, box->back - box->front);
-    wined3d_texture_upload_data(texture, op->sub_resource_idx, context, texture->resource.format, &src_box,
-            &addr, op->data.row_pitch, op->data.slice_pitch, box->left, box->top, box->front, FALSE);
-
-    wined3d_texture_validate_location(texture, op->sub_resource_idx, WINED3D_LOCATION_TEXTURE_RGB);
-    wined3d_texture_invalidate_location(texture, op->sub_resource_idx, ~WINED3D_LOCATION_TEXTURE_RGB);
+    wined3d_cs_update_texture(context, wined3d_texture_from_resource(resource), op->sub_resource_idx,
+            box, &addr, op->data.row_pitch, op->data.slice_pitch);
 
 done:
     context_release(context);
@@ -2378,6 +2463,121 @@ void wined3d_cs_emit_update_sub_resource(struct wined3d_cs *cs, struct wined3d_r
     wined3d_cs_finish(cs, WINED3D_CS_QUEUE_MAP);
 }
 
+static void wined3d_cs_exec_upload_buffer(struct wined3d_cs *cs, const void *data)
+{
+    const struct wined3d_cs_upload_buffer *op = data;
+    struct wined3d_buffer *buffer = op->buffer;
+    struct wined3d_context *context;
+
+    context = context_acquire(cs->device, NULL, 0);
+    wined3d_buffer_upload_from_heap(buffer, context, op->heap_offset, op->offset, op->size, op->flags);
+    wined3d_upload_heap_retire(cs->device->upload_heap, cs->device, op->end);
+    context_release(context);
+
+    wined3d_resource_release(&buffer->resource);
+}
+
+void wined3d_cs_emit_upload_buffer(struct wined3d_cs *cs, struct wined3d_buffer *buffer, unsigned int offset,
+        unsigned int size, size_t heap_offset, ULONGLONG end, DWORD flags)
+{
+    struct wined3d_cs_upload_buffer *op;
+
+    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    op->opcode = WINED3D_CS_OP_UPLOAD_BUFFER;
+    op->buffer = buffer;
+    op->offset = offset;
+    op->size = size;
+    op->heap_offset = heap_offset;
+    op->end = end;
+    op->flags = flags;
+
+    wined3d_resource_acquire(&buffer->resource);
+
+    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+}
+
+static void wined3d_cs_exec_upload_texture(struct wined3d_cs *cs, const void *data)
+{
+    const struct wined3d_cs_upload_texture *op = data;
+    struct wined3d_upload_heap *heap = cs->device->upload_heap;
+    struct wined3d_const_bo_address addr;
+    struct wined3d_context *context;
+
+    context = context_acquire(cs->device, NULL, 0);
+    addr.buffer_object = heap->buffer_object;
+    addr.addr = (const BYTE *)op->heap_offset;
+    wined3d_cs_update_texture(context, op->texture, op->sub_resource_idx,
+            &op->box, &addr, op->row_pitch, op->slice_pitch);
+    wined3d_upload_heap_retire(heap, cs->device, op->end);
+    context_release(context);
+
+    wined3d_resource_release(&op->texture->resource);
+}
+
+/* Copy the data of a sub-resource update to the upload heap, and queue the
+ * update after the commands that were already emitted. Unlike
+ * wined3d_cs_emit_update_sub_resource(), this needs to wait neither for the
+ * resource to become idle, nor for the command to be executed. */
+BOOL wined3d_cs_emit_upload_sub_resource(struct wined3d_cs *cs, struct wined3d_resource *resource,
+        unsigned int sub_resource_idx, const struct wined3d_box *box, const void *data, unsigned int row_pitch,
+        unsigned int slice_pitch)
+{
+    struct wined3d_upload_heap *heap = cs->device->upload_heap;
+    unsigned int dst_row_pitch, dst_slice_pitch, row_count, z, y;
+    struct wined3d_cs_upload_texture *op;
+    struct wined3d_texture *texture;
+    size_t heap_offset;
+    ULONGLONG end;
+    BYTE *dst;
+
+    if (!heap || resource->map_count)
+        return FALSE;
+
+    if (resource->type == WINED3D_RTYPE_BUFFER)
+        return wined3d_buffer_update_upload(buffer_from_resource(resource), box, data);
+
+    /* Converted formats are uploaded through a mapping of the source data,
+     * which isn't possible while the heap is persistently mapped. */
+    texture = texture_from_resource(resource);
+    if (resource->format->upload || resource->format_flags & WINED3DFMT_FLAG_DECOMPRESS
+            || resource->multisample_type != WINED3D_MULTISAMPLE_NONE)
+        return FALSE;
+
+    wined3d_format_calculate_pitch(resource->format, 1, box->right - box->left,
+            box->bottom - box->top, &dst_row_pitch, &dst_slice_pitch);
+    if (!(dst = wined3d_upload_heap_alloc(heap, dst_slice_pitch * (box->back - box->front), &heap_offset, &end)))
+        return FALSE;
+
+    row_count = dst_slice_pitch / dst_row_pitch;
+    for (z = 0; z < box->back - box->front; ++z)
+    {
+        const BYTE *src = (const BYTE *)data + z * slice_pitch;
+
+        for (y = 0; y < row_count; ++y)
+        {
+            memcpy(dst, src, dst_row_pitch);
+            dst += dst_row_pitch;
+            src += row_pitch;
+        }
+    }
+
+    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    op->opcode = WINED3D_CS_OP_UPLOAD_TEXTURE;
+    op->texture = texture;
+    op->sub_resource_idx = sub_resource_idx;
+    op->box = *box;
+    op->row_pitch = dst_row_pitch;
+    op->slice_pitch = dst_slice_pitch;
+    op->heap_offset = heap_offset;
+    op->end = end;
+
+    wined3d_resource_acquire(resource);
+
+    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+
+    return TRUE;
+}
+
 static void wined3d_cs_exec_add_dirty_texture_region(struct wined3d_cs *cs, const void *data)
 {
     const struct wined3d_cs_add_dirty_texture_region *op = data;
@@ -2501,7 +2701,11 @@ static void wined3d_cs_emit_stop(struct wined3d_cs *cs)
     op->opcode = WINED3D_CS_OP_STOP;
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
-    wined3d_cs_finish(cs, WINED3D_CS_QUEUE_DEFAULT);
+
+    /* The worker thread can't signal "producer_event" after it stopped, the
+     * event may already be destroyed by then. */
+    while (InterlockedCompareExchange(&cs->queue[WINED3D_CS_QUEUE_DEFAULT].pending, 0, 0))
+        wined3d_pause();
 }
 
 static void (* const wined3d_cs_op_handlers[])(struct wined3d_cs *cs, const void *data) =
@@ -2549,12 +2753,245 @@ static void (* const wined3d_cs_op_handlers[])(struct wined3d_cs *cs, const void
     /* WINED3D_CS_OP_UNMAP                       */ wined3d_cs_exec_unmap,
     /* WINED3D_CS_OP_BLT_SUB_RESOURCE            */ wined3d_cs_exec_blt_sub_resource,
     /* WINED3D_CS_OP_UPDATE_SUB_RESOURCE         */ wined3d_cs_exec_update_sub_resource,
+    /* WINED3D_CS_OP_UPLOAD_BUFFER               */ wined3d_cs_exec_upload_buffer,
+    /* WINED3D_CS_OP_UPLOAD_TEXTURE              */ wined3d_cs_exec_upload_texture,
     /* WINED3D_CS_OP_ADD_DIRTY_TEXTURE_REGION    */ wined3d_cs_exec_add_dirty_texture_region,
     /* WINED3D_CS_OP_CLEAR_UNORDERED_ACCESS_VIEW */ wined3d_cs_exec_clear_unordered_access_view,
     /* WINED3D_CS_OP_COPY_UAV_COUNTER            */ wined3d_cs_exec_copy_uav_counter,
     /* WINED3D_CS_OP_GENERATE_MIPMAPS            */ wined3d_cs_exec_generate_mipmaps,
 };
 
+static const char *wined3d_frame_stats_op_name(enum wined3d_cs_op op)
+{
+    return debug_cs_op(op) + strlen("WINED3D_CS_OP_");
+}
+
+static void wined3d_frame_stats_write_header(struct wined3d_frame_stats *stats)
+{
+    char buffer[4096];
+    unsigned int i;
+    DWORD written;
+    int len;
+
+    len = sprintf(buffer, "frame,present_ms,stall_ms,cs_busy_ms,cs_present_ms,gpu_ms,ops");
+    for (i = 0; i < WINED3D_CS_OP_STOP; ++i)
+        len += sprintf(buffer + len, ",%s", wined3d_frame_stats_op_name(i));
+    buffer[len++] = '\n';
+    WriteFile(stats->log, buffer, len, &written, NULL);
+}
+
+static struct wined3d_frame_stats *wined3d_frame_stats_create(void)
+{
+    static const WCHAR logW[] = {'W','I','N','E','_','D','3','D','_','F','R','A','M','E','_','L','O','G',0};
+    static const WCHAR statsW[] = {'W','I','N','E','_','D','3','D','_',
+            'F','R','A','M','E','_','S','T','A','T','S',0};
+    WCHAR log_name[MAX_PATH], stats_name[MAX_PATH];
+    struct wined3d_frame_stats *stats;
+    DWORD log_size, stats_size;
+    LARGE_INTEGER frequency;
+    unsigned int i;
+
+    if ((log_size = GetEnvironmentVariableW(logW, log_name, ARRAY_SIZE(log_name))) >= ARRAY_SIZE(log_name))
+        log_size = 0;
+    if ((stats_size = GetEnvironmentVariableW(statsW, stats_name, ARRAY_SIZE(stats_name))) >= ARRAY_SIZE(stats_name))
+        stats_size = 0;
+    if (!log_size && !stats_size)
+        return NULL;
+
+    if (!(stats = heap_alloc_zero(sizeof(*stats))))
+        return NULL;
+    stats->log = INVALID_HANDLE_VALUE;
+    QueryPerformanceFrequency(&frequency);
+    stats->tick_ms = 1000.0 / frequency.QuadPart;
+
+    if (log_size)
+    {
+        if ((stats->log = CreateFileW(log_name, FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL)) == INVALID_HANDLE_VALUE)
+            ERR("Failed to open frame log %s, error %u.\n", debugstr_w(log_name), GetLastError());
+        else if (!GetFileSize(stats->log, NULL))
+            wined3d_frame_stats_write_header(stats);
+    }
+
+    if (stats_size)
+    {
+        if (!(stats->mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                0, sizeof(*stats->block), stats_name)))
+            ERR("Failed to create frame statistics mapping %s, error %u.\n",
+                    debugstr_w(stats_name), GetLastError());
+        else if (!(stats->block = MapViewOfFile(stats->mapping, FILE_MAP_WRITE, 0, 0, sizeof(*stats->block))))
+            ERR("Failed to map frame statistics, error %u.\n", GetLastError());
+        else
+        {
+            stats->block->magic = WINED3D_FRAME_STATS_MAGIC;
+            stats->block->version = WINED3D_FRAME_STATS_VERSION;
+            stats->block->op_count = min(WINED3D_CS_OP_STOP, WINED3D_FRAME_STATS_MAX_OPS);
+            for (i = 0; i < stats->block->op_count; ++i)
+                lstrcpynA(stats->block->ops[i].name, wined3d_frame_stats_op_name(i),
+                        sizeof(stats->block->ops[i].name));
+        }
+    }
+
+    TRACE("Frame statistics enabled, log %s, mapping %s.\n",
+            debugstr_w(stats->log != INVALID_HANDLE_VALUE ? log_name : NULL),
+            debugstr_w(stats->block ? stats_name : NULL));
+
+    return stats;
+}
+
+static void wined3d_frame_stats_destroy(struct wined3d_frame_stats *stats)
+{
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(stats->queries); ++i)
+    {
+        if (stats->queries[i].context)
+            context_free_timestamp_query(&stats->queries[i]);
+    }
+    if (stats->block)
+        UnmapViewOfFile(stats->block);
+    if (stats->mapping)
+        CloseHandle(stats->mapping);
+    if (stats->log != INVALID_HANDLE_VALUE)
+        CloseHandle(stats->log);
+    heap_free(stats);
+}
+
+/* Issue a timestamp query at the end of the frame, and read back the
+ * timestamps of earlier frames that are available. */
+static void wined3d_frame_stats_update_gpu_time(struct wined3d_frame_stats *stats, struct wined3d_device *device)
+{
+    struct wined3d_timestamp_query *query;
+    const struct wined3d_gl_info *gl_info;
+    struct wined3d_context *context;
+    GLuint64 timestamp;
+    GLuint available;
+
+    if (!device->adapter->gl_info.supported[ARB_TIMER_QUERY])
+        return;
+
+    while (stats->query_count)
+    {
+        query = &stats->queries[stats->query_start];
+        if (query->context)
+        {
+            if (!(context = context_reacquire(device, query->context)))
+                break;
+            gl_info = context->gl_info;
+
+            GL_EXTCALL(glGetQueryObjectuiv(query->id, GL_QUERY_RESULT_AVAILABLE, &available));
+            if (available)
+                GL_EXTCALL(glGetQueryObjectui64v(query->id, GL_QUERY_RESULT, &timestamp));
+            checkGLcall("get frame timestamp");
+            context_release(context);
+            if (!available)
+                break;
+
+            if (stats->last_timestamp)
+                stats->gpu_ms = (timestamp - stats->last_timestamp) / 1000000.0;
+            stats->last_timestamp = timestamp;
+            context_free_timestamp_query(query);
+        }
+        stats->query_start = (stats->query_start + 1) % ARRAY_SIZE(stats->queries);
+        --stats->query_count;
+    }
+
+    if (stats->query_count == ARRAY_SIZE(stats->queries))
+        return;
+
+    query = &stats->queries[(stats->query_start + stats->query_count) % ARRAY_SIZE(stats->queries)];
+    context = context_acquire(device, NULL, 0);
+    gl_info = context->gl_info;
+    context_alloc_timestamp_query(context, query);
+    GL_EXTCALL(glQueryCounter(query->id, GL_TIMESTAMP));
+    checkGLcall("glQueryCounter");
+    context_release(context);
+    ++stats->query_count;
+}
+
+static void wined3d_frame_stats_end_frame(struct wined3d_cs *cs, const struct wined3d_cs_present *op)
+{
+    struct wined3d_frame_stats *stats = cs->frame_stats;
+    struct wined3d_frame_record record;
+    LONGLONG busy = 0;
+    LARGE_INTEGER now;
+    unsigned int i;
+
+    wined3d_frame_stats_update_gpu_time(stats, cs->device);
+
+    QueryPerformanceCounter(&now);
+    memset(&record, 0, sizeof(record));
+    record.frame = ++stats->frame;
+    for (i = 0; i < WINED3D_CS_OP_STOP; ++i)
+    {
+        busy += stats->op_time[i];
+        record.ops += stats->op_count[i];
+    }
+    record.present_ms = op->frame_time * stats->tick_ms;
+    record.stall_ms = op->stall_time * stats->tick_ms;
+    record.cs_busy_ms = busy * stats->tick_ms;
+    if (stats->cs_present)
+        record.cs_present_ms = (now.QuadPart - stats->cs_present) * stats->tick_ms;
+    stats->cs_present = now.QuadPart;
+    record.gpu_ms = stats->gpu_ms;
+
+    if (stats->log != INVALID_HANDLE_VALUE)
+    {
+        char buffer[4096];
+        DWORD written;
+        int len;
+
+        len = sprintf(buffer, "%u,%.3f,%.3f,%.3f,%.3f,%.3f,%u", (unsigned int)record.frame,
+                record.present_ms, record.stall_ms, record.cs_busy_ms, record.cs_present_ms,
+                record.gpu_ms, record.ops);
+        for (i = 0; i < WINED3D_CS_OP_STOP; ++i)
+            len += sprintf(buffer + len, ",%.3f", stats->op_time[i] * stats->tick_ms);
+        buffer[len++] = '\n';
+        WriteFile(stats->log, buffer, len, &written, NULL);
+    }
+
+    if (stats->block)
+    {
+        struct wined3d_frame_stats_block *block = stats->block;
+
+        InterlockedIncrement(&block->sequence);
+        block->records[record.frame % WINED3D_FRAME_STATS_HISTORY] = record;
+        for (i = 0; i < block->op_count; ++i)
+        {
+            block->ops[i].ms = stats->op_time[i] * stats->tick_ms;
+            block->ops[i].count = stats->op_count[i];
+        }
+        block->frame = record.frame;
+        InterlockedIncrement(&block->sequence);
+    }
+
+    memset(stats->op_time, 0, sizeof(stats->op_time));
+    memset(stats->op_count, 0, sizeof(stats->op_count));
+}
+
+static void wined3d_cs_execute(struct wined3d_cs *cs, enum wined3d_cs_op opcode, const void *data)
+{
+    struct wined3d_frame_stats *stats = cs->frame_stats;
+    LARGE_INTEGER start, end;
+
+    if (!stats || stats->depth)
+    {
+        wined3d_cs_op_handlers[opcode](cs, data);
+        return;
+    }
+
+    ++stats->depth;
+    QueryPerformanceCounter(&start);
+    wined3d_cs_op_handlers[opcode](cs, data);
+    QueryPerformanceCounter(&end);
+    stats->op_time[opcode] += end.QuadPart - start.QuadPart;
+    ++stats->op_count[opcode];
+
+    if (opcode == WINED3D_CS_OP_PRESENT)
+        wined3d_frame_stats_end_frame(cs, data);
+    --stats->depth;
+}
+
 static void *wined3d_cs_st_require_space(struct wined3d_cs *cs, size_t size, enum wined3d_cs_queue_id queue_id)
 {
     if (size > (cs->data_size - cs->end))
@@ -2594,7 +3031,7 @@ static void wined3d_cs_st_submit(struct wined3d_cs *cs, enum wined3d_cs_queue_id
     if (opcode >= WINED3D_CS_OP_STOP)
         ERR("Invalid opcode %#x.\n", opcode);
     else
-        wined3d_cs_op_handlers[opcode](cs, &data[start]);
+        wined3d_cs_execute(cs, opcode, &data[start]);
 
     if (cs->data == data)
         cs->start = cs->end = start;
@@ -2617,17 +3054,106 @@ static const struct wined3d_cs_ops wined3d_cs_st_ops =
 static BOOL wined3d_cs_queue_is_empty(const struct wined3d_cs *cs, const struct wined3d_cs_queue *queue)
 {
     wined3d_from_cs(cs);
-    return *(volatile LONG *)&queue->head == queue->tail;
+    return !*(volatile LONG *)&queue->pending;
+}
+
+static struct wined3d_cs_chunk *wined3d_cs_queue_get_chunk(struct wined3d_cs_queue *queue, size_t size)
+{
+    struct wined3d_cs_chunk *chunk;
+
+    if (size <= WINED3D_CS_CHUNK_SIZE && (chunk = InterlockedExchangePointer((void **)&queue->free_chunk, NULL)))
+    {
+        chunk->next = NULL;
+        return chunk;
+    }
+
+    size = max(size, WINED3D_CS_CHUNK_SIZE);
+    if (!(chunk = heap_alloc(FIELD_OFFSET(struct wined3d_cs_chunk, data[size]))))
+        return NULL;
+    chunk->next = NULL;
+    chunk->size = size;
+
+    return chunk;
+}
+
+static void wined3d_cs_queue_put_chunk(struct wined3d_cs_queue *queue, struct wined3d_cs_chunk *chunk)
+{
+    if (chunk->size == WINED3D_CS_CHUNK_SIZE)
+        chunk = InterlockedExchangePointer((void **)&queue->free_chunk, chunk);
+    heap_free(chunk);
+}
+
+static BOOL wined3d_cs_queue_init(struct wined3d_cs_queue *queue)
+{
+    if (!(queue->head_chunk = wined3d_cs_queue_get_chunk(queue, WINED3D_CS_CHUNK_SIZE)))
+        return FALSE;
+    queue->tail_chunk = queue->head_chunk;
+    queue->head = queue->tail = 0;
+    queue->pending = 0;
+
+    return TRUE;
+}
+
+static void wined3d_cs_queue_cleanup(struct wined3d_cs_queue *queue)
+{
+    struct wined3d_cs_chunk *chunk, *next;
+
+    for (chunk = queue->tail_chunk; chunk; chunk = next)
+    {
+        next = chunk->next;
+        heap_free(chunk);
+    }
+    heap_free(queue->free_chunk);
+}
+
+/* Wait until "counter" drops to "max" or below. The counters passed here are
+ * only decreased by the worker thread, which signals "producer_event" after
+ * executing a packet if "producer_waiting" is set. */
+void wined3d_cs_wait_counter(struct wined3d_cs *cs, LONG *counter, LONG max)
+{
+    LARGE_INTEGER start, end;
+    unsigned int spin_count;
+
+    if (!cs->thread || InterlockedCompareExchange(counter, 0, 0) <= max)
+        return;
+
+    QueryPerformanceCounter(&start);
+    for (spin_count = 0; InterlockedCompareExchange(counter, 0, 0) > max; ++spin_count)
+    {
+        if (spin_count < WINED3D_CS_WAIT_SPIN_COUNT)
+        {
+            wined3d_pause();
+            continue;
+        }
+
+        /* Either the worker thread sees "producer_waiting" after it changed
+         * the counter, or we see the new counter value here. */
+        InterlockedExchange(&cs->producer_waiting, TRUE);
+        if (InterlockedCompareExchange(counter, 0, 0) <= max)
+            break;
+        WaitForSingleObject(cs->producer_event, INFINITE);
+    }
+    QueryPerformanceCounter(&end);
+
+    ++cs->stats.stalls;
+    cs->stats.stall_time += end.QuadPart - start.QuadPart;
 }
 
 static void wined3d_cs_queue_submit(struct wined3d_cs_queue *queue, struct wined3d_cs *cs)
 {
     struct wined3d_cs_packet *packet;
     size_t packet_size;
+    LONG pending;
 
-    packet = (struct wined3d_cs_packet *)&queue->data[queue->head];
+    packet = (struct wined3d_cs_packet *)&queue->head_chunk->data[queue->head];
     packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[packet->size]);
-    InterlockedExchange(&queue->head, (queue->head + packet_size) & (WINED3D_CS_QUEUE_SIZE - 1));
+    queue->head += packet_size;
+    pending = InterlockedExchangeAdd(&queue->pending, packet_size) + packet_size;
+
+    ++cs->stats.packets;
+    cs->stats.bytes += packet_size;
+    if (pending > cs->stats.max_pending)
+        cs->stats.max_pending = pending;
 
     if (InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
         SetEvent(cs->event);
@@ -2643,61 +3169,43 @@ static void wined3d_cs_mt_submit(struct wined3d_cs *cs, enum wined3d_cs_queue_id
 
 static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size_t size, struct wined3d_cs *cs)
 {
-    size_t queue_size = ARRAY_SIZE(queue->data);
-    size_t header_size, packet_size, remaining;
+    size_t header_size, packet_size;
     struct wined3d_cs_packet *packet;
+    struct wined3d_cs_chunk *chunk;
 
     header_size = FIELD_OFFSET(struct wined3d_cs_packet, data[0]);
     size = (size + header_size - 1) & ~(header_size - 1);
     packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[size]);
-    if (packet_size >= WINED3D_CS_QUEUE_SIZE)
-    {
-        ERR("Packet size %lu >= queue size %u.\n",
-                (unsigned long)packet_size, WINED3D_CS_QUEUE_SIZE);
-        return NULL;
-    }
-
-    remaining = queue_size - queue->head;
-    if (remaining < packet_size)
-    {
-        size_t nop_size = remaining - header_size;
-        struct wined3d_cs_nop *nop;
-
-        TRACE("Inserting a nop for %lu + %lu bytes.\n",
-                (unsigned long)header_size, (unsigned long)nop_size);
 
-        nop = wined3d_cs_queue_require_space(queue, nop_size, cs);
-        if (nop_size)
-            nop->opcode = WINED3D_CS_OP_NOP;
+    /* Keep the amount of queued data bounded. Larger packets simply wait for
+     * the queue to drain completely. */
+    wined3d_cs_wait_counter(cs, &queue->pending, packet_size < WINED3D_CS_QUEUE_LIMIT
+            ? WINED3D_CS_QUEUE_LIMIT - packet_size : 0);
 
-        wined3d_cs_queue_submit(queue, cs);
-        assert(!queue->head);
-    }
-
-    for (;;)
+    /* Always leave room for the packet that links to the next chunk. */
+    chunk = queue->head_chunk;
+    if (chunk->size - queue->head < packet_size + header_size)
     {
-        LONG tail = *(volatile LONG *)&queue->tail;
-        LONG head = queue->head;
-        LONG new_pos;
+        struct wined3d_cs_chunk *next;
 
-        /* Empty. */
-        if (head == tail)
-            break;
-        new_pos = (head + packet_size) & (WINED3D_CS_QUEUE_SIZE - 1);
-        /* Head ahead of tail. We checked the remaining size above, so we only
-         * need to make sure we don't make head equal to tail. */
-        if (head > tail && (new_pos != tail))
-            break;
-        /* Tail ahead of head. Make sure the new head is before the tail as
-         * well. Note that new_pos is 0 when it's at the end of the queue. */
-        if (new_pos < tail && new_pos)
-            break;
+        if (!(next = wined3d_cs_queue_get_chunk(queue, packet_size + header_size)))
+        {
+            ERR("Failed to allocate a %lu bytes command stream chunk.\n",
+                    (unsigned long)(packet_size + header_size));
+            return NULL;
+        }
+
+        TRACE("Linking chunk %p to chunk %p.\n", next, chunk);
 
-        TRACE("Waiting for free space. Head %u, tail %u, packet size %lu.\n",
-                head, tail, (unsigned long)packet_size);
+        chunk->next = next;
+        packet = (struct wined3d_cs_packet *)&chunk->data[queue->head];
+        packet->size = WINED3D_CS_PACKET_NEXT_CHUNK;
+        queue->head_chunk = next;
+        queue->head = 0;
+        InterlockedExchangeAdd(&queue->pending, header_size);
     }
 
-    packet = (struct wined3d_cs_packet *)&queue->data[queue->head];
+    packet = (struct wined3d_cs_packet *)&queue->head_chunk->data[queue->head];
     packet->size = size;
     return packet->data;
 }
@@ -2715,8 +3223,7 @@ static void wined3d_cs_mt_finish(struct wined3d_cs *cs, enum wined3d_cs_queue_id
     if (cs->thread_id == GetCurrentThreadId())
         return wined3d_cs_st_finish(cs, queue_id);
 
-    while (cs->queue[queue_id].head != *(volatile LONG *)&cs->queue[queue_id].tail)
-        wined3d_pause();
+    wined3d_cs_wait_counter(cs, &cs->queue[queue_id].pending, 0);
 }
 
 static const struct wined3d_cs_ops wined3d_cs_mt_ops =
@@ -2742,7 +3249,7 @@ static void poll_queries(struct wined3d_cs *cs)
     }
 }
 
-static void wined3d_cs_wait_event(struct wined3d_cs *cs)
+static void wined3d_cs_wait_event(struct wined3d_cs *cs, DWORD timeout)
 {
     InterlockedExchange(&cs->waiting_for_event, TRUE);
 
@@ -2758,19 +3265,21 @@ static void wined3d_cs_wait_event(struct wined3d_cs *cs)
             && InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
         return;
 
-    WaitForSingleObject(cs->event, INFINITE);
+    WaitForSingleObject(cs->event, timeout);
 }
 
 static DWORD WINAPI wined3d_cs_run(void *ctx)
 {
+    size_t header_size = FIELD_OFFSET(struct wined3d_cs_packet, data[0]);
     struct wined3d_cs_packet *packet;
+    struct wined3d_cs_chunk *chunk;
     struct wined3d_cs_queue *queue;
     unsigned int spin_count = 0;
     struct wined3d_cs *cs = ctx;
     enum wined3d_cs_op opcode;
     HMODULE wined3d_module;
     unsigned int poll = 0;
-    LONG tail;
+    size_t packet_size;
 
     TRACE("Started.\n");
 
@@ -2794,15 +3303,34 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
             queue = &cs->queue[WINED3D_CS_QUEUE_DEFAULT];
             if (wined3d_cs_queue_is_empty(cs, queue))
             {
-                if (++spin_count >= WINED3D_CS_SPIN_COUNT && list_empty(&cs->query_poll_list))
-                    wined3d_cs_wait_event(cs);
+                /* Keep polling queries, but without spinning. Each timed
+                 * wake-up polls them, so that results aren't delayed by
+                 * WINED3D_CS_QUERY_POLL_INTERVAL waits. */
+                if (++spin_count >= WINED3D_CS_SPIN_COUNT)
+                {
+                    wined3d_cs_wait_event(cs, list_empty(&cs->query_poll_list) ? INFINITE : 1);
+                    poll = WINED3D_CS_QUERY_POLL_INTERVAL - 1;
+                }
+                else
+                    wined3d_pause();
                 continue;
             }
         }
         spin_count = 0;
 
-        tail = queue->tail;
-        packet = (struct wined3d_cs_packet *)&queue->data[tail];
+        chunk = queue->tail_chunk;
+        packet = (struct wined3d_cs_packet *)&chunk->data[queue->tail];
+        if (packet->size == WINED3D_CS_PACKET_NEXT_CHUNK)
+        {
+            queue->tail_chunk = chunk->next;
+            queue->tail = 0;
+            wined3d_cs_queue_put_chunk(queue, chunk);
+            InterlockedExchangeAdd(&queue->pending, -(LONG)header_size);
+            if (InterlockedCompareExchange(&cs->producer_waiting, FALSE, TRUE))
+                SetEvent(cs->producer_event);
+            continue;
+        }
+
         if (packet->size)
         {
             opcode = *(const enum wined3d_cs_op *)packet->data;
@@ -2815,17 +3343,20 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
                 break;
             }
 
-            wined3d_cs_op_handlers[opcode](cs, packet->data);
+            wined3d_cs_execute(cs, opcode, packet->data);
             TRACE("%s executed.\n", debug_cs_op(opcode));
         }
 
-        tail += FIELD_OFFSET(struct wined3d_cs_packet, data[packet->size]);
-        tail &= (WINED3D_CS_QUEUE_SIZE - 1);
-        InterlockedExchange(&queue->tail, tail);
+        packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[packet->size]);
+        queue->tail += packet_size;
+        InterlockedExchangeAdd(&queue->pending, -(LONG)packet_size);
+
+        if (InterlockedCompareExchange(&cs->producer_waiting, FALSE, TRUE))
+            SetEvent(cs->producer_event);
     }
 
-    cs->queue[WINED3D_CS_QUEUE_MAP].tail = cs->queue[WINED3D_CS_QUEUE_MAP].head;
-    cs->queue[WINED3D_CS_QUEUE_DEFAULT].tail = cs->queue[WINED3D_CS_QUEUE_DEFAULT].head;
+    InterlockedExchange(&cs->queue[WINED3D_CS_QUEUE_MAP].pending, 0);
+    InterlockedExchange(&cs->queue[WINED3D_CS_QUEUE_DEFAULT].pending, 0);
     TRACE("Stopped.\n");
     FreeLibraryAndExitThread(wined3d_module, 0);
 }
@@ -2847,39 +3378,60 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device)
     if (!(cs->data = heap_alloc(cs->data_size)))
         goto fail;
 
+    cs->frame_stats = wined3d_frame_stats_create();
+
     if (wined3d_settings.cs_multithreaded
             && !RtlIsCriticalSectionLockedByThread(NtCurrentTeb()->Peb->LoaderLock))
     {
         cs->ops = &wined3d_cs_mt_ops;
 
+        if (!wined3d_cs_queue_init(&cs->queue[WINED3D_CS_QUEUE_DEFAULT])
+                || !wined3d_cs_queue_init(&cs->queue[WINED3D_CS_QUEUE_MAP]))
+        {
+            ERR("Failed to initialise command stream queues.\n");
+            goto fail_queues;
+        }
+
         if (!(cs->event = CreateEventW(NULL, FALSE, FALSE, NULL)))
         {
             ERR("Failed to create command stream event.\n");
-            heap_free(cs->data);
-            goto fail;
+            goto fail_queues;
+        }
+
+        if (!(cs->producer_event = CreateEventW(NULL, FALSE, FALSE, NULL)))
+        {
+            ERR("Failed to create command stream producer event.\n");
+            CloseHandle(cs->event);
+            goto fail_queues;
         }
 
         if (!(GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
                 (const WCHAR *)wined3d_cs_run, &cs->wined3d_module)))
         {
             ERR("Failed to get wined3d module handle.\n");
+            CloseHandle(cs->producer_event);
             CloseHandle(cs->event);
-            heap_free(cs->data);
-            goto fail;
+            goto fail_queues;
         }
 
         if (!(cs->thread = CreateThread(NULL, 0, wined3d_cs_run, cs, 0, NULL)))
         {
             ERR("Failed to create wined3d command stream thread.\n");
             FreeLibrary(cs->wined3d_module);
+            CloseHandle(cs->producer_event);
             CloseHandle(cs->event);
-            heap_free(cs->data);
-            goto fail;
+            goto fail_queues;
         }
     }
 
     return cs;
 
+fail_queues:
+    wined3d_cs_queue_cleanup(&cs->queue[WINED3D_CS_QUEUE_MAP]);
+    wined3d_cs_queue_cleanup(&cs->queue[WINED3D_CS_QUEUE_DEFAULT]);
+    if (cs->frame_stats)
+        wined3d_frame_stats_destroy(cs->frame_stats);
+    heap_free(cs->data);
 fail:
     state_cleanup(&cs->state);
     heap_free(cs);
@@ -2890,12 +3442,19 @@ void wined3d_cs_destroy(struct wined3d_cs *cs)
 {
     if (cs->thread)
     {
+        wined3d_cs_finish(cs, WINED3D_CS_QUEUE_DEFAULT);
         wined3d_cs_emit_stop(cs);
         CloseHandle(cs->thread);
+        if (!CloseHandle(cs->producer_event))
+            ERR("Closing producer event failed.\n");
         if (!CloseHandle(cs->event))
             ERR("Closing event failed.\n");
+        wined3d_cs_queue_cleanup(&cs->queue[WINED3D_CS_QUEUE_MAP]);
+        wined3d_cs_queue_cleanup(&cs->queue[WINED3D_CS_QUEUE_DEFAULT]);
     }
 
+    if (cs->frame_stats)
+        wined3d_frame_stats_destroy(cs->frame_stats);
     state_cleanup(&cs->state);
     heap_free(cs->data);
     heap_free(cs);
@@ -347,7 +347,7 @@ void device_clear_render_targets(struct wined3d_device *device, UINT rt_count, c
     {
         if (gl_info->supported[EXT_STENCIL_TWO_SIDE])
         {
-            gl_info->gl_ops.gl.p_glDisable(GL_STENCIL_TEST_TWO_SIDE_EXT);
+            wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_STENCIL_TEST_TWO_SIDE_EXT, FALSE);
             context_invalidate_state(context, STATE_RENDER(WINED3D_RS_TWOSIDEDSTENCILMODE));
         }
         gl_info->gl_ops.gl.p_glStencilMask(~0U);
@@ -1028,6 +1028,11 @@ void wined3d_device_delete_opengl_contexts_cs(void *object)
     }
 
     context = context_acquire(device, NULL, 0);
+    if (device->upload_heap)
+    {
+        wined3d_upload_heap_destroy(device->upload_heap, context);
+        device->upload_heap = NULL;
+    }
     device->blitter->ops->blitter_destroy(device->blitter, context);
     device->shader_backend->shader_free_private(device, context);
     destroy_dummy_textures(device, context);
@@ -1075,6 +1080,7 @@ void wined3d_device_create_primary_opengl_context_cs(void *object)
     context = context_acquire(device, target, 0);
     create_dummy_textures(device, context);
     create_default_samplers(device, context);
+    device->upload_heap = wined3d_upload_heap_create(device, context);
     context_release(context);
 }
 
@@ -4341,6 +4347,10 @@ void CDECL wined3d_device_update_sub_resource(struct wined3d_device *device, str
         return;
     }
 
+    if (wined3d_cs_emit_upload_sub_resource(device->cs, resource, sub_resource_idx,
+            box, data, row_pitch, depth_pitch))
+        return;
+
     wined3d_resource_wait_idle(resource);
 
     wined3d_cs_emit_update_sub_resource(device->cs, resource, sub_resource_idx, box, data, row_pitch, depth_pitch);
@@ -5294,6 +5304,7 @@ HRESULT wined3d_device_init(struct wined3d_device *device, struct wined3d *wined
     fragment_pipeline = adapter->fragment_pipe;
 
     wine_rb_init(&device->samplers, wined3d_sampler_compare);
+    list_init(&device->readback_textures);
 
     if (vertex_pipeline->vp_states && fragment_pipeline->states
             && FAILED(hr = compile_state_table(device->state_table, device->multistate_funcs,
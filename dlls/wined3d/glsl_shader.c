@@ -42,6 +42,7 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d_shader);
 WINE_DECLARE_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 WINE_DECLARE_DEBUG_CHANNEL(winediag);
 
 #define WINED3D_GLSL_SAMPLE_PROJECTED   0x01
@@ -128,6 +129,66 @@ struct constant_heap
 };
 
 /* GLSL shader private data */
+#define WINED3D_GLSL_MAX_TRANSLATION_THREADS 4
+
+enum glsl_shader_job_state
+{
+    GLSL_SHADER_JOB_QUEUED,
+    GLSL_SHADER_JOB_RUNNING,
+    GLSL_SHADER_JOB_DONE,
+};
+
+/* The context state that GLSL generation depends on. */
+struct glsl_gen_context
+{
+    const struct wined3d_gl_info *gl_info;
+    const struct wined3d_d3d_info *d3d_info;
+    unsigned int tex_unit_map[WINED3D_MAX_COMBINED_SAMPLERS];
+};
+
+/* A speculative translation of a vertex or pixel shader, started when the
+ * shader is created, for the compile args derived from the state at that
+ * time. The translation threads only produce the GLSL source, the command
+ * stream thread still creates and compiles the GL shader object. */
+struct glsl_shader_job
+{
+    struct list entry;
+    struct wined3d_shader *shader;
+    enum glsl_shader_job_state state;
+    union
+    {
+        struct vs_compile_args vs;
+        struct ps_compile_args ps;
+    } args;
+    struct ps_np2fixup_info np2fixup;
+    /* Captured on the command stream thread, the translation threads never
+     * look at a live context or at the reg_maps of the shader. */
+    struct glsl_gen_context gen;
+    struct wined3d_shader_reg_maps reg_maps;
+    char *source;
+    LONGLONG time;
+};
+
+struct glsl_shader_translator
+{
+    CRITICAL_SECTION cs;
+    CONDITION_VARIABLE work_cond;
+    CONDITION_VARIABLE done_cond;
+    struct list jobs;
+    BOOL stop;
+    HANDLE threads[WINED3D_GLSL_MAX_TRANSLATION_THREADS];
+    unsigned int thread_count;
+    BOOL initialised;
+
+    /* Statistics, command stream thread only. */
+    unsigned int submitted;
+    unsigned int used;
+    unsigned int waited;
+    unsigned int generated;
+    LONGLONG worker_time;
+    LONGLONG cs_time;
+};
+
 struct shader_glsl_priv
 {
     struct wined3d_string_buffer shader_buffer;
@@ -144,6 +205,11 @@ struct shader_glsl_priv
     struct wine_rb_tree ffp_fragment_shaders;
     BOOL ffp_proj_control;
     BOOL legacy_lighting;
+
+    struct glsl_program_cache *program_cache;
+    BOOL program_cache_initialised;
+
+    struct glsl_shader_translator translator;
 };
 
 struct glsl_vs_program
@@ -333,6 +399,7 @@ struct glsl_shader_private
         struct glsl_cs_compiled_shader *cs;
     } gl_shaders;
     unsigned int num_gl_shaders, shader_array_size;
+    struct glsl_shader_job *job;
 };
 
 struct glsl_ffp_vertex_shader
@@ -542,26 +609,6 @@ void print_glsl_info_log(const struct wined3d_gl_info *gl_info, GLuint id, BOOL
     }
 }
 
-/* Context activation is done by the caller. */
-static void shader_glsl_compile(const struct wined3d_gl_info *gl_info, GLuint shader, const char *src)
-{
-    const char *ptr, *line;
-
-    TRACE("Compiling shader object %u.\n", shader);
-
-    if (TRACE_ON(d3d_shader))
-    {
-        ptr = src;
-        while ((line = get_info_log_line(&ptr))) TRACE_(d3d_shader)("    %.*s", (int)(ptr - line), line);
-    }
-
-    GL_EXTCALL(glShaderSource(shader, 1, &src, NULL));
-    checkGLcall("glShaderSource");
-    GL_EXTCALL(glCompileShader(shader));
-    checkGLcall("glCompileShader");
-    print_glsl_info_log(gl_info, shader, FALSE);
-}
-
 /* Context activation is done by the caller. */
 static void shader_glsl_dump_program_source(const struct wined3d_gl_info *gl_info, GLuint program)
 {
@@ -632,6 +679,464 @@ void shader_glsl_validate_link(const struct wined3d_gl_info *gl_info, GLuint pro
     print_glsl_info_log(gl_info, program, TRUE);
 }
 
+/* When the ShaderCache setting is enabled, linked programs are cached on
+ * disk, keyed by the GLSL source of their shaders, so that the next run can
+ * load the program binary instead of compiling and linking the shaders
+ * again. The cache file starts with a glsl_cache_header, followed by
+ * glsl_cache_record structures. Each record is followed by the program
+ * source and the program binary. */
+#define WINED3D_GLSL_CACHE_MAGIC    0x43534c47  /* 'GLSC' */
+#define WINED3D_GLSL_CACHE_VERSION  1
+
+struct glsl_cache_header
+{
+    DWORD magic;
+    DWORD version;
+    UINT64 driver_hash;
+};
+
+struct glsl_cache_record
+{
+    UINT64 hash;
+    DWORD format;
+    DWORD source_size;
+    DWORD binary_size;
+    DWORD reserved;
+};
+
+struct glsl_cache_entry
+{
+    struct wine_rb_entry entry;
+    struct glsl_cache_record record;
+    UINT64 offset;  /* File offset of the source, followed by the binary. */
+    void *data;     /* Source and binary of records that couldn't be written. */
+};
+
+struct glsl_program_cache
+{
+    HANDLE file;
+    struct wine_rb_tree entries;
+    UINT64 size;
+    BOOL full;
+    unsigned int hits;
+    unsigned int misses;
+};
+
+static UINT64 glsl_cache_hash(UINT64 hash, const void *data, SIZE_T size)
+{
+    const BYTE *ptr = data;
+
+    /* FNV-1a */
+    while (size--)
+        hash = (hash ^ *ptr++) * 0x100000001b3ull;
+    return hash;
+}
+
+static int glsl_cache_entry_compare(const void *key, const struct wine_rb_entry *entry)
+{
+    UINT64 hash = *(const UINT64 *)key;
+    const struct glsl_cache_entry *e = WINE_RB_ENTRY_VALUE(entry, struct glsl_cache_entry, entry);
+
+    return hash < e->record.hash ? -1 : hash > e->record.hash;
+}
+
+static struct glsl_cache_entry *glsl_cache_add_entry(struct glsl_program_cache *cache,
+        const struct glsl_cache_record *record, UINT64 offset)
+{
+    struct glsl_cache_entry *entry;
+
+    if (wine_rb_get(&cache->entries, &record->hash))
+        return NULL;
+    if (!(entry = heap_alloc(sizeof(*entry))))
+        return NULL;
+    entry->record = *record;
+    entry->offset = offset;
+    entry->data = NULL;
+    wine_rb_put(&cache->entries, &record->hash, &entry->entry);
+    return entry;
+}
+
+static void glsl_cache_free_entry(struct wine_rb_entry *entry, void *context)
+{
+    struct glsl_cache_entry *e = WINE_RB_ENTRY_VALUE(entry, struct glsl_cache_entry, entry);
+
+    heap_free(e->data);
+    heap_free(e);
+}
+
+/* Returns the source of an entry, followed by its binary. */
+static void *glsl_cache_read_entry(struct glsl_program_cache *cache, const struct glsl_cache_entry *entry)
+{
+    SIZE_T size = entry->record.source_size + entry->record.binary_size;
+    LARGE_INTEGER offset;
+    DWORD read;
+    void *data;
+
+    if (!(data = heap_alloc(size)))
+        return NULL;
+    if (entry->data)
+    {
+        memcpy(data, entry->data, size);
+        return data;
+    }
+
+    offset.QuadPart = entry->offset;
+    if (!SetFilePointerEx(cache->file, offset, NULL, FILE_BEGIN)
+            || !ReadFile(cache->file, data, size, &read, NULL) || read != size)
+    {
+        WARN("Failed to read program cache record at offset %s.\n", wine_dbgstr_longlong(entry->offset));
+        heap_free(data);
+        return NULL;
+    }
+    return data;
+}
+
+static HANDLE glsl_cache_open_file(void)
+{
+    static const WCHAR localappdataW[] = {'L','O','C','A','L','A','P','P','D','A','T','A',0};
+    static const WCHAR dirW[] = {'\\','w','i','n','e','d','3','d',0};
+    static const WCHAR fileW[] = {'\\','%','s','-','%','0','8','x','%','0','8','x','.','c','a','c','h','e',0};
+    WCHAR path[MAX_PATH], exe[MAX_PATH], *name;
+    unsigned int len;
+    UINT64 hash;
+    HANDLE file;
+
+    if (!(len = GetModuleFileNameW(NULL, exe, ARRAY_SIZE(exe))) || len >= ARRAY_SIZE(exe))
+        return INVALID_HANDLE_VALUE;
+    hash = glsl_cache_hash(0xcbf29ce484222325ull, exe, len * sizeof(*exe));
+    name = (name = strrchrW(exe, '\\')) ? name + 1 : exe;
+
+    len = GetEnvironmentVariableW(localappdataW, path, ARRAY_SIZE(path));
+    if (!len || len + ARRAY_SIZE(dirW) + strlenW(name) + 24 > ARRAY_SIZE(path))
+        return INVALID_HANDLE_VALUE;
+    strcatW(path, dirW);
+    CreateDirectoryW(path, NULL);
+    sprintfW(path + strlenW(path), fileW, name, (unsigned int)(hash >> 32), (unsigned int)hash);
+
+    /* Only one process updates the cache, the others get a read-only copy. */
+    file = CreateFileW(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, 0, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+    TRACE("Using program cache %s, handle %p.\n", debugstr_w(path), file);
+    return file;
+}
+
+static BOOL glsl_cache_reset(struct glsl_program_cache *cache, const struct glsl_cache_header *header)
+{
+    DWORD written;
+
+    SetFilePointer(cache->file, 0, NULL, FILE_BEGIN);
+    if (!SetEndOfFile(cache->file) || !WriteFile(cache->file, header, sizeof(*header), &written, NULL)
+            || written != sizeof(*header))
+        return FALSE;
+    cache->size = sizeof(*header);
+    return TRUE;
+}
+
+/* Only the records are loaded, the sources and binaries are read from the
+ * file when they are looked up. */
+static void glsl_cache_load(struct glsl_program_cache *cache, const struct glsl_cache_header *header)
+{
+    struct glsl_cache_header file_header;
+    struct glsl_cache_record record;
+    LARGE_INTEGER file_size, next;
+    UINT64 offset, size;
+    DWORD read;
+
+    if (!GetFileSizeEx(cache->file, &file_size) || file_size.QuadPart < sizeof(*header)
+            || file_size.QuadPart > (UINT64)wined3d_settings.shader_cache_size * 1024 * 1024)
+    {
+        /* Empty, or too large to be loaded. Start again. */
+        glsl_cache_reset(cache, header);
+        return;
+    }
+
+    if (!ReadFile(cache->file, &file_header, sizeof(file_header), &read, NULL) || read != sizeof(file_header)
+            || memcmp(&file_header, header, sizeof(*header)))
+    {
+        TRACE("Discarding program cache from a different driver or version.\n");
+        glsl_cache_reset(cache, header);
+        return;
+    }
+
+    size = file_size.QuadPart;
+    for (offset = sizeof(*header); size - offset >= sizeof(record);)
+    {
+        if (!ReadFile(cache->file, &record, sizeof(record), &read, NULL) || read != sizeof(record))
+            break;
+        if (record.source_size > size - offset - sizeof(record)
+                || record.binary_size > size - offset - sizeof(record) - record.source_size)
+            break;
+        glsl_cache_add_entry(cache, &record, offset + sizeof(record));
+        offset += sizeof(record) + record.source_size + record.binary_size;
+        next.QuadPart = offset;
+        if (!SetFilePointerEx(cache->file, next, NULL, FILE_BEGIN))
+            break;
+    }
+
+    /* Drop any truncated record, new records are appended. */
+    cache->size = offset;
+    if (offset != size)
+    {
+        next.QuadPart = offset;
+        SetFilePointerEx(cache->file, next, NULL, FILE_BEGIN);
+        SetEndOfFile(cache->file);
+    }
+}
+
+/* Context activation is done by the caller. */
+static struct glsl_program_cache *glsl_cache_create(const struct wined3d_gl_info *gl_info)
+{
+    static const GLenum strings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    struct glsl_cache_header header;
+    struct glsl_program_cache *cache;
+    const char *str;
+    unsigned int i;
+    GLint count;
+
+    gl_info->gl_ops.gl.p_glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &count);
+    if (!count)
+    {
+        TRACE("The driver doesn't support program binaries.\n");
+        return NULL;
+    }
+
+    header.magic = WINED3D_GLSL_CACHE_MAGIC;
+    header.version = WINED3D_GLSL_CACHE_VERSION;
+    header.driver_hash = 0xcbf29ce484222325ull;
+    for (i = 0; i < ARRAY_SIZE(strings); ++i)
+    {
+        if ((str = (const char *)gl_info->gl_ops.gl.p_glGetString(strings[i])))
+            header.driver_hash = glsl_cache_hash(header.driver_hash, str, strlen(str) + 1);
+    }
+
+    if (!(cache = heap_alloc_zero(sizeof(*cache))))
+        return NULL;
+    wine_rb_init(&cache->entries, glsl_cache_entry_compare);
+    if ((cache->file = glsl_cache_open_file()) == INVALID_HANDLE_VALUE)
+    {
+        heap_free(cache);
+        return NULL;
+    }
+    glsl_cache_load(cache, &header);
+
+    return cache;
+}
+
+static void glsl_cache_destroy(struct glsl_program_cache *cache)
+{
+    TRACE("Program cache %p: %u hits, %u misses.\n", cache, cache->hits, cache->misses);
+
+    CloseHandle(cache->file);
+    wine_rb_destroy(&cache->entries, glsl_cache_free_entry, NULL);
+    heap_free(cache);
+}
+
+/* Context activation is done by the caller. */
+static void glsl_cache_store(struct glsl_program_cache *cache, const struct wined3d_gl_info *gl_info,
+        GLuint program_id, UINT64 hash, const char *source, unsigned int source_size)
+{
+    struct glsl_cache_record record;
+    struct glsl_cache_entry *entry;
+    LARGE_INTEGER offset;
+    GLint status, length;
+    DWORD written;
+    GLenum format;
+    char *data;
+
+    GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+    GL_EXTCALL(glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &length));
+    if (!status || length <= 0 || cache->full)
+        return;
+
+    if (cache->size + sizeof(record) + source_size + length
+            > (UINT64)wined3d_settings.shader_cache_size * 1024 * 1024)
+    {
+        WARN("Program cache is full.\n");
+        cache->full = TRUE;
+        return;
+    }
+
+    if (!(data = heap_alloc(source_size + length)))
+        return;
+    memcpy(data, source, source_size);
+    GL_EXTCALL(glGetProgramBinary(program_id, length, &length, &format, data + source_size));
+    checkGLcall("glGetProgramBinary");
+
+    record.hash = hash;
+    record.format = format;
+    record.source_size = source_size;
+    record.binary_size = length;
+    record.reserved = 0;
+    if (!(entry = glsl_cache_add_entry(cache, &record, cache->size + sizeof(record))))
+    {
+        heap_free(data);
+        return;
+    }
+
+    offset.QuadPart = cache->size;
+    if (!SetFilePointerEx(cache->file, offset, NULL, FILE_BEGIN)
+            || !WriteFile(cache->file, &record, sizeof(record), &written, NULL)
+            || !WriteFile(cache->file, data, source_size + length, &written, NULL))
+    {
+        /* Read-only cache, or out of disk space. Keep the in-memory copy. */
+        TRACE("Failed to write program cache, error %u.\n", GetLastError());
+        entry->data = data;
+        cache->full = TRUE;
+        return;
+    }
+    cache->size += sizeof(record) + source_size + length;
+    heap_free(data);
+}
+
+/* Returns the program cache, creating it on first use. Shader objects are
+ * only compiled before linking when there is no cache.
+ *
+ * Context activation is done by the caller. */
+static struct glsl_program_cache *shader_glsl_get_program_cache(struct shader_glsl_priv *priv,
+        const struct wined3d_gl_info *gl_info)
+{
+    if (!wined3d_settings.shader_cache || !gl_info->supported[ARB_GET_PROGRAM_BINARY])
+        return NULL;
+    if (!priv->program_cache_initialised)
+    {
+        priv->program_cache = glsl_cache_create(gl_info);
+        priv->program_cache_initialised = TRUE;
+    }
+    return priv->program_cache;
+}
+
+/* Context activation is done by the caller. */
+static void shader_glsl_compile(struct shader_glsl_priv *priv, const struct wined3d_gl_info *gl_info,
+        GLuint shader, const char *src)
+{
+    const char *ptr, *line;
+
+    TRACE("Compiling shader object %u.\n", shader);
+
+    if (TRACE_ON(d3d_shader))
+    {
+        ptr = src;
+        while ((line = get_info_log_line(&ptr))) TRACE_(d3d_shader)("    %.*s", (int)(ptr - line), line);
+    }
+
+    GL_EXTCALL(glShaderSource(shader, 1, &src, NULL));
+    checkGLcall("glShaderSource");
+    /* With the program cache, shaders are compiled when the program is linked. */
+    if (shader_glsl_get_program_cache(priv, gl_info))
+        return;
+    GL_EXTCALL(glCompileShader(shader));
+    checkGLcall("glCompileShader");
+    print_glsl_info_log(gl_info, shader, FALSE);
+}
+
+/* Context activation is done by the caller. */
+static char *shader_glsl_get_program_source(const struct wined3d_gl_info *gl_info,
+        GLuint program_id, unsigned int *size)
+{
+    GLint i, shader_count, length, total = 0;
+    GLuint shaders[WINED3D_SHADER_TYPE_COUNT + 1];
+    char *source;
+
+    GL_EXTCALL(glGetAttachedShaders(program_id, ARRAY_SIZE(shaders), &shader_count, shaders));
+    for (i = 0; i < shader_count; ++i)
+    {
+        GL_EXTCALL(glGetShaderiv(shaders[i], GL_SHADER_SOURCE_LENGTH, &length));
+        total += length;
+    }
+    if (!total || !(source = heap_alloc(total)))
+        return NULL;
+
+    for (i = 0, *size = 0; i < shader_count; ++i)
+    {
+        GL_EXTCALL(glGetShaderSource(shaders[i], total - *size, &length, source + *size));
+        /* Keep the terminators to separate the shaders. */
+        *size += length + 1;
+    }
+    checkGLcall("get program source");
+    return source;
+}
+
+/* Context activation is done by the caller. */
+static void shader_glsl_compile_attached_shaders(const struct wined3d_gl_info *gl_info, GLuint program_id)
+{
+    GLuint shaders[WINED3D_SHADER_TYPE_COUNT + 1];
+    GLint i, shader_count, status;
+
+    GL_EXTCALL(glGetAttachedShaders(program_id, ARRAY_SIZE(shaders), &shader_count, shaders));
+    for (i = 0; i < shader_count; ++i)
+    {
+        GL_EXTCALL(glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &status));
+        if (status)
+            continue;
+        TRACE("Compiling shader object %u.\n", shaders[i]);
+        GL_EXTCALL(glCompileShader(shaders[i]));
+        checkGLcall("glCompileShader");
+        print_glsl_info_log(gl_info, shaders[i], FALSE);
+    }
+}
+
+/* Link a program, or load it from the program cache. Shader objects are only
+ * compiled when the program is not found in the cache. Programs that depend
+ * on state set with glTransformFeedbackVaryings() are not cacheable.
+ *
+ * Context activation is done by the caller. */
+static void shader_glsl_link_program(struct shader_glsl_priv *priv,
+        const struct wined3d_gl_info *gl_info, GLuint program_id, BOOL cacheable)
+{
+    struct glsl_program_cache *cache = shader_glsl_get_program_cache(priv, gl_info);
+    const struct glsl_cache_entry *entry;
+    struct wine_rb_entry *rb_entry;
+    unsigned int source_size = 0;
+    char *source = NULL, *data;
+    GLint status = GL_FALSE;
+    UINT64 hash = 0;
+
+    if (cache && cacheable && (source = shader_glsl_get_program_source(gl_info, program_id, &source_size)))
+    {
+        hash = glsl_cache_hash(0xcbf29ce484222325ull, source, source_size);
+        if ((rb_entry = wine_rb_get(&cache->entries, &hash)))
+        {
+            entry = WINE_RB_ENTRY_VALUE(rb_entry, struct glsl_cache_entry, entry);
+            if (entry->record.source_size == source_size && (data = glsl_cache_read_entry(cache, entry)))
+            {
+                if (!memcmp(data, source, source_size))
+                {
+                    GL_EXTCALL(glProgramBinary(program_id, entry->record.format,
+                            data + source_size, entry->record.binary_size));
+                    GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+                    checkGLcall("glProgramBinary");
+                    if (!status)
+                        WARN("Failed to load cached binary for program %u.\n", program_id);
+                }
+                heap_free(data);
+                if (status)
+                {
+                    TRACE("Loaded GLSL shader program %u from the program cache.\n", program_id);
+                    ++cache->hits;
+                    heap_free(source);
+                    return;
+                }
+            }
+        }
+        ++cache->misses;
+        GL_EXTCALL(glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    }
+
+    if (cache)
+        shader_glsl_compile_attached_shaders(gl_info, program_id);
+
+    TRACE("Linking GLSL shader program %u.\n", program_id);
+    GL_EXTCALL(glLinkProgram(program_id));
+    shader_glsl_validate_link(gl_info, program_id);
+
+    if (source)
+    {
+        glsl_cache_store(cache, gl_info, program_id, hash, source, source_size);
+        heap_free(source);
+    }
+}
+
 static BOOL shader_glsl_use_layout_qualifier(const struct wined3d_gl_info *gl_info)
 {
     /* Layout qualifiers were introduced in GLSL 1.40. The Nvidia Legacy GPU
@@ -702,14 +1207,20 @@ static void shader_glsl_load_samplers_range(const struct wined3d_gl_info *gl_inf
     string_buffer_release(&priv->string_buffers, sampler_name);
 }
 
-static unsigned int shader_glsl_map_tex_unit(const struct wined3d_context *context,
+static void glsl_gen_context_init(struct glsl_gen_context *gen, const struct wined3d_context *context)
+{
+    gen->gl_info = context->gl_info;
+    gen->d3d_info = context->d3d_info;
+    memcpy(gen->tex_unit_map, context->tex_unit_map, sizeof(gen->tex_unit_map));
+}
+
+static unsigned int shader_glsl_map_tex_unit(const struct glsl_gen_context *gen,
         const struct wined3d_shader_version *shader_version, unsigned int sampler_idx)
 {
-    const struct wined3d_context_gl *context_gl = wined3d_context_gl_const(context);
     const unsigned int *tex_unit_map;
     unsigned int base, count;
 
-    tex_unit_map = wined3d_context_gl_get_tex_unit_mapping(context_gl, shader_version, &base, &count);
+    tex_unit_map = wined3d_get_tex_unit_mapping(gen->gl_info, gen->tex_unit_map, shader_version, &base, &count);
     if (sampler_idx >= count)
         return WINED3D_UNMAPPED_STAGE;
     if (!tex_unit_map)
@@ -718,10 +1229,10 @@ static unsigned int shader_glsl_map_tex_unit(const struct wined3d_context *conte
 }
 
 static void shader_glsl_append_sampler_binding_qualifier(struct wined3d_string_buffer *buffer,
-        const struct wined3d_context *context, const struct wined3d_shader_version *shader_version,
+        const struct glsl_gen_context *gen, const struct wined3d_shader_version *shader_version,
         unsigned int sampler_idx)
 {
-    unsigned int mapped_unit = shader_glsl_map_tex_unit(context, shader_version, sampler_idx);
+    unsigned int mapped_unit = shader_glsl_map_tex_unit(gen, shader_version, sampler_idx);
     if (mapped_unit != WINED3D_UNMAPPED_STAGE)
         shader_addline(buffer, "layout(binding = %u)\n", mapped_unit);
     else
@@ -2431,14 +2942,14 @@ static void shader_glsl_declare_generic_vertex_attribute(struct wined3d_string_b
 }
 
 /** Generate the variable & register declarations for the GLSL output target */
-static void shader_generate_glsl_declarations(const struct wined3d_context *context,
+static void shader_generate_glsl_declarations(const struct glsl_gen_context *gen,
         struct wined3d_string_buffer *buffer, const struct wined3d_shader *shader,
         const struct wined3d_shader_reg_maps *reg_maps, const struct shader_glsl_ctx_priv *ctx_priv)
 {
     const struct wined3d_shader_version *version = &reg_maps->shader_version;
     const struct vs_compile_args *vs_args = ctx_priv->cur_vs_args;
     const struct ps_compile_args *ps_args = ctx_priv->cur_ps_args;
-    const struct wined3d_gl_info *gl_info = context->gl_info;
+    const struct wined3d_gl_info *gl_info = gen->gl_info;
     const struct wined3d_shader_indexable_temp *idx_temp_reg;
     unsigned int uniform_block_base, uniform_block_count;
     const struct wined3d_shader_lconst *lconst;
@@ -2678,7 +3189,7 @@ static void shader_generate_glsl_declarations(const struct wined3d_context *cont
         }
 
         if (shader_glsl_use_layout_binding_qualifier(gl_info))
-            shader_glsl_append_sampler_binding_qualifier(buffer, context, version, entry->bind_idx);
+            shader_glsl_append_sampler_binding_qualifier(buffer, gen, version, entry->bind_idx);
         shader_addline(buffer, "uniform %s%s %s_sampler%u;\n",
                 sampler_type_prefix, sampler_type, prefix, entry->bind_idx);
     }
@@ -7448,7 +7959,7 @@ static GLuint shader_glsl_generate_vs3_rasterizer_input_setup(struct shader_glsl
 
     ret = GL_EXTCALL(glCreateShader(GL_VERTEX_SHADER));
     checkGLcall("glCreateShader(GL_VERTEX_SHADER)");
-    shader_glsl_compile(gl_info, ret, buffer->buffer);
+    shader_glsl_compile(priv, gl_info, ret, buffer->buffer);
 
     return ret;
 }
@@ -7818,20 +8329,19 @@ static void shader_glsl_generate_ps_epilogue(const struct wined3d_gl_info *gl_in
         shader_glsl_generate_color_output(buffer, gl_info, shader, args, string_buffers);
 }
 
-/* Context activation is done by the caller. */
-static GLuint shader_glsl_generate_pshader(const struct wined3d_context *context,
+/* Only generates the GLSL source, the shader translation threads call this
+ * with their own copies of the context state and of the reg_maps. */
+static BOOL shader_glsl_generate_pshader(const struct glsl_gen_context *gen,
         struct wined3d_string_buffer *buffer, struct wined3d_string_buffer_list *string_buffers,
-        const struct wined3d_shader *shader,
+        const struct wined3d_shader *shader, const struct wined3d_shader_reg_maps *reg_maps,
         const struct ps_compile_args *args, struct ps_np2fixup_info *np2fixup_info)
 {
-    const struct wined3d_shader_reg_maps *reg_maps = &shader->reg_maps;
     const struct wined3d_shader_version *version = &reg_maps->shader_version;
     const char *prefix = shader_glsl_get_prefix(version->type);
-    const struct wined3d_gl_info *gl_info = context->gl_info;
+    const struct wined3d_gl_info *gl_info = gen->gl_info;
     const BOOL legacy_syntax = needs_legacy_glsl_syntax(gl_info);
     unsigned int i, extra_constants_needed = 0;
     struct shader_glsl_ctx_priv priv_ctx;
-    GLuint shader_id;
     DWORD map;
 
     memset(&priv_ctx, 0, sizeof(priv_ctx));
@@ -7862,7 +8372,7 @@ static GLuint shader_glsl_generate_pshader(const struct wined3d_context *context
         shader_addline(buffer, "#extension GL_ARB_texture_rectangle : enable\n");
 
     /* Base Declarations */
-    shader_generate_glsl_declarations(context, buffer, shader, reg_maps, &priv_ctx);
+    shader_generate_glsl_declarations(gen, buffer, shader, reg_maps, &priv_ctx);
 
     if (gl_info->supported[ARB_CONSERVATIVE_DEPTH])
     {
@@ -7983,7 +8493,7 @@ static GLuint shader_glsl_generate_pshader(const struct wined3d_context *context
         {
             if (gl_info->supported[ARB_FRAGMENT_COORD_CONVENTIONS])
             {
-                if (context->d3d_info->wined3d_creation_flags & WINED3D_PIXEL_CENTER_INTEGER)
+                if (gen->d3d_info->wined3d_creation_flags & WINED3D_PIXEL_CENTER_INTEGER)
                     shader_addline(buffer, "layout(%spixel_center_integer) in vec4 gl_FragCoord;\n",
                             args->render_offscreen ? "" : "origin_upper_left, ");
                 else if (!args->render_offscreen)
@@ -8065,7 +8575,7 @@ static GLuint shader_glsl_generate_pshader(const struct wined3d_context *context
     {
         if (gl_info->supported[ARB_FRAGMENT_COORD_CONVENTIONS])
             shader_addline(buffer, "vpos = gl_FragCoord;\n");
-        else if (context->d3d_info->wined3d_creation_flags & WINED3D_PIXEL_CENTER_INTEGER)
+        else if (gen->d3d_info->wined3d_creation_flags & WINED3D_PIXEL_CENTER_INTEGER)
             shader_addline(buffer,
                     "vpos = floor(vec4(0, ycorrection[0], 0, 0) + gl_FragCoord * vec4(1, ycorrection[1], 1, 1));\n");
         else
@@ -8112,7 +8622,7 @@ static GLuint shader_glsl_generate_pshader(const struct wined3d_context *context
 
     /* Base Shader Body */
     if (FAILED(shader_generate_code(shader, buffer, reg_maps, &priv_ctx, NULL, NULL)))
-        return 0;
+        return FALSE;
 
     /* In SM4+ the shader epilogue is generated by the "ret" instruction. */
     if (reg_maps->shader_version.major < 4)
@@ -8120,11 +8630,7 @@ static GLuint shader_glsl_generate_pshader(const struct wined3d_context *context
 
     shader_addline(buffer, "}\n");
 
-    shader_id = GL_EXTCALL(glCreateShader(GL_FRAGMENT_SHADER));
-    TRACE("Compiling shader object %u.\n", shader_id);
-    shader_glsl_compile(gl_info, shader_id, buffer->buffer);
-
-    return shader_id;
+    return TRUE;
 }
 
 static void shader_glsl_generate_vs_epilogue(const struct wined3d_gl_info *gl_info,
@@ -8170,17 +8676,17 @@ static void shader_glsl_generate_vs_epilogue(const struct wined3d_gl_info *gl_in
         shader_glsl_fixup_position(buffer, FALSE);
 }
 
-/* Context activation is done by the caller. */
-static GLuint shader_glsl_generate_vshader(const struct wined3d_context *context,
-        struct shader_glsl_priv *priv, const struct wined3d_shader *shader, const struct vs_compile_args *args)
+/* Only generates the GLSL source, the shader translation threads call this
+ * with their own copies of the context state and of the reg_maps. */
+static BOOL shader_glsl_generate_vshader(const struct glsl_gen_context *gen,
+        struct shader_glsl_priv *priv, const struct wined3d_shader *shader,
+        const struct wined3d_shader_reg_maps *reg_maps, const struct vs_compile_args *args)
 {
     struct wined3d_string_buffer_list *string_buffers = &priv->string_buffers;
-    const struct wined3d_shader_reg_maps *reg_maps = &shader->reg_maps;
     const struct wined3d_shader_version *version = &reg_maps->shader_version;
     struct wined3d_string_buffer *buffer = &priv->shader_buffer;
-    const struct wined3d_gl_info *gl_info = context->gl_info;
+    const struct wined3d_gl_info *gl_info = gen->gl_info;
     struct shader_glsl_ctx_priv priv_ctx;
-    GLuint shader_id;
     unsigned int i;
 
     memset(&priv_ctx, 0, sizeof(priv_ctx));
@@ -8198,7 +8704,7 @@ static GLuint shader_glsl_generate_vshader(const struct wined3d_context *context
         shader_addline(buffer, "#extension GL_ARB_shader_viewport_layer_array : enable\n");
 
     /* Base Declarations */
-    shader_generate_glsl_declarations(context, buffer, shader, reg_maps, &priv_ctx);
+    shader_generate_glsl_declarations(gen, buffer, shader, reg_maps, &priv_ctx);
 
     for (i = 0; i < shader->input_signature.element_count; ++i)
         shader_glsl_declare_generic_vertex_attribute(buffer, gl_info, &shader->input_signature.elements[i]);
@@ -8250,7 +8756,7 @@ static GLuint shader_glsl_generate_vshader(const struct wined3d_context *context
     }
 
     if (FAILED(shader_generate_code(shader, buffer, reg_maps, &priv_ctx, NULL, NULL)))
-        return 0;
+        return FALSE;
 
     /* In SM4+ the shader epilogue is generated by the "ret" instruction. */
     if (reg_maps->shader_version.major < 4)
@@ -8258,11 +8764,7 @@ static GLuint shader_glsl_generate_vshader(const struct wined3d_context *context
 
     shader_addline(buffer, "}\n");
 
-    shader_id = GL_EXTCALL(glCreateShader(GL_VERTEX_SHADER));
-    TRACE("Compiling shader object %u.\n", shader_id);
-    shader_glsl_compile(gl_info, shader_id, buffer->buffer);
-
-    return shader_id;
+    return TRUE;
 }
 
 static void shader_glsl_generate_default_control_point_phase(const struct wined3d_shader *shader,
@@ -8323,10 +8825,12 @@ static GLuint shader_glsl_generate_hull_shader(const struct wined3d_context *con
     const struct wined3d_gl_info *gl_info = context->gl_info;
     const struct wined3d_hull_shader *hs = &shader->u.hs;
     const struct wined3d_shader_phase *phase;
+    struct glsl_gen_context gen;
     struct shader_glsl_ctx_priv priv_ctx;
     GLuint shader_id;
     unsigned int i;
 
+    glsl_gen_context_init(&gen, context);
     memset(&priv_ctx, 0, sizeof(priv_ctx));
     priv_ctx.string_buffers = string_buffers;
 
@@ -8335,7 +8839,7 @@ static GLuint shader_glsl_generate_hull_shader(const struct wined3d_context *con
     shader_glsl_enable_extensions(buffer, gl_info);
     shader_addline(buffer, "#extension GL_ARB_tessellation_shader : enable\n");
 
-    shader_generate_glsl_declarations(context, buffer, shader, reg_maps, &priv_ctx);
+    shader_generate_glsl_declarations(&gen, buffer, shader, reg_maps, &priv_ctx);
 
     shader_addline(buffer, "layout(vertices = %u) out;\n", hs->output_vertex_count);
 
@@ -8395,7 +8899,7 @@ static GLuint shader_glsl_generate_hull_shader(const struct wined3d_context *con
 
     shader_id = GL_EXTCALL(glCreateShader(GL_TESS_CONTROL_SHADER));
     TRACE("Compiling shader object %u.\n", shader_id);
-    shader_glsl_compile(gl_info, shader_id, buffer->buffer);
+    shader_glsl_compile(priv, gl_info, shader_id, buffer->buffer);
 
     return shader_id;
 }
@@ -8417,9 +8921,11 @@ static GLuint shader_glsl_generate_domain_shader(const struct wined3d_context *c
     const struct wined3d_shader_reg_maps *reg_maps = &shader->reg_maps;
     struct wined3d_string_buffer *buffer = &priv->shader_buffer;
     const struct wined3d_gl_info *gl_info = context->gl_info;
+    struct glsl_gen_context gen;
     struct shader_glsl_ctx_priv priv_ctx;
     GLuint shader_id;
 
+    glsl_gen_context_init(&gen, context);
     memset(&priv_ctx, 0, sizeof(priv_ctx));
     priv_ctx.cur_ds_args = args;
     priv_ctx.string_buffers = string_buffers;
@@ -8429,7 +8935,7 @@ static GLuint shader_glsl_generate_domain_shader(const struct wined3d_context *c
     shader_glsl_enable_extensions(buffer, gl_info);
     shader_addline(buffer, "#extension GL_ARB_tessellation_shader : enable\n");
 
-    shader_generate_glsl_declarations(context, buffer, shader, reg_maps, &priv_ctx);
+    shader_generate_glsl_declarations(&gen, buffer, shader, reg_maps, &priv_ctx);
 
     shader_addline(buffer, "layout(");
     switch (shader->u.ds.tessellator_domain)
@@ -8498,7 +9004,7 @@ static GLuint shader_glsl_generate_domain_shader(const struct wined3d_context *c
 
     shader_id = GL_EXTCALL(glCreateShader(GL_TESS_EVALUATION_SHADER));
     TRACE("Compiling shader object %u.\n", shader_id);
-    shader_glsl_compile(gl_info, shader_id, buffer->buffer);
+    shader_glsl_compile(priv, gl_info, shader_id, buffer->buffer);
 
     return shader_id;
 }
@@ -8513,11 +9019,13 @@ static GLuint shader_glsl_generate_geometry_shader(const struct wined3d_context
     const struct wined3d_gl_info *gl_info = context->gl_info;
     const struct wined3d_shader_signature_element *output;
     enum wined3d_primitive_type primitive_type;
+    struct glsl_gen_context gen;
     struct shader_glsl_ctx_priv priv_ctx;
     unsigned int max_vertices;
     unsigned int i, j;
     GLuint shader_id;
 
+    glsl_gen_context_init(&gen, context);
     memset(&priv_ctx, 0, sizeof(priv_ctx));
     priv_ctx.string_buffers = string_buffers;
 
@@ -8525,7 +9033,7 @@ static GLuint shader_glsl_generate_geometry_shader(const struct wined3d_context
 
     shader_glsl_enable_extensions(buffer, gl_info);
 
-    shader_generate_glsl_declarations(context, buffer, shader, reg_maps, &priv_ctx);
+    shader_generate_glsl_declarations(&gen, buffer, shader, reg_maps, &priv_ctx);
 
     primitive_type = shader->u.gs.input_type ? shader->u.gs.input_type : args->primitive_type;
     shader_addline(buffer, "layout(%s", glsl_primitive_type_from_d3d(primitive_type));
@@ -8600,7 +9108,7 @@ static GLuint shader_glsl_generate_geometry_shader(const struct wined3d_context
 
     shader_id = GL_EXTCALL(glCreateShader(GL_GEOMETRY_SHADER));
     TRACE("Compiling shader object %u.\n", shader_id);
-    shader_glsl_compile(gl_info, shader_id, buffer->buffer);
+    shader_glsl_compile(priv, gl_info, shader_id, buffer->buffer);
 
     return shader_id;
 }
@@ -8634,16 +9142,19 @@ static void shader_glsl_generate_shader_epilogue(const struct wined3d_shader_con
 
 /* Context activation is done by the caller. */
 static GLuint shader_glsl_generate_compute_shader(const struct wined3d_context *context,
-        struct wined3d_string_buffer *buffer, struct wined3d_string_buffer_list *string_buffers,
-        const struct wined3d_shader *shader)
+        struct shader_glsl_priv *priv, const struct wined3d_shader *shader)
 {
     const struct wined3d_shader_thread_group_size *thread_group_size = &shader->u.cs.thread_group_size;
+    struct wined3d_string_buffer_list *string_buffers = &priv->string_buffers;
     const struct wined3d_shader_reg_maps *reg_maps = &shader->reg_maps;
+    struct wined3d_string_buffer *buffer = &priv->shader_buffer;
     const struct wined3d_gl_info *gl_info = context->gl_info;
+    struct glsl_gen_context gen;
     struct shader_glsl_ctx_priv priv_ctx;
     GLuint shader_id;
     unsigned int i;
 
+    glsl_gen_context_init(&gen, context);
     memset(&priv_ctx, 0, sizeof(priv_ctx));
     priv_ctx.string_buffers = string_buffers;
 
@@ -8652,7 +9163,7 @@ static GLuint shader_glsl_generate_compute_shader(const struct wined3d_context *
     shader_glsl_enable_extensions(buffer, gl_info);
     shader_addline(buffer, "#extension GL_ARB_compute_shader : enable\n");
 
-    shader_generate_glsl_declarations(context, buffer, shader, reg_maps, &priv_ctx);
+    shader_generate_glsl_declarations(&gen, buffer, shader, reg_maps, &priv_ctx);
 
     for (i = 0; i < reg_maps->tgsm_count; ++i)
     {
@@ -8669,19 +9180,279 @@ static GLuint shader_glsl_generate_compute_shader(const struct wined3d_context *
 
     shader_id = GL_EXTCALL(glCreateShader(GL_COMPUTE_SHADER));
     TRACE("Compiling shader object %u.\n", shader_id);
-    shader_glsl_compile(gl_info, shader_id, buffer->buffer);
+    shader_glsl_compile(priv, gl_info, shader_id, buffer->buffer);
 
     return shader_id;
 }
 
-static GLuint find_glsl_pshader(const struct wined3d_context *context,
-        struct wined3d_string_buffer *buffer, struct wined3d_string_buffer_list *string_buffers,
+/* Context activation is done by the caller. */
+static GLuint shader_glsl_compile_source(struct shader_glsl_priv *priv,
+        const struct wined3d_gl_info *gl_info, GLenum type, const char *source)
+{
+    GLuint shader_id;
+
+    shader_id = GL_EXTCALL(glCreateShader(type));
+    shader_glsl_compile(priv, gl_info, shader_id, source);
+
+    return shader_id;
+}
+
+static double shader_glsl_ticks_to_ms(LONGLONG ticks)
+{
+    LARGE_INTEGER freq;
+
+    QueryPerformanceFrequency(&freq);
+    return ticks * 1000.0 / freq.QuadPart;
+}
+
+static void shader_glsl_run_job(struct shader_glsl_priv *priv, struct glsl_shader_job *job)
+{
+    struct wined3d_shader *shader = job->shader;
+    LARGE_INTEGER start, end;
+    BOOL ret;
+
+    QueryPerformanceCounter(&start);
+
+    string_buffer_clear(&priv->shader_buffer);
+    if (job->reg_maps.shader_version.type == WINED3D_SHADER_TYPE_PIXEL)
+        ret = shader_glsl_generate_pshader(&job->gen, &priv->shader_buffer, &priv->string_buffers,
+                shader, &job->reg_maps, &job->args.ps, &job->np2fixup);
+    else
+        ret = shader_glsl_generate_vshader(&job->gen, priv, shader, &job->reg_maps, &job->args.vs);
+
+    if (ret && (job->source = heap_alloc(priv->shader_buffer.content_size + 1)))
+        memcpy(job->source, priv->shader_buffer.buffer, priv->shader_buffer.content_size + 1);
+
+    QueryPerformanceCounter(&end);
+    job->time = end.QuadPart - start.QuadPart;
+}
+
+static DWORD WINAPI shader_glsl_translator_run(void *ctx)
+{
+    struct glsl_shader_translator *translator = ctx;
+    struct glsl_shader_job *job;
+    struct shader_glsl_priv priv;
+
+    /* Only the string buffers are used while generating shaders. */
+    memset(&priv, 0, sizeof(priv));
+    if (!string_buffer_init(&priv.shader_buffer))
+    {
+        ERR("Failed to initialize shader buffer.\n");
+        return 0;
+    }
+    string_buffer_list_init(&priv.string_buffers);
+
+    EnterCriticalSection(&translator->cs);
+    for (;;)
+    {
+        while (!translator->stop && list_empty(&translator->jobs))
+            SleepConditionVariableCS(&translator->work_cond, &translator->cs, INFINITE);
+        if (translator->stop)
+            break;
+
+        job = LIST_ENTRY(list_head(&translator->jobs), struct glsl_shader_job, entry);
+        list_remove(&job->entry);
+        job->state = GLSL_SHADER_JOB_RUNNING;
+        LeaveCriticalSection(&translator->cs);
+
+        shader_glsl_run_job(&priv, job);
+
+        EnterCriticalSection(&translator->cs);
+        job->state = GLSL_SHADER_JOB_DONE;
+        WakeAllConditionVariable(&translator->done_cond);
+    }
+    LeaveCriticalSection(&translator->cs);
+
+    string_buffer_list_cleanup(&priv.string_buffers);
+    string_buffer_free(&priv.shader_buffer);
+
+    return 0;
+}
+
+static void shader_glsl_free_reg_maps_copy(struct wined3d_shader_reg_maps *reg_maps)
+{
+    struct wined3d_shader_indexable_temp *temp, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE(temp, next, &reg_maps->indexable_temps, struct wined3d_shader_indexable_temp, entry)
+        heap_free(temp);
+    list_init(&reg_maps->indexable_temps);
+}
+
+/* The list of indexable temporaries can't be shared by a plain struct copy,
+ * the job gets its own copy of the entries. */
+static BOOL shader_glsl_copy_reg_maps(struct wined3d_shader_reg_maps *dst,
+        const struct wined3d_shader_reg_maps *src)
+{
+    const struct wined3d_shader_indexable_temp *src_temp;
+    struct wined3d_shader_indexable_temp *temp;
+
+    *dst = *src;
+    list_init(&dst->indexable_temps);
+    LIST_FOR_EACH_ENTRY(src_temp, &src->indexable_temps, struct wined3d_shader_indexable_temp, entry)
+    {
+        if (!(temp = heap_alloc(sizeof(*temp))))
+        {
+            shader_glsl_free_reg_maps_copy(dst);
+            return FALSE;
+        }
+        *temp = *src_temp;
+        list_add_tail(&dst->indexable_temps, &temp->entry);
+    }
+
+    return TRUE;
+}
+
+static void shader_glsl_free_job(struct glsl_shader_job *job)
+{
+    shader_glsl_free_reg_maps_copy(&job->reg_maps);
+    heap_free(job->source);
+    heap_free(job);
+}
+
+static BOOL shader_glsl_translator_start(struct glsl_shader_translator *translator)
+{
+    unsigned int count = wined3d_settings.shader_translation_threads;
+    SYSTEM_INFO info;
+
+    if (translator->initialised)
+        return !!translator->thread_count;
+    translator->initialised = TRUE;
+
+    if (count == ~0u)
+    {
+        GetSystemInfo(&info);
+        count = info.dwNumberOfProcessors - 1;
+    }
+    count = min(count, ARRAY_SIZE(translator->threads));
+
+    while (translator->thread_count < count)
+    {
+        if (!(translator->threads[translator->thread_count]
+                = CreateThread(NULL, 0, shader_glsl_translator_run, translator, 0, NULL)))
+        {
+            ERR("Failed to create shader translation thread.\n");
+            break;
+        }
+        ++translator->thread_count;
+    }
+    TRACE("Using %u shader translation threads.\n", translator->thread_count);
+
+    return !!translator->thread_count;
+}
+
+static void shader_glsl_translator_stop(struct glsl_shader_translator *translator)
+{
+    unsigned int i;
+
+    EnterCriticalSection(&translator->cs);
+    translator->stop = TRUE;
+    WakeAllConditionVariable(&translator->work_cond);
+    LeaveCriticalSection(&translator->cs);
+
+    if (translator->thread_count)
+        WaitForMultipleObjects(translator->thread_count, translator->threads, TRUE, INFINITE);
+    for (i = 0; i < translator->thread_count; ++i)
+        CloseHandle(translator->threads[i]);
+
+    if (translator->submitted)
+        TRACE_(d3d_perf)("Shader translation: %u jobs, %u used, %u waited for, %u shaders generated "
+                "on the command stream thread in %.3f ms, %.3f ms saved.\n",
+                translator->submitted, translator->used, translator->waited, translator->generated,
+                shader_glsl_ticks_to_ms(translator->cs_time), shader_glsl_ticks_to_ms(translator->worker_time));
+
+    DeleteCriticalSection(&translator->cs);
+}
+
+/* Called from the command stream thread when a shader is created. */
+static void shader_glsl_submit_job(struct shader_glsl_priv *priv, struct wined3d_shader *shader)
+{
+    struct glsl_shader_translator *translator = &priv->translator;
+    struct wined3d_device *device = shader->device;
+    const struct wined3d_state *state = &device->cs->state;
+    struct glsl_shader_private *shader_data;
+    struct wined3d_context *context;
+    struct glsl_shader_job *job;
+
+    if (!device->context_count || !shader_glsl_translator_start(translator))
+        return;
+    context = device->contexts[0];
+
+    if (!shader->backend_data && !(shader->backend_data = heap_alloc_zero(sizeof(*shader_data))))
+        return;
+    shader_data = shader->backend_data;
+
+    if (!(job = heap_alloc_zero(sizeof(*job))))
+        return;
+    job->shader = shader;
+    job->state = GLSL_SHADER_JOB_QUEUED;
+    glsl_gen_context_init(&job->gen, context);
+    if (!shader_glsl_copy_reg_maps(&job->reg_maps, &shader->reg_maps))
+    {
+        heap_free(job);
+        return;
+    }
+    if (shader->reg_maps.shader_version.type == WINED3D_SHADER_TYPE_PIXEL)
+    {
+        find_ps_compile_args(state, shader, context->stream_info.position_transformed, &job->args.ps, context);
+        pixelshader_update_reg_maps_resource_types(&job->reg_maps, shader->limits->sampler, job->args.ps.tex_types);
+    }
+    else
+        find_vs_compile_args(state, shader, context->stream_info.swizzle_map, &job->args.vs, context);
+    shader_data->job = job;
+    ++translator->submitted;
+
+    EnterCriticalSection(&translator->cs);
+    list_add_tail(&translator->jobs, &job->entry);
+    WakeConditionVariable(&translator->work_cond);
+    LeaveCriticalSection(&translator->cs);
+}
+
+/* Takes the translation job of a shader away from the translation threads.
+ * A job that hasn't started yet is cancelled, a running one is waited for.
+ * After this, the command stream thread can safely generate code for the
+ * shader itself. */
+static struct glsl_shader_job *shader_glsl_finish_job(struct shader_glsl_priv *priv, struct wined3d_shader *shader)
+{
+    struct glsl_shader_translator *translator = &priv->translator;
+    struct glsl_shader_private *shader_data = shader->backend_data;
+    struct glsl_shader_job *job;
+
+    if (!shader_data || !(job = shader_data->job))
+        return NULL;
+    shader_data->job = NULL;
+
+    EnterCriticalSection(&translator->cs);
+    if (job->state == GLSL_SHADER_JOB_QUEUED)
+    {
+        list_remove(&job->entry);
+        LeaveCriticalSection(&translator->cs);
+        shader_glsl_free_job(job);
+        return NULL;
+    }
+    if (job->state == GLSL_SHADER_JOB_RUNNING)
+    {
+        TRACE_(d3d_perf)("Waiting for the translation of shader %p.\n", shader);
+        ++translator->waited;
+        while (job->state != GLSL_SHADER_JOB_DONE)
+            SleepConditionVariableCS(&translator->done_cond, &translator->cs, INFINITE);
+    }
+    LeaveCriticalSection(&translator->cs);
+
+    return job;
+}
+
+
+static GLuint find_glsl_pshader(const struct wined3d_context *context, struct shader_glsl_priv *priv,
         struct wined3d_shader *shader,
         const struct ps_compile_args *args, const struct ps_np2fixup_info **np2fixup_info)
 {
+    struct glsl_shader_translator *translator = &priv->translator;
     struct glsl_ps_compiled_shader *gl_shaders, *new_array;
     struct glsl_shader_private *shader_data;
     struct ps_np2fixup_info *np2fixup;
+    struct glsl_gen_context gen;
+    LARGE_INTEGER start, end;
+    struct glsl_shader_job *job;
     UINT i;
     DWORD new_size;
     GLuint ret;
@@ -8740,10 +9511,36 @@ static GLuint find_glsl_pshader(const struct wined3d_context *context,
     memset(np2fixup, 0, sizeof(*np2fixup));
     *np2fixup_info = args->np2_fixup ? np2fixup : NULL;
 
+    job = shader_glsl_finish_job(priv, shader);
+
     pixelshader_update_resource_types(shader, args->tex_types);
 
-    string_buffer_clear(buffer);
-    ret = shader_glsl_generate_pshader(context, buffer, string_buffers, shader, args, np2fixup);
+    if (job && job->source && !memcmp(&job->args.ps, args, sizeof(*args)))
+    {
+        TRACE("Using the GLSL source translated ahead of time for shader %p.\n", shader);
+        *np2fixup = job->np2fixup;
+        ret = shader_glsl_compile_source(priv, context->gl_info, GL_FRAGMENT_SHADER, job->source);
+        translator->worker_time += job->time;
+        ++translator->used;
+    }
+    else
+    {
+        QueryPerformanceCounter(&start);
+        string_buffer_clear(&priv->shader_buffer);
+        glsl_gen_context_init(&gen, context);
+        if (shader_glsl_generate_pshader(&gen, &priv->shader_buffer, &priv->string_buffers,
+                shader, &shader->reg_maps, args, np2fixup))
+            ret = shader_glsl_compile_source(priv, context->gl_info, GL_FRAGMENT_SHADER, priv->shader_buffer.buffer);
+        else
+            ret = 0;
+        QueryPerformanceCounter(&end);
+        translator->cs_time += end.QuadPart - start.QuadPart;
+        ++translator->generated;
+        TRACE_(d3d_perf)("Generated pixel shader %p on the command stream thread in %.3f ms.\n",
+                shader, shader_glsl_ticks_to_ms(end.QuadPart - start.QuadPart));
+    }
+    if (job)
+        shader_glsl_free_job(job);
     gl_shaders[shader_data->num_gl_shaders++].id = ret;
 
     return ret;
@@ -8777,8 +9574,12 @@ static GLuint find_glsl_vshader(const struct wined3d_context *context, struct sh
     UINT i;
     DWORD new_size;
     DWORD use_map = context->stream_info.use_map;
+    struct glsl_shader_translator *translator = &priv->translator;
     struct glsl_vs_compiled_shader *gl_shaders, *new_array;
     struct glsl_shader_private *shader_data;
+    struct glsl_gen_context gen;
+    LARGE_INTEGER start, end;
+    struct glsl_shader_job *job;
     GLuint ret;
 
     if (!shader->backend_data)
@@ -8828,8 +9629,32 @@ static GLuint find_glsl_vshader(const struct wined3d_context *context, struct sh
 
     gl_shaders[shader_data->num_gl_shaders].args = *args;
 
-    string_buffer_clear(&priv->shader_buffer);
-    ret = shader_glsl_generate_vshader(context, priv, shader, args);
+    job = shader_glsl_finish_job(priv, shader);
+
+    if (job && job->source && vs_args_equal(&job->args.vs, args, use_map))
+    {
+        TRACE("Using the GLSL source translated ahead of time for shader %p.\n", shader);
+        ret = shader_glsl_compile_source(priv, context->gl_info, GL_VERTEX_SHADER, job->source);
+        translator->worker_time += job->time;
+        ++translator->used;
+    }
+    else
+    {
+        QueryPerformanceCounter(&start);
+        string_buffer_clear(&priv->shader_buffer);
+        glsl_gen_context_init(&gen, context);
+        if (shader_glsl_generate_vshader(&gen, priv, shader, &shader->reg_maps, args))
+            ret = shader_glsl_compile_source(priv, context->gl_info, GL_VERTEX_SHADER, priv->shader_buffer.buffer);
+        else
+            ret = 0;
+        QueryPerformanceCounter(&end);
+        translator->cs_time += end.QuadPart - start.QuadPart;
+        ++translator->generated;
+        TRACE_(d3d_perf)("Generated vertex shader %p on the command stream thread in %.3f ms.\n",
+                shader, shader_glsl_ticks_to_ms(end.QuadPart - start.QuadPart));
+    }
+    if (job)
+        shader_glsl_free_job(job);
     gl_shaders[shader_data->num_gl_shaders++].id = ret;
 
     return ret;
@@ -9418,7 +10243,7 @@ static GLuint shader_glsl_generate_ffp_vertex_shader(struct shader_glsl_priv *pr
     shader_addline(buffer, "}\n");
 
     shader_obj = GL_EXTCALL(glCreateShader(GL_VERTEX_SHADER));
-    shader_glsl_compile(gl_info, shader_obj, buffer->buffer);
+    shader_glsl_compile(priv, gl_info, shader_obj, buffer->buffer);
 
     return shader_obj;
 }
@@ -9673,11 +10498,13 @@ static GLuint shader_glsl_generate_ffp_fragment_shader(struct shader_glsl_priv *
     const struct wined3d_gl_info *gl_info = context->gl_info;
     const BOOL legacy_syntax = needs_legacy_glsl_syntax(gl_info);
     BOOL tempreg_used = FALSE, tfactor_used = FALSE;
+    struct glsl_gen_context gen;
     UINT lowest_disabled_stage;
     GLuint shader_id;
     DWORD arg0, arg1, arg2;
     unsigned int stage;
 
+    glsl_gen_context_init(&gen, context);
     string_buffer_clear(buffer);
 
     /* Find out which textures are read */
@@ -9799,7 +10626,7 @@ static GLuint shader_glsl_generate_ffp_fragment_shader(struct shader_glsl_priv *
         if (sampler_type)
         {
             if (shader_glsl_use_layout_binding_qualifier(gl_info))
-                shader_glsl_append_sampler_binding_qualifier(buffer, context, NULL, stage);
+                shader_glsl_append_sampler_binding_qualifier(buffer, &gen, NULL, stage);
             shader_addline(buffer, "uniform sampler%s ps_sampler%u;\n", sampler_type, stage);
         }
 
@@ -10067,7 +10894,7 @@ static GLuint shader_glsl_generate_ffp_fragment_shader(struct shader_glsl_priv *
     shader_addline(buffer, "}\n");
 
     shader_id = GL_EXTCALL(glCreateShader(GL_FRAGMENT_SHADER));
-    shader_glsl_compile(gl_info, shader_id, buffer->buffer);
+    shader_glsl_compile(priv, gl_info, shader_id, buffer->buffer);
 
     string_buffer_release(&priv->string_buffers, tex_reg_name);
     return shader_id;
@@ -10305,7 +11132,7 @@ static HRESULT shader_glsl_compile_compute_shader(struct shader_glsl_priv *priv,
     TRACE("Compiling compute shader %p.\n", shader);
 
     string_buffer_clear(buffer);
-    shader_id = shader_glsl_generate_compute_shader(context, buffer, &priv->string_buffers, shader);
+    shader_id = shader_glsl_generate_compute_shader(context, priv, shader);
     gl_shaders[shader_data->num_gl_shaders++].id = shader_id;
 
     program_id = GL_EXTCALL(glCreateProgram());
@@ -10329,9 +11156,7 @@ static HRESULT shader_glsl_compile_compute_shader(struct shader_glsl_priv *priv,
 
     list_add_head(&shader->linked_programs, &entry->cs.shader_entry);
 
-    TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    shader_glsl_link_program(priv, gl_info, program_id, TRUE);
 
     GL_EXTCALL(glUseProgram(program_id));
     checkGLcall("glUseProgram");
@@ -10495,8 +11320,7 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
         struct ps_compile_args ps_compile_args;
         pshader = state->shader[WINED3D_SHADER_TYPE_PIXEL];
         find_ps_compile_args(state, pshader, context->stream_info.position_transformed, &ps_compile_args, context);
-        ps_id = find_glsl_pshader(context, &priv->shader_buffer, &priv->string_buffers,
-                pshader, &ps_compile_args, &np2fixup_info);
+        ps_id = find_glsl_pshader(context, priv, pshader, &ps_compile_args, &np2fixup_info);
         ps_list = &pshader->linked_programs;
     }
     else if (priv->fragment_pipe == &glsl_fragment_pipe
@@ -10658,9 +11482,7 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
     }
 
     /* Link the program */
-    TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    shader_glsl_link_program(priv, gl_info, program_id, !gshader || !gshader->u.gs.so_desc.element_count);
 
     shader_glsl_init_vs_uniform_locations(gl_info, priv, program_id, &entry->vs,
             vshader ? vshader->limits->constant_float : 0);
@@ -10816,15 +11638,71 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
 
 static void shader_glsl_precompile(void *shader_priv, struct wined3d_shader *shader)
 {
+    enum wined3d_shader_type type = shader->reg_maps.shader_version.type;
     struct wined3d_device *device = shader->device;
     struct wined3d_context *context;
 
-    if (shader->reg_maps.shader_version.type == WINED3D_SHADER_TYPE_COMPUTE)
+    if (type == WINED3D_SHADER_TYPE_COMPUTE)
     {
         context = context_acquire(device, NULL, 0);
         shader_glsl_compile_compute_shader(shader_priv, context, shader);
         context_release(context);
     }
+    else if ((type == WINED3D_SHADER_TYPE_VERTEX || type == WINED3D_SHADER_TYPE_PIXEL)
+            && wined3d_settings.shader_translation_threads)
+    {
+        shader_glsl_submit_job(shader_priv, shader);
+    }
+}
+
+/* Generates the GLSL source of a vertex or pixel shader for the compile args
+ * derived from the current state, without creating a GL shader object. */
+static HRESULT shader_glsl_translate(void *shader_priv, struct wined3d_shader *shader,
+        struct wined3d_string_buffer *source)
+{
+    enum wined3d_shader_type type = shader->reg_maps.shader_version.type;
+    struct shader_glsl_priv *priv = shader_priv;
+    struct wined3d_device *device = shader->device;
+    const struct wined3d_state *state = &device->cs->state;
+    struct ps_np2fixup_info np2fixup;
+    struct vs_compile_args vs_args;
+    struct ps_compile_args ps_args;
+    struct wined3d_context *context;
+    struct glsl_shader_job *job;
+    struct glsl_gen_context gen;
+    BOOL ret;
+
+    if (type != WINED3D_SHADER_TYPE_VERTEX && type != WINED3D_SHADER_TYPE_PIXEL)
+        return E_NOTIMPL;
+    if (!device->context_count)
+        return WINED3DERR_INVALIDCALL;
+    context = device->contexts[0];
+
+    if ((job = shader_glsl_finish_job(priv, shader)))
+        shader_glsl_free_job(job);
+
+    glsl_gen_context_init(&gen, context);
+    string_buffer_clear(&priv->shader_buffer);
+    if (type == WINED3D_SHADER_TYPE_PIXEL)
+    {
+        find_ps_compile_args(state, shader, context->stream_info.position_transformed, &ps_args, context);
+        pixelshader_update_resource_types(shader, ps_args.tex_types);
+        memset(&np2fixup, 0, sizeof(np2fixup));
+        ret = shader_glsl_generate_pshader(&gen, &priv->shader_buffer, &priv->string_buffers,
+                shader, &shader->reg_maps, &ps_args, &np2fixup);
+    }
+    else
+    {
+        find_vs_compile_args(state, shader, context->stream_info.swizzle_map, &vs_args, context);
+        ret = shader_glsl_generate_vshader(&gen, priv, shader, &shader->reg_maps, &vs_args);
+    }
+    if (!ret)
+        return E_FAIL;
+
+    string_buffer_clear(source);
+    shader_addline(source, "%s", priv->shader_buffer.buffer);
+
+    return WINED3D_OK;
 }
 
 /* Context activation is done by the caller. */
@@ -10975,6 +11853,10 @@ static void shader_glsl_destroy(struct wined3d_shader *shader)
     const struct wined3d_gl_info *gl_info;
     const struct list *linked_programs;
     struct wined3d_context *context;
+    struct glsl_shader_job *job;
+
+    if ((job = shader_glsl_finish_job(priv, shader)))
+        shader_glsl_free_job(job);
 
     if (!shader_data || !shader_data->num_gl_shaders)
     {
@@ -11248,6 +12130,11 @@ static HRESULT shader_glsl_alloc(struct wined3d_device *device, const struct win
 
     wine_rb_init(&priv->program_lookup, glsl_program_key_compare);
 
+    InitializeCriticalSection(&priv->translator.cs);
+    InitializeConditionVariable(&priv->translator.work_cond);
+    InitializeConditionVariable(&priv->translator.done_cond);
+    list_init(&priv->translator.jobs);
+
     priv->next_constant_version = 1;
     priv->vertex_pipe = vertex_pipe;
     priv->fragment_pipe = fragment_pipe;
@@ -11277,6 +12164,9 @@ static void shader_glsl_free(struct wined3d_device *device, struct wined3d_conte
 {
     struct shader_glsl_priv *priv = device->shader_priv;
 
+    shader_glsl_translator_stop(&priv->translator);
+    if (priv->program_cache)
+        glsl_cache_destroy(priv->program_cache);
     wine_rb_destroy(&priv->program_lookup, NULL, NULL);
     constant_heap_free(&priv->pconst_heap);
     constant_heap_free(&priv->vconst_heap);
@@ -11666,6 +12556,7 @@ const struct wined3d_shader_backend_ops glsl_shader_backend =
 {
     shader_glsl_handle_instruction,
     shader_glsl_precompile,
+    shader_glsl_translate,
     shader_glsl_select,
     shader_glsl_select_compute,
     shader_glsl_disable,
@@ -12374,12 +13265,12 @@ static void glsl_fragment_pipe_alpha_test(struct wined3d_context *context,
 
     if (state->render_states[WINED3D_RS_ALPHATESTENABLE])
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_ALPHA_TEST);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_ALPHA_TEST, TRUE);
         checkGLcall("glEnable(GL_ALPHA_TEST)");
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_ALPHA_TEST);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_ALPHA_TEST, FALSE);
         checkGLcall("glDisable(GL_ALPHA_TEST)");
     }
 }
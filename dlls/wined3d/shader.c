@@ -3171,6 +3171,11 @@ struct shader_none_priv
 
 static void shader_none_handle_instruction(const struct wined3d_shader_instruction *ins) {}
 static void shader_none_precompile(void *shader_priv, struct wined3d_shader *shader) {}
+static HRESULT shader_none_translate(void *shader_priv, struct wined3d_shader *shader,
+        struct wined3d_string_buffer *source)
+{
+    return E_NOTIMPL;
+}
 static void shader_none_select_compute(void *shader_priv, struct wined3d_context *context,
         const struct wined3d_state *state) {}
 static void shader_none_update_float_vertex_constants(struct wined3d_device *device, UINT start, UINT count) {}
@@ -3284,6 +3289,7 @@ const struct wined3d_shader_backend_ops none_shader_backend =
 {
     shader_none_handle_instruction,
     shader_none_precompile,
+    shader_none_translate,
     shader_none_select,
     shader_none_select_compute,
     shader_none_disable,
@@ -3467,6 +3473,57 @@ HRESULT CDECL wined3d_shader_get_byte_code(const struct wined3d_shader *shader,
     return WINED3D_OK;
 }
 
+struct wined3d_shader_translation
+{
+    struct wined3d_shader *shader;
+    struct wined3d_string_buffer source;
+    HRESULT hr;
+};
+
+static void wined3d_shader_translate_object(void *object)
+{
+    struct wined3d_shader_translation *translation = object;
+    struct wined3d_device *device = translation->shader->device;
+
+    translation->hr = device->shader_backend->shader_translate(device->shader_priv,
+            translation->shader, &translation->source);
+}
+
+/* Returns the code the shader backend generates for the shader with the
+ * device's current state. Mostly useful for testing and benchmarking the
+ * shader translators. */
+HRESULT CDECL wined3d_shader_translate(struct wined3d_shader *shader, char *source, unsigned int *source_size)
+{
+    struct wined3d_shader_translation translation;
+    struct wined3d_device *device = shader->device;
+    unsigned int size;
+    HRESULT hr;
+
+    TRACE("shader %p, source %p, source_size %p.\n", shader, source, source_size);
+
+    translation.shader = shader;
+    translation.hr = E_FAIL;
+    if (!string_buffer_init(&translation.source))
+        return E_OUTOFMEMORY;
+
+    wined3d_cs_init_object(device->cs, wined3d_shader_translate_object, &translation);
+    wined3d_cs_finish(device->cs, WINED3D_CS_QUEUE_DEFAULT);
+
+    if (SUCCEEDED(hr = translation.hr))
+    {
+        size = translation.source.content_size + 1;
+        if (source && *source_size < size)
+            hr = WINED3DERR_INVALIDCALL;
+        else if (source)
+            memcpy(source, translation.source.buffer, size);
+        *source_size = size;
+    }
+
+    string_buffer_free(&translation.source);
+
+    return hr;
+}
+
 /* Set local constants for d3d8 shaders. */
 HRESULT CDECL wined3d_shader_set_local_constants_float(struct wined3d_shader *shader,
         UINT start_idx, const float *src_data, UINT count)
@@ -4200,15 +4257,15 @@ static HRESULT pixel_shader_init(struct wined3d_shader *shader, struct wined3d_d
     return WINED3D_OK;
 }
 
-void pixelshader_update_resource_types(struct wined3d_shader *shader, WORD tex_types)
+void pixelshader_update_reg_maps_resource_types(struct wined3d_shader_reg_maps *reg_maps,
+        unsigned int sampler_count, WORD tex_types)
 {
-    struct wined3d_shader_reg_maps *reg_maps = &shader->reg_maps;
     struct wined3d_shader_resource_info *resource_info = reg_maps->resource_info;
     unsigned int i;
 
     if (reg_maps->shader_version.major != 1) return;
 
-    for (i = 0; i < shader->limits->sampler; ++i)
+    for (i = 0; i < sampler_count; ++i)
     {
         /* We don't sample from this sampler. */
         if (!resource_info[i].type)
@@ -4231,6 +4288,11 @@ void pixelshader_update_resource_types(struct wined3d_shader *shader, WORD tex_t
     }
 }
 
+void pixelshader_update_resource_types(struct wined3d_shader *shader, WORD tex_types)
+{
+    pixelshader_update_reg_maps_resource_types(&shader->reg_maps, shader->limits->sampler, tex_types);
+}
+
 HRESULT CDECL wined3d_shader_create_cs(struct wined3d_device *device, const struct wined3d_shader_desc *desc,
         void *parent, const struct wined3d_parent_ops *parent_ops, struct wined3d_shader **shader)
 {
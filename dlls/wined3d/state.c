@@ -210,12 +210,12 @@ static void state_lighting(struct wined3d_context *context, const struct wined3d
     if (state->render_states[WINED3D_RS_LIGHTING]
             && !context->stream_info.position_transformed)
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_LIGHTING);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_LIGHTING, TRUE);
         checkGLcall("glEnable GL_LIGHTING");
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_LIGHTING);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_LIGHTING, FALSE);
         checkGLcall("glDisable GL_LIGHTING");
     }
 }
@@ -235,15 +235,15 @@ static void state_zenable(struct wined3d_context *context, const struct wined3d_
     switch (zenable)
     {
         case WINED3D_ZB_FALSE:
-            gl_info->gl_ops.gl.p_glDisable(GL_DEPTH_TEST);
+            wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_DEPTH_TEST, FALSE);
             checkGLcall("glDisable GL_DEPTH_TEST");
             break;
         case WINED3D_ZB_TRUE:
-            gl_info->gl_ops.gl.p_glEnable(GL_DEPTH_TEST);
+            wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_DEPTH_TEST, TRUE);
             checkGLcall("glEnable GL_DEPTH_TEST");
             break;
         case WINED3D_ZB_USEW:
-            gl_info->gl_ops.gl.p_glEnable(GL_DEPTH_TEST);
+            wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_DEPTH_TEST, TRUE);
             checkGLcall("glEnable GL_DEPTH_TEST");
             FIXME("W buffer is not well handled\n");
             break;
@@ -265,17 +265,17 @@ static void state_cullmode(struct wined3d_context *context, const struct wined3d
     switch (state->render_states[WINED3D_RS_CULLMODE])
     {
         case WINED3D_CULL_NONE:
-            gl_info->gl_ops.gl.p_glDisable(GL_CULL_FACE);
+            wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_CULL_FACE, FALSE);
             checkGLcall("glDisable GL_CULL_FACE");
             break;
         case WINED3D_CULL_FRONT:
-            gl_info->gl_ops.gl.p_glEnable(GL_CULL_FACE);
+            wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_CULL_FACE, TRUE);
             checkGLcall("glEnable GL_CULL_FACE");
             gl_info->gl_ops.gl.p_glCullFace(GL_FRONT);
             checkGLcall("glCullFace(GL_FRONT)");
             break;
         case WINED3D_CULL_BACK:
-            gl_info->gl_ops.gl.p_glEnable(GL_CULL_FACE);
+            wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_CULL_FACE, TRUE);
             checkGLcall("glEnable GL_CULL_FACE");
             gl_info->gl_ops.gl.p_glCullFace(GL_BACK);
             checkGLcall("glCullFace(GL_BACK)");
@@ -315,12 +315,12 @@ static void state_ditherenable(struct wined3d_context *context, const struct win
 
     if (state->render_states[WINED3D_RS_DITHERENABLE])
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_DITHER);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_DITHER, TRUE);
         checkGLcall("glEnable GL_DITHER");
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_DITHER);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_DITHER, FALSE);
         checkGLcall("glDisable GL_DITHER");
     }
 }
@@ -550,12 +550,12 @@ static void state_blend(struct wined3d_context *context, const struct wined3d_st
 
     if (!enable_blend)
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_BLEND);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_BLEND, FALSE);
         checkGLcall("glDisable(GL_BLEND)");
         return;
     }
 
-    gl_info->gl_ops.gl.p_glEnable(GL_BLEND);
+    wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_BLEND, TRUE);
     checkGLcall("glEnable(GL_BLEND)");
 
     gl_blend_from_d3d(&src_blend, &dst_blend,
@@ -627,10 +627,7 @@ static void state_blend_object(struct wined3d_context *context, const struct win
         alpha_to_coverage = desc->alpha_to_coverage;
     }
 
-    if (alpha_to_coverage)
-        gl_info->gl_ops.gl.p_glEnable(GL_SAMPLE_ALPHA_TO_COVERAGE);
-    else
-        gl_info->gl_ops.gl.p_glDisable(GL_SAMPLE_ALPHA_TO_COVERAGE);
+    wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_SAMPLE_ALPHA_TO_COVERAGE, alpha_to_coverage);
 
     checkGLcall("blend state");
 }
@@ -661,12 +658,12 @@ void state_alpha_test(struct wined3d_context *context, const struct wined3d_stat
     if (state->render_states[WINED3D_RS_ALPHATESTENABLE]
             || (state->render_states[WINED3D_RS_COLORKEYENABLE] && enable_ckey))
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_ALPHA_TEST);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_ALPHA_TEST, TRUE);
         checkGLcall("glEnable GL_ALPHA_TEST");
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_ALPHA_TEST);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_ALPHA_TEST, FALSE);
         checkGLcall("glDisable GL_ALPHA_TEST");
         /* Alpha test is disabled, don't bother setting the params - it will happen on the next
          * enable call
@@ -781,7 +778,7 @@ static void state_specularenable(struct wined3d_context *context, const struct w
         checkGLcall("glMaterialf(GL_SHININESS)");
 
         if (gl_info->supported[EXT_SECONDARY_COLOR])
-            gl_info->gl_ops.gl.p_glEnable(GL_COLOR_SUM_EXT);
+            wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_COLOR_SUM_EXT, TRUE);
         else
             TRACE("Specular colors cannot be enabled in this version of opengl\n");
         checkGLcall("glEnable(GL_COLOR_SUM)");
@@ -800,7 +797,7 @@ static void state_specularenable(struct wined3d_context *context, const struct w
 
         /* for the case of disabled lighting: */
         if (gl_info->supported[EXT_SECONDARY_COLOR])
-            gl_info->gl_ops.gl.p_glDisable(GL_COLOR_SUM_EXT);
+            wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_COLOR_SUM_EXT, FALSE);
         else
             TRACE("Specular colors cannot be disabled in this version of opengl\n");
         checkGLcall("glDisable(GL_COLOR_SUM)");
@@ -852,7 +849,7 @@ static void renderstate_stencil_twosided(struct wined3d_context *context, GLint
 {
     const struct wined3d_gl_info *gl_info = context->gl_info;
 
-    gl_info->gl_ops.gl.p_glEnable(GL_STENCIL_TEST_TWO_SIDE_EXT);
+    wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_STENCIL_TEST_TWO_SIDE_EXT, TRUE);
     checkGLcall("glEnable(GL_STENCIL_TEST_TWO_SIDE_EXT)");
     GL_EXTCALL(glActiveStencilFaceEXT(face));
     checkGLcall("glActiveStencilFaceEXT(...)");
@@ -910,7 +907,7 @@ static void state_stencil(struct wined3d_context *context, const struct wined3d_
     /* No stencil test without a stencil buffer. */
     if (!state->fb->depth_stencil)
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_STENCIL_TEST);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_STENCIL_TEST, FALSE);
         checkGLcall("glDisable GL_STENCIL_TEST");
         return;
     }
@@ -939,7 +936,7 @@ static void state_stencil(struct wined3d_context *context, const struct wined3d_
 
     if (twosided_enable && onesided_enable)
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_STENCIL_TEST);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_STENCIL_TEST, TRUE);
         checkGLcall("glEnable GL_STENCIL_TEST");
 
         if (gl_info->supported[WINED3D_GL_VERSION_2_0])
@@ -981,14 +978,14 @@ static void state_stencil(struct wined3d_context *context, const struct wined3d_
     {
         if (gl_info->supported[EXT_STENCIL_TWO_SIDE])
         {
-            gl_info->gl_ops.gl.p_glDisable(GL_STENCIL_TEST_TWO_SIDE_EXT);
+            wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_STENCIL_TEST_TWO_SIDE_EXT, FALSE);
             checkGLcall("glDisable(GL_STENCIL_TEST_TWO_SIDE_EXT)");
         }
 
         /* This code disables the ATI extension as well, since the standard stencil functions are equal
          * to calling the ATI functions with GL_FRONT_AND_BACK as face parameter
          */
-        gl_info->gl_ops.gl.p_glEnable(GL_STENCIL_TEST);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_STENCIL_TEST, TRUE);
         checkGLcall("glEnable GL_STENCIL_TEST");
         gl_info->gl_ops.gl.p_glStencilFunc(func, ref, mask);
         checkGLcall("glStencilFunc(...)");
@@ -997,7 +994,7 @@ static void state_stencil(struct wined3d_context *context, const struct wined3d_
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_STENCIL_TEST);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_STENCIL_TEST, FALSE);
         checkGLcall("glDisable GL_STENCIL_TEST");
     }
 }
@@ -1368,14 +1365,14 @@ static void state_colormat(struct wined3d_context *context, const struct wined3d
 
     if (!Parm)
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_COLOR_MATERIAL);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_COLOR_MATERIAL, FALSE);
         checkGLcall("glDisable GL_COLOR_MATERIAL");
     }
     else
     {
         gl_info->gl_ops.gl.p_glColorMaterial(GL_FRONT_AND_BACK, Parm);
         checkGLcall("glColorMaterial(GL_FRONT_AND_BACK, Parm)");
-        gl_info->gl_ops.gl.p_glEnable(GL_COLOR_MATERIAL);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_COLOR_MATERIAL, TRUE);
         checkGLcall("glEnable(GL_COLOR_MATERIAL)");
     }
 
@@ -1439,12 +1436,12 @@ static void state_linepattern(struct wined3d_context *context, const struct wine
     {
         gl_info->gl_ops.gl.p_glLineStipple(tmppattern.lp.repeat_factor, tmppattern.lp.line_pattern);
         checkGLcall("glLineStipple(repeat, linepattern)");
-        gl_info->gl_ops.gl.p_glEnable(GL_LINE_STIPPLE);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_LINE_STIPPLE, TRUE);
         checkGLcall("glEnable(GL_LINE_STIPPLE);");
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_LINE_STIPPLE);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_LINE_STIPPLE, FALSE);
         checkGLcall("glDisable(GL_LINE_STIPPLE);");
     }
 }
@@ -1471,12 +1468,12 @@ static void state_normalize(struct wined3d_context *context, const struct wined3
     if (state->render_states[WINED3D_RS_NORMALIZENORMALS]
             && (context->stream_info.use_map & (1u << WINED3D_FFP_NORMAL)))
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_NORMALIZE);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_NORMALIZE, TRUE);
         checkGLcall("glEnable(GL_NORMALIZE);");
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_NORMALIZE);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_NORMALIZE, FALSE);
         checkGLcall("glDisable(GL_NORMALIZE);");
     }
 }
@@ -1662,12 +1659,12 @@ void state_pointsprite(struct wined3d_context *context, const struct wined3d_sta
 
     if (state->render_states[WINED3D_RS_POINTSPRITEENABLE])
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_POINT_SPRITE_ARB);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_POINT_SPRITE_ARB, TRUE);
         checkGLcall("glEnable(GL_POINT_SPRITE_ARB)");
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_POINT_SPRITE_ARB);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_POINT_SPRITE_ARB, FALSE);
         checkGLcall("glDisable(GL_POINT_SPRITE_ARB)");
     }
 }
@@ -1708,12 +1705,12 @@ static void state_msaa(struct wined3d_context *context, const struct wined3d_sta
 
     if (state->render_states[WINED3D_RS_MULTISAMPLEANTIALIAS])
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_MULTISAMPLE_ARB);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_MULTISAMPLE_ARB, TRUE);
         checkGLcall("glEnable(GL_MULTISAMPLE_ARB)");
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_MULTISAMPLE_ARB);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_MULTISAMPLE_ARB, FALSE);
         checkGLcall("glDisable(GL_MULTISAMPLE_ARB)");
     }
 }
@@ -1725,12 +1722,12 @@ static void state_line_antialias(struct wined3d_context *context, const struct w
     if (state->render_states[WINED3D_RS_EDGEANTIALIAS]
             || state->render_states[WINED3D_RS_ANTIALIASEDLINEENABLE])
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_LINE_SMOOTH);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_LINE_SMOOTH, TRUE);
         checkGLcall("glEnable(GL_LINE_SMOOTH)");
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_LINE_SMOOTH);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_LINE_SMOOTH, FALSE);
         checkGLcall("glDisable(GL_LINE_SMOOTH)");
     }
 }
@@ -1741,12 +1738,12 @@ static void state_scissor(struct wined3d_context *context, const struct wined3d_
 
     if (state->render_states[WINED3D_RS_SCISSORTESTENABLE])
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_SCISSOR_TEST);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_SCISSOR_TEST, TRUE);
         checkGLcall("glEnable(GL_SCISSOR_TEST)");
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_SCISSOR_TEST);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_SCISSOR_TEST, FALSE);
         checkGLcall("glDisable(GL_SCISSOR_TEST)");
     }
 }
@@ -1810,7 +1807,7 @@ static void state_depthbias(struct wined3d_context *context, const struct wined3
             units = const_bias.f * scale;
         }
 
-        gl_info->gl_ops.gl.p_glEnable(GL_POLYGON_OFFSET_FILL);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_POLYGON_OFFSET_FILL, TRUE);
         if (gl_info->supported[ARB_POLYGON_OFFSET_CLAMP])
         {
             gl_info->gl_ops.ext.p_glPolygonOffsetClamp(factor, units, clamp);
@@ -1824,7 +1821,7 @@ static void state_depthbias(struct wined3d_context *context, const struct wined3
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_POLYGON_OFFSET_FILL);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_POLYGON_OFFSET_FILL, FALSE);
     }
 
     checkGLcall("depth bias");
@@ -1921,20 +1918,20 @@ static void state_nvdb(struct wined3d_context *context, const struct wined3d_sta
          * In d3d9 test is not performed in this case*/
         if (zmin.f <= zmax.f)
         {
-            gl_info->gl_ops.gl.p_glEnable(GL_DEPTH_BOUNDS_TEST_EXT);
+            wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_DEPTH_BOUNDS_TEST_EXT, TRUE);
             checkGLcall("glEnable(GL_DEPTH_BOUNDS_TEST_EXT)");
             GL_EXTCALL(glDepthBoundsEXT(zmin.f, zmax.f));
             checkGLcall("glDepthBoundsEXT(...)");
         }
         else
         {
-            gl_info->gl_ops.gl.p_glDisable(GL_DEPTH_BOUNDS_TEST_EXT);
+            wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_DEPTH_BOUNDS_TEST_EXT, FALSE);
             checkGLcall("glDisable(GL_DEPTH_BOUNDS_TEST_EXT)");
         }
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_DEPTH_BOUNDS_TEST_EXT);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_DEPTH_BOUNDS_TEST_EXT, FALSE);
         checkGLcall("glDisable(GL_DEPTH_BOUNDS_TEST_EXT)");
     }
 
@@ -4311,8 +4308,10 @@ static void indexbuffer(struct wined3d_context *context, const struct wined3d_st
     }
 }
 
-static void depth_clip(const struct wined3d_rasterizer_state *r, const struct wined3d_gl_info *gl_info)
+static void depth_clip(struct wined3d_context *context, const struct wined3d_rasterizer_state *r)
 {
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+
     if (!gl_info->supported[ARB_DEPTH_CLAMP])
     {
         if (r && !r->desc.depth_clip)
@@ -4320,10 +4319,7 @@ static void depth_clip(const struct wined3d_rasterizer_state *r, const struct wi
         return;
     }
 
-    if (r && !r->desc.depth_clip)
-        gl_info->gl_ops.gl.p_glEnable(GL_DEPTH_CLAMP);
-    else
-        gl_info->gl_ops.gl.p_glDisable(GL_DEPTH_CLAMP);
+    wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_DEPTH_CLAMP, r && !r->desc.depth_clip);
     checkGLcall("depth clip");
 }
 
@@ -4340,7 +4336,7 @@ static void rasterizer(struct wined3d_context *context, const struct wined3d_sta
     checkGLcall("glFrontFace");
     if (!isStateDirty(context, STATE_RENDER(WINED3D_RS_DEPTHBIAS)))
         state_depthbias(context, state, STATE_RENDER(WINED3D_RS_DEPTHBIAS));
-    depth_clip(state->rasterizer_state, gl_info);
+    depth_clip(context, state->rasterizer_state);
 }
 
 static void rasterizer_cc(struct wined3d_context *context, const struct wined3d_state *state, DWORD state_id)
@@ -4354,7 +4350,7 @@ static void rasterizer_cc(struct wined3d_context *context, const struct wined3d_
     checkGLcall("glFrontFace");
     if (!isStateDirty(context, STATE_RENDER(WINED3D_RS_DEPTHBIAS)))
         state_depthbias(context, state, STATE_RENDER(WINED3D_RS_DEPTHBIAS));
-    depth_clip(state->rasterizer_state, gl_info);
+    depth_clip(context, state->rasterizer_state);
 }
 
 static void psorigin_w(struct wined3d_context *context, const struct wined3d_state *state, DWORD state_id)
@@ -4379,14 +4375,10 @@ static void psorigin(struct wined3d_context *context, const struct wined3d_state
 
 void state_srgbwrite(struct wined3d_context *context, const struct wined3d_state *state, DWORD state_id)
 {
-    const struct wined3d_gl_info *gl_info = context->gl_info;
-
     TRACE("context %p, state %p, state_id %#x.\n", context, state, state_id);
 
-    if (needs_srgb_write(context, state, state->fb))
-        gl_info->gl_ops.gl.p_glEnable(GL_FRAMEBUFFER_SRGB);
-    else
-        gl_info->gl_ops.gl.p_glDisable(GL_FRAMEBUFFER_SRGB);
+    wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_FRAMEBUFFER_SRGB,
+            needs_srgb_write(context, state, state->fb));
 }
 
 static void state_cb(struct wined3d_context *context, const struct wined3d_state *state, DWORD state_id)
@@ -122,14 +122,14 @@ static void texture2d_depth_blt_fbo(const struct wined3d_device *device, struct
     {
         if (context->gl_info->supported[EXT_STENCIL_TWO_SIDE])
         {
-            gl_info->gl_ops.gl.p_glDisable(GL_STENCIL_TEST_TWO_SIDE_EXT);
+            wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_STENCIL_TEST_TWO_SIDE_EXT, FALSE);
             context_invalidate_state(context, STATE_RENDER(WINED3D_RS_TWOSIDEDSTENCILMODE));
         }
         gl_info->gl_ops.gl.p_glStencilMask(~0U);
         context_invalidate_state(context, STATE_RENDER(WINED3D_RS_STENCILWRITEMASK));
     }
 
-    gl_info->gl_ops.gl.p_glDisable(GL_SCISSOR_TEST);
+    wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_SCISSOR_TEST, FALSE);
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_SCISSORTESTENABLE));
 
     gl_info->fbo_ops.glBlitFramebuffer(src_rect->left, src_rect->top, src_rect->right, src_rect->bottom,
@@ -277,7 +277,7 @@ static void texture2d_blt_fbo(const struct wined3d_device *device, struct wined3
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_COLORWRITEENABLE2));
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_COLORWRITEENABLE3));
 
-    gl_info->gl_ops.gl.p_glDisable(GL_SCISSOR_TEST);
+    wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_SCISSOR_TEST, FALSE);
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_SCISSORTESTENABLE));
 
     gl_info->fbo_ops.glBlitFramebuffer(src_rect->left, src_rect->top, src_rect->right, src_rect->bottom,
@@ -2263,7 +2263,7 @@ static DWORD ffp_blitter_blit(struct wined3d_blitter *blitter, enum wined3d_blit
 
     if (op == WINED3D_BLIT_OP_COLOR_BLIT_ALPHATEST || color_key)
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_ALPHA_TEST);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_ALPHA_TEST, TRUE);
         checkGLcall("glEnable(GL_ALPHA_TEST)");
     }
 
@@ -2285,7 +2285,7 @@ static DWORD ffp_blitter_blit(struct wined3d_blitter *blitter, enum wined3d_blit
 
     if (op == WINED3D_BLIT_OP_COLOR_BLIT_ALPHATEST || color_key)
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_ALPHA_TEST);
+        wined3d_context_gl_enable_cap(wined3d_context_gl(context), GL_ALPHA_TEST, FALSE);
         checkGLcall("glDisable(GL_ALPHA_TEST)");
     }
 
@@ -2522,6 +2522,8 @@ static HRESULT surface_cpu_blt(struct wined3d_texture *dst_texture, unsigned int
         src_format = src_texture->resource.format;
         src_fmt_flags = src_texture->resource.format_flags;
 
+        if (!converted_texture)
+            wined3d_texture_track_readback(src_texture, src_sub_resource_idx);
         map_binding = src_texture->resource.map_binding;
         texture_level = src_sub_resource_idx % src_texture->level_count;
         if (!wined3d_texture_load_location(src_texture, src_sub_resource_idx, context, map_binding))
@@ -25,6 +25,7 @@
 #include "wined3d_private.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 WINE_DECLARE_DEBUG_CHANNEL(fps);
 
 static void wined3d_swapchain_destroy_object(void *object)
@@ -539,6 +540,16 @@ static void swapchain_gl_present(struct wined3d_swapchain *swapchain,
         }
     }
 
+    if (TRACE_ON(d3d_perf))
+    {
+        struct wined3d_context_gl *context_gl = wined3d_context_gl(context);
+
+        TRACE_(d3d_perf)("Context %p: %u capability changes, %u redundant changes skipped.\n",
+                context, context_gl->cap_calls, context_gl->cap_calls_skipped);
+        context_gl->cap_calls = 0;
+        context_gl->cap_calls_skipped = 0;
+    }
+
     wined3d_texture_validate_location(swapchain->front_buffer, 0, WINED3D_LOCATION_DRAWABLE);
     wined3d_texture_invalidate_location(swapchain->front_buffer, 0, ~WINED3D_LOCATION_DRAWABLE);
     /* If the swapeffect is DISCARD, the back buffer is undefined. That means the SYSMEM
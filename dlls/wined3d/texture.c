@@ -521,6 +521,114 @@ void wined3d_texture_set_map_binding(struct wined3d_texture *texture, DWORD map_
         wined3d_texture_update_map_binding(texture);
 }
 
+/* Called when the CPU reads a sub-resource. Offscreen render targets that are
+ * read back repeatedly get a PBO map binding, and are downloaded ahead of
+ * time by wined3d_texture_prefetch_readbacks(), so that the map itself
+ * doesn't have to wait for the GPU. */
+void wined3d_texture_track_readback(struct wined3d_texture *texture, unsigned int sub_resource_idx)
+{
+    struct wined3d_texture_sub_resource *sub_resource = &texture->sub_resources[sub_resource_idx];
+    struct wined3d_device *device = texture->resource.device;
+    const struct wined3d_gl_info *gl_info = &device->adapter->gl_info;
+    DWORD map_binding = texture->resource.map_binding;
+
+    if (sub_resource->prefetched)
+    {
+        sub_resource->prefetched = 0;
+        texture->async.readback_misses = 0;
+        if (sub_resource->locations & map_binding)
+            TRACE_(d3d_perf)("Using prefetched data for texture %p, sub-resource %u.\n", texture, sub_resource_idx);
+    }
+
+    if (sub_resource->locations & map_binding)
+        return;
+
+    if (texture->resource.type != WINED3D_RTYPE_TEXTURE_2D
+            || !(texture->resource.bind_flags & WINED3D_BIND_RENDER_TARGET)
+            || texture->swapchain || texture->flags & WINED3D_TEXTURE_GET_DC)
+        return;
+
+    sub_resource->readback = 1;
+    if (texture->async.flags & WINED3D_TEXTURE_ASYNC_READBACK)
+        return;
+
+    if (!gl_info->supported[ARB_PIXEL_BUFFER_OBJECT] || texture->resource.format->conv_byte_count
+            || texture->flags & (WINED3D_TEXTURE_PIN_SYSMEM | WINED3D_TEXTURE_COND_NP2_EMULATED
+            | WINED3D_TEXTURE_CONVERTED)
+            || (map_binding != WINED3D_LOCATION_SYSMEM && map_binding != WINED3D_LOCATION_BUFFER))
+        return;
+
+    TRACE_(d3d_perf)("Prefetching readbacks of texture %p.\n", texture);
+    texture->async.flags |= WINED3D_TEXTURE_ASYNC_READBACK;
+    texture->async.readback_misses = 0;
+    texture->async.readback_map_binding = map_binding;
+    if (map_binding != WINED3D_LOCATION_BUFFER)
+        wined3d_texture_set_map_binding(texture, WINED3D_LOCATION_BUFFER);
+    list_add_tail(&device->readback_textures, &texture->async.readback_entry);
+}
+
+/* Download the render targets read back by the CPU into their PBOs. Called
+ * from the command stream thread after presenting, so that the transfers
+ * overlap with the application preparing the next frame. */
+void wined3d_texture_prefetch_readbacks(struct wined3d_device *device)
+{
+    static const DWORD gpu_locations = WINED3D_LOCATION_TEXTURE_RGB | WINED3D_LOCATION_TEXTURE_SRGB
+            | WINED3D_LOCATION_RB_MULTISAMPLE | WINED3D_LOCATION_RB_RESOLVED;
+    struct wined3d_texture_sub_resource *sub_resource;
+    struct wined3d_texture *texture, *next;
+    struct wined3d_context *context = NULL;
+    unsigned int i, sub_count;
+    BOOL missed;
+
+    LIST_FOR_EACH_ENTRY_SAFE(texture, next, &device->readback_textures, struct wined3d_texture, async.readback_entry)
+    {
+        sub_count = texture->level_count * texture->layer_count;
+
+        /* Stop prefetching textures whose data ends up not being read. */
+        for (i = 0, missed = FALSE; i < sub_count; ++i)
+        {
+            if (texture->sub_resources[i].prefetched)
+                missed = TRUE;
+        }
+        if (missed && ++texture->async.readback_misses >= WINED3D_TEXTURE_READBACK_MISS_LIMIT)
+        {
+            TRACE_(d3d_perf)("Stopping readback prefetching for texture %p.\n", texture);
+            for (i = 0; i < sub_count; ++i)
+            {
+                texture->sub_resources[i].readback = 0;
+                texture->sub_resources[i].prefetched = 0;
+            }
+            texture->async.flags &= ~WINED3D_TEXTURE_ASYNC_READBACK;
+            if (texture->resource.map_binding == WINED3D_LOCATION_BUFFER
+                    && texture->async.readback_map_binding != WINED3D_LOCATION_BUFFER)
+                wined3d_texture_set_map_binding(texture, texture->async.readback_map_binding);
+            list_remove(&texture->async.readback_entry);
+            list_init(&texture->async.readback_entry);
+            continue;
+        }
+
+        if (texture->resource.map_binding != WINED3D_LOCATION_BUFFER)
+            continue;
+
+        for (i = 0; i < sub_count; ++i)
+        {
+            sub_resource = &texture->sub_resources[i];
+            if (!sub_resource->readback || sub_resource->map_count
+                    || sub_resource->locations & WINED3D_LOCATION_BUFFER
+                    || !(sub_resource->locations & gpu_locations))
+                continue;
+
+            if (!context)
+                context = context_acquire(device, NULL, 0);
+            if (wined3d_texture_load_location(texture, i, context, WINED3D_LOCATION_BUFFER))
+                sub_resource->prefetched = 1;
+        }
+    }
+
+    if (context)
+        context_release(context);
+}
+
 /* A GL context is provided by the caller */
 static void gltexture_delete(struct wined3d_device *device, const struct wined3d_gl_info *gl_info,
         struct gl_texture *tex)
@@ -821,6 +929,8 @@ static void wined3d_texture_cleanup(struct wined3d_texture *texture)
 
     TRACE("texture %p.\n", texture);
 
+    list_remove(&texture->async.readback_entry);
+
     for (i = 0; i < sub_count; ++i)
     {
         if (!(buffer_object = texture->sub_resources[i].buffer_object))
@@ -2582,6 +2692,9 @@ static HRESULT texture_resource_sub_resource_map(struct wined3d_resource *resour
         return WINED3DERR_INVALIDCALL;
     }
 
+    if (device->d3d_initialized && flags & WINED3D_MAP_READ)
+        wined3d_texture_track_readback(texture, sub_resource_idx);
+
     if (device->d3d_initialized)
         context = context_acquire(device, NULL, 0);
 
@@ -2982,6 +3095,7 @@ static HRESULT wined3d_texture_init(struct wined3d_texture *texture, const struc
     wined3d_resource_update_draw_binding(&texture->resource);
 
     texture->texture_ops = texture_ops;
+    list_init(&texture->async.readback_entry);
 
     texture->layer_count = layer_count;
     texture->level_count = level_count;
@@ -91,6 +91,9 @@ struct wined3d_settings wined3d_settings =
     ~0u,            /* No CS shader model limit by default. */
     WINED3D_RENDERER_AUTO,
     WINED3D_SHADER_BACKEND_AUTO,
+    FALSE,          /* Don't cache linked GLSL programs on disk by default. */
+    256,            /* Shader cache size limit in MB. */
+    ~0u,            /* One shader translation thread per additional CPU, up to four. */
 };
 
 struct wined3d * CDECL wined3d_create(DWORD flags)
@@ -346,6 +349,13 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
             TRACE("Limiting PS shader model to %u.\n", wined3d_settings.max_sm_ps);
         if (!get_config_key_dword(hkey, appkey, "MaxShaderModelCS", &wined3d_settings.max_sm_cs))
             TRACE("Limiting CS shader model to %u.\n", wined3d_settings.max_sm_cs);
+        if (!get_config_key_dword(hkey, appkey, "ShaderCache", &wined3d_settings.shader_cache))
+            TRACE("Setting shader cache to %#x.\n", wined3d_settings.shader_cache);
+        if (!get_config_key_dword(hkey, appkey, "ShaderCacheSize", &wined3d_settings.shader_cache_size))
+            TRACE("Limiting shader cache size to %u MB.\n", wined3d_settings.shader_cache_size);
+        if (!get_config_key_dword(hkey, appkey, "ShaderTranslationThreads",
+                &wined3d_settings.shader_translation_threads))
+            TRACE("Using %u shader translation threads.\n", wined3d_settings.shader_translation_threads);
         if (!get_config_key(hkey, appkey, "renderer", buffer, size)
                 || !get_config_key(hkey, appkey, "DirectDrawRenderer", buffer, size))
         {
@@ -421,6 +421,9 @@ struct wined3d_settings
     unsigned int max_sm_cs;
     enum wined3d_renderer renderer;
     enum wined3d_shader_backend shader_backend;
+    unsigned int shader_cache;
+    unsigned int shader_cache_size;
+    unsigned int shader_translation_threads;
 };
 
 extern struct wined3d_settings wined3d_settings DECLSPEC_HIDDEN;
@@ -1429,6 +1432,8 @@ struct wined3d_shader_backend_ops
 {
     void (*shader_handle_instruction)(const struct wined3d_shader_instruction *);
     void (*shader_precompile)(void *shader_priv, struct wined3d_shader *shader);
+    HRESULT (*shader_translate)(void *shader_priv, struct wined3d_shader *shader,
+            struct wined3d_string_buffer *source);
     void (*shader_select)(void *shader_priv, struct wined3d_context *context,
             const struct wined3d_state *state);
     void (*shader_select_compute)(void *shader_priv, struct wined3d_context *context,
@@ -1732,6 +1737,8 @@ struct wined3d_fence
 HRESULT wined3d_fence_create(struct wined3d_device *device, struct wined3d_fence **fence) DECLSPEC_HIDDEN;
 void wined3d_fence_destroy(struct wined3d_fence *fence) DECLSPEC_HIDDEN;
 void wined3d_fence_issue(struct wined3d_fence *fence, const struct wined3d_device *device) DECLSPEC_HIDDEN;
+enum wined3d_fence_result wined3d_fence_test(const struct wined3d_fence *fence,
+        const struct wined3d_device *device, DWORD flags) DECLSPEC_HIDDEN;
 enum wined3d_fence_result wined3d_fence_wait(const struct wined3d_fence *fence,
         const struct wined3d_device *device) DECLSPEC_HIDDEN;
 
@@ -2034,6 +2041,13 @@ struct wined3d_context_gl
     uint32_t fog_enabled : 1;
     uint32_t padding : 31;
 
+    /* Shadow copy of the capabilities set through
+     * wined3d_context_gl_enable_cap(), used to drop redundant calls. */
+    uint32_t cap_valid_mask;
+    uint32_t cap_enabled_mask;
+    unsigned int cap_calls;
+    unsigned int cap_calls_skipped;
+
     GLenum *texture_type;
 
     /* Extension emulation. */
@@ -2061,6 +2075,10 @@ void wined3d_context_gl_apply_ffp_blit_state(struct wined3d_context_gl *context_
 void wined3d_context_gl_bind_texture(struct wined3d_context_gl *context_gl,
         GLenum target, GLuint name) DECLSPEC_HIDDEN;
 void wined3d_context_gl_cleanup(struct wined3d_context_gl *context_gl) DECLSPEC_HIDDEN;
+void wined3d_context_gl_enable_cap(struct wined3d_context_gl *context_gl, GLenum cap, BOOL enable) DECLSPEC_HIDDEN;
+const unsigned int *wined3d_get_tex_unit_mapping(const struct wined3d_gl_info *gl_info,
+        const unsigned int *tex_unit_map, const struct wined3d_shader_version *shader_version,
+        unsigned int *base, unsigned int *count) DECLSPEC_HIDDEN;
 const unsigned int *wined3d_context_gl_get_tex_unit_mapping(const struct wined3d_context_gl *context_gl,
         const struct wined3d_shader_version *shader_version, unsigned int *base, unsigned int *count) DECLSPEC_HIDDEN;
 HRESULT wined3d_context_gl_init(struct wined3d_context_gl *context_gl,
@@ -3152,6 +3170,8 @@ struct wined3d_device
     /* Array of functions for states which are handled by more than one pipeline part */
     APPLYSTATEFUNC *multistate_funcs[STATE_HIGHEST + 1];
     struct wined3d_blitter *blitter;
+    struct wined3d_upload_heap *upload_heap;
+    struct list readback_textures;      /* CS thread */
 
     BYTE bCursorVisible : 1;
     BYTE d3d_initialized : 1;
@@ -3384,6 +3404,9 @@ struct wined3d_texture_ops
 #define WINED3D_TEXTURE_GENERATE_MIPMAPS    0x00008000
 
 #define WINED3D_TEXTURE_ASYNC_COLOR_KEY     0x00000001
+#define WINED3D_TEXTURE_ASYNC_READBACK      0x00000002
+
+#define WINED3D_TEXTURE_READBACK_MISS_LIMIT 8
 
 struct wined3d_texture
 {
@@ -3418,6 +3441,11 @@ struct wined3d_texture
         struct wined3d_color_key src_overlay_color_key;
         struct wined3d_color_key gl_color_key;
         DWORD color_key_flags;
+
+        /* Entry in the device's list of textures read back by the CPU. */
+        struct list readback_entry;
+        unsigned int readback_misses;
+        DWORD readback_map_binding;     /* Map binding before prefetching. */
     } async;
 
     struct wined3d_overlay_info
@@ -3447,6 +3475,11 @@ struct wined3d_texture
         unsigned int map_count;
         DWORD locations;
         GLuint buffer_object;
+
+        /* May only be accessed from the command stream worker thread. */
+        uint32_t readback : 1;          /* Read back by the CPU after GPU writes. */
+        uint32_t prefetched : 1;        /* Downloaded ahead of time, not read yet. */
+        uint32_t padding : 30;
     } *sub_resources;
 };
 
@@ -3526,6 +3559,7 @@ void wined3d_texture_load(struct wined3d_texture *texture,
         struct wined3d_context *context, BOOL srgb) DECLSPEC_HIDDEN;
 BOOL wined3d_texture_load_location(struct wined3d_texture *texture,
         unsigned int sub_resource_idx, struct wined3d_context *context, DWORD location) DECLSPEC_HIDDEN;
+void wined3d_texture_prefetch_readbacks(struct wined3d_device *device) DECLSPEC_HIDDEN;
 BOOL wined3d_texture_prepare_location(struct wined3d_texture *texture, unsigned int sub_resource_idx,
         struct wined3d_context *context, DWORD location) DECLSPEC_HIDDEN;
 void wined3d_texture_prepare_texture(struct wined3d_texture *texture,
@@ -3533,6 +3567,8 @@ void wined3d_texture_prepare_texture(struct wined3d_texture *texture,
 void wined3d_texture_set_map_binding(struct wined3d_texture *texture, DWORD map_binding) DECLSPEC_HIDDEN;
 void wined3d_texture_set_swapchain(struct wined3d_texture *texture,
         struct wined3d_swapchain *swapchain) DECLSPEC_HIDDEN;
+void wined3d_texture_track_readback(struct wined3d_texture *texture,
+        unsigned int sub_resource_idx) DECLSPEC_HIDDEN;
 void wined3d_texture_translate_drawable_coords(const struct wined3d_texture *texture,
         HWND window, RECT *rect) DECLSPEC_HIDDEN;
 void wined3d_texture_upload_data(struct wined3d_texture *texture, unsigned int sub_resource_idx,
@@ -3794,13 +3830,39 @@ enum wined3d_push_constants
 };
 
 #define WINED3D_CS_QUERY_POLL_INTERVAL  10u
-#define WINED3D_CS_QUEUE_SIZE           0x100000u
-#define WINED3D_CS_SPIN_COUNT           10000000u
+#define WINED3D_CS_CHUNK_SIZE           0x100000u
+#define WINED3D_CS_QUEUE_LIMIT          0x4000000u
+#define WINED3D_CS_SPIN_COUNT           10000u
+#define WINED3D_CS_WAIT_SPIN_COUNT      1000u
 
+struct wined3d_cs_chunk
+{
+    struct wined3d_cs_chunk *next;
+    size_t size;
+    BYTE data[1];
+};
+
+/* The queue is a list of chunks. The producer appends packets to
+ * "head_chunk", the worker thread executes them from "tail_chunk", and
+ * "pending" counts the bytes in between. The queue grows by adding chunks,
+ * the producer only waits once "pending" exceeds WINED3D_CS_QUEUE_LIMIT. */
 struct wined3d_cs_queue
 {
-    LONG head, tail;
-    BYTE data[WINED3D_CS_QUEUE_SIZE];
+    LONG pending;
+    struct wined3d_cs_chunk *head_chunk;
+    size_t head;
+    struct wined3d_cs_chunk *tail_chunk;
+    size_t tail;
+    struct wined3d_cs_chunk *free_chunk;
+};
+
+struct wined3d_cs_stats
+{
+    unsigned int packets;
+    ULONGLONG bytes;
+    LONG max_pending;
+    unsigned int stalls;
+    LONGLONG stall_time;
 };
 
 struct wined3d_cs_ops
@@ -3830,7 +3892,12 @@ struct wined3d_cs
 
     HANDLE event;
     BOOL waiting_for_event;
+    HANDLE producer_event;
+    BOOL producer_waiting;
     LONG pending_presents;
+
+    struct wined3d_cs_stats stats;
+    struct wined3d_frame_stats *frame_stats;
 };
 
 struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device) DECLSPEC_HIDDEN;
@@ -3917,11 +3984,17 @@ void wined3d_cs_emit_set_vertex_declaration(struct wined3d_cs *cs,
         struct wined3d_vertex_declaration *declaration) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_set_viewports(struct wined3d_cs *cs, unsigned int viewport_count, const struct wined3d_viewport *viewports) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_unload_resource(struct wined3d_cs *cs, struct wined3d_resource *resource) DECLSPEC_HIDDEN;
+void wined3d_cs_emit_upload_buffer(struct wined3d_cs *cs, struct wined3d_buffer *buffer, unsigned int offset,
+        unsigned int size, size_t heap_offset, ULONGLONG end, DWORD flags) DECLSPEC_HIDDEN;
+BOOL wined3d_cs_emit_upload_sub_resource(struct wined3d_cs *cs, struct wined3d_resource *resource,
+        unsigned int sub_resource_idx, const struct wined3d_box *box, const void *data, unsigned int row_pitch,
+        unsigned int slice_pitch) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_update_sub_resource(struct wined3d_cs *cs, struct wined3d_resource *resource,
         unsigned int sub_resource_idx, const struct wined3d_box *box, const void *data, unsigned int row_pitch,
         unsigned int slice_pitch) DECLSPEC_HIDDEN;
 void wined3d_cs_init_object(struct wined3d_cs *cs,
         void (*callback)(void *object), void *object) DECLSPEC_HIDDEN;
+void wined3d_cs_wait_counter(struct wined3d_cs *cs, LONG *counter, LONG max) DECLSPEC_HIDDEN;
 HRESULT wined3d_cs_map(struct wined3d_cs *cs, struct wined3d_resource *resource, unsigned int sub_resource_idx,
         struct wined3d_map_desc *map_desc, const struct wined3d_box *box, unsigned int flags) DECLSPEC_HIDDEN;
 HRESULT wined3d_cs_unmap(struct wined3d_cs *cs, struct wined3d_resource *resource,
@@ -3945,8 +4018,7 @@ static inline void wined3d_resource_wait_idle(struct wined3d_resource *resource)
     if (!cs->thread || cs->thread_id == GetCurrentThreadId())
         return;
 
-    while (InterlockedCompareExchange(&resource->access_count, 0, 0))
-        wined3d_pause();
+    wined3d_cs_wait_counter(resource->device->cs, &resource->access_count, 0);
 }
 
 /* TODO: Add tests and support for FLOAT16_4 POSITIONT, D3DCOLOR position, other
@@ -3983,6 +4055,14 @@ struct wined3d_buffer
     UINT stride;                                            /* 0 if no conversion */
     enum wined3d_buffer_conversion_type *conversion_map;    /* NULL if no conversion */
     UINT conversion_stride;                                 /* 0 if no shifted conversion */
+
+    /* Upload heap map, set by the application thread. */
+    struct
+    {
+        DWORD flags;
+        size_t heap_offset;
+        ULONGLONG end;
+    } upload;
 };
 
 static inline struct wined3d_buffer *buffer_from_resource(struct wined3d_resource *resource)
@@ -4002,6 +4082,53 @@ void wined3d_buffer_copy(struct wined3d_buffer *dst_buffer, unsigned int dst_off
         struct wined3d_buffer *src_buffer, unsigned int src_offset, unsigned int size) DECLSPEC_HIDDEN;
 void wined3d_buffer_upload_data(struct wined3d_buffer *buffer, struct wined3d_context *context,
         const struct wined3d_box *box, const void *data) DECLSPEC_HIDDEN;
+BOOL wined3d_buffer_map_upload(struct wined3d_buffer *buffer, struct wined3d_map_desc *map_desc,
+        const struct wined3d_box *box, DWORD flags) DECLSPEC_HIDDEN;
+BOOL wined3d_buffer_unmap_upload(struct wined3d_buffer *buffer) DECLSPEC_HIDDEN;
+BOOL wined3d_buffer_update_upload(struct wined3d_buffer *buffer,
+        const struct wined3d_box *box, const void *data) DECLSPEC_HIDDEN;
+void wined3d_buffer_upload_from_heap(struct wined3d_buffer *buffer, struct wined3d_context *context,
+        size_t heap_offset, unsigned int offset, unsigned int size, DWORD flags) DECLSPEC_HIDDEN;
+
+#define WINED3D_UPLOAD_HEAP_SIZE            0x1000000u
+#define WINED3D_UPLOAD_HEAP_FENCE_COUNT     16u
+
+struct wined3d_upload_heap_fence
+{
+    struct wined3d_fence *fence;
+    ULONGLONG end;
+};
+
+/* A persistently mapped ring buffer used for DISCARD and NOOVERWRITE buffer
+ * maps. The application thread allocates from "head" without synchronising
+ * with the command stream, the CS thread copies the data to the destination
+ * buffer and advances "retired" once the GPU no longer reads it. Positions
+ * only ever increase, the offset in the ring is the position modulo
+ * WINED3D_UPLOAD_HEAP_SIZE. */
+struct wined3d_upload_heap
+{
+    GLuint buffer_object;
+    BYTE *map_ptr;
+    LONGLONG retired;
+
+    /* Application thread. "map_start" is the position of the oldest map
+     * while "map_count" is non-zero. */
+    ULONGLONG head, map_start;
+    unsigned int map_count;
+
+    /* CS thread. */
+    ULONGLONG submitted, fenced;
+    struct wined3d_upload_heap_fence fences[WINED3D_UPLOAD_HEAP_FENCE_COUNT];
+    unsigned int fence_start, fence_count;
+};
+
+struct wined3d_upload_heap *wined3d_upload_heap_create(struct wined3d_device *device,
+        struct wined3d_context *context) DECLSPEC_HIDDEN;
+BYTE *wined3d_upload_heap_alloc(struct wined3d_upload_heap *heap, unsigned int size,
+        size_t *heap_offset, ULONGLONG *end) DECLSPEC_HIDDEN;
+void wined3d_upload_heap_destroy(struct wined3d_upload_heap *heap, struct wined3d_context *context) DECLSPEC_HIDDEN;
+void wined3d_upload_heap_retire(struct wined3d_upload_heap *heap,
+        struct wined3d_device *device, ULONGLONG end) DECLSPEC_HIDDEN;
 
 struct wined3d_buffer_gl
 {
@@ -4406,6 +4533,8 @@ struct wined3d_shader
 };
 
 void pixelshader_update_resource_types(struct wined3d_shader *shader, WORD tex_types) DECLSPEC_HIDDEN;
+void pixelshader_update_reg_maps_resource_types(struct wined3d_shader_reg_maps *reg_maps,
+        unsigned int sampler_count, WORD tex_types) DECLSPEC_HIDDEN;
 void find_ps_compile_args(const struct wined3d_state *state, const struct wined3d_shader *shader,
         BOOL position_transformed, struct ps_compile_args *args,
         const struct wined3d_context *context) DECLSPEC_HIDDEN;
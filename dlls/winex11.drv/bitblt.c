@@ -1569,6 +1569,12 @@ struct x11drv_window_surface
     COLORREF              color_key;
     HRGN                  region;
     void                 *bits;
+    RECT                  exposed;      /* area to upload even if the bits didn't change */
+    BOOL                  image_valid;  /* image holds the last flushed bits */
+    HRGN                  pending;      /* damage waiting for the flush thread */
+    BOOL                  queued;       /* surface is in the flush queue */
+    struct list           flush_entry;
+    ULONGLONG             uploaded;     /* total bytes sent to the server */
 #ifdef HAVE_LIBXXSHM
     XShmSegmentInfo       shminfo;
 #endif
@@ -1625,7 +1631,7 @@ static void update_surface_region( struct x11drv_window_surface *surface )
     int x, y, start, width;
     HRGN rgn;
 
-    if (!shape_layered_windows) return;
+    if (!shape_layered_windows || !surface->window) return;
 
     if (!surface->is_argb && surface->color_key == CLR_INVALID)
     {
@@ -1885,6 +1891,383 @@ static void x11drv_surface_set_region( struct window_surface *window_surface, HR
     window_surface->funcs->unlock( window_surface );
 }
 
+/* Damage is detected by comparing the surface bits with the image holding the
+ * last flushed bits, in tiles of this size. */
+#define DAMAGE_TILE_WIDTH  64
+#define DAMAGE_TILE_HEIGHT 16
+
+static CRITICAL_SECTION flush_section;
+static CRITICAL_SECTION_DEBUG flush_critsect_debug =
+{
+    0, 0, &flush_section,
+    { &flush_critsect_debug.ProcessLocksList, &flush_critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": flush_section") }
+};
+static CRITICAL_SECTION flush_section = { &flush_critsect_debug, -1, 0, 0, 0, 0 };
+
+/* held by the flush thread while it sends a snapshot to the window */
+static CRITICAL_SECTION upload_section;
+static CRITICAL_SECTION_DEBUG upload_critsect_debug =
+{
+    0, 0, &upload_section,
+    { &upload_critsect_debug.ProcessLocksList, &upload_critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": upload_section") }
+};
+static CRITICAL_SECTION upload_section = { &upload_critsect_debug, -1, 0, 0, 0, 0 };
+
+static struct list flush_queue = LIST_INIT( flush_queue );
+static HANDLE flush_event;
+
+/* image contents handed to the flush thread */
+struct surface_snapshot
+{
+    Window   window;
+    XImage  *image;   /* the SHM image itself, or the copy below */
+    XImage   copy;    /* header of the surface image, pointing to the copied rows */
+    int      top;     /* surface row of the first row of the image */
+    RGNDATA *data;    /* rectangles to send, in surface coordinates */
+};
+
+/* SHM images are sent directly, the flush thread fences them with upload_section */
+static inline BOOL surface_uses_shm( struct x11drv_window_surface *surface )
+{
+#ifdef HAVE_LIBXXSHM
+    return surface->shminfo.shmid != -1;
+#else
+    return FALSE;
+#endif
+}
+
+/* check whether the bits can be compared directly with the image contents */
+static inline BOOL surface_can_diff( struct x11drv_window_surface *surface )
+{
+    return surface->bits != surface->image->data && !surface->byteswap &&
+           surface->image->bits_per_pixel >= 16;
+}
+
+static BOOL is_tile_damaged( struct x11drv_window_surface *surface, const RECT *rect )
+{
+    int x, y, stride = surface->image->bytes_per_line;
+    int bpp = surface->image->bits_per_pixel / 8, width = rect->right - rect->left;
+    const unsigned char *src = (const unsigned char *)surface->bits + rect->top * stride + rect->left * bpp;
+    const unsigned char *dst = (const unsigned char *)surface->image->data + rect->top * stride + rect->left * bpp;
+
+    for (y = rect->top; y < rect->bottom; y++, src += stride, dst += stride)
+    {
+        if (surface->alpha_bits)
+        {
+            for (x = 0; x < width; x++)
+                if ((((const ULONG *)src)[x] | surface->alpha_bits) != ((const ULONG *)dst)[x]) return TRUE;
+        }
+        else if (memcmp( src, dst, width * bpp )) return TRUE;
+    }
+    return FALSE;
+}
+
+/***********************************************************************
+ *           get_surface_damage
+ *
+ * Build the region of the tiles that changed since the last flush.
+ */
+static HRGN get_surface_damage( struct x11drv_window_surface *surface, const RECT *visrect )
+{
+    int x, y, columns, bands, count = 0, run_start = 0;
+    RGNDATA *data;
+    RECT *rects, tile;
+    BOOL in_run;
+    HRGN region;
+
+    columns = (visrect->right - visrect->left) / DAMAGE_TILE_WIDTH + 2;
+    bands = (visrect->bottom - visrect->top) / DAMAGE_TILE_HEIGHT + 2;
+    if (!(data = HeapAlloc( GetProcessHeap(), 0,
+                            FIELD_OFFSET( RGNDATA, Buffer[columns * bands * sizeof(RECT)] ))))
+        return CreateRectRgnIndirect( visrect );
+    rects = (RECT *)data->Buffer;
+
+    for (y = visrect->top - visrect->top % DAMAGE_TILE_HEIGHT; y < visrect->bottom; y += DAMAGE_TILE_HEIGHT)
+    {
+        tile.top = max( y, visrect->top );
+        tile.bottom = min( y + DAMAGE_TILE_HEIGHT, visrect->bottom );
+        in_run = FALSE;
+        for (x = visrect->left - visrect->left % DAMAGE_TILE_WIDTH; x < visrect->right; x += DAMAGE_TILE_WIDTH)
+        {
+            tile.left = max( x, visrect->left );
+            tile.right = min( x + DAMAGE_TILE_WIDTH, visrect->right );
+            if (is_tile_damaged( surface, &tile ))
+            {
+                if (!in_run) run_start = tile.left;
+                in_run = TRUE;
+                continue;
+            }
+            if (in_run) SetRect( &rects[count++], run_start, tile.top, tile.left, tile.bottom );
+            in_run = FALSE;
+        }
+        if (in_run) SetRect( &rects[count++], run_start, tile.top, visrect->right, tile.bottom );
+    }
+
+    data->rdh.dwSize = sizeof(data->rdh);
+    data->rdh.iType = RDH_RECTANGLES;
+    data->rdh.nCount = count;
+    data->rdh.nRgnSize = count * sizeof(RECT);
+    data->rdh.rcBound = *visrect;
+    region = ExtCreateRegion( NULL, FIELD_OFFSET( RGNDATA, Buffer[count * sizeof(RECT)] ), data );
+    HeapFree( GetProcessHeap(), 0, data );
+    return region;
+}
+
+/* copy the damaged areas of the bits into the image */
+static void copy_surface_damage( struct x11drv_window_surface *surface, const RECT *rects, DWORD count )
+{
+    int x, y, stride = surface->image->bytes_per_line, bpp = surface->image->bits_per_pixel / 8;
+    DWORD i;
+
+    for (i = 0; i < count; i++)
+    {
+        int width = rects[i].right - rects[i].left;
+        const unsigned char *src = (const unsigned char *)surface->bits + rects[i].top * stride + rects[i].left * bpp;
+        unsigned char *dst = (unsigned char *)surface->image->data + rects[i].top * stride + rects[i].left * bpp;
+
+        for (y = rects[i].top; y < rects[i].bottom; y++, src += stride, dst += stride)
+        {
+            if (surface->alpha_bits)
+                for (x = 0; x < width; x++)
+                    ((ULONG *)dst)[x] = ((const ULONG *)src)[x] | surface->alpha_bits;
+            else
+                memcpy( dst, src, width * bpp );
+        }
+    }
+}
+
+/* account for the bytes of a region that are about to be sent, the surface must be locked */
+static void count_uploaded_bytes( struct x11drv_window_surface *surface, const RGNDATA *data )
+{
+    const XRectangle *rects = (const XRectangle *)data->Buffer;
+    ULONGLONG bytes = 0;
+    DWORD i;
+
+    for (i = 0; i < data->rdh.nCount; i++)
+        bytes += (ULONGLONG)rects[i].height * rects[i].width * surface->image->bits_per_pixel / 8;
+    surface->uploaded += bytes;
+    TRACE( "surface %p sending %u rects, %s bytes, %s total\n", surface, data->rdh.nCount,
+           wine_dbgstr_longlong( bytes ), wine_dbgstr_longlong( surface->uploaded ));
+}
+
+/* send the image contents of a region to the server, the surface must be locked */
+static void put_surface_region( struct x11drv_window_surface *surface, HRGN region )
+{
+    RGNDATA *data;
+    DWORD i;
+
+    if (!(data = X11DRV_GetRegionData( region, 0 ))) return;
+
+    for (i = 0; i < data->rdh.nCount; i++)
+    {
+        const XRectangle *rect = (const XRectangle *)data->Buffer + i;
+
+#ifdef HAVE_LIBXXSHM
+        if (surface->shminfo.shmid != -1)
+            XShmPutImage( gdi_display, surface->window, surface->gc, surface->image,
+                          rect->x, rect->y,
+                          surface->header.rect.left + rect->x, surface->header.rect.top + rect->y,
+                          rect->width, rect->height, False );
+        else
+#endif
+        XPutImage( gdi_display, surface->window, surface->gc, surface->image,
+                   rect->x, rect->y,
+                   surface->header.rect.left + rect->x, surface->header.rect.top + rect->y,
+                   rect->width, rect->height );
+    }
+    XFlush( gdi_display );
+
+    count_uploaded_bytes( surface, data );
+    HeapFree( GetProcessHeap(), 0, data );
+}
+
+/***********************************************************************
+ *           snapshot_surface_region
+ *
+ * Copy the image rows covered by a region, so that the flush thread can
+ * send them without holding the surface lock. SHM images aren't copied, the
+ * flush thread holds upload_section until the server has read them, and
+ * the image isn't modified meanwhile. The surface must be locked.
+ */
+static BOOL snapshot_surface_region( struct x11drv_window_surface *surface, HRGN region,
+                                     struct surface_snapshot *snapshot )
+{
+    int stride = surface->image->bytes_per_line, bottom = 0, prev_y = -1;
+    const XRectangle *rects;
+    DWORD i;
+
+    if (!surface->window) return FALSE;
+    if (!(snapshot->data = X11DRV_GetRegionData( region, 0 ))) return FALSE;
+    rects = (const XRectangle *)snapshot->data->Buffer;
+
+    snapshot->top = surface->image->height;
+    for (i = 0; i < snapshot->data->rdh.nCount; i++)
+    {
+        snapshot->top = min( snapshot->top, rects[i].y );
+        bottom = max( bottom, rects[i].y + rects[i].height );
+    }
+    if (bottom <= snapshot->top) goto failed;
+
+    if (surface_uses_shm( surface ))
+    {
+        snapshot->image = surface->image;
+        snapshot->top = 0;
+    }
+    else
+    {
+        snapshot->image = &snapshot->copy;
+        snapshot->copy = *surface->image;
+        snapshot->copy.height = bottom - snapshot->top;
+        if (!(snapshot->copy.data = HeapAlloc( GetProcessHeap(), 0, snapshot->copy.height * stride )))
+            goto failed;
+
+        /* the rectangles of a band share the same rows */
+        for (i = 0; i < snapshot->data->rdh.nCount; i++)
+        {
+            if (rects[i].y == prev_y) continue;
+            prev_y = rects[i].y;
+            memcpy( snapshot->copy.data + (rects[i].y - snapshot->top) * stride,
+                    surface->image->data + rects[i].y * stride, rects[i].height * stride );
+        }
+    }
+
+    snapshot->window = surface->window;
+    count_uploaded_bytes( surface, snapshot->data );
+    return TRUE;
+
+failed:
+    HeapFree( GetProcessHeap(), 0, snapshot->data );
+    return FALSE;
+}
+
+/* send a snapshot to the server and free it */
+static void put_surface_snapshot( struct x11drv_window_surface *surface, struct surface_snapshot *snapshot )
+{
+    DWORD i;
+
+    for (i = 0; i < snapshot->data->rdh.nCount; i++)
+    {
+        const XRectangle *rect = (const XRectangle *)snapshot->data->Buffer + i;
+
+#ifdef HAVE_LIBXXSHM
+        if (snapshot->image == surface->image)
+            XShmPutImage( gdi_display, snapshot->window, surface->gc, snapshot->image,
+                          rect->x, rect->y,
+                          surface->header.rect.left + rect->x, surface->header.rect.top + rect->y,
+                          rect->width, rect->height, False );
+        else
+#endif
+        XPutImage( gdi_display, snapshot->window, surface->gc, snapshot->image,
+                   rect->x, rect->y - snapshot->top,
+                   surface->header.rect.left + rect->x, surface->header.rect.top + rect->y,
+                   rect->width, rect->height );
+    }
+
+    if (snapshot->image == surface->image)
+        XSync( gdi_display, False );  /* the server is done with the image after this */
+    else
+    {
+        XFlush( gdi_display );
+        HeapFree( GetProcessHeap(), 0, snapshot->copy.data );
+    }
+    HeapFree( GetProcessHeap(), 0, snapshot->data );
+}
+
+/***********************************************************************
+ *           flush_thread_proc
+ *
+ * Send pending damage to the server so that the flushing thread doesn't
+ * have to wait for the connection.
+ */
+static DWORD CALLBACK flush_thread_proc( void *arg )
+{
+    for (;;)
+    {
+        struct x11drv_window_surface *surface = NULL;
+        struct surface_snapshot snapshot;
+        BOOL have_snapshot = FALSE;
+        struct list *ptr;
+        HRGN region;
+
+        EnterCriticalSection( &flush_section );
+        if ((ptr = list_head( &flush_queue )))
+        {
+            surface = LIST_ENTRY( ptr, struct x11drv_window_surface, flush_entry );
+            list_remove( ptr );
+        }
+        LeaveCriticalSection( &flush_section );
+
+        if (!surface)
+        {
+            WaitForSingleObject( flush_event, INFINITE );
+            continue;
+        }
+
+        /* the window can't be detached from the surface until the snapshot is sent */
+        EnterCriticalSection( &upload_section );
+        surface->header.funcs->lock( &surface->header );
+        region = surface->pending;
+        surface->pending = 0;
+        surface->queued = FALSE;
+        if (region)
+        {
+            have_snapshot = snapshot_surface_region( surface, region, &snapshot );
+            DeleteObject( region );
+        }
+        surface->header.funcs->unlock( &surface->header );
+
+        if (have_snapshot) put_surface_snapshot( surface, &snapshot );
+        LeaveCriticalSection( &upload_section );
+        window_surface_release( &surface->header );
+    }
+    return 0;
+}
+
+static BOOL start_flush_thread(void)
+{
+    HANDLE thread;
+    BOOL ret;
+
+    EnterCriticalSection( &flush_section );
+    if (!flush_event && (flush_event = CreateEventW( NULL, FALSE, FALSE, NULL )))
+    {
+        if ((thread = CreateThread( NULL, 0, flush_thread_proc, NULL, 0, NULL ))) CloseHandle( thread );
+        else
+        {
+            WARN( "failed to create flush thread, flushing synchronously\n" );
+            CloseHandle( flush_event );
+            flush_event = INVALID_HANDLE_VALUE;
+        }
+    }
+    ret = flush_event && flush_event != INVALID_HANDLE_VALUE;
+    LeaveCriticalSection( &flush_section );
+    return ret;
+}
+
+/* queue damage for the flush thread, the surface must be locked */
+static BOOL queue_surface_damage( struct x11drv_window_surface *surface, HRGN damage )
+{
+    if (!start_flush_thread()) return FALSE;
+
+    if (!surface->pending) surface->pending = damage;
+    else
+    {
+        CombineRgn( surface->pending, surface->pending, damage, RGN_OR );
+        DeleteObject( damage );
+    }
+    if (surface->queued) return TRUE;
+
+    window_surface_add_ref( &surface->header );
+    surface->queued = TRUE;
+    EnterCriticalSection( &flush_section );
+    list_add_tail( &flush_queue, &surface->flush_entry );
+    LeaveCriticalSection( &flush_section );
+    SetEvent( flush_event );
+    return TRUE;
+}
+
 /***********************************************************************
  *           x11drv_surface_flush
  */
@@ -1894,8 +2277,20 @@ static void x11drv_surface_flush( struct window_surface *window_surface )
     unsigned char *src = surface->bits;
     unsigned char *dst = (unsigned char *)surface->image->data;
     struct bitblt_coords coords;
+    BOOL use_shm = surface_uses_shm( surface );
+    HRGN damage = 0;
 
+    /* don't update the SHM image while the flush thread is sending it */
+    if (use_shm) EnterCriticalSection( &upload_section );
     window_surface->funcs->lock( window_surface );
+    if (!surface->window)  /* detached from its window, nothing to send */
+    {
+        reset_bounds( &surface->bounds );
+        reset_bounds( &surface->exposed );
+        window_surface->funcs->unlock( window_surface );
+        if (use_shm) LeaveCriticalSection( &upload_section );
+        return;
+    }
     coords.x = 0;
     coords.y = 0;
     coords.width  = surface->header.rect.right - surface->header.rect.left;
@@ -1909,50 +2304,91 @@ static void x11drv_surface_flush( struct window_surface *window_surface )
 
         if (surface->is_argb || surface->color_key != CLR_INVALID) update_surface_region( surface );
 
-        if (src != dst)
+        if (!surface_can_diff( surface ))
         {
-            const int *mapping = NULL;
-            int width_bytes = surface->image->bytes_per_line;
+            damage = CreateRectRgnIndirect( &coords.visrect );
+
+            if (src != dst)
+            {
+                const int *mapping = NULL;
+                int width_bytes = surface->image->bytes_per_line;
 
-            if (surface->image->bits_per_pixel == 4 || surface->image->bits_per_pixel == 8)
-                mapping = X11DRV_PALETTE_PaletteToXPixel;
+                if (surface->image->bits_per_pixel == 4 || surface->image->bits_per_pixel == 8)
+                    mapping = X11DRV_PALETTE_PaletteToXPixel;
 
-            src += coords.visrect.top * width_bytes;
-            dst += coords.visrect.top * width_bytes;
-            copy_image_byteswap( &surface->info, src, dst, width_bytes, width_bytes,
-                                 coords.visrect.bottom - coords.visrect.top,
-                                 surface->byteswap, mapping, ~0u, surface->alpha_bits );
+                src += coords.visrect.top * width_bytes;
+                dst += coords.visrect.top * width_bytes;
+                copy_image_byteswap( &surface->info, src, dst, width_bytes, width_bytes,
+                                     coords.visrect.bottom - coords.visrect.top,
+                                     surface->byteswap, mapping, ~0u, surface->alpha_bits );
+            }
+            else if (surface->alpha_bits)
+            {
+                int x, y, stride = surface->image->bytes_per_line / sizeof(ULONG);
+                ULONG *ptr = (ULONG *)dst + coords.visrect.top * stride;
+
+                for (y = coords.visrect.top; y < coords.visrect.bottom; y++, ptr += stride)
+                    for (x = coords.visrect.left; x < coords.visrect.right; x++)
+                        ptr[x] |= surface->alpha_bits;
+            }
         }
-        else if (surface->alpha_bits)
+        else
         {
-            int x, y, stride = surface->image->bytes_per_line / sizeof(ULONG);
-            ULONG *ptr = (ULONG *)dst + coords.visrect.top * stride;
+            /* the first flush must send everything since the image contents are unknown */
+            if (!surface->image_valid)
+            {
+                SetRect( &coords.visrect, 0, 0, coords.width, coords.height );
+                damage = CreateRectRgnIndirect( &coords.visrect );
+                surface->image_valid = TRUE;
+            }
+            else damage = get_surface_damage( surface, &coords.visrect );
+        }
+    }
+
+    if (!IsRectEmpty( &surface->exposed ))
+    {
+        RECT rect;
+        HRGN tmp;
 
-            for (y = coords.visrect.top; y < coords.visrect.bottom; y++, ptr += stride)
-                for (x = coords.visrect.left; x < coords.visrect.right; x++)
-                    ptr[x] |= surface->alpha_bits;
+        SetRect( &rect, 0, 0, coords.width, coords.height );
+        if (IntersectRect( &rect, &rect, &surface->exposed ) && (tmp = CreateRectRgnIndirect( &rect )))
+        {
+            if (!damage) damage = tmp;
+            else
+            {
+                CombineRgn( damage, damage, tmp, RGN_OR );
+                DeleteObject( tmp );
+            }
         }
+        reset_bounds( &surface->exposed );
+    }
 
-#ifdef HAVE_LIBXXSHM
-        if (surface->shminfo.shmid != -1)
-            XShmPutImage( gdi_display, surface->window, surface->gc, surface->image,
-                          coords.visrect.left, coords.visrect.top,
-                          surface->header.rect.left + coords.visrect.left,
-                          surface->header.rect.top + coords.visrect.top,
-                          coords.visrect.right - coords.visrect.left,
-                          coords.visrect.bottom - coords.visrect.top, False );
-        else
-#endif
-        XPutImage( gdi_display, surface->window, surface->gc, surface->image,
-                   coords.visrect.left, coords.visrect.top,
-                   surface->header.rect.left + coords.visrect.left,
-                   surface->header.rect.top + coords.visrect.top,
-                   coords.visrect.right - coords.visrect.left,
-                   coords.visrect.bottom - coords.visrect.top );
-        XFlush( gdi_display );
+    if (damage && GetRgnBox( damage, &coords.visrect ) == NULLREGION)
+    {
+        DeleteObject( damage );
+        damage = 0;
+    }
+
+    if (damage)
+    {
+        if (surface_can_diff( surface ))
+        {
+            DWORD size = GetRegionData( damage, 0, NULL );
+            RGNDATA *data = HeapAlloc( GetProcessHeap(), 0, size );
+
+            if (data && GetRegionData( damage, size, data ))
+                copy_surface_damage( surface, (const RECT *)data->Buffer, data->rdh.nCount );
+            HeapFree( GetProcessHeap(), 0, data );
+        }
+        if (!queue_surface_damage( surface, damage ))
+        {
+            put_surface_region( surface, damage );
+            DeleteObject( damage );
+        }
     }
     reset_bounds( &surface->bounds );
     window_surface->funcs->unlock( window_surface );
+    if (use_shm) LeaveCriticalSection( &upload_section );
 }
 
 /***********************************************************************
@@ -1982,6 +2418,7 @@ static void x11drv_surface_destroy( struct window_surface *window_surface )
     surface->crit.DebugInfo->Spare[0] = 0;
     DeleteCriticalSection( &surface->crit );
     if (surface->region) DeleteObject( surface->region );
+    if (surface->pending) DeleteObject( surface->pending );
     HeapFree( GetProcessHeap(), 0, surface );
 }
 
@@ -2028,6 +2465,7 @@ struct window_surface *create_surface( Window window, const XVisualInfo *vis, co
     surface->is_argb = (use_alpha && vis->depth == 32 && surface->info.bmiHeader.biCompression == BI_RGB);
     set_color_key( surface, color_key );
     reset_bounds( &surface->bounds );
+    reset_bounds( &surface->exposed );
 
 #ifdef HAVE_LIBXXSHM
     surface->image = create_shm_image( vis, width, height, &surface->shminfo );
@@ -2048,14 +2486,11 @@ struct window_surface *create_surface( Window window, const XVisualInfo *vis, co
     if (vis->depth == 32 && !surface->is_argb)
         surface->alpha_bits = ~(vis->red_mask | vis->green_mask | vis->blue_mask);
 
-    if (surface->byteswap || format->bits_per_pixel == 4 || format->bits_per_pixel == 8)
-    {
-        /* allocate separate surface bits if byte swapping or palette mapping is required */
-        if (!(surface->bits  = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY,
-                                          surface->info.bmiHeader.biSizeImage )))
-            goto failed;
-    }
-    else surface->bits = surface->image->data;
+    /* the surface bits are always separate from the image, either for byte swapping
+     * and palette mapping, or to find the damaged areas by comparing with the image */
+    if (!(surface->bits  = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                      surface->info.bmiHeader.biSizeImage )))
+        goto failed;
 
     TRACE( "created %p for %lx %s bits %p-%p image %p\n", surface, window, wine_dbgstr_rect(rect),
            surface->bits, (char *)surface->bits + surface->info.bmiHeader.biSizeImage,
@@ -2068,6 +2503,29 @@ failed:
     return NULL;
 }
 
+/***********************************************************************
+ *           detach_surface_window
+ *
+ * Drop the damage that wasn't sent yet and stop sending updates to the window,
+ * before the window is destroyed or the surface is replaced.
+ */
+void detach_surface_window( struct window_surface *window_surface )
+{
+    struct x11drv_window_surface *surface = get_x11_surface( window_surface );
+
+    if (window_surface->funcs != &x11drv_surface_funcs) return;  /* we may get the null surface */
+
+    window_surface->funcs->lock( window_surface );
+    surface->window = 0;
+    if (surface->pending) DeleteObject( surface->pending );
+    surface->pending = 0;
+    window_surface->funcs->unlock( window_surface );
+
+    /* wait for a snapshot that is being sent */
+    EnterCriticalSection( &upload_section );
+    LeaveCriticalSection( &upload_section );
+}
+
 /***********************************************************************
  *           set_surface_color_key
  */
@@ -2099,6 +2557,7 @@ HRGN expose_surface( struct window_surface *window_surface, const RECT *rect )
     window_surface->funcs->lock( window_surface );
     OffsetRect( &rc, -window_surface->rect.left, -window_surface->rect.top );
     add_bounds_rect( &surface->bounds, &rc );
+    add_bounds_rect( &surface->exposed, &rc );
     if (surface->region)
     {
         region = CreateRectRgnIndirect( rect );
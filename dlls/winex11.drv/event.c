@@ -311,6 +311,33 @@ static enum event_merge_action merge_raw_motion_events( XIRawEvent *prev, XIRawE
 }
 #endif
 
+/***********************************************************************
+ *           merge_expose_events
+ *
+ * Fold the previous exposed area into the next one, as long as their
+ * bounding rectangle doesn't repaint much more than the two of them.
+ */
+static enum event_merge_action merge_expose_events( XExposeEvent *prev, XExposeEvent *next )
+{
+    int left   = min( prev->x, next->x );
+    int top    = min( prev->y, next->y );
+    int right  = max( prev->x + prev->width, next->x + next->width );
+    int bottom = max( prev->y + prev->height, next->y + next->height );
+    ULONGLONG area = (ULONGLONG)(right - left) * (bottom - top);
+
+    if (area > 2 * ((ULONGLONG)prev->width * prev->height + (ULONGLONG)next->width * next->height))
+        return MERGE_HANDLE;
+
+    TRACE( "merging Expose %d,%d %dx%d into %d,%d %dx%d for window %lx\n",
+           prev->x, prev->y, prev->width, prev->height,
+           next->x, next->y, next->width, next->height, prev->window );
+    next->x      = left;
+    next->y      = top;
+    next->width  = right - left;
+    next->height = bottom - top;
+    return MERGE_DISCARD;
+}
+
 /***********************************************************************
  *           merge_events
  *
@@ -335,6 +362,15 @@ static enum event_merge_action merge_events( XEvent *prev, XEvent *next )
             return MERGE_KEEP;
         }
         break;
+    case Expose:
+        switch (next->type)
+        {
+        case Expose:
+            if (prev->xany.window == next->xany.window)
+                return merge_expose_events( &prev->xexpose, &next->xexpose );
+            break;
+        }
+        break;
     case MotionNotify:
         switch (next->type)
         {
@@ -345,6 +381,9 @@ static enum event_merge_action merge_events( XEvent *prev, XEvent *next )
                 return MERGE_DISCARD;
             }
             break;
+        case Expose:
+            /* painting doesn't depend on the cursor, keep merging motion */
+            return MERGE_KEEP;
 #ifdef HAVE_X11_EXTENSIONS_XINPUT2_H
         case GenericEvent:
             if (next->xcookie.extension != xinput2_opcode) break;
@@ -407,12 +446,13 @@ static inline BOOL call_event_handler( Display *display, XEvent *event )
  */
 static BOOL process_events( Display *display, Bool (*filter)(Display*, XEvent*,XPointer), ULONG_PTR arg )
 {
-    XEvent event, prev_event;
+    XEvent event, prev_event, expose_event;
     int count = 0;
     BOOL queued = FALSE;
     enum event_merge_action action = MERGE_DISCARD;
 
     prev_event.type = 0;
+    expose_event.type = 0;  /* Expose kept behind prev_event, merged separately */
     while (XCheckIfEvent( display, &event, filter, (char *)arg ))
     {
         count++;
@@ -452,12 +492,22 @@ static BOOL process_events( Display *display, Bool (*filter)(Display*, XEvent*,X
         {
         case MERGE_HANDLE:  /* handle prev, keep new */
             queued |= call_event_handler( display, &prev_event );
+            if (expose_event.type) queued |= call_event_handler( display, &expose_event );
+            expose_event.type = 0;
             /* fall through */
         case MERGE_DISCARD:  /* discard prev, keep new */
             free_event_data( &prev_event );
             prev_event = event;
             break;
         case MERGE_KEEP:  /* handle new, keep prev for future merging */
+            if (event.type == Expose)
+            {
+                /* merge exposes received during a drag with each other instead */
+                if (expose_event.type && merge_events( &expose_event, &event ) == MERGE_HANDLE)
+                    queued |= call_event_handler( display, &expose_event );
+                expose_event = event;
+                break;
+            }
             queued |= call_event_handler( display, &event );
             /* fall through */
         case MERGE_IGNORE: /* ignore new, keep prev for future merging */
@@ -466,6 +516,7 @@ static BOOL process_events( Display *display, Bool (*filter)(Display*, XEvent*,X
         }
     }
     if (prev_event.type) queued |= call_event_handler( display, &prev_event );
+    if (expose_event.type) queued |= call_event_handler( display, &expose_event );
     free_event_data( &prev_event );
     XFlush( gdi_display );
     if (count) TRACE( "processed %d events, returning %d\n", count, queued );
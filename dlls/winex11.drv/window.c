@@ -1559,6 +1559,7 @@ static void destroy_whole_window( struct x11drv_win_data *data, BOOL already_des
 {
     TRACE( "win %p xwin %lx/%lx\n", data->hwnd, data->whole_window, data->client_window );
 
+    if (data->surface) detach_surface_window( data->surface );
     if (data->client_window) XDeleteContext( data->display, data->client_window, winContext );
 
     if (!data->whole_window)
@@ -1617,7 +1618,11 @@ void set_window_visual( struct x11drv_win_data *data, const XVisualInfo *vis, BO
     Window whole_window = data->whole_window;
 
     if (!data->use_alpha == !use_alpha) return;
-    if (data->surface) window_surface_release( data->surface );
+    if (data->surface)
+    {
+        detach_surface_window( data->surface );
+        window_surface_release( data->surface );
+    }
     data->surface = NULL;
     data->use_alpha = use_alpha;
 
@@ -2328,7 +2333,11 @@ void CDECL X11DRV_WindowPosChanged( HWND hwnd, HWND insert_after, UINT swp_flags
     if (data->vis.visualid == default_visual.visualid)
     {
         if (surface) window_surface_add_ref( surface );
-        if (data->surface) window_surface_release( data->surface );
+        if (data->surface)
+        {
+            if (data->surface != surface) detach_surface_window( data->surface );
+            window_surface_release( data->surface );
+        }
         data->surface = surface;
     }
 
@@ -2640,7 +2649,11 @@ BOOL CDECL X11DRV_UpdateLayeredWindow( HWND hwnd, const UPDATELAYEREDWINDOWINFO
     {
         data->surface = create_surface( data->whole_window, &data->vis, &rect,
                                         color_key, data->use_alpha );
-        if (surface) window_surface_release( surface );
+        if (surface)
+        {
+            detach_surface_window( surface );
+            window_surface_release( surface );
+        }
         surface = data->surface;
     }
     else set_surface_color_key( surface, color_key );
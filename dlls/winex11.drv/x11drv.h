@@ -204,6 +204,7 @@ extern DWORD get_pixmap_image( Pixmap pixmap, int width, int height, const XVisu
                                BITMAPINFO *info, struct gdi_image_bits *bits ) DECLSPEC_HIDDEN;
 extern struct window_surface *create_surface( Window window, const XVisualInfo *vis, const RECT *rect,
                                               COLORREF color_key, BOOL use_alpha ) DECLSPEC_HIDDEN;
+extern void detach_surface_window( struct window_surface *window_surface ) DECLSPEC_HIDDEN;
 extern void set_surface_color_key( struct window_surface *window_surface, COLORREF color_key ) DECLSPEC_HIDDEN;
 extern HRGN expose_surface( struct window_surface *window_surface, const RECT *rect ) DECLSPEC_HIDDEN;
 
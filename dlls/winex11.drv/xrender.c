@@ -127,6 +127,7 @@ typedef struct
     int nrealized;
     BOOL *realized;
     XGlyphInfo *gis;
+    SIZE_T glyph_bytes;  /* bitmap data uploaded to the server */
 } gsCacheEntryFormat;
 
 typedef struct
@@ -162,9 +163,15 @@ static gsCacheEntry *glyphsetCache = NULL;
 static DWORD glyphsetCacheSize = 0;
 static INT lastfree = -1;
 static INT mru = -1;
+static SIZE_T glyphsetCacheBytes = 0;
 
 #define INIT_CACHE_SIZE 10
 
+/* Unused glyphsets are kept around so that fonts re-selected by other DCs
+ * don't need to be uploaded again; these bound how much we keep. */
+#define MAX_UNUSED_ENTRIES 64
+#define MAX_CACHE_BYTES    (16 * 1024 * 1024)
+
 static void *xrender_handle;
 
 #define MAKE_FUNCPTR(f) static typeof(f) * p##f;
@@ -636,6 +643,7 @@ static void FreeEntry(int entry)
                 pXRenderFreeGlyphSet(gdi_display, formatEntry->glyphset);
                 formatEntry->glyphset = 0;
             }
+            glyphsetCacheBytes -= formatEntry->glyph_bytes;
             if(formatEntry->nrealized) {
                 HeapFree(GetProcessHeap(), 0, formatEntry->realized);
                 formatEntry->realized = NULL;
@@ -652,7 +660,7 @@ static void FreeEntry(int entry)
 
 static int AllocEntry(void)
 {
-  int best = -1, prev_best = -1, i, prev_i = -1;
+  int best = -1, prev_best = -1, i, prev_i = -1, unused = 0;
 
   if(lastfree >= 0) {
     assert(glyphsetCache[lastfree].count == -1);
@@ -671,11 +679,13 @@ static int AllocEntry(void)
     if(glyphsetCache[i].count == 0) {
       best = i;
       prev_best = prev_i;
+      unused++;
     }
     prev_i = i;
   }
 
-  if(best >= 0) {
+  /* only recycle the least recently used glyphset once enough are retained */
+  if(best >= 0 && (unused >= MAX_UNUSED_ENTRIES || glyphsetCacheBytes > MAX_CACHE_BYTES)) {
     TRACE("freeing unused glyphset at cache %d\n", best);
     FreeEntry(best);
     glyphsetCache[best].count = 1;
@@ -730,12 +740,44 @@ static int GetCacheEntry( LFANDSIZE *plfsz )
     return ret;
 }
 
+/* release least recently used glyphsets that no DC references until the
+ * server memory they hold is back under the limit */
+static void shrink_cache(void)
+{
+    int i, prev_i, best, prev_best;
+
+    while (glyphsetCacheBytes > MAX_CACHE_BYTES)
+    {
+        best = prev_best = prev_i = -1;
+        for (i = mru; i >= 0; i = glyphsetCache[i].next)
+        {
+            if (glyphsetCache[i].count == 0)
+            {
+                best = i;
+                prev_best = prev_i;
+            }
+            prev_i = i;
+        }
+        if (best < 0) break;
+
+        TRACE( "evicting glyphset at cache %d, %lu bytes cached\n",
+               best, (unsigned long)glyphsetCacheBytes );
+        FreeEntry( best );
+        if (prev_best >= 0) glyphsetCache[prev_best].next = glyphsetCache[best].next;
+        else mru = glyphsetCache[best].next;
+        glyphsetCache[best].count = -1;
+        glyphsetCache[best].next = lastfree;
+        lastfree = best;
+    }
+}
+
 static void dec_ref_cache(int index)
 {
     assert(index >= 0);
     TRACE("dec'ing entry %d to %d\n", index, glyphsetCache[index].count - 1);
     assert(glyphsetCache[index].count > 0);
     glyphsetCache[index].count--;
+    if (!glyphsetCache[index].count) shrink_cache();
 }
 
 static void lfsz_calc_hash(LFANDSIZE *plfsz)
@@ -1209,6 +1251,8 @@ static void UploadGlyph(struct xrender_physdev *physDev, UINT glyph, enum glyph_
 
 	pXRenderAddGlyphs(gdi_display, formatEntry->glyphset, &gid, &gi, 1,
                           buflen ? buf : zero, buflen ? buflen : sizeof(zero));
+        formatEntry->glyph_bytes += buflen ? buflen : sizeof(zero);
+        glyphsetCacheBytes += buflen ? buflen : sizeof(zero);
     }
 
     HeapFree(GetProcessHeap(), 0, buf);
@@ -1308,7 +1352,8 @@ static BOOL xrenderdrv_ExtTextOut( PHYSDEV dev, INT x, INT y, UINT flags,
     struct xrender_physdev *physdev = get_xrender_dev( dev );
     gsCacheEntry *entry;
     gsCacheEntryFormat *formatEntry;
-    unsigned int idx;
+    unsigned int idx, nelts, uploaded = 0;
+    unsigned long first_request;
     Picture pict, tile_pict = 0;
     XGlyphElt16 *elts;
     POINT offset, desired, current;
@@ -1343,16 +1388,19 @@ static BOOL xrenderdrv_ExtTextOut( PHYSDEV dev, INT x, INT y, UINT flags,
 
     EnterCriticalSection(&xrender_cs);
 
+    first_request = NextRequest( gdi_display );
     entry = glyphsetCache + physdev->cache_index;
     formatEntry = entry->format[type][aa_type_from_flags( physdev->aa_flags )];
 
     for(idx = 0; idx < count; idx++) {
         if( !formatEntry ) {
 	    UploadGlyph(physdev, wstr[idx], type);
+            uploaded++;
             /* re-evaluate format entry since aa_flags may have changed */
             formatEntry = entry->format[type][aa_type_from_flags( physdev->aa_flags )];
         } else if( wstr[idx] >= formatEntry->nrealized || formatEntry->realized[wstr[idx]] == FALSE) {
 	    UploadGlyph(physdev, wstr[idx], type);
+            uploaded++;
 	}
     }
     if (!formatEntry)
@@ -1383,17 +1431,26 @@ static BOOL xrenderdrv_ExtTextOut( PHYSDEV dev, INT x, INT y, UINT flags,
     if (physdev->format == WXR_FORMAT_MONO && col.red == 0 && col.green == 0 && col.blue == 0)
         render_op = PictOpOutReverse; /* This gives us 'black' text */
 
+    /* Glyphs that land where the previous advance left the pen share an
+       element, so that plain strings go out as a single run. */
     reset_bounds( &bounds );
+    nelts = 0;
     for(idx = 0; idx < count; idx++)
     {
-        elts[idx].glyphset = formatEntry->glyphset;
-        elts[idx].chars = wstr + idx;
-        elts[idx].nchars = 1;
-        elts[idx].xOff = desired.x - current.x;
-        elts[idx].yOff = desired.y - current.y;
+        if (!nelts || desired.x != current.x || desired.y != current.y)
+        {
+            elts[nelts].glyphset = formatEntry->glyphset;
+            elts[nelts].chars = wstr + idx;
+            elts[nelts].nchars = 0;
+            elts[nelts].xOff = desired.x - current.x;
+            elts[nelts].yOff = desired.y - current.y;
+            current = desired;
+            nelts++;
+        }
+        elts[nelts - 1].nchars++;
 
-        current.x += (elts[idx].xOff + formatEntry->gis[wstr[idx]].xOff);
-        current.y += (elts[idx].yOff + formatEntry->gis[wstr[idx]].yOff);
+        current.x += formatEntry->gis[wstr[idx]].xOff;
+        current.y += formatEntry->gis[wstr[idx]].yOff;
 
         rect.left   = desired.x - physdev->x11dev->dc_rect.left - formatEntry->gis[wstr[idx]].x;
         rect.top    = desired.y - physdev->x11dev->dc_rect.top - formatEntry->gis[wstr[idx]].y;
@@ -1426,9 +1483,11 @@ static BOOL xrenderdrv_ExtTextOut( PHYSDEV dev, INT x, INT y, UINT flags,
                             tile_pict,
                             pict,
                             formatEntry->font_format,
-                            0, 0, 0, 0, elts, count);
+                            0, 0, 0, 0, elts, nelts);
     HeapFree(GetProcessHeap(), 0, elts);
 
+    TRACE("%u glyphs in %u runs, %u uploaded, %lu X requests\n",
+          count, nelts, uploaded, NextRequest( gdi_display ) - first_request);
     LeaveCriticalSection(&xrender_cs);
     add_device_bounds( physdev->x11dev, &bounds );
     return TRUE;
@@ -0,0 +1,96 @@
+/*
+ * Wine-specific heap statistics
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_WINE_HEAPSTATS_H
+#define __WINE_WINE_HEAPSTATS_H
+
+/* Wine-specific information classes for RtlQueryHeapInformation */
+#define HeapWineStatistics       ((HEAP_INFORMATION_CLASS)0x5701)  /* struct wine_heap_statistics */
+#define HeapWineAllocationSites  ((HEAP_INFORMATION_CLASS)0x5702)  /* struct wine_heap_sites */
+
+/* size class n holds the blocks with a requested size between 2^(n-1) and 2^n - 1,
+ * the last class holds everything larger */
+#define WINE_HEAP_SIZE_CLASSES  32
+
+struct wine_heap_size_class
+{
+    SIZE_T             blocks;         /* number of blocks currently allocated */
+    SIZE_T             bytes;          /* bytes requested by these blocks */
+    ULONGLONG          allocs;         /* total number of allocations */
+};
+
+struct wine_heap_statistics
+{
+    HANDLE             heap;           /* heap handle */
+    DWORD              flags;          /* HEAP_* flags */
+    DWORD              subheaps;       /* number of sub-heaps */
+    SIZE_T             reserved;       /* address space reserved by the sub-heaps */
+    SIZE_T             committed;      /* memory committed by the sub-heaps */
+    SIZE_T             free;           /* free space in the sub-heaps, committed or not */
+    SIZE_T             free_blocks;    /* number of free blocks */
+    SIZE_T             largest_free;   /* largest free block */
+    SIZE_T             large_blocks;   /* number of blocks allocated directly from virtual memory */
+    SIZE_T             large_size;     /* memory used by these blocks */
+    SIZE_T             in_use;         /* bytes requested by all allocated blocks */
+    SIZE_T             in_use_blocks;  /* number of allocated blocks */
+    ULONGLONG          allocs;         /* total number of allocations */
+    ULONGLONG          frees;          /* total number of frees */
+    ULONGLONG          reallocs;       /* total number of reallocations */
+    struct wine_heap_size_class classes[WINE_HEAP_SIZE_CLASSES];
+};
+
+/* allocation sites are only recorded when WINEHEAPPROFILE is set to the sampling rate */
+#define WINE_HEAP_SITE_FRAMES  16
+
+struct wine_heap_site
+{
+    HANDLE             heap;           /* heap the blocks were allocated from */
+    ULONG              frames;         /* number of valid entries in stack */
+    ULONG              reserved;
+    ULONGLONG          allocs;         /* number of sampled allocations */
+    ULONGLONG          bytes;          /* bytes requested by the sampled allocations */
+    SIZE_T             live_blocks;    /* sampled blocks that are still allocated */
+    SIZE_T             live_bytes;     /* bytes requested by these blocks */
+    void              *stack[WINE_HEAP_SITE_FRAMES];  /* return addresses, innermost first */
+};
+
+struct wine_heap_sites
+{
+    ULONG              rate;           /* one allocation out of 'rate' is sampled, 0 if disabled */
+    ULONG              count;          /* number of sites */
+    ULONG              dropped;        /* samples lost because the tables were full */
+    ULONG              reserved;
+    struct wine_heap_site sites[1];
+};
+
+/* Snapshot of all the process heaps, filled by __wine_heap_snapshot in the target
+ * process. The header is followed by 'heaps' wine_heap_statistics structures and
+ * 'sites' wine_heap_site structures. */
+struct wine_heap_snapshot
+{
+    ULONG              size;           /* [in] size of the whole buffer */
+    ULONG              needed;         /* [out] size needed for a complete snapshot */
+    ULONG              heaps;          /* [out] number of heaps */
+    ULONG              sites;          /* [out] number of allocation sites */
+    ULONG              rate;           /* [out] sampling rate */
+    ULONG              dropped;        /* [out] samples lost because the tables were full */
+};
+
+extern DWORD WINAPI __wine_heap_snapshot( void *snapshot );
+
+#endif  /* __WINE_WINE_HEAPSTATS_H */
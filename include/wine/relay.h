@@ -0,0 +1,66 @@
+/*
+ * Binary relay trace file format
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_WINE_RELAY_H
+#define __WINE_WINE_RELAY_H
+
+/* The file starts with a relay_trace_header, followed by a sequence of blocks.
+ * Each block is a relay_trace_block header followed by 'size' bytes of data. */
+
+#define RELAY_TRACE_MAGIC    0x594c5257  /* 'WRLY' */
+#define RELAY_TRACE_VERSION  1
+
+struct relay_trace_header
+{
+    DWORD              magic;      /* RELAY_TRACE_MAGIC */
+    DWORD              version;    /* RELAY_TRACE_VERSION */
+    DWORD              pid;        /* Windows process id */
+    DWORD              reserved;
+    ULONGLONG          frequency;  /* timestamp ticks per second */
+};
+
+enum relay_block_type
+{
+    RELAY_BLOCK_MODULE = 1,   /* module names: ordinal base, dll name, then 'count' entry point names */
+    RELAY_BLOCK_RECORDS = 2   /* 'count' relay_trace_record structures for thread 'id' */
+};
+
+struct relay_trace_block
+{
+    DWORD              type;       /* enum relay_block_type */
+    DWORD              id;         /* module index or thread id */
+    DWORD              count;      /* number of names or records */
+    DWORD              size;       /* size of the data following the header */
+};
+
+enum relay_record_type
+{
+    RELAY_RECORD_CALL = 1,
+    RELAY_RECORD_RET = 2
+};
+
+struct relay_trace_record
+{
+    WORD               type;       /* enum relay_record_type */
+    WORD               module;     /* module index */
+    DWORD              ordinal;    /* entry point index, without the ordinal base */
+    ULONGLONG          time;       /* timestamp */
+    ULONGLONG          value;      /* return address for calls, return value for returns */
+};
+
+#endif  /* __WINE_WINE_RELAY_H */
@@ -49,7 +49,15 @@ struct __server_request_info
     struct __server_iovec data[__SERVER_MAX_DATA];  /* request variable size data */
 };
 
+struct __server_batch
+{
+    unsigned int                  count;                       /* number of requests */
+    struct batch_header           headers[MAX_BATCH_REQUESTS]; /* per-request batch headers */
+    struct __server_request_info *reqs[MAX_BATCH_REQUESTS];    /* requests to execute in order */
+};
+
 extern unsigned int wine_server_call( void *req_ptr );
+extern unsigned int CDECL wine_server_call_batch( struct __server_batch *batch );
 extern void CDECL wine_server_send_fd( int fd );
 extern int CDECL wine_server_fd_to_handle( int fd, unsigned int access, unsigned int attributes, HANDLE *handle );
 extern int CDECL wine_server_handle_to_fd( HANDLE handle, unsigned int access, int *unix_fd, unsigned int *options );
@@ -89,6 +97,36 @@ static inline void wine_server_set_reply( void *req_ptr, void *ptr, data_size_t
     req->u.req.request_header.reply_size = max_size;
 }
 
+/* initialize an empty batch of requests */
+static inline void wine_server_batch_init( struct __server_batch *batch )
+{
+    batch->count = 0;
+}
+
+/* add a request to a batch; returns the request structure to fill */
+static inline void *wine_server_batch_add( struct __server_batch *batch,
+                                           struct __server_request_info *req, enum request type )
+{
+    static const union generic_request empty_request;
+    static const struct batch_header empty_header;
+
+    req->u.req = empty_request;
+    req->u.req.request_header.req = type;
+    req->data_count = 0;
+    req->reply_data = NULL;
+    batch->headers[batch->count] = empty_header;
+    batch->reqs[batch->count++] = req;
+    return &req->u.req;
+}
+
+/* pass a handle returned by the previous request of a batch to the last added request */
+static inline void wine_server_batch_link( struct __server_batch *batch,
+                                           unsigned int req_offset, unsigned int reply_offset )
+{
+    batch->headers[batch->count - 1].link_req = req_offset;
+    batch->headers[batch->count - 1].link_reply = reply_offset;
+}
+
 /* convert an object handle to a server handle */
 static inline obj_handle_t wine_server_obj_handle( HANDLE handle )
 {
@@ -43,6 +43,16 @@ struct reply_header
     data_size_t  reply_size;
 };
 
+/* header of a request in a batch, followed by the request structure and its variable
+ * part padded to a multiple of 8 bytes; the replies are stored the same way without header */
+struct batch_header
+{
+    unsigned short link_req;
+    unsigned short link_reply;
+    unsigned int   __pad;
+};
+#define MAX_BATCH_REQUESTS 16
+
 
 
 struct request_max_size
@@ -5784,6 +5794,22 @@ struct resume_process_reply
 };
 
 
+
+struct batch_request
+{
+    struct request_header __header;
+    /* VARARG(requests,bytes); */
+    char __pad_12[4];
+};
+struct batch_reply
+{
+    struct reply_header __header;
+    unsigned int count;
+    /* VARARG(replies,bytes); */
+    char __pad_12[4];
+};
+
+
 enum request
 {
     REQ_new_process,
@@ -6084,6 +6110,7 @@ enum request
     REQ_terminate_job,
     REQ_suspend_process,
     REQ_resume_process,
+    REQ_batch,
     REQ_NB_REQUESTS
 };
 
@@ -6389,6 +6416,7 @@ union generic_request
     struct terminate_job_request terminate_job_request;
     struct suspend_process_request suspend_process_request;
     struct resume_process_request resume_process_request;
+    struct batch_request batch_request;
 };
 union generic_reply
 {
@@ -6692,8 +6720,9 @@ union generic_reply
     struct terminate_job_reply terminate_job_reply;
     struct suspend_process_reply suspend_process_reply;
     struct resume_process_reply resume_process_reply;
+    struct batch_reply batch_reply;
 };
 
-#define SERVER_PROTOCOL_VERSION 583
+#define SERVER_PROTOCOL_VERSION 584
 
 #endif /* __WINE_WINE_SERVER_PROTOCOL_H */
@@ -2643,6 +2643,7 @@ void * __cdecl wined3d_shader_get_parent(const struct wined3d_shader *shader);
 ULONG __cdecl wined3d_shader_incref(struct wined3d_shader *shader);
 HRESULT __cdecl wined3d_shader_set_local_constants_float(struct wined3d_shader *shader,
         UINT start_idx, const float *src_data, UINT vector4f_count);
+HRESULT __cdecl wined3d_shader_translate(struct wined3d_shader *shader, char *source, unsigned int *source_size);
 
 HRESULT __cdecl wined3d_shader_resource_view_create(const struct wined3d_view_desc *desc,
         struct wined3d_resource *resource, void *parent, const struct wined3d_parent_ops *parent_ops,
@@ -0,0 +1,60 @@
+/*
+ * Layout of the wined3d frame statistics shared memory block
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_WINE_WINED3D_STATS_H
+#define __WINE_WINE_WINED3D_STATS_H
+
+/* When WINE_D3D_FRAME_STATS is set, wined3d publishes its per-frame timings
+ * in a named file mapping of that name. When WINE_D3D_FRAME_LOG is set, the
+ * same data is appended to a CSV file at that path. */
+
+#define WINED3D_FRAME_STATS_MAGIC    0x53463344  /* "D3FS" */
+#define WINED3D_FRAME_STATS_VERSION  1
+#define WINED3D_FRAME_STATS_HISTORY  64
+#define WINED3D_FRAME_STATS_MAX_OPS  64
+
+struct wined3d_frame_record
+{
+    ULONGLONG          frame;          /* frame number, starting at 1 */
+    float              present_ms;     /* application thread present to present interval */
+    float              stall_ms;       /* application thread time spent waiting for the CS thread */
+    float              cs_busy_ms;     /* CS thread time spent executing commands */
+    float              cs_present_ms;  /* CS thread present to present interval */
+    float              gpu_ms;         /* GPU time between the two most recent timestamps, 0 if unknown */
+    DWORD              ops;            /* number of commands executed */
+};
+
+struct wined3d_frame_op_record
+{
+    char               name[40];       /* command name */
+    float              ms;             /* time spent executing the command in the last frame */
+    DWORD              count;          /* number of commands executed in the last frame */
+};
+
+struct wined3d_frame_stats_block
+{
+    DWORD              magic;          /* WINED3D_FRAME_STATS_MAGIC */
+    DWORD              version;        /* WINED3D_FRAME_STATS_VERSION */
+    LONG               sequence;       /* odd while the block is being updated */
+    DWORD              op_count;       /* number of valid entries in ops */
+    ULONGLONG          frame;          /* number of the most recent frame */
+    struct wined3d_frame_record records[WINED3D_FRAME_STATS_HISTORY];  /* indexed by frame % history */
+    struct wined3d_frame_op_record ops[WINED3D_FRAME_STATS_MAX_OPS];
+};
+
+#endif  /* __WINE_WINE_WINED3D_STATS_H */
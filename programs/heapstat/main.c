@@ -0,0 +1,258 @@
+/*
+ * Dump the heap statistics of a running process
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#define WIN32_LEAN_AND_MEAN
+
+#include <windows.h>
+#include <winternl.h>
+#include <psapi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wine/heapstats.h"
+
+struct module
+{
+    char   name[MAX_PATH];
+    char  *base;
+    DWORD  size;
+};
+
+static HANDLE process;
+static struct module *modules;
+static DWORD nb_modules;
+static unsigned int max_sites = 20;
+
+static void usage(void)
+{
+    printf( "Usage: heapstat [-n count] pid\n\n" );
+    printf( "Print the heap statistics of a running process.\n" );
+    printf( "The process must run with WINEHEAPPROFILE=<rate> for allocation sites to be\n" );
+    printf( "recorded; the <count> sites holding the most memory are printed (default 20).\n" );
+    exit( 1 );
+}
+
+static BOOL load_modules(void)
+{
+    HMODULE *handles;
+    MODULEINFO info;
+    DWORD i, size;
+
+    if (!EnumProcessModules( process, NULL, 0, &size )) return FALSE;
+    handles = malloc( size );
+    if (!EnumProcessModules( process, handles, size, &size )) return FALSE;
+    nb_modules = size / sizeof(*handles);
+    modules = calloc( nb_modules, sizeof(*modules) );
+    for (i = 0; i < nb_modules; i++)
+    {
+        if (!GetModuleInformation( process, handles[i], &info, sizeof(info) )) continue;
+        GetModuleBaseNameA( process, handles[i], modules[i].name, sizeof(modules[i].name) );
+        modules[i].base = info.lpBaseOfDll;
+        modules[i].size = info.SizeOfImage;
+    }
+    free( handles );
+    return TRUE;
+}
+
+static const struct module *find_module( const void *addr )
+{
+    DWORD i;
+
+    for (i = 0; i < nb_modules; i++)
+        if ((const char *)addr >= modules[i].base && (const char *)addr < modules[i].base + modules[i].size)
+            return &modules[i];
+    return NULL;
+}
+
+/* locate __wine_heap_snapshot in the target, ntdll is the same binary in all processes */
+static LPTHREAD_START_ROUTINE get_snapshot_func(void)
+{
+    HMODULE ntdll = GetModuleHandleA( "ntdll.dll" );
+    char *func = (char *)GetProcAddress( ntdll, "__wine_heap_snapshot" );
+    DWORD i;
+
+    if (!func) return NULL;
+    for (i = 0; i < nb_modules; i++)
+        if (!lstrcmpiA( modules[i].name, "ntdll.dll" ))
+            return (LPTHREAD_START_ROUTINE)(modules[i].base + (func - (char *)ntdll));
+    return NULL;
+}
+
+static struct wine_heap_snapshot *get_snapshot(void)
+{
+    LPTHREAD_START_ROUTINE func = get_snapshot_func();
+    struct wine_heap_snapshot *snapshot;
+    ULONG size = 0x10000;
+    HANDLE thread;
+    DWORD status;
+    void *remote;
+
+    if (!func)
+    {
+        fprintf( stderr, "heapstat: ntdll not found in the target process\n" );
+        return NULL;
+    }
+
+    for (;;)
+    {
+        if (!(remote = VirtualAllocEx( process, NULL, size, MEM_COMMIT, PAGE_READWRITE ))) return NULL;
+        WriteProcessMemory( process, remote, &size, sizeof(size), NULL );
+        if (!(thread = CreateRemoteThread( process, NULL, 0, func, remote, 0, NULL )))
+        {
+            VirtualFreeEx( process, remote, 0, MEM_RELEASE );
+            return NULL;
+        }
+        WaitForSingleObject( thread, INFINITE );
+        GetExitCodeThread( thread, &status );
+        CloseHandle( thread );
+
+        snapshot = malloc( size );
+        ReadProcessMemory( process, remote, snapshot, size, NULL );
+        VirtualFreeEx( process, remote, 0, MEM_RELEASE );
+
+        if (status == STATUS_SUCCESS) return snapshot;
+        if (status != STATUS_BUFFER_TOO_SMALL || snapshot->needed <= size)
+        {
+            fprintf( stderr, "heapstat: snapshot failed with status %08x\n", status );
+            free( snapshot );
+            return NULL;
+        }
+        /* leave some room for the allocations made in the meantime */
+        size = snapshot->needed + snapshot->needed / 4;
+        free( snapshot );
+    }
+}
+
+static void dump_heap( const struct wine_heap_statistics *stats )
+{
+    unsigned int i;
+
+    printf( "Heap %p flags %08x\n", stats->heap, stats->flags );
+    printf( "  reserved %I64u, committed %I64u in %u sub-heaps\n",
+            (ULONGLONG)stats->reserved, (ULONGLONG)stats->committed, stats->subheaps );
+    printf( "  in use %I64u bytes in %I64u blocks, %I64u large blocks using %I64u bytes\n",
+            (ULONGLONG)stats->in_use, (ULONGLONG)stats->in_use_blocks,
+            (ULONGLONG)stats->large_blocks, (ULONGLONG)stats->large_size );
+    printf( "  free %I64u bytes in %I64u blocks, largest %I64u, fragmentation %.1f%%\n",
+            (ULONGLONG)stats->free, (ULONGLONG)stats->free_blocks, (ULONGLONG)stats->largest_free,
+            stats->free ? 100.0 - 100.0 * stats->largest_free / stats->free : 0.0 );
+    printf( "  %I64u allocs, %I64u frees, %I64u reallocs\n", stats->allocs, stats->frees, stats->reallocs );
+
+    printf( "  %12s %12s %14s %12s\n", "size <=", "blocks", "bytes", "allocs" );
+    for (i = 0; i < WINE_HEAP_SIZE_CLASSES; i++)
+    {
+        const struct wine_heap_size_class *class = &stats->classes[i];
+
+        if (!class->allocs && !class->blocks) continue;
+        if (i < WINE_HEAP_SIZE_CLASSES - 1)
+            printf( "  %12I64u", ((ULONGLONG)1 << i) - 1 );
+        else
+            printf( "  %12s", "larger" );
+        printf( " %12I64u %14I64u %12I64u\n", (ULONGLONG)class->blocks,
+                (ULONGLONG)class->bytes, class->allocs );
+    }
+    printf( "\n" );
+}
+
+static int __cdecl compare_sites( const void *a, const void *b )
+{
+    const struct wine_heap_site *site1 = a, *site2 = b;
+
+    if (site1->live_bytes != site2->live_bytes) return site1->live_bytes > site2->live_bytes ? -1 : 1;
+    if (site1->bytes != site2->bytes) return site1->bytes > site2->bytes ? -1 : 1;
+    return 0;
+}
+
+static void dump_sites( const struct wine_heap_snapshot *snapshot, struct wine_heap_site *sites )
+{
+    const struct module *module;
+    unsigned int i, j;
+
+    if (!snapshot->rate)
+    {
+        printf( "Allocation sites are not recorded, run the process with WINEHEAPPROFILE=<rate>\n" );
+        return;
+    }
+
+    printf( "Allocation sites, one allocation out of %u sampled", snapshot->rate );
+    if (snapshot->dropped) printf( ", %u samples dropped", snapshot->dropped );
+    printf( "\n\n" );
+
+    qsort( sites, snapshot->sites, sizeof(*sites), compare_sites );
+    for (i = 0; i < snapshot->sites && i < max_sites; i++)
+    {
+        printf( "Heap %p: ~%I64u bytes live in ~%I64u blocks, ~%I64u bytes in ~%I64u allocations\n",
+                sites[i].heap, (ULONGLONG)sites[i].live_bytes * snapshot->rate,
+                (ULONGLONG)sites[i].live_blocks * snapshot->rate,
+                sites[i].bytes * snapshot->rate, sites[i].allocs * snapshot->rate );
+        for (j = 0; j < sites[i].frames && j < WINE_HEAP_SITE_FRAMES; j++)
+        {
+            if ((module = find_module( sites[i].stack[j] )))
+                printf( "    %s+0x%x\n", module->name, (unsigned int)((char *)sites[i].stack[j] - module->base) );
+            else
+                printf( "    %p\n", sites[i].stack[j] );
+        }
+        printf( "\n" );
+    }
+}
+
+int main( int argc, char *argv[] )
+{
+    struct wine_heap_snapshot *snapshot;
+    struct wine_heap_statistics *stats;
+    BOOL wow64, target_wow64;
+    DWORD pid = 0;
+    unsigned int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!strcmp( argv[i], "-n" ) && i + 1 < argc) max_sites = atoi( argv[++i] );
+        else if (argv[i][0] == '-' || pid) usage();
+        else pid = strtoul( argv[i], NULL, 0 );
+    }
+    if (!pid) usage();
+
+    if (!(process = OpenProcess( PROCESS_CREATE_THREAD | PROCESS_QUERY_INFORMATION |
+                                 PROCESS_VM_OPERATION | PROCESS_VM_READ | PROCESS_VM_WRITE, FALSE, pid )))
+    {
+        fprintf( stderr, "heapstat: cannot open process %04x, error %u\n", pid, GetLastError() );
+        return 1;
+    }
+    if (IsWow64Process( GetCurrentProcess(), &wow64 ) && IsWow64Process( process, &target_wow64 ) &&
+        wow64 != target_wow64)
+    {
+        fprintf( stderr, "heapstat: process %04x has a different architecture\n", pid );
+        return 1;
+    }
+    if (!load_modules() || !(snapshot = get_snapshot()))
+    {
+        fprintf( stderr, "heapstat: cannot get the heaps of process %04x, error %u\n", pid, GetLastError() );
+        return 1;
+    }
+
+    stats = (struct wine_heap_statistics *)(snapshot + 1);
+    for (i = 0; i < snapshot->heaps; i++) if (stats[i].heap) dump_heap( &stats[i] );
+    dump_sites( snapshot, (struct wine_heap_site *)(stats + snapshot->heaps) );
+
+    free( snapshot );
+    CloseHandle( process );
+    return 0;
+}
@@ -0,0 +1,359 @@
+/*
+ * Translate shader bytecode with wined3d and time the translation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "config.h"
+#include "wine/port.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COBJMACROS
+#include "windef.h"
+#include "winbase.h"
+#include "wingdi.h"
+#include "winuser.h"
+#include "objbase.h"
+
+#include "wine/wined3d.h"
+
+#define MAKE_TAG(ch0, ch1, ch2, ch3) \
+    ((DWORD)(ch0) | ((DWORD)(ch1) << 8) | ((DWORD)(ch2) << 16) | ((DWORD)(ch3) << 24))
+#define TAG_DXBC MAKE_TAG('D', 'X', 'B', 'C')
+#define TAG_SHDR MAKE_TAG('S', 'H', 'D', 'R')
+#define TAG_SHEX MAKE_TAG('S', 'H', 'E', 'X')
+
+enum shader_type
+{
+    SHADER_TYPE_UNKNOWN,
+    SHADER_TYPE_VERTEX,
+    SHADER_TYPE_PIXEL,
+};
+
+static struct wined3d_device *device;
+static unsigned int iterations = 10;
+static const char *output_dir;
+
+static void usage(void)
+{
+    printf( "Usage: shadertranslate [-n count] [-o dir] [-r state=value]... file...\n\n" );
+    printf( "Translate D3D9 or DXBC vertex and pixel shader bytecode with wined3d, and\n" );
+    printf( "print the time spent creating and translating each shader.\n\n" );
+    printf( "  -n count        translate each shader count times (default 10)\n" );
+    printf( "  -o dir          write the generated code to dir\\<file>.glsl\n" );
+    printf( "  -r state=value  set the wined3d render state 'state' before translating,\n" );
+    printf( "                  this selects the compile args the shaders are translated for\n" );
+    exit( 1 );
+}
+
+static void __stdcall null_object_destroyed( void *parent ) {}
+
+static const struct wined3d_parent_ops null_parent_ops =
+{
+    null_object_destroyed,
+};
+
+static void CDECL device_parent_wined3d_device_created( struct wined3d_device_parent *device_parent,
+        struct wined3d_device *wined3d_device )
+{
+    device = wined3d_device;
+}
+
+static void CDECL device_parent_mode_changed( struct wined3d_device_parent *device_parent ) {}
+
+static void CDECL device_parent_activate( struct wined3d_device_parent *device_parent, BOOL activate ) {}
+
+static HRESULT CDECL device_parent_texture_sub_resource_created( struct wined3d_device_parent *device_parent,
+        enum wined3d_resource_type type, struct wined3d_texture *texture, unsigned int sub_resource_idx,
+        void **parent, const struct wined3d_parent_ops **parent_ops )
+{
+    *parent = NULL;
+    *parent_ops = &null_parent_ops;
+    return S_OK;
+}
+
+static HRESULT CDECL device_parent_create_swapchain_texture( struct wined3d_device_parent *device_parent,
+        void *container_parent, const struct wined3d_resource_desc *desc, DWORD texture_flags,
+        struct wined3d_texture **texture )
+{
+    return wined3d_texture_create( device, desc, 1, 1, texture_flags, NULL, NULL, &null_parent_ops, texture );
+}
+
+static const struct wined3d_device_parent_ops device_parent_ops =
+{
+    device_parent_wined3d_device_created,
+    device_parent_mode_changed,
+    device_parent_activate,
+    device_parent_texture_sub_resource_created,
+    device_parent_create_swapchain_texture,
+};
+
+static struct wined3d_device_parent device_parent = {&device_parent_ops};
+
+static struct wined3d_swapchain *create_device( struct wined3d *wined3d, HWND window )
+{
+    static const enum wined3d_feature_level feature_levels[] =
+    {
+        WINED3D_FEATURE_LEVEL_11_1,
+        WINED3D_FEATURE_LEVEL_11,
+        WINED3D_FEATURE_LEVEL_10_1,
+        WINED3D_FEATURE_LEVEL_10,
+        WINED3D_FEATURE_LEVEL_9_SM3,
+        WINED3D_FEATURE_LEVEL_9_SM2,
+        WINED3D_FEATURE_LEVEL_9_1,
+    };
+    struct wined3d_swapchain_desc desc;
+    struct wined3d_swapchain *swapchain;
+    struct wined3d_device *wined3d_device;
+    HRESULT hr;
+
+    if (FAILED(hr = wined3d_device_create( wined3d, 0, WINED3D_DEVICE_TYPE_HAL, window, 0, 4,
+            feature_levels, ARRAY_SIZE(feature_levels), &device_parent, &wined3d_device )))
+    {
+        fprintf( stderr, "shadertranslate: failed to create the device, hr %#x\n", hr );
+        return NULL;
+    }
+
+    memset( &desc, 0, sizeof(desc) );
+    desc.backbuffer_width = 64;
+    desc.backbuffer_height = 64;
+    desc.backbuffer_format = WINED3DFMT_B8G8R8A8_UNORM;
+    desc.backbuffer_count = 1;
+    desc.backbuffer_bind_flags = WINED3D_BIND_RENDER_TARGET;
+    desc.swap_effect = WINED3D_SWAP_EFFECT_DISCARD;
+    desc.device_window = window;
+    desc.windowed = TRUE;
+    desc.flags = WINED3D_SWAPCHAIN_IMPLICIT;
+
+    if (FAILED(hr = wined3d_swapchain_create( wined3d_device, &desc, NULL, &null_parent_ops, &swapchain )))
+    {
+        fprintf( stderr, "shadertranslate: failed to create the swapchain, hr %#x\n", hr );
+        wined3d_device_decref( wined3d_device );
+        return NULL;
+    }
+    return swapchain;
+}
+
+static void *load_file( const char *name, SIZE_T *size )
+{
+    FILE *file;
+    void *data;
+    long len;
+
+    if (!(file = fopen( name, "rb" ))) return NULL;
+    fseek( file, 0, SEEK_END );
+    len = ftell( file );
+    fseek( file, 0, SEEK_SET );
+    if (len <= 0 || !(data = malloc( len )))
+    {
+        fclose( file );
+        return NULL;
+    }
+    *size = fread( data, 1, len, file );
+    fclose( file );
+    return data;
+}
+
+static enum shader_type get_shader_type( const DWORD *data, SIZE_T size )
+{
+    const DWORD *chunk;
+    DWORD i, count, offset;
+
+    if (size < sizeof(DWORD)) return SHADER_TYPE_UNKNOWN;
+
+    if (data[0] != TAG_DXBC)
+    {
+        /* D3D9 bytecode starts with the version token */
+        switch (data[0] >> 16)
+        {
+            case 0xfffe: return SHADER_TYPE_VERTEX;
+            case 0xffff: return SHADER_TYPE_PIXEL;
+            default: return SHADER_TYPE_UNKNOWN;
+        }
+    }
+
+    /* DXBC header: tag, checksum, version, total size, chunk count, chunk offsets */
+    if (size < 8 * sizeof(DWORD)) return SHADER_TYPE_UNKNOWN;
+    count = data[7];
+    if (count > (size - 8 * sizeof(DWORD)) / sizeof(DWORD)) return SHADER_TYPE_UNKNOWN;
+
+    for (i = 0; i < count; i++)
+    {
+        offset = data[8 + i];
+        if (offset % sizeof(DWORD) || offset > size - 3 * sizeof(DWORD)) continue;
+        chunk = data + offset / sizeof(DWORD);
+        if (chunk[0] != TAG_SHDR && chunk[0] != TAG_SHEX) continue;
+        /* the program type is in the high word of the version token */
+        switch (chunk[2] >> 16)
+        {
+            case 0: return SHADER_TYPE_PIXEL;
+            case 1: return SHADER_TYPE_VERTEX;
+            default: return SHADER_TYPE_UNKNOWN;
+        }
+    }
+    return SHADER_TYPE_UNKNOWN;
+}
+
+static double elapsed_ms( const LARGE_INTEGER *start, const LARGE_INTEGER *end )
+{
+    LARGE_INTEGER freq;
+
+    QueryPerformanceFrequency( &freq );
+    return (end->QuadPart - start->QuadPart) * 1000.0 / freq.QuadPart;
+}
+
+static void write_source( const char *name, const char *source, unsigned int size )
+{
+    const char *base;
+    char path[MAX_PATH];
+    FILE *file;
+
+    if ((base = strrchr( name, '\\' )) || (base = strrchr( name, '/' ))) base++;
+    else base = name;
+    if (snprintf( path, sizeof(path), "%s\\%s.glsl", output_dir, base ) >= sizeof(path)) return;
+
+    if (!(file = fopen( path, "wb" )))
+    {
+        fprintf( stderr, "shadertranslate: cannot create %s\n", path );
+        return;
+    }
+    fwrite( source, 1, size - 1, file );
+    fclose( file );
+}
+
+static BOOL translate_file( const char *name )
+{
+    struct wined3d_shader_desc desc;
+    struct wined3d_shader *shader;
+    LARGE_INTEGER start, end;
+    double create_ms, total_ms = 0.0, min_ms = 0.0, ms;
+    enum shader_type type;
+    unsigned int i, size;
+    char *source;
+    SIZE_T data_size;
+    void *data;
+    HRESULT hr;
+
+    if (!(data = load_file( name, &data_size )))
+    {
+        fprintf( stderr, "shadertranslate: cannot read %s\n", name );
+        return FALSE;
+    }
+    if (!(type = get_shader_type( data, data_size )))
+    {
+        fprintf( stderr, "shadertranslate: %s is not a vertex or pixel shader\n", name );
+        free( data );
+        return FALSE;
+    }
+
+    desc.byte_code = data;
+    desc.byte_code_size = data_size;
+    QueryPerformanceCounter( &start );
+    if (type == SHADER_TYPE_VERTEX)
+        hr = wined3d_shader_create_vs( device, &desc, NULL, &null_parent_ops, &shader );
+    else
+        hr = wined3d_shader_create_ps( device, &desc, NULL, &null_parent_ops, &shader );
+    QueryPerformanceCounter( &end );
+    free( data );
+    if (FAILED(hr))
+    {
+        fprintf( stderr, "shadertranslate: failed to create a shader from %s, hr %#x\n", name, hr );
+        return FALSE;
+    }
+    create_ms = elapsed_ms( &start, &end );
+
+    if (FAILED(hr = wined3d_shader_translate( shader, NULL, &size )) || !(source = malloc( size )))
+    {
+        fprintf( stderr, "shadertranslate: failed to translate %s, hr %#x\n", name, hr );
+        wined3d_shader_decref( shader );
+        return FALSE;
+    }
+
+    for (i = 0; i < iterations; i++)
+    {
+        QueryPerformanceCounter( &start );
+        hr = wined3d_shader_translate( shader, source, &size );
+        QueryPerformanceCounter( &end );
+        if (FAILED(hr)) break;
+        ms = elapsed_ms( &start, &end );
+        total_ms += ms;
+        if (!i || ms < min_ms) min_ms = ms;
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        printf( "%-40s %-2s %8u %10.3f %10.3f %10.3f %8u\n", name, type == SHADER_TYPE_VERTEX ? "vs" : "ps",
+                (unsigned int)data_size, create_ms, min_ms, total_ms / iterations, size - 1 );
+        if (output_dir) write_source( name, source, size );
+    }
+    else
+        fprintf( stderr, "shadertranslate: failed to translate %s, hr %#x\n", name, hr );
+
+    free( source );
+    wined3d_shader_decref( shader );
+    return SUCCEEDED(hr);
+}
+
+int main( int argc, char *argv[] )
+{
+    struct wined3d_swapchain *swapchain;
+    unsigned int i, count = 0, failed = 0;
+    struct wined3d *wined3d;
+    char *value;
+    HWND window;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (argv[i][0] != '-') break;
+        if (!strcmp( argv[i], "-n" ) && i + 1 < argc) iterations = atoi( argv[++i] );
+        else if (!strcmp( argv[i], "-o" ) && i + 1 < argc) output_dir = argv[++i];
+        else if (!strcmp( argv[i], "-r" ) && i + 1 < argc) i++;
+        else usage();
+    }
+    if (i == argc || !iterations) usage();
+
+    window = CreateWindowA( "static", "shadertranslate", WS_OVERLAPPEDWINDOW, 0, 0, 64, 64,
+                            NULL, NULL, NULL, NULL );
+    if (!(wined3d = wined3d_create( 0 )) || !(swapchain = create_device( wined3d, window )))
+    {
+        fprintf( stderr, "shadertranslate: cannot initialize wined3d\n" );
+        return 1;
+    }
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++)
+    {
+        if (strcmp( argv[i++], "-r" )) continue;
+        if (!(value = strchr( argv[i], '=' ))) usage();
+        wined3d_device_set_render_state( device, strtoul( argv[i], NULL, 0 ), strtoul( value + 1, NULL, 0 ) );
+    }
+
+    printf( "%-40s %-2s %8s %10s %10s %10s %8s\n", "shader", "", "bytes", "create ms", "min ms", "avg ms", "output" );
+    for (; i < argc; i++)
+    {
+        if (!translate_file( argv[i] )) failed++;
+        count++;
+    }
+    printf( "%u shaders, %u failed\n", count, failed );
+
+    wined3d_swapchain_decref( swapchain );
+    wined3d_device_decref( device );
+    wined3d_decref( wined3d );
+    DestroyWindow( window );
+    return failed ? 1 : 0;
+}
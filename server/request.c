@@ -293,6 +293,101 @@ static void send_reply( union generic_reply *reply )
         fatal_protocol_error( current, "reply write: %s\n", strerror( errno ));
 }
 
+/* execute a batch of requests, see struct batch_header */
+DECL_HANDLER(batch)
+{
+    struct thread *thread = current;
+    const char *data = get_req_data();
+    const char *end = data + get_req_data_size();
+    void *batch_data = current->req_data;
+    union generic_request batch_req = current->req;
+    union generic_reply prev_reply;
+    data_size_t max_size = get_reply_max_size(), size = 0, len;
+    char *replies = NULL;
+    unsigned int count = 0;
+    enum request type;
+
+    if (max_size && !(replies = mem_alloc( max_size ))) return;
+
+    while (data < end)
+    {
+        const struct batch_header *header = (const struct batch_header *)data;
+        union generic_reply sub_reply;
+
+        if (count >= MAX_BATCH_REQUESTS ||
+            end - data < sizeof(*header) + sizeof(union generic_request))
+        {
+            set_error( STATUS_INVALID_PARAMETER );
+            break;
+        }
+        memcpy( &thread->req, header + 1, sizeof(thread->req) );
+        data += sizeof(*header) + sizeof(union generic_request);
+
+        type = thread->req.request_header.req;
+        if (type >= REQ_NB_REQUESTS || type == REQ_batch || type == REQ_select ||
+            thread->req.request_header.request_size > end - data ||
+            sizeof(union generic_reply) + ((thread->req.request_header.reply_size + 7) & ~7) > max_size - size)
+        {
+            set_error( STATUS_INVALID_PARAMETER );
+            break;
+        }
+        if (header->link_req)
+        {
+            if (!count || header->link_req < sizeof(struct request_header) ||
+                header->link_req > sizeof(union generic_request) - sizeof(obj_handle_t) ||
+                header->link_reply < sizeof(struct reply_header) ||
+                header->link_reply > sizeof(union generic_reply) - sizeof(obj_handle_t))
+            {
+                set_error( STATUS_INVALID_PARAMETER );
+                break;
+            }
+            memcpy( (char *)&thread->req + header->link_req,
+                    (char *)&prev_reply + header->link_reply, sizeof(obj_handle_t) );
+        }
+
+        thread->req_data = (void *)data;
+        thread->reply_size = 0;
+        clear_error();
+        memset( &sub_reply, 0, sizeof(sub_reply) );
+        if (debug_level) trace_request();
+
+        req_handlers[type]( &thread->req, &sub_reply );
+
+        if (!current) break;  /* the thread has been killed */
+
+        sub_reply.reply_header.error = current->error;
+        sub_reply.reply_header.reply_size = current->reply_size;
+        if (debug_level) trace_reply( type, &sub_reply );
+
+        memcpy( replies + size, &sub_reply, sizeof(sub_reply) );
+        size += sizeof(sub_reply);
+        len = (current->reply_size + 7) & ~7;
+        if (current->reply_size) memcpy( replies + size, current->reply_data, current->reply_size );
+        memset( replies + size + current->reply_size, 0, len - current->reply_size );
+        size += len;
+        free( current->reply_data );
+        current->reply_data = NULL;
+
+        prev_reply = sub_reply;
+        data += (thread->req.request_header.request_size + 7) & ~7;
+        count++;
+        if (sub_reply.reply_header.error) break;
+    }
+
+    /* restore the batch request so that it can be freed and replied to normally */
+    thread->req = batch_req;
+    thread->req_data = batch_data;
+    thread->reply_size = 0;
+    if (!current)
+    {
+        free( replies );
+        return;
+    }
+    reply->count = count;
+    if (size) set_reply_data_ptr( replies, size );
+    else free( replies );
+}
+
 /* call a request handler */
 static void call_req_handler( struct thread *thread )
 {
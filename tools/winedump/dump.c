@@ -239,6 +239,7 @@ dumpers[] =
     {SIG_EMF,           get_kind_emf,   emf_dump},
     {SIG_FNT,           get_kind_fnt,   fnt_dump},
     {SIG_TLB,           get_kind_tlb,   tlb_dump},
+    {SIG_RELAY,         get_kind_relay, relay_dump},
     {SIG_UNKNOWN,       NULL,           NULL} /* sentinel */
 };
 
@@ -0,0 +1,346 @@
+/*
+ * Dump a binary relay trace file
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "config.h"
+#include "wine/port.h"
+#include "winedump.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "wine/relay.h"
+
+#define MAX_DEPTH 256
+
+struct relay_module
+{
+    const char   *dllname;
+    unsigned int  base;
+    unsigned int  count;
+    const char  **names;
+    unsigned int *calls;
+    ULONGLONG    *time;
+};
+
+struct relay_frame
+{
+    unsigned int module;
+    unsigned int ordinal;
+    ULONGLONG    start;     /* time of the call */
+    ULONGLONG    children;  /* time spent in nested calls */
+};
+
+struct relay_thread
+{
+    DWORD              tid;
+    unsigned int       depth;
+    struct relay_frame frames[MAX_DEPTH];
+};
+
+struct folded_stack
+{
+    struct folded_stack *next;
+    ULONGLONG            time;
+    char                 name[1];
+};
+
+static struct relay_module *modules;
+static unsigned int nb_modules;
+static struct relay_thread *threads;
+static unsigned int nb_threads;
+static struct folded_stack *folded_hash[4096];
+static ULONGLONG frequency;
+
+static const char *get_func_name( unsigned int module, unsigned int ordinal )
+{
+    static char buffer[16];
+
+    if (module >= nb_modules || !modules[module].names) sprintf( buffer, "%u", ordinal );
+    else if (ordinal >= modules[module].count || !modules[module].names[ordinal][0])
+        sprintf( buffer, "%u", modules[module].base + ordinal );
+    else return modules[module].names[ordinal];
+    return buffer;
+}
+
+static const char *get_dll_name( unsigned int module )
+{
+    if (module < nb_modules && modules[module].dllname) return modules[module].dllname;
+    return "?";
+}
+
+static double get_seconds( ULONGLONG time )
+{
+    return frequency ? (double)time / frequency : 0.0;
+}
+
+static struct relay_thread *get_thread( DWORD tid )
+{
+    unsigned int i;
+
+    for (i = 0; i < nb_threads; i++) if (threads[i].tid == tid) return &threads[i];
+    threads = realloc( threads, (nb_threads + 1) * sizeof(*threads) );
+    memset( &threads[nb_threads], 0, sizeof(*threads) );
+    threads[nb_threads].tid = tid;
+    return &threads[nb_threads++];
+}
+
+static void add_folded_stack( const struct relay_thread *thread, ULONGLONG time )
+{
+    char buffer[4096];
+    unsigned int i, hash = 0, len = 0;
+    struct folded_stack *stack;
+    const char *p;
+
+    for (i = 0; i < thread->depth && i < MAX_DEPTH; i++)
+    {
+        len += snprintf( buffer + len, sizeof(buffer) - len, "%s%s.%s", i ? ";" : "",
+                         get_dll_name( thread->frames[i].module ),
+                         get_func_name( thread->frames[i].module, thread->frames[i].ordinal ));
+        if (len >= sizeof(buffer)) return;
+    }
+    for (p = buffer; *p; p++) hash = hash * 31 + (unsigned char)*p;
+    hash %= ARRAY_SIZE(folded_hash);
+
+    for (stack = folded_hash[hash]; stack; stack = stack->next)
+        if (!strcmp( stack->name, buffer )) break;
+    if (!stack)
+    {
+        stack = malloc( sizeof(*stack) + len );
+        strcpy( stack->name, buffer );
+        stack->time = 0;
+        stack->next = folded_hash[hash];
+        folded_hash[hash] = stack;
+    }
+    stack->time += time;
+}
+
+static void dump_module_block( const struct relay_trace_block *block, const char *data )
+{
+    const char *end = data + block->size;
+    struct relay_module *module;
+    unsigned int i;
+
+    if (block->id >= nb_modules)
+    {
+        modules = realloc( modules, (block->id + 1) * sizeof(*modules) );
+        memset( modules + nb_modules, 0, (block->id + 1 - nb_modules) * sizeof(*modules) );
+        nb_modules = block->id + 1;
+    }
+    if (block->size < sizeof(DWORD) + 1) return;
+    module = &modules[block->id];
+    module->base = *(const DWORD *)data;
+    module->dllname = data + sizeof(DWORD);
+    module->count = block->count;
+    module->names = calloc( block->count, sizeof(*module->names) );
+    module->calls = calloc( block->count, sizeof(*module->calls) );
+    module->time = calloc( block->count, sizeof(*module->time) );
+
+    data = module->dllname + strlen( module->dllname ) + 1;
+    for (i = 0; i < block->count && data < end; i++)
+    {
+        module->names[i] = data;
+        data += strlen( data ) + 1;
+    }
+    for ( ; i < block->count; i++) module->names[i] = "";
+
+    if (!globals.dumpsect) printf( "Module %u: %s, %u entry points\n", block->id, module->dllname, block->count );
+}
+
+static void dump_records_block( const struct relay_trace_block *block, const struct relay_trace_record *record )
+{
+    struct relay_thread *thread = get_thread( block->id );
+    BOOL folded = globals.dumpsect && !strcmp( globals.dumpsect, "folded" );
+    BOOL stats = globals.dumpsect && !strcmp( globals.dumpsect, "stats" );
+    unsigned int i;
+
+    for (i = 0; i < block->count; i++, record++)
+    {
+        if (!stats && !folded)
+        {
+            unsigned int indent = record->type == RELAY_RECORD_CALL ? thread->depth : thread->depth - 1;
+
+            printf( "%04x:%12.6f:%*s%s %s.%s() %s=", block->id, get_seconds( record->time ),
+                    min( indent, 64 ) * 2, "", record->type == RELAY_RECORD_CALL ? "Call" : "Ret ",
+                    get_dll_name( record->module ), get_func_name( record->module, record->ordinal ),
+                    record->type == RELAY_RECORD_CALL ? "ret" : "retval" );
+            if (record->value >> 32)
+                printf( "%x%08x\n", (unsigned int)(record->value >> 32), (unsigned int)record->value );
+            else
+                printf( "%08x\n", (unsigned int)record->value );
+        }
+
+        if (record->type == RELAY_RECORD_CALL)
+        {
+            if (thread->depth < MAX_DEPTH)
+            {
+                struct relay_frame *frame = &thread->frames[thread->depth];
+                frame->module   = record->module;
+                frame->ordinal  = record->ordinal;
+                frame->start    = record->time;
+                frame->children = 0;
+            }
+            thread->depth++;
+        }
+        else if (thread->depth > MAX_DEPTH) thread->depth--;
+        else
+        {
+            struct relay_frame *frame;
+            unsigned int depth;
+            ULONGLONG time;
+
+            /* skip frames left behind by exceptions unwinding through relayed calls */
+            for (depth = thread->depth; depth; depth--)
+            {
+                frame = &thread->frames[depth - 1];
+                if (frame->module == record->module && frame->ordinal == record->ordinal) break;
+            }
+            if (!depth) continue;
+            thread->depth = depth;
+            time = record->time - frame->start;
+
+            if (frame->module < nb_modules && frame->ordinal < modules[frame->module].count)
+            {
+                modules[frame->module].calls[frame->ordinal]++;
+                modules[frame->module].time[frame->ordinal] += time;
+            }
+            if (folded) add_folded_stack( thread, time - frame->children );
+            thread->depth--;
+            if (thread->depth) thread->frames[thread->depth - 1].children += time;
+        }
+    }
+}
+
+struct relay_stat
+{
+    unsigned int module;
+    unsigned int ordinal;
+};
+
+static int compare_stats( const void *a, const void *b )
+{
+    const struct relay_stat *stat1 = a, *stat2 = b;
+    ULONGLONG time1 = modules[stat1->module].time[stat1->ordinal];
+    ULONGLONG time2 = modules[stat2->module].time[stat2->ordinal];
+
+    if (time1 != time2) return time1 > time2 ? -1 : 1;
+    return 0;
+}
+
+static void dump_stats(void)
+{
+    struct relay_stat *stats;
+    unsigned int i, j, count = 0;
+
+    for (i = 0; i < nb_modules; i++)
+        for (j = 0; j < modules[i].count; j++) if (modules[i].calls[j]) count++;
+
+    stats = malloc( count * sizeof(*stats) );
+    count = 0;
+    for (i = 0; i < nb_modules; i++)
+    {
+        for (j = 0; j < modules[i].count; j++)
+        {
+            if (!modules[i].calls[j]) continue;
+            stats[count].module = i;
+            stats[count].ordinal = j;
+            count++;
+        }
+    }
+    qsort( stats, count, sizeof(*stats), compare_stats );
+
+    printf( "%12s %14s %12s  %s\n", "calls", "total(s)", "avg(us)", "function" );
+    for (i = 0; i < count; i++)
+    {
+        unsigned int calls = modules[stats[i].module].calls[stats[i].ordinal];
+        ULONGLONG time = modules[stats[i].module].time[stats[i].ordinal];
+
+        printf( "%12u %14.6f %12.3f  %s.%s\n", calls, get_seconds( time ),
+                get_seconds( time ) * 1000000 / calls, get_dll_name( stats[i].module ),
+                get_func_name( stats[i].module, stats[i].ordinal ));
+    }
+    free( stats );
+}
+
+static void dump_folded(void)
+{
+    const struct folded_stack *stack;
+    unsigned int i;
+
+    /* one line per call stack with its self time in microseconds, as used by flamegraph.pl */
+    for (i = 0; i < ARRAY_SIZE(folded_hash); i++)
+        for (stack = folded_hash[i]; stack; stack = stack->next)
+            printf( "%s %.0f\n", stack->name, get_seconds( stack->time ) * 1000000 );
+}
+
+enum FileSig get_kind_relay(void)
+{
+    const struct relay_trace_header *hdr;
+
+    hdr = PRD(0, sizeof(*hdr));
+    if (hdr && hdr->magic == RELAY_TRACE_MAGIC) return SIG_RELAY;
+    return SIG_UNKNOWN;
+}
+
+void relay_dump(void)
+{
+    const struct relay_trace_header *hdr = PRD(0, sizeof(*hdr));
+    const struct relay_trace_block *block;
+    unsigned long pos = sizeof(*hdr);
+
+    if (hdr->version != RELAY_TRACE_VERSION)
+    {
+        printf( "Unsupported relay trace version %u\n", hdr->version );
+        return;
+    }
+    frequency = hdr->frequency;
+    if (!globals.dumpsect)
+        printf( "Relay trace of process %04x, %.0f ticks per second\n\n",
+                hdr->pid, (double)hdr->frequency );
+
+    while ((block = PRD(pos, sizeof(*block))))
+    {
+        const void *data = PRD(pos + sizeof(*block), block->size);
+
+        if (!data)
+        {
+            printf( "Truncated block at offset %lx\n", pos );
+            break;
+        }
+        switch (block->type)
+        {
+        case RELAY_BLOCK_MODULE:
+            dump_module_block( block, data );
+            break;
+        case RELAY_BLOCK_RECORDS:
+            dump_records_block( block, data );
+            break;
+        default:
+            printf( "Unknown block type %u at offset %lx\n", block->type, pos );
+            break;
+        }
+        pos += sizeof(*block) + block->size;
+    }
+
+    if (!globals.dumpsect) return;
+    if (!strcmp( globals.dumpsect, "stats" )) dump_stats();
+    else if (!strcmp( globals.dumpsect, "folded" )) dump_folded();
+}